@@ -0,0 +1,137 @@
+/****************************************************************************
+ * apps/benchmarks/focbench/focbench.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_BENCHMARKS_FOCBENCH_FOCBENCH_H
+#define __APPS_BENCHMARKS_FOCBENCH_FOCBENCH_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Simulated motor.  The constants are chosen so that they can also be
+ * represented with reasonable accuracy in fixed16.
+ */
+
+#define FOCBENCH_MODEL_POLES  (4)
+#define FOCBENCH_MODEL_RES    (0.5f)
+#define FOCBENCH_MODEL_IND    (0.001f)
+#define FOCBENCH_MODEL_INER   (0.001f)
+#define FOCBENCH_MODEL_FLUX   (0.05f)
+#define FOCBENCH_MODEL_LOAD   (0.0f)
+#define FOCBENCH_VBUS         (48.0f)
+
+/* Current controller gains for about 2000 rad/s bandwidth */
+
+#define FOCBENCH_FOC_KP       (2.0f)
+#define FOCBENCH_FOC_KI       (0.1f)
+
+/* Velocity controller, the output is the Q current reference */
+
+#define FOCBENCH_VEL_KP       (0.04f)
+#define FOCBENCH_VEL_KI       (0.0001f)
+#define FOCBENCH_IQ_MAX       (2.0f)
+
+#define FOCBENCH_PWM_DUTY_MAX (0.95f)
+
+/* A settled loop tracks well inside these RMS errors.  Fixed16 overflow
+ * wraps or saturates instead of producing NaN, so a larger error is taken
+ * as divergence.  The velocity bound is relative to the set point, with a
+ * floor for set points close to zero, so that a motor which never spins
+ * up fails too.
+ */
+
+#define FOCBENCH_IQ_ERR_MAX   (FOCBENCH_IQ_MAX)
+#define FOCBENCH_VEL_ERR_REL  (0.2f)
+#define FOCBENCH_VEL_ERR_MIN  (1.0f)
+
+/****************************************************************************
+ * Public Type Definition
+ ****************************************************************************/
+
+/* Benchmark configuration */
+
+struct focbench_cfg_s
+{
+  uint32_t iterations;          /* Number of control periods */
+  float    vel;                 /* Electrical velocity set point */
+};
+
+/* Tracking error statistics */
+
+struct focbench_err_s
+{
+  float sum_sq;                 /* Sum of squared errors */
+  float max;                    /* Maximum absolute error */
+};
+
+/* Benchmark results */
+
+struct focbench_result_s
+{
+  /* Execution time of one control period in perf ticks */
+
+  uint32_t              ticks_min;
+  uint32_t              ticks_max;
+  uint64_t              ticks_sum;
+  uint64_t              ticks_sum_sq;
+  uint32_t              samples;
+
+  /* Tracking errors over the settled part of the run */
+
+  uint32_t              err_samples;
+  struct focbench_err_s iq;     /* Q current vs. reference (A) */
+  struct focbench_err_s vel;    /* Velocity vs. set point (rad/s) */
+  struct focbench_err_s smo;    /* SMO angle vs. model (rad) */
+  struct focbench_err_s nfo;    /* NFO angle vs. model (rad) */
+  struct focbench_err_s div;    /* DIV velocity vs. model (rad/s) */
+  struct focbench_err_s pll;    /* PLL velocity vs. model (rad/s) */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+void focbench_result_init(FAR struct focbench_result_s *res);
+void focbench_ticks_add(FAR struct focbench_result_s *res, uint32_t ticks);
+void focbench_err_add(FAR struct focbench_err_s *err, float val);
+float focbench_angle_err(float angle, float ref);
+
+#ifdef CONFIG_INDUSTRY_FOC_FLOAT
+int focbench_f32(FAR const struct focbench_cfg_s *cfg,
+                 FAR struct focbench_result_s *res);
+#endif
+
+#ifdef CONFIG_INDUSTRY_FOC_FIXED16
+int focbench_b16(FAR const struct focbench_cfg_s *cfg,
+                 FAR struct focbench_result_s *res);
+#endif
+
+#endif /* __APPS_BENCHMARKS_FOCBENCH_FOCBENCH_H */
@@ -0,0 +1,466 @@
+/****************************************************************************
+ * apps/benchmarks/focbench/focbench_b16.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <nuttx/clock.h>
+
+#include "industry/foc/fixed16/foc_handler.h"
+#include "industry/foc/fixed16/foc_angle.h"
+#include "industry/foc/fixed16/foc_velocity.h"
+#include "industry/foc/fixed16/foc_model.h"
+
+#include "focbench.h"
+
+/****************************************************************************
+ * Private Type Definition
+ ****************************************************************************/
+
+struct focbench_b16_s
+{
+  foc_handler_b16_t             handler;
+  foc_model_b16_t               model;
+  foc_angle_b16_t               smo;
+  foc_angle_b16_t               nfo;
+  foc_velocity_b16_t            div;
+  foc_velocity_b16_t            pll;
+  pid_controller_b16_t          vel_pi;
+  struct motor_phy_params_b16_s phy;
+  struct foc_model_state_b16_s  model_state;
+  struct foc_state_b16_s        foc_state;
+  b16_t                         per;
+  b16_t                         angle;      /* Model electrical angle */
+  b16_t                         iq_ref;
+  b16_t                         angle_smo;
+  b16_t                         angle_nfo;
+  b16_t                         vel_div;
+  b16_t                         vel_pll;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_b16_init
+ ****************************************************************************/
+
+static int focbench_b16_init(FAR struct focbench_b16_s *b)
+{
+  struct foc_initdata_b16_s       ctrl_cfg;
+  struct foc_mod_cfg_b16_s        mod_cfg;
+  struct foc_model_pmsm_cfg_b16_s pmsm_cfg;
+  struct foc_angle_osmo_cfg_b16_s smo_cfg;
+  struct foc_angle_onfo_cfg_b16_s nfo_cfg;
+  struct foc_vel_div_b16_cfg_s    div_cfg;
+  struct foc_vel_pll_b16_cfg_s    pll_cfg;
+  int                             ret = OK;
+
+  DEBUGASSERT(b);
+
+  /* Motor parameters known to the controller, the same as the model */
+
+  motor_phy_params_init_b16(&b->phy,
+                            FOCBENCH_MODEL_POLES,
+                            ftob16(FOCBENCH_MODEL_RES),
+                            ftob16(FOCBENCH_MODEL_IND),
+                            ftob16(FOCBENCH_MODEL_FLUX));
+
+  /* FOC current controller */
+
+  ret = foc_handler_init_b16(&b->handler,
+                             &g_foc_control_pi_b16,
+                             &g_foc_mod_svm3_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_handler_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  ctrl_cfg.id_kp = ftob16(FOCBENCH_FOC_KP);
+  ctrl_cfg.id_ki = ftob16(FOCBENCH_FOC_KI);
+  ctrl_cfg.iq_kp = ftob16(FOCBENCH_FOC_KP);
+  ctrl_cfg.iq_ki = ftob16(FOCBENCH_FOC_KI);
+
+  mod_cfg.pwm_duty_max = ftob16(FOCBENCH_PWM_DUTY_MAX);
+
+  foc_handler_cfg_b16(&b->handler, &ctrl_cfg, &mod_cfg);
+
+  /* Velocity controller */
+
+  pi_controller_init_b16(&b->vel_pi,
+                         ftob16(FOCBENCH_VEL_KP),
+                         ftob16(FOCBENCH_VEL_KI));
+  pi_saturation_set_b16(&b->vel_pi,
+                        -ftob16(FOCBENCH_IQ_MAX),
+                        ftob16(FOCBENCH_IQ_MAX));
+  pi_antiwindup_enable_b16(&b->vel_pi, ftob16(0.99f), true);
+
+  /* PMSM model */
+
+  ret = foc_model_init_b16(&b->model, &g_foc_model_pmsm_ops_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_model_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  pmsm_cfg.poles      = FOCBENCH_MODEL_POLES;
+  pmsm_cfg.res        = ftob16(FOCBENCH_MODEL_RES);
+  pmsm_cfg.ind        = ftob16(FOCBENCH_MODEL_IND);
+  pmsm_cfg.iner       = ftob16(FOCBENCH_MODEL_INER);
+  pmsm_cfg.flux_link  = ftob16(FOCBENCH_MODEL_FLUX);
+  pmsm_cfg.ind_d      = ftob16(FOCBENCH_MODEL_IND);
+  pmsm_cfg.ind_q      = ftob16(FOCBENCH_MODEL_IND);
+  pmsm_cfg.per        = b->per;
+  pmsm_cfg.iphase_adc = b16ONE;
+
+  ret = foc_model_cfg_b16(&b->model, &pmsm_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_model_cfg_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* SMO angle observer */
+
+  ret = foc_angle_init_b16(&b->smo, &g_foc_angle_osmo_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  smo_cfg.per     = b->per;
+  smo_cfg.k_slide = ftob16(CONFIG_BENCHMARK_FOCBENCH_SMO_KSLIDE / 1000.0f);
+  smo_cfg.err_max = ftob16(CONFIG_BENCHMARK_FOCBENCH_SMO_ERRMAX / 1000.0f);
+  memcpy(&smo_cfg.phy, &b->phy, sizeof(struct motor_phy_params_b16_s));
+
+  ret = foc_angle_cfg_b16(&b->smo, &smo_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_cfg_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* NFO angle observer */
+
+  ret = foc_angle_init_b16(&b->nfo, &g_foc_angle_onfo_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  nfo_cfg.per       = b->per;
+  nfo_cfg.gain      = ftob16(CONFIG_BENCHMARK_FOCBENCH_NFO_GAIN / 1.0f);
+  nfo_cfg.gain_slow = ftob16(CONFIG_BENCHMARK_FOCBENCH_NFO_GAINSLOW / 1.0f);
+  memcpy(&nfo_cfg.phy, &b->phy, sizeof(struct motor_phy_params_b16_s));
+
+  ret = foc_angle_cfg_b16(&b->nfo, &nfo_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_cfg_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* DIV velocity observer */
+
+  ret = foc_velocity_init_b16(&b->div, &g_foc_velocity_odiv_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  div_cfg.samples = CONFIG_BENCHMARK_FOCBENCH_DIV_SAMPLES;
+  div_cfg.filter  = ftob16(CONFIG_BENCHMARK_FOCBENCH_DIV_FILTER / 1000.0f);
+  div_cfg.per     = b->per;
+
+  ret = foc_velocity_cfg_b16(&b->div, &div_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_cfg_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* PLL velocity observer */
+
+  ret = foc_velocity_init_b16(&b->pll, &g_foc_velocity_opll_b16);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_init_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+  pll_cfg.kp  = ftob16(CONFIG_BENCHMARK_FOCBENCH_PLL_KP / 1.0f);
+  pll_cfg.ki  = ftob16(CONFIG_BENCHMARK_FOCBENCH_PLL_KI / 1.0f);
+  pll_cfg.per = b->per;
+
+  ret = foc_velocity_cfg_b16(&b->pll, &pll_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_cfg_b16 failed %d\n", ret);
+      goto errout;
+    }
+
+errout:
+  return ret;
+}
+
+/****************************************************************************
+ * Name: focbench_b16_deinit
+ ****************************************************************************/
+
+static void focbench_b16_deinit(FAR struct focbench_b16_s *b)
+{
+  DEBUGASSERT(b);
+
+  /* Handlers that were never initialized have no ops */
+
+  if (b->pll.ops)
+    {
+      foc_velocity_deinit_b16(&b->pll);
+    }
+
+  if (b->div.ops)
+    {
+      foc_velocity_deinit_b16(&b->div);
+    }
+
+  if (b->nfo.ops)
+    {
+      foc_angle_deinit_b16(&b->nfo);
+    }
+
+  if (b->smo.ops)
+    {
+      foc_angle_deinit_b16(&b->smo);
+    }
+
+  if (b->model.ops)
+    {
+      foc_model_deinit_b16(&b->model);
+    }
+
+  if (b->handler.ops.ctrl)
+    {
+      foc_handler_deinit_b16(&b->handler);
+    }
+}
+
+/****************************************************************************
+ * Name: focbench_b16_control
+ *
+ * Description:
+ *   One control period, this is the part that is timed.
+ *
+ ****************************************************************************/
+
+static int focbench_b16_control(FAR struct focbench_b16_s *b, b16_t vel)
+{
+  struct foc_handler_input_b16_s  in;
+  struct foc_handler_output_b16_s out;
+  struct foc_angle_in_b16_s       ain;
+  struct foc_angle_out_b16_s      aout;
+  struct foc_velocity_in_b16_s    vin;
+  struct foc_velocity_out_b16_s   vout;
+  dq_frame_b16_t                  dq_ref;
+  dq_frame_b16_t                  vdq_comp;
+  int                             ret = OK;
+
+  /* Velocity controller */
+
+  b->iq_ref = pi_controller_b16(&b->vel_pi,
+                                vel - b->model_state.omega_e);
+
+  /* Current controller */
+
+  dq_ref.d   = 0;
+  dq_ref.q   = b->iq_ref;
+  vdq_comp.d = 0;
+  vdq_comp.q = 0;
+
+  in.current  = b->model_state.curr;
+  in.dq_ref   = &dq_ref;
+  in.vdq_comp = &vdq_comp;
+  in.angle    = b->angle;
+  in.vbus     = ftob16(FOCBENCH_VBUS);
+  in.mode     = FOC_HANDLER_MODE_CURRENT;
+
+  ret = foc_handler_run_b16(&b->handler, &in, &out);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  foc_handler_state_b16(&b->handler, &b->foc_state, NULL);
+
+  /* Angle observers */
+
+  ain.state = &b->foc_state;
+  ain.angle = b->angle;
+  ain.vel   = b->model_state.omega_e;
+  ain.dir   = DIR_CW_B16;
+
+  ret = foc_angle_run_b16(&b->smo, &ain, &aout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->angle_smo = aout.angle;
+
+  ret = foc_angle_run_b16(&b->nfo, &ain, &aout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->angle_nfo = aout.angle;
+
+  /* Velocity observers */
+
+  vin.state = &b->foc_state;
+  vin.angle = b->angle;
+  vin.vel   = b->model_state.omega_e;
+  vin.dir   = DIR_CW_B16;
+
+  ret = foc_velocity_run_b16(&b->div, &vin, &vout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->vel_div = vout.velocity;
+
+  ret = foc_velocity_run_b16(&b->pll, &vin, &vout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->vel_pll = vout.velocity;
+
+errout:
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_b16
+ *
+ * Description:
+ *   Run the closed-loop benchmark with the fixed16 controller
+ *
+ ****************************************************************************/
+
+int focbench_b16(FAR const struct focbench_cfg_s *cfg,
+                 FAR struct focbench_result_s *res)
+{
+  struct focbench_b16_s b;
+  b16_t                 vel   = ftob16(cfg->vel);
+  clock_t               start = 0;
+  uint32_t              i     = 0;
+  int                   ret   = OK;
+
+  DEBUGASSERT(cfg);
+  DEBUGASSERT(res);
+
+  memset(&b, 0, sizeof(b));
+  focbench_result_init(res);
+
+  b.per = b16divi(b16ONE, CONFIG_BENCHMARK_FOCBENCH_FREQ);
+
+  ret = focbench_b16_init(&b);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  for (i = 0; i < cfg->iterations; i++)
+    {
+      /* Sample the model, the rotor angle is the integral of the model
+       * velocity since the model state does not provide it.
+       */
+
+      foc_model_state_b16(&b.model, &b.model_state);
+
+      b.angle += b16mulb16(b.model_state.omega_e, b.per);
+      angle_norm_2pi_b16(&b.angle, MOTOR_ANGLE_E_MIN_B16,
+                         MOTOR_ANGLE_E_MAX_B16);
+
+      start = perf_gettime();
+
+      ret = focbench_b16_control(&b, vel);
+
+      focbench_ticks_add(res, perf_gettime() - start);
+
+      if (ret < 0)
+        {
+          printf("ERROR: focbench_b16_control failed %d\n", ret);
+          goto errout;
+        }
+
+      /* Tracking errors once the velocity has settled */
+
+      if (i >= cfg->iterations / 2)
+        {
+          focbench_err_add(&res->iq,
+                           b16tof(b.iq_ref - b.model_state.idq.q));
+          focbench_err_add(&res->vel,
+                           b16tof(vel - b.model_state.omega_e));
+          focbench_err_add(&res->smo,
+                           focbench_angle_err(b16tof(b.angle_smo),
+                                              b16tof(b.angle)));
+          focbench_err_add(&res->nfo,
+                           focbench_angle_err(b16tof(b.angle_nfo),
+                                              b16tof(b.angle)));
+          focbench_err_add(&res->div,
+                           b16tof(b.vel_div - b.model_state.omega_e));
+          focbench_err_add(&res->pll,
+                           b16tof(b.vel_pll - b.model_state.omega_e));
+          res->err_samples++;
+        }
+
+      /* Feed the model with the voltage requested by the controller */
+
+      foc_model_run_b16(&b.model, ftob16(FOCBENCH_MODEL_LOAD),
+                        &b.foc_state.vab);
+    }
+
+errout:
+  focbench_b16_deinit(&b);
+  return ret;
+}
@@ -0,0 +1,457 @@
+/****************************************************************************
+ * apps/benchmarks/focbench/focbench_f32.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <nuttx/clock.h>
+
+#include "industry/foc/float/foc_handler.h"
+#include "industry/foc/float/foc_angle.h"
+#include "industry/foc/float/foc_velocity.h"
+#include "industry/foc/float/foc_model.h"
+
+#include "focbench.h"
+
+/****************************************************************************
+ * Private Type Definition
+ ****************************************************************************/
+
+struct focbench_f32_s
+{
+  foc_handler_f32_t             handler;
+  foc_model_f32_t               model;
+  foc_angle_f32_t               smo;
+  foc_angle_f32_t               nfo;
+  foc_velocity_f32_t            div;
+  foc_velocity_f32_t            pll;
+  pid_controller_f32_t          vel_pi;
+  struct motor_phy_params_f32_s phy;
+  struct foc_model_state_f32_s  model_state;
+  struct foc_state_f32_s        foc_state;
+  float                         per;
+  float                         angle;      /* Model electrical angle */
+  float                         iq_ref;
+  float                         angle_smo;
+  float                         angle_nfo;
+  float                         vel_div;
+  float                         vel_pll;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_f32_init
+ ****************************************************************************/
+
+static int focbench_f32_init(FAR struct focbench_f32_s *b)
+{
+  struct foc_initdata_f32_s       ctrl_cfg;
+  struct foc_mod_cfg_f32_s        mod_cfg;
+  struct foc_model_pmsm_cfg_f32_s pmsm_cfg;
+  struct foc_angle_osmo_cfg_f32_s smo_cfg;
+  struct foc_angle_onfo_cfg_f32_s nfo_cfg;
+  struct foc_vel_div_f32_cfg_s    div_cfg;
+  struct foc_vel_pll_f32_cfg_s    pll_cfg;
+  int                             ret = OK;
+
+  DEBUGASSERT(b);
+
+  /* Motor parameters known to the controller, the same as the model */
+
+  motor_phy_params_init(&b->phy,
+                        FOCBENCH_MODEL_POLES,
+                        FOCBENCH_MODEL_RES,
+                        FOCBENCH_MODEL_IND,
+                        FOCBENCH_MODEL_FLUX);
+
+  /* FOC current controller */
+
+  ret = foc_handler_init_f32(&b->handler,
+                             &g_foc_control_pi_f32,
+                             &g_foc_mod_svm3_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_handler_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  ctrl_cfg.id_kp = FOCBENCH_FOC_KP;
+  ctrl_cfg.id_ki = FOCBENCH_FOC_KI;
+  ctrl_cfg.iq_kp = FOCBENCH_FOC_KP;
+  ctrl_cfg.iq_ki = FOCBENCH_FOC_KI;
+
+  mod_cfg.pwm_duty_max = FOCBENCH_PWM_DUTY_MAX;
+
+  foc_handler_cfg_f32(&b->handler, &ctrl_cfg, &mod_cfg);
+
+  /* Velocity controller */
+
+  pi_controller_init(&b->vel_pi, FOCBENCH_VEL_KP, FOCBENCH_VEL_KI);
+  pi_saturation_set(&b->vel_pi, -FOCBENCH_IQ_MAX, FOCBENCH_IQ_MAX);
+  pi_antiwindup_enable(&b->vel_pi, 0.99f, true);
+
+  /* PMSM model */
+
+  ret = foc_model_init_f32(&b->model, &g_foc_model_pmsm_ops_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_model_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  pmsm_cfg.poles      = FOCBENCH_MODEL_POLES;
+  pmsm_cfg.res        = FOCBENCH_MODEL_RES;
+  pmsm_cfg.ind        = FOCBENCH_MODEL_IND;
+  pmsm_cfg.iner       = FOCBENCH_MODEL_INER;
+  pmsm_cfg.flux_link  = FOCBENCH_MODEL_FLUX;
+  pmsm_cfg.ind_d      = FOCBENCH_MODEL_IND;
+  pmsm_cfg.ind_q      = FOCBENCH_MODEL_IND;
+  pmsm_cfg.per        = b->per;
+  pmsm_cfg.iphase_adc = 1.0f;
+
+  ret = foc_model_cfg_f32(&b->model, &pmsm_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_model_cfg_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* SMO angle observer */
+
+  ret = foc_angle_init_f32(&b->smo, &g_foc_angle_osmo_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  smo_cfg.per     = b->per;
+  smo_cfg.k_slide = (CONFIG_BENCHMARK_FOCBENCH_SMO_KSLIDE / 1000.0f);
+  smo_cfg.err_max = (CONFIG_BENCHMARK_FOCBENCH_SMO_ERRMAX / 1000.0f);
+  memcpy(&smo_cfg.phy, &b->phy, sizeof(struct motor_phy_params_f32_s));
+
+  ret = foc_angle_cfg_f32(&b->smo, &smo_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_cfg_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* NFO angle observer */
+
+  ret = foc_angle_init_f32(&b->nfo, &g_foc_angle_onfo_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  nfo_cfg.per       = b->per;
+  nfo_cfg.gain      = (CONFIG_BENCHMARK_FOCBENCH_NFO_GAIN / 1.0f);
+  nfo_cfg.gain_slow = (CONFIG_BENCHMARK_FOCBENCH_NFO_GAINSLOW / 1.0f);
+  memcpy(&nfo_cfg.phy, &b->phy, sizeof(struct motor_phy_params_f32_s));
+
+  ret = foc_angle_cfg_f32(&b->nfo, &nfo_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_angle_cfg_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* DIV velocity observer */
+
+  ret = foc_velocity_init_f32(&b->div, &g_foc_velocity_odiv_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  div_cfg.samples = CONFIG_BENCHMARK_FOCBENCH_DIV_SAMPLES;
+  div_cfg.filter  = (CONFIG_BENCHMARK_FOCBENCH_DIV_FILTER / 1000.0f);
+  div_cfg.per     = b->per;
+
+  ret = foc_velocity_cfg_f32(&b->div, &div_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_cfg_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  /* PLL velocity observer */
+
+  ret = foc_velocity_init_f32(&b->pll, &g_foc_velocity_opll_f32);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_init_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+  pll_cfg.kp  = (CONFIG_BENCHMARK_FOCBENCH_PLL_KP / 1.0f);
+  pll_cfg.ki  = (CONFIG_BENCHMARK_FOCBENCH_PLL_KI / 1.0f);
+  pll_cfg.per = b->per;
+
+  ret = foc_velocity_cfg_f32(&b->pll, &pll_cfg);
+  if (ret < 0)
+    {
+      printf("ERROR: foc_velocity_cfg_f32 failed %d\n", ret);
+      goto errout;
+    }
+
+errout:
+  return ret;
+}
+
+/****************************************************************************
+ * Name: focbench_f32_deinit
+ ****************************************************************************/
+
+static void focbench_f32_deinit(FAR struct focbench_f32_s *b)
+{
+  DEBUGASSERT(b);
+
+  /* Handlers that were never initialized have no ops */
+
+  if (b->pll.ops)
+    {
+      foc_velocity_deinit_f32(&b->pll);
+    }
+
+  if (b->div.ops)
+    {
+      foc_velocity_deinit_f32(&b->div);
+    }
+
+  if (b->nfo.ops)
+    {
+      foc_angle_deinit_f32(&b->nfo);
+    }
+
+  if (b->smo.ops)
+    {
+      foc_angle_deinit_f32(&b->smo);
+    }
+
+  if (b->model.ops)
+    {
+      foc_model_deinit_f32(&b->model);
+    }
+
+  if (b->handler.ops.ctrl)
+    {
+      foc_handler_deinit_f32(&b->handler);
+    }
+}
+
+/****************************************************************************
+ * Name: focbench_f32_control
+ *
+ * Description:
+ *   One control period, this is the part that is timed.
+ *
+ ****************************************************************************/
+
+static int focbench_f32_control(FAR struct focbench_f32_s *b, float vel)
+{
+  struct foc_handler_input_f32_s  in;
+  struct foc_handler_output_f32_s out;
+  struct foc_angle_in_f32_s       ain;
+  struct foc_angle_out_f32_s      aout;
+  struct foc_velocity_in_f32_s    vin;
+  struct foc_velocity_out_f32_s   vout;
+  dq_frame_f32_t                  dq_ref;
+  dq_frame_f32_t                  vdq_comp;
+  int                             ret = OK;
+
+  /* Velocity controller */
+
+  b->iq_ref = pi_controller(&b->vel_pi, vel - b->model_state.omega_e);
+
+  /* Current controller */
+
+  dq_ref.d   = 0.0f;
+  dq_ref.q   = b->iq_ref;
+  vdq_comp.d = 0.0f;
+  vdq_comp.q = 0.0f;
+
+  in.current  = b->model_state.curr;
+  in.dq_ref   = &dq_ref;
+  in.vdq_comp = &vdq_comp;
+  in.angle    = b->angle;
+  in.vbus     = FOCBENCH_VBUS;
+  in.mode     = FOC_HANDLER_MODE_CURRENT;
+
+  ret = foc_handler_run_f32(&b->handler, &in, &out);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  foc_handler_state_f32(&b->handler, &b->foc_state, NULL);
+
+  /* Angle observers */
+
+  ain.state = &b->foc_state;
+  ain.angle = b->angle;
+  ain.vel   = b->model_state.omega_e;
+  ain.dir   = DIR_CW;
+
+  ret = foc_angle_run_f32(&b->smo, &ain, &aout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->angle_smo = aout.angle;
+
+  ret = foc_angle_run_f32(&b->nfo, &ain, &aout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->angle_nfo = aout.angle;
+
+  /* Velocity observers */
+
+  vin.state = &b->foc_state;
+  vin.angle = b->angle;
+  vin.vel   = b->model_state.omega_e;
+  vin.dir   = DIR_CW;
+
+  ret = foc_velocity_run_f32(&b->div, &vin, &vout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->vel_div = vout.velocity;
+
+  ret = foc_velocity_run_f32(&b->pll, &vin, &vout);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  b->vel_pll = vout.velocity;
+
+errout:
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_f32
+ *
+ * Description:
+ *   Run the closed-loop benchmark with the float controller
+ *
+ ****************************************************************************/
+
+int focbench_f32(FAR const struct focbench_cfg_s *cfg,
+                 FAR struct focbench_result_s *res)
+{
+  struct focbench_f32_s b;
+  clock_t               start = 0;
+  uint32_t              i     = 0;
+  int                   ret   = OK;
+
+  DEBUGASSERT(cfg);
+  DEBUGASSERT(res);
+
+  memset(&b, 0, sizeof(b));
+  focbench_result_init(res);
+
+  b.per = (1.0f / CONFIG_BENCHMARK_FOCBENCH_FREQ);
+
+  ret = focbench_f32_init(&b);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  for (i = 0; i < cfg->iterations; i++)
+    {
+      /* Sample the model, the rotor angle is the integral of the model
+       * velocity since the model state does not provide it.
+       */
+
+      foc_model_state_f32(&b.model, &b.model_state);
+
+      b.angle += b.model_state.omega_e * b.per;
+      angle_norm_2pi(&b.angle, MOTOR_ANGLE_E_MIN, MOTOR_ANGLE_E_MAX);
+
+      start = perf_gettime();
+
+      ret = focbench_f32_control(&b, cfg->vel);
+
+      focbench_ticks_add(res, perf_gettime() - start);
+
+      if (ret < 0)
+        {
+          printf("ERROR: focbench_f32_control failed %d\n", ret);
+          goto errout;
+        }
+
+      /* Tracking errors once the velocity has settled */
+
+      if (i >= cfg->iterations / 2)
+        {
+          focbench_err_add(&res->iq,
+                           b.iq_ref - b.model_state.idq.q);
+          focbench_err_add(&res->vel,
+                           cfg->vel - b.model_state.omega_e);
+          focbench_err_add(&res->smo,
+                           focbench_angle_err(b.angle_smo, b.angle));
+          focbench_err_add(&res->nfo,
+                           focbench_angle_err(b.angle_nfo, b.angle));
+          focbench_err_add(&res->div,
+                           b.vel_div - b.model_state.omega_e);
+          focbench_err_add(&res->pll,
+                           b.vel_pll - b.model_state.omega_e);
+          res->err_samples++;
+        }
+
+      /* Feed the model with the voltage requested by the controller */
+
+      foc_model_run_f32(&b.model, FOCBENCH_MODEL_LOAD,
+                        &b.foc_state.vab);
+    }
+
+errout:
+  focbench_f32_deinit(&b);
+  return ret;
+}
@@ -0,0 +1,270 @@
+/****************************************************************************
+ * apps/benchmarks/focbench/focbench_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nuttx/clock.h>
+
+#include "focbench.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_help
+ ****************************************************************************/
+
+static void focbench_help(void)
+{
+  printf("Usage: focbench [-n iterations] [-v velocity]\n");
+  printf("  -n  number of control periods (default %d)\n",
+         CONFIG_BENCHMARK_FOCBENCH_ITERATIONS);
+  printf("  -v  electrical velocity set point in rad/s (default %.3f)\n",
+         CONFIG_BENCHMARK_FOCBENCH_VEL / 1000.0);
+}
+
+/****************************************************************************
+ * Name: focbench_err_print
+ ****************************************************************************/
+
+static void focbench_err_print(FAR const char *name,
+                               FAR const struct focbench_err_s *err,
+                               uint32_t samples)
+{
+  printf("  %-14s rms %10.4f  max %10.4f\n", name,
+         sqrtf(err->sum_sq / samples), err->max);
+}
+
+/****************************************************************************
+ * Name: focbench_print
+ *
+ * Description:
+ *   Print the results and check that the loop did not diverge
+ *
+ ****************************************************************************/
+
+static int focbench_print(FAR const char *name,
+                          FAR const struct focbench_cfg_s *cfg,
+                          FAR const struct focbench_result_s *res)
+{
+  struct timespec ts;
+  double          mean;
+  double          var;
+
+  mean = (double)res->ticks_sum / res->samples;
+  var  = (double)res->ticks_sum_sq / res->samples - mean * mean;
+  perf_convert((clock_t)mean, &ts);
+
+  printf("%s:\n", name);
+  printf("  ticks/iter     mean %10.1f  min %" PRIu32 "  max %" PRIu32
+         "\n", mean, res->ticks_min, res->ticks_max);
+  printf("  jitter         p-p %" PRIu32 "  stddev %.1f\n",
+         res->ticks_max - res->ticks_min, var > 0.0 ? sqrt(var) : 0.0);
+  printf("  time/iter      %" PRIu64 " ns\n",
+         (uint64_t)((uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec));
+
+  if (res->err_samples == 0)
+    {
+      return OK;
+    }
+
+  printf("  tracking error over %" PRIu32 " samples:\n", res->err_samples);
+  focbench_err_print("iq [A]", &res->iq, res->err_samples);
+  focbench_err_print("vel [rad/s]", &res->vel, res->err_samples);
+  focbench_err_print("smo [rad]", &res->smo, res->err_samples);
+  focbench_err_print("nfo [rad]", &res->nfo, res->err_samples);
+  focbench_err_print("div [rad/s]", &res->div, res->err_samples);
+  focbench_err_print("pll [rad/s]", &res->pll, res->err_samples);
+
+  /* A diverged loop shows up as NaN or Inf in float, and as a tracking
+   * error out of bounds in both float and fixed16
+   */
+
+  if (!isfinite(res->iq.sum_sq) || !isfinite(res->vel.sum_sq) ||
+      sqrtf(res->iq.sum_sq / res->err_samples) > FOCBENCH_IQ_ERR_MAX ||
+      sqrtf(res->vel.sum_sq / res->err_samples) >
+      fmaxf(fabsf(cfg->vel) * FOCBENCH_VEL_ERR_REL, FOCBENCH_VEL_ERR_MIN))
+    {
+      printf("  ERROR: control loop diverged\n");
+      return -ERANGE;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: focbench_result_init
+ ****************************************************************************/
+
+void focbench_result_init(FAR struct focbench_result_s *res)
+{
+  memset(res, 0, sizeof(struct focbench_result_s));
+
+  res->ticks_min = UINT32_MAX;
+}
+
+/****************************************************************************
+ * Name: focbench_ticks_add
+ ****************************************************************************/
+
+void focbench_ticks_add(FAR struct focbench_result_s *res, uint32_t ticks)
+{
+  if (ticks < res->ticks_min)
+    {
+      res->ticks_min = ticks;
+    }
+
+  if (ticks > res->ticks_max)
+    {
+      res->ticks_max = ticks;
+    }
+
+  res->ticks_sum    += ticks;
+  res->ticks_sum_sq += (uint64_t)ticks * ticks;
+  res->samples      += 1;
+}
+
+/****************************************************************************
+ * Name: focbench_err_add
+ ****************************************************************************/
+
+void focbench_err_add(FAR struct focbench_err_s *err, float val)
+{
+  err->sum_sq += val * val;
+
+  if (fabsf(val) > err->max)
+    {
+      err->max = fabsf(val);
+    }
+}
+
+/****************************************************************************
+ * Name: focbench_angle_err
+ *
+ * Description:
+ *   Get the angle error wrapped to [-pi, pi]
+ *
+ ****************************************************************************/
+
+float focbench_angle_err(float angle, float ref)
+{
+  float err = fmodf(angle - ref, 2.0f * M_PI_F);
+
+  if (err > M_PI_F)
+    {
+      err -= 2.0f * M_PI_F;
+    }
+  else if (err < -M_PI_F)
+    {
+      err += 2.0f * M_PI_F;
+    }
+
+  return err;
+}
+
+/****************************************************************************
+ * Name: main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct focbench_result_s res;
+  struct focbench_cfg_s    cfg;
+  int                      ret = OK;
+  int                      opt;
+
+  cfg.iterations = CONFIG_BENCHMARK_FOCBENCH_ITERATIONS;
+  cfg.vel        = (CONFIG_BENCHMARK_FOCBENCH_VEL / 1000.0f);
+
+  while ((opt = getopt(argc, argv, "n:v:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            cfg.iterations = strtoul(optarg, NULL, 0);
+            break;
+          case 'v':
+            cfg.vel = strtof(optarg, NULL);
+            break;
+          case 'h':
+            focbench_help();
+            return EXIT_SUCCESS;
+          default:
+            focbench_help();
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (cfg.iterations == 0)
+    {
+      focbench_help();
+      return EXIT_FAILURE;
+    }
+
+  printf("focbench: %" PRIu32 " iterations at %d Hz, velocity %.3f rad/s\n",
+         cfg.iterations, CONFIG_BENCHMARK_FOCBENCH_FREQ, cfg.vel);
+
+#ifdef CONFIG_INDUSTRY_FOC_FLOAT
+  ret = focbench_f32(&cfg, &res);
+  if (ret >= 0)
+    {
+      ret = focbench_print("float", &cfg, &res);
+    }
+
+  if (ret < 0)
+    {
+      return EXIT_FAILURE;
+    }
+#endif
+
+#ifdef CONFIG_INDUSTRY_FOC_FIXED16
+  ret = focbench_b16(&cfg, &res);
+  if (ret >= 0)
+    {
+      ret = focbench_print("fixed16", &cfg, &res);
+    }
+
+  if (ret < 0)
+    {
+      return EXIT_FAILURE;
+    }
+#endif
+
+  return EXIT_SUCCESS;
+}
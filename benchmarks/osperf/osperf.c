@@ -25,10 +25,14 @@
  ****************************************************************************/
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <mqueue.h>
 #include <pthread.h>
 #include <sched.h>
 #include <semaphore.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -37,9 +41,36 @@
 #include <string.h>
 #include <sys/param.h>
 #include <sys/poll.h>
+#include <unistd.h>
+
+#ifdef CONFIG_EVENT_FD
+#  include <sys/eventfd.h>
+#endif
+
+#ifdef CONFIG_TIMER_FD
+#  include <sys/timerfd.h>
+#endif
 
 #include <nuttx/sched.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_BENCHMARK_OSPERF_COUNT
+#  define CONFIG_BENCHMARK_OSPERF_COUNT 100
+#endif
+
+#ifndef CONFIG_BENCHMARK_OSPERF_THREADS
+#  define CONFIG_BENCHMARK_OSPERF_THREADS 4
+#endif
+
+#define PERFORMANCE_MAXTHREADS  32
+
+#define PERFORMANCE_TEXT        0
+#define PERFORMANCE_CSV         1
+#define PERFORMANCE_JSON        2
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -56,10 +87,18 @@ struct performance_thread_s
   struct performance_time_s time;
 };
 
+struct performance_mutex_s
+{
+  pthread_mutex_t mutex;
+  struct performance_time_s time;
+};
+
 struct performance_entry_s
 {
   const char name[NAME_MAX];
   CODE size_t (*entry)(void);
+  bool csection;              /* Run inside a critical section */
+  bool threads;               /* Uses the -t thread count */
 };
 
 /****************************************************************************
@@ -74,6 +113,22 @@ static size_t poll_performance(void);
 static size_t pipe_performance(void);
 static size_t semwait_performance(void);
 static size_t sempost_performance(void);
+static size_t mutex_performance(void);
+#ifndef CONFIG_DISABLE_MQUEUE
+static size_t mqueue_performance(void);
+#endif
+#ifdef CONFIG_EVENT_FD
+static size_t eventfd_performance(void);
+#endif
+#ifndef CONFIG_DISABLE_SIGNALS
+static size_t signal_performance(void);
+#endif
+#ifdef CONFIG_TIMER_FD
+static size_t timerfd_performance(void);
+#endif
+#ifdef CONFIG_SMP
+static size_t crosscpu_performance(void);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -81,16 +136,36 @@ static size_t sempost_performance(void);
 
 static const struct performance_entry_s g_entry_list[] =
 {
-  {"pthread-create", pthread_create_performance},
-  {"pthread-switch", pthread_switch_performance},
-  {"context-switch", context_switch_performance},
-  {"hpwork", hpwork_performance},
-  {"poll-write", poll_performance},
-  {"pipe-rw", pipe_performance},
-  {"semwait", semwait_performance},
-  {"sempost", sempost_performance},
+  {"pthread-create", pthread_create_performance, true},
+  {"pthread-switch", pthread_switch_performance, true},
+  {"context-switch", context_switch_performance, true},
+  {"hpwork", hpwork_performance, true},
+  {"poll-write", poll_performance, true},
+  {"pipe-rw", pipe_performance, true},
+  {"semwait", semwait_performance, true},
+  {"sempost", sempost_performance, true},
+  {"mutex-handover", mutex_performance, true, true},
+#ifndef CONFIG_DISABLE_MQUEUE
+  {"mqueue", mqueue_performance, true},
+#endif
+#ifdef CONFIG_EVENT_FD
+  {"eventfd", eventfd_performance, true},
+#endif
+#ifndef CONFIG_DISABLE_SIGNALS
+  {"signal", signal_performance, true},
+#endif
+#ifdef CONFIG_TIMER_FD
+  {"timerfd-latency", timerfd_performance, true},
+#endif
+#ifdef CONFIG_SMP
+  {"crosscpu-wakeup", crosscpu_performance, false},
+#endif
 };
 
+/* Number of threads waiting in the mutex hand-over test */
+
+static int g_nthreads = CONFIG_BENCHMARK_OSPERF_THREADS;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -354,6 +429,259 @@ static size_t sempost_performance(void)
   return performance_gettime(&result);
 }
 
+/****************************************************************************
+ * mutex hand-over performance
+ ****************************************************************************/
+
+static FAR void *mutex_task(FAR void *arg)
+{
+  FAR struct performance_mutex_s *perf = arg;
+
+  pthread_mutex_lock(&perf->mutex);
+  performance_end(&perf->time);
+  pthread_mutex_unlock(&perf->mutex);
+  return NULL;
+}
+
+static size_t mutex_performance(void)
+{
+  struct performance_mutex_s perf;
+  pthread_t tid[PERFORMANCE_MAXTHREADS];
+  int i;
+
+  /* The waiters have a higher priority and block on the held mutex.  The
+   * mutex is then passed from one waiter to the next, they never spin on
+   * it at the same time, and the time is until the last of them has got
+   * it.
+   */
+
+  pthread_mutex_init(&perf.mutex, NULL);
+  pthread_mutex_lock(&perf.mutex);
+
+  for (i = 0; i < g_nthreads; i++)
+    {
+      tid[i] = performance_thread_create(mutex_task, &perf,
+                                         CONFIG_BENCHMARK_OSPERF_PRIORITY +
+                                         1);
+    }
+
+  performance_start(&perf.time);
+  pthread_mutex_unlock(&perf.mutex);
+
+  for (i = 0; i < g_nthreads; i++)
+    {
+      pthread_join(tid[i], NULL);
+    }
+
+  pthread_mutex_destroy(&perf.mutex);
+  return performance_gettime(&perf.time);
+}
+
+/****************************************************************************
+ * mqueue performance
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_MQUEUE
+static FAR void *mqueue_task(FAR void *arg)
+{
+  FAR void **argv = arg;
+  FAR struct performance_time_s *time = argv[0];
+  mqd_t mq = (mqd_t)(uintptr_t)argv[1];
+  char r;
+
+  mq_receive(mq, &r, 1, NULL);
+  performance_end(time);
+  return NULL;
+}
+
+static size_t mqueue_performance(void)
+{
+  struct performance_time_s result;
+  struct mq_attr attr;
+  FAR void *argv[2];
+  pthread_t tid;
+  mqd_t mq;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.mq_maxmsg  = 1;
+  attr.mq_msgsize = 1;
+
+  mq = mq_open("/osperf", O_RDWR | O_CREAT, 0666, &attr);
+  DEBUGASSERT(mq != (mqd_t)-1);
+  argv[0] = &result;
+  argv[1] = (FAR void *)(uintptr_t)mq;
+
+  tid = performance_thread_create(mqueue_task, argv,
+                                  CONFIG_BENCHMARK_OSPERF_PRIORITY + 1);
+
+  performance_start(&result);
+  mq_send(mq, "a", 1, 0);
+  pthread_join(tid, NULL);
+
+  mq_close(mq);
+  mq_unlink("/osperf");
+  return performance_gettime(&result);
+}
+#endif
+
+/****************************************************************************
+ * eventfd performance
+ ****************************************************************************/
+
+#ifdef CONFIG_EVENT_FD
+static FAR void *eventfd_task(FAR void *arg)
+{
+  FAR void **argv = arg;
+  FAR struct performance_time_s *time = argv[0];
+  int fd = (int)(uintptr_t)argv[1];
+  eventfd_t value;
+
+  eventfd_read(fd, &value);
+  performance_end(time);
+  return NULL;
+}
+
+static size_t eventfd_performance(void)
+{
+  struct performance_time_s result;
+  FAR void *argv[2];
+  pthread_t tid;
+  int fd;
+
+  fd = eventfd(0, 0);
+  DEBUGASSERT(fd >= 0);
+  argv[0] = &result;
+  argv[1] = (FAR void *)(uintptr_t)fd;
+
+  tid = performance_thread_create(eventfd_task, argv,
+                                  CONFIG_BENCHMARK_OSPERF_PRIORITY + 1);
+
+  performance_start(&result);
+  eventfd_write(fd, 1);
+  pthread_join(tid, NULL);
+
+  close(fd);
+  return performance_gettime(&result);
+}
+#endif
+
+/****************************************************************************
+ * signal performance
+ ****************************************************************************/
+
+#ifndef CONFIG_DISABLE_SIGNALS
+static FAR void *signal_task(FAR void *arg)
+{
+  FAR struct performance_time_s *time = arg;
+  sigset_t set;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  sigwaitinfo(&set, NULL);
+  performance_end(time);
+  return NULL;
+}
+
+static size_t signal_performance(void)
+{
+  struct performance_time_s result;
+  sigset_t oldset;
+  sigset_t set;
+  pthread_t tid;
+
+  /* The thread inherits the blocked SIGUSR1 and takes it in sigwaitinfo */
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &set, &oldset);
+
+  tid = performance_thread_create(signal_task, &result,
+                                  CONFIG_BENCHMARK_OSPERF_PRIORITY + 1);
+
+  performance_start(&result);
+  pthread_kill(tid, SIGUSR1);
+  pthread_join(tid, NULL);
+
+  pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+  return performance_gettime(&result);
+}
+#endif
+
+/****************************************************************************
+ * timerfd latency
+ ****************************************************************************/
+
+#ifdef CONFIG_TIMER_FD
+static size_t timerfd_performance(void)
+{
+  struct performance_time_s result;
+  struct itimerspec its;
+  uint64_t expired;
+  size_t elapsed;
+  int fd;
+
+  fd = timerfd_create(CLOCK_MONOTONIC, 0);
+  DEBUGASSERT(fd >= 0);
+
+  /* The time past the one tick timeout until the reader runs */
+
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_nsec = USEC_PER_TICK * NSEC_PER_USEC;
+
+  performance_start(&result);
+  timerfd_settime(fd, 0, &its, NULL);
+  read(fd, &expired, sizeof(expired));
+  performance_end(&result);
+
+  close(fd);
+  elapsed = performance_gettime(&result);
+  return elapsed > its.it_value.tv_nsec ?
+         elapsed - its.it_value.tv_nsec : 0;
+}
+#endif
+
+/****************************************************************************
+ * cross CPU wakeup performance
+ ****************************************************************************/
+
+#ifdef CONFIG_SMP
+static size_t crosscpu_performance(void)
+{
+  struct performance_thread_s perf;
+  struct sched_param param;
+  pthread_attr_t attr;
+  cpu_set_t cpuset;
+  pthread_t tid;
+
+  /* Wake up a thread waiting on the next CPU, without the critical section
+   * that would hold it off until this thread blocks.
+   */
+
+  sem_init(&perf.sem, 0, 0);
+
+  CPU_ZERO(&cpuset);
+  CPU_SET((sched_getcpu() + 1) % CONFIG_SMP_NCPUS, &cpuset);
+
+  param.sched_priority = CONFIG_BENCHMARK_OSPERF_PRIORITY + 1;
+  pthread_attr_init(&attr);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  pthread_attr_setschedparam(&attr, &param);
+  pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+  pthread_create(&tid, &attr, pthread_switch_task, &perf);
+
+  /* Give the thread time to block */
+
+  usleep(USEC_PER_TICK);
+
+  performance_start(&perf.time);
+  sem_post(&perf.sem);
+  pthread_join(tid, NULL);
+
+  sem_destroy(&perf.sem);
+  return performance_gettime(&perf.time);
+}
+#endif
+
 /****************************************************************************
  * performance_help
  ****************************************************************************/
@@ -362,49 +690,120 @@ static void performance_help(void)
 {
   printf("Usage: performance [OPTIONS] [name]\n\n");
   printf("OPTIONS:\n");
-  printf("\t-c, \tNumber of times to run each test\n");
+  printf("\t-c, \tNumber of times to run each test (default %d)\n",
+         CONFIG_BENCHMARK_OSPERF_COUNT);
   printf("\t-d, \tShow detail of each test\n");
+  printf("\t-f, \tOutput format: text, csv or json\n");
+  printf("\t-t, \tThreads in the mutex-handover test, 1..%d "
+         "(default %d)\n",
+         PERFORMANCE_MAXTHREADS, CONFIG_BENCHMARK_OSPERF_THREADS);
   printf("\t-h, \tShow this help message\n");
   printf("\t-l, \tList all tests\n");
 }
 
+/****************************************************************************
+ * performance_compare
+ ****************************************************************************/
+
+static int performance_compare(FAR const void *a, FAR const void *b)
+{
+  size_t x = *(FAR const size_t *)a;
+  size_t y = *(FAR const size_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/****************************************************************************
+ * performance_percentile
+ *
+ * Nearest rank of the sorted samples, permille is 500 for the median.
+ *
+ ****************************************************************************/
+
+static size_t performance_percentile(FAR const size_t *samples,
+                                     size_t count, unsigned int permille)
+{
+  size_t rank = (count * permille + 999) / 1000;
+
+  return samples[rank > 0 ? rank - 1 : 0];
+}
+
 /****************************************************************************
  * performance_run
  ****************************************************************************/
 
 static void performance_run(const FAR struct performance_entry_s *item,
-                            size_t count, bool detail)
+                            FAR size_t *samples, size_t count, bool detail,
+                            int format, bool first)
 {
   size_t total = 0;
-  size_t max = 0;
-  size_t min = 0;
   size_t i;
 
   for (i = 0; i < count; i++)
     {
-      irqstate_t flags = enter_critical_section();
-      size_t time = item->entry();
-      leave_critical_section(flags);
-
-      total += time;
-      if (time > max)
+      if (item->csection)
         {
-          max = time;
+          irqstate_t flags = enter_critical_section();
+          samples[i] = item->entry();
+          leave_critical_section(flags);
         }
-
-      if (time < min || min == 0)
+      else
         {
-          min = time;
+          samples[i] = item->entry();
         }
 
-      if (detail)
+      total += samples[i];
+      if (detail && format == PERFORMANCE_TEXT)
         {
-          printf("\t%zu: %zu\n", i, time);
+          printf("\t%zu: %zu\n", i, samples[i]);
         }
     }
 
-  printf("%-*s %10zu %10zu %10zu\n", NAME_MAX, item->name, max, min,
-         total / count);
+  qsort(samples, count, sizeof(size_t), performance_compare);
+
+  switch (format)
+    {
+      case PERFORMANCE_CSV:
+        /* The threads column is left empty for single thread tests */
+
+        printf("%s,", item->name);
+        if (item->threads)
+          {
+            printf("%d", g_nthreads);
+          }
+
+        printf(",%zu,%zu,%zu,%zu,%zu,%zu,%zu\n", count, samples[0],
+               performance_percentile(samples, count, 500),
+               performance_percentile(samples, count, 990),
+               performance_percentile(samples, count, 999),
+               samples[count - 1], total / count);
+        break;
+
+      case PERFORMANCE_JSON:
+        printf("%s  {\"name\": \"%s\", ", first ? "" : ",\n", item->name);
+        if (item->threads)
+          {
+            printf("\"threads\": %d, ", g_nthreads);
+          }
+
+        printf("\"count\": %zu, \"min\": %zu, \"p50\": %zu, \"p99\": %zu, "
+               "\"p999\": %zu, \"max\": %zu, \"avg\": %zu}", count,
+               samples[0],
+               performance_percentile(samples, count, 500),
+               performance_percentile(samples, count, 990),
+               performance_percentile(samples, count, 999),
+               samples[count - 1], total / count);
+        break;
+
+      default:
+        printf("%-*s %10zu %10zu %10zu %10zu %10zu %10zu\n", NAME_MAX,
+               item->name, samples[0],
+               performance_percentile(samples, count, 500),
+               performance_percentile(samples, count, 990),
+               performance_percentile(samples, count, 999),
+               samples[count - 1], total / count);
+        break;
+    }
 }
 
 /****************************************************************************
@@ -444,12 +843,14 @@ void performance_list(void)
 int main(int argc, FAR char *argv[])
 {
   const FAR struct performance_entry_s *item = NULL;
+  FAR size_t *samples;
   bool detail = false;
-  size_t count = 100;
+  size_t count = CONFIG_BENCHMARK_OSPERF_COUNT;
+  int format = PERFORMANCE_TEXT;
   size_t i;
   int opt;
 
-  while ((opt = getopt(argc, argv, "dc:hl")) != -1)
+  while ((opt = getopt(argc, argv, "dc:f:t:hl")) != -1)
     {
       switch (opt)
         {
@@ -459,6 +860,28 @@ int main(int argc, FAR char *argv[])
           case 'c':
             count = strtoul(optarg, NULL, 0);
             break;
+          case 'f':
+            if (strcmp(optarg, "csv") == 0)
+              {
+                format = PERFORMANCE_CSV;
+              }
+            else if (strcmp(optarg, "json") == 0)
+              {
+                format = PERFORMANCE_JSON;
+              }
+            else if (strcmp(optarg, "text") == 0)
+              {
+                format = PERFORMANCE_TEXT;
+              }
+            else
+              {
+                performance_help();
+                return EXIT_FAILURE;
+              }
+            break;
+          case 't':
+            g_nthreads = atoi(optarg);
+            break;
           case 'h':
             performance_help();
             return EXIT_SUCCESS;
@@ -471,6 +894,12 @@ int main(int argc, FAR char *argv[])
         }
     }
 
+  if (count == 0 || g_nthreads < 1 || g_nthreads > PERFORMANCE_MAXTHREADS)
+    {
+      performance_help();
+      return EXIT_FAILURE;
+    }
+
   if (optind < argc)
     {
       item = find_entry(argv[optind]);
@@ -481,23 +910,54 @@ int main(int argc, FAR char *argv[])
         }
     }
 
-  printf("OS performance args: count:%zu, detail:%s\n", count,
-         detail ? "true" : "false");
+  samples = malloc(count * sizeof(size_t));
+  if (samples == NULL)
+    {
+      printf("No memory for %zu samples\n", count);
+      return EXIT_FAILURE;
+    }
+
+  /* All times are in ns */
 
-  printf("==============================================================\n");
-  printf("%-*s %10s %10s %10s\n", NAME_MAX, "Describe", "Max", "Min", "Avg");
+  switch (format)
+    {
+      case PERFORMANCE_CSV:
+        printf("name,threads,count,min,p50,p99,p99.9,max,avg\n");
+        break;
+
+      case PERFORMANCE_JSON:
+        printf("[\n");
+        break;
+
+      default:
+        printf("OS performance args: count:%zu, threads:%d, detail:%s\n",
+               count, g_nthreads, detail ? "true" : "false");
+
+        printf("============================================================"
+               "==================================\n");
+        printf("%-*s %10s %10s %10s %10s %10s %10s\n", NAME_MAX,
+               "Describe", "Min", "P50", "P99", "P99.9", "Max", "Avg");
+        break;
+    }
 
   if (item != NULL)
     {
-      performance_run(item, count, detail);
-      return EXIT_SUCCESS;
+      performance_run(item, samples, count, detail, format, true);
+    }
+  else
+    {
+      for (i = 0; i < nitems(g_entry_list); i++)
+        {
+          item = &g_entry_list[i];
+          performance_run(item, samples, count, detail, format, i == 0);
+        }
     }
 
-  for (i = 0; i < nitems(g_entry_list); i++)
+  if (format == PERFORMANCE_JSON)
     {
-      item = &g_entry_list[i];
-      performance_run(item, count, detail);
+      printf("\n]\n");
     }
 
+  free(samples);
   return EXIT_SUCCESS;
 }
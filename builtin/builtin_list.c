@@ -30,6 +30,10 @@
 #include <sys/param.h>
 
 #include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+
+#include "builtin/builtin.h"
 
 #include "builtin_proto.h"
 
@@ -68,3 +72,75 @@ const int g_builtin_count = nitems(g_builtins);
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
+
+/****************************************************************************
+ * Name: builtin_find
+ *
+ * Description:
+ *   Returns the index of a builtin application.  g_builtins[] is generated
+ *   sorted by name, so this is a binary search.  A list that is not sorted
+ *   (e.g. assembled by a host without 'sort') falls back to the linear
+ *   search of builtin_isavail().
+ *
+ * Input Parameter:
+ *   appname       - Name of the builtin application.
+ *
+ * Returned Value:
+ *   The index of the application, or -1 (ERROR) with errno set to ENOENT
+ *   if there is no such application.
+ *
+ ****************************************************************************/
+
+int builtin_find(FAR const char *appname)
+{
+  static int sorted = -1;
+  int lo = 0;
+  int hi = g_builtin_count - 1;
+  int mid;
+  int cmp;
+
+  /* The check has no side effects besides its result, concurrent first
+   * callers just compute the same value.
+   */
+
+  if (sorted < 0)
+    {
+      for (mid = 1; mid < hi; mid++)
+        {
+          if (strcmp(g_builtins[mid - 1].name, g_builtins[mid].name) > 0)
+            {
+              break;
+            }
+        }
+
+      sorted = mid >= hi;
+    }
+
+  if (!sorted)
+    {
+      return builtin_isavail(appname);
+    }
+
+  /* The last entry is the NULL terminator */
+
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      cmp = strcmp(appname, g_builtins[mid].name);
+      if (cmp == 0)
+        {
+          return mid;
+        }
+      else if (cmp < 0)
+        {
+          hi = mid;
+        }
+      else
+        {
+          lo = mid + 1;
+        }
+    }
+
+  errno = ENOENT;
+  return ERROR;
+}
@@ -69,7 +69,7 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
 
   /* Verify that an application with this name exists */
 
-  index = builtin_isavail(appname);
+  index = builtin_find(appname);
   if (index < 0)
     {
       ret = ENOENT;
@@ -31,6 +31,7 @@
 #include "crypto/controlse/chex_util.hxx"
 #include "crypto/controlse/cpublic_key.hxx"
 #include "crypto/controlse/csecure_element.hxx"
+#include "crypto/controlse/csecure_element_queue.hxx"
 #include "crypto/controlse/cstring.hxx"
 #include <errno.h>
 #include <fcntl.h>
@@ -40,8 +41,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef CONFIG_CRYPTO_CONTROLSE_SOFT_ELEMENT
+#include "crypto/controlse/csoft_secure_element.hxx"
+#endif
+
 #ifdef CONFIG_STACK_COLORATION
 #include <nuttx/arch.h>
 #include <nuttx/sched.h>
@@ -64,6 +70,13 @@
 #define RAW_KEY_BUFFER_SIZE 600
 #define DEFAULT_BUFFER_SIZE 1000
 
+// A queued request may still be executing while the queue is full again,
+// so the benchmark needs two signature buffers more than the queue depth
+
+#define BENCHMARK_QUEUE_DEPTH 4
+#define BENCHMARK_SLOTS (BENCHMARK_QUEUE_DEPTH + 2)
+#define BENCHMARK_SIGNATURE_SIZE 128
+
 //***************************************************************************
 // Private Types
 //**************************************************************************
@@ -82,6 +95,7 @@ typedef enum
   KEYSTORE_VERIFY_CERTIFICATE,
   KEYSTORE_GET_INFO,
   KEYSTORE_GET_UID,
+  KEYSTORE_BENCHMARK_SIGNATURE,
 } EKeystoreOperation;
 
 typedef enum
@@ -102,6 +116,7 @@ struct SSettings
   uint32_t key_id;
   uint32_t private_key_id;
   bool show_stack_used;
+  bool emulate;
 };
 
 //***************************************************************************
@@ -154,6 +169,10 @@ static void printUsage(FAR FILE *f, FAR char *prg)
   fprintf(f, "                      use with -a)\n");
   fprintf(f, "         -n <file>   (Read input from file)\n");
   fprintf(f, "         -N <file>   (Read signature from file)\n");
+  fprintf(f, "         -b <id>     (benchmark signatures\n");
+  fprintf(f, "                      with key at <id>)\n");
+  fprintf(f, "         -e          (use software emulated\n");
+  fprintf(f, "                      secure element)\n");
   fprintf(f, "         -i          (show generic information)\n");
   fprintf(f, "         -u          (show UID)\n");
   fprintf(f, "         -m          (show used stack memory space)\n");
@@ -186,7 +205,8 @@ static int parseArguments(int argc, FAR char *argv[],
   int result = 0;
   int opt;
   FAR char *prg = basename(argv[0]);
-  while (((opt = getopt(argc, argv, "iug:w:r:d:s:v:S:V:tca:p:n:N:mh")) != -1)
+  while (((opt = getopt(argc, argv,
+                        "iug:w:r:d:s:v:S:V:tca:p:n:N:b:emh")) != -1)
          && (result == 0))
     {
       switch (opt)
@@ -239,6 +259,17 @@ static int parseArguments(int argc, FAR char *argv[],
         case 'N':
           settings->signature_filename = optarg;
           break;
+        case 'b':
+          result = setOperation(settings, KEYSTORE_BENCHMARK_SIGNATURE,
+                                optarg);
+          break;
+        case 'e':
+#ifdef CONFIG_CRYPTO_CONTROLSE_SOFT_ELEMENT
+          settings->emulate = TRUE;
+#else
+          result = -ENOSYS;
+#endif
+          break;
         case 'm':
           settings->show_stack_used = TRUE;
           break;
@@ -372,10 +403,93 @@ static size_t addZeroTerminationCharacter(char *data, size_t content_size,
   return content_size;
 }
 
-static int process(int se05x_fd, FAR struct SSettings *settings)
+static unsigned long elapsedMilliseconds(FAR const struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000
+         + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void printThroughput(FAR const char *mode, int count,
+                            unsigned long ms)
+{
+  printf("%s: %d signatures in %lu ms", mode, count, ms);
+  if (ms > 0)
+    {
+      printf(", %lu per second", count * 1000ul / ms);
+    }
+
+  printf("\n");
+}
+
+static void signatureDone(bool result, FAR void *arg)
+{
+  if (!result)
+    {
+      (*static_cast<FAR int *>(arg))++;
+    }
+}
+
+// Sign the same hash CONFIG_CRYPTO_CONTROLSE_BENCHMARK_SIGNATURES times,
+// waiting for each signature and then through a request queue
+
+static int benchmarkSignatures(Controlse::ISecureElement &se,
+                               uint32_t key_id)
+{
+  const int count = CONFIG_CRYPTO_CONTROLSE_BENCHMARK_SIGNATURES;
+  uint8_t tbs_buffer[TBS_HASH_BUFFER_SIZE];
+  uint8_t signature_buffer[BENCHMARK_SLOTS][BENCHMARK_SIGNATURE_SIZE];
+  struct se05x_signature_s args[BENCHMARK_SLOTS];
+  struct timespec start;
+  int failed = 0;
+
+  memset(tbs_buffer, 0x5a, sizeof(tbs_buffer));
+  for (int i = 0; i < BENCHMARK_SLOTS; i++)
+    {
+      args[i] = {
+        .key_id = key_id,
+        .algorithm = SE05X_ALGORITHM_SHA256,
+        .tbs = { .buffer = tbs_buffer,
+                 .buffer_size = sizeof(tbs_buffer),
+                 .buffer_content_size = sizeof(tbs_buffer) },
+        .signature = { .buffer = signature_buffer[i],
+                       .buffer_size = sizeof(signature_buffer[i]) },
+      };
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; i++)
+    {
+      if (!se.CreateSignature(args[0]))
+        {
+          return -EPERM;
+        }
+    }
+
+  printThroughput("blocking", count, elapsedMilliseconds(&start));
+
+  Controlse::CSecureElementQueue queue(se, BENCHMARK_QUEUE_DEPTH);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < count; i++)
+    {
+      if (!queue.SubmitSignature(args[i % BENCHMARK_SLOTS], signatureDone,
+                                 &failed))
+        {
+          return -EPERM;
+        }
+    }
+
+  queue.Flush();
+  printThroughput("queued", count, elapsedMilliseconds(&start));
+
+  return failed == 0 ? 0 : -EPERM;
+}
+
+static int process(Controlse::ISecureElement &se,
+                   FAR struct SSettings *settings)
 {
   int result = 0;
-  Controlse::CSecureElement se(se05x_fd);
   if (settings->operation == KEYSTORE_GET_INFO)
     {
       struct se05x_info_s info;
@@ -664,6 +778,10 @@ static int process(int se05x_fd, FAR struct SSettings *settings)
           printf("Signature verified successfully\n");
         }
     }
+  else if (settings->operation == KEYSTORE_BENCHMARK_SIGNATURE)
+    {
+      result = benchmarkSignatures(se, settings->key_id);
+    }
 
   return result;
 }
@@ -677,6 +795,29 @@ int main(int argc, FAR char *argv[])
   struct SSettings settings = DEFAULT_SETTINGS;
   int result = parseArguments(argc, argv, &settings);
 
+#ifdef CONFIG_CRYPTO_CONTROLSE_SOFT_ELEMENT
+  if ((result == 0) && (!settings.skip_process) && settings.emulate)
+    {
+      // The emulated element starts empty, give the benchmark a key
+
+      Controlse::CSoftSecureElement se;
+      if (settings.operation == KEYSTORE_BENCHMARK_SIGNATURE)
+        {
+          struct se05x_generate_keypair_s args
+              = { .id = settings.key_id,
+                  .cipher = SE05X_ASYM_CIPHER_EC_NIST_P_256 };
+          result = se.GenerateKey(args) ? 0 : -EPERM;
+        }
+
+      if (result == 0)
+        {
+          result = process(se, &settings);
+        }
+
+      settings.skip_process = TRUE;
+    }
+#endif
+
   if ((result == 0) && (!settings.skip_process))
     {
       int fd = open(settings.se05x_dev_filename, O_RDONLY);
@@ -686,7 +827,8 @@ int main(int argc, FAR char *argv[])
         }
       else
         {
-          result = process(fd, &settings);
+          Controlse::CSecureElement se(fd);
+          result = process(se, &settings);
           close(fd);
         }
     }
@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 extern "C"
@@ -50,15 +51,45 @@ namespace Controlse
 CSecureElement::CSecureElement(const char *se05x_device)
     : se05x_fd(open(se05x_device, O_RDONLY)), close_device_at_destructor(true)
 {
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  pthread_mutex_init(&cache_lock, NULL);
+#endif
 }
 
 CSecureElement::CSecureElement(int fd)
     : se05x_fd(fd), close_device_at_destructor(false)
 {
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  pthread_mutex_init(&cache_lock, NULL);
+#endif
+}
+
+CSecureElement::CSecureElement(CSecureElement &&other)
+    : se05x_fd(other.se05x_fd),
+      close_device_at_destructor(other.close_device_at_destructor)
+{
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  pthread_mutex_init(&cache_lock, NULL);
+  pthread_mutex_lock(&other.cache_lock);
+  memcpy(cache, other.cache, sizeof(cache));
+  memset(other.cache, 0, sizeof(other.cache));
+  cache_clock = other.cache_clock;
+  cache_generation = other.cache_generation;
+  pthread_mutex_unlock(&other.cache_lock);
+#endif
 }
 
 CSecureElement::~CSecureElement()
 {
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  for (auto &entry : cache)
+    {
+      delete[] entry.data;
+    }
+
+  pthread_mutex_destroy(&cache_lock);
+#endif
+
   if ((se05x_fd >= 0) && close_device_at_destructor)
     {
       close(se05x_fd);
@@ -74,6 +105,14 @@ bool CSecureElement::GenerateKey(struct se05x_generate_keypair_s &args) const
     {
       result = 0 == ioctl(se05x_fd, SEIOC_GENERATE_KEYPAIR, &args);
     }
+
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  if (result)
+    {
+      CacheInvalidate(args.id);
+    }
+#endif
+
   return result;
 }
 
@@ -84,6 +123,14 @@ bool CSecureElement::SetKey(struct se05x_key_transmission_s &args) const
     {
       result = 0 == ioctl(se05x_fd, SEIOC_SET_KEY, &args);
     }
+
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  if (result)
+    {
+      CacheInvalidate(args.entry.id);
+    }
+#endif
+
   return result;
 }
 
@@ -104,6 +151,14 @@ bool CSecureElement::DeleteKey(uint32_t id) const
     {
       result = 0 == ioctl(se05x_fd, SEIOC_DELETE_KEY, id);
     }
+
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  if (result)
+    {
+      CacheInvalidate(id);
+    }
+#endif
+
   return result;
 }
 
@@ -114,6 +169,14 @@ bool CSecureElement::SetData(struct se05x_key_transmission_s &args) const
     {
       result = 0 == ioctl(se05x_fd, SEIOC_SET_DATA, &args);
     }
+
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  if (result)
+    {
+      CacheInvalidate(args.entry.id);
+    }
+#endif
+
   return result;
 }
 
@@ -180,12 +243,135 @@ bool CSecureElement::GetInfo(struct se05x_info_s &args) const
 
 CCertificate *CSecureElement::GetCertificate(uint32_t keystore_id)
 {
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  pthread_mutex_lock(&cache_lock);
+  auto entry = CacheLookup(keystore_id, true);
+  if (entry)
+    {
+      auto certificate = new CCertificate(entry->data, entry->size);
+      pthread_mutex_unlock(&cache_lock);
+      return certificate;
+    }
+
+  auto generation = cache_generation;
+  pthread_mutex_unlock(&cache_lock);
+
+  auto certificate = new CCertificate(*this, keystore_id);
+  uint8_t *der;
+  size_t der_size = certificate->GetDer(&der);
+  if (der_size > 0)
+    {
+      CacheInsert(keystore_id, true, der, der_size, generation);
+    }
+
+  return certificate;
+#else
   return new CCertificate(*this, keystore_id);
+#endif
 }
 
 CPublicKey *CSecureElement::GetPublicKey(uint32_t keystore_id)
 {
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  pthread_mutex_lock(&cache_lock);
+  auto entry = CacheLookup(keystore_id, false);
+  if (entry)
+    {
+      auto key = new CPublicKey(entry->data, entry->size);
+      pthread_mutex_unlock(&cache_lock);
+      return key;
+    }
+
+  auto generation = cache_generation;
+  pthread_mutex_unlock(&cache_lock);
+
+  auto key = new CPublicKey(*this, keystore_id);
+  if (key->IsLoaded())
+    {
+      size_t raw_size = key->GetRawSize();
+      auto raw = new uint8_t[raw_size];
+      key->GetRaw(raw);
+      CacheInsert(keystore_id, false, raw, raw_size, generation);
+    }
+
+  return key;
+#else
   return new CPublicKey(*this, keystore_id);
+#endif
+}
+
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+const CSecureElement::CacheEntry *
+CSecureElement::CacheLookup(uint32_t keystore_id, bool is_certificate) const
+{
+  for (auto &entry : cache)
+    {
+      if (entry.data && entry.keystore_id == keystore_id
+          && entry.is_certificate == is_certificate)
+        {
+          entry.last_used = ++cache_clock;
+          return &entry;
+        }
+    }
+
+  return nullptr;
+}
+
+// Takes ownership of data, evicting the least recently used entry when
+// the cache is full.  Data read before generation was taken is dropped if
+// an object was written meanwhile.
+
+void CSecureElement::CacheInsert(uint32_t keystore_id, bool is_certificate,
+                                 uint8_t *data, size_t size,
+                                 uint32_t generation) const
+{
+  pthread_mutex_lock(&cache_lock);
+  if (generation != cache_generation)
+    {
+      pthread_mutex_unlock(&cache_lock);
+      delete[] data;
+      return;
+    }
+
+  CacheEntry *victim = &cache[0];
+  for (auto &entry : cache)
+    {
+      if (!entry.data)
+        {
+          victim = &entry;
+          break;
+        }
+
+      if (entry.last_used - victim->last_used > UINT32_MAX / 2)
+        {
+          victim = &entry;
+        }
+    }
+
+  delete[] victim->data;
+  victim->keystore_id = keystore_id;
+  victim->is_certificate = is_certificate;
+  victim->last_used = ++cache_clock;
+  victim->data = data;
+  victim->size = size;
+  pthread_mutex_unlock(&cache_lock);
+}
+
+void CSecureElement::CacheInvalidate(uint32_t keystore_id) const
+{
+  pthread_mutex_lock(&cache_lock);
+  cache_generation++;
+  for (auto &entry : cache)
+    {
+      if (entry.data && entry.keystore_id == keystore_id)
+        {
+          delete[] entry.data;
+          entry.data = nullptr;
+        }
+    }
+
+  pthread_mutex_unlock(&cache_lock);
 }
+#endif
 
 } // namespace Controlse
@@ -0,0 +1,293 @@
+//***************************************************************************
+// apps/crypto/controlse/csecure_element_queue.cxx
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed to the Apache Software Foundation (ASF) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.  The
+// ASF licenses this file to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance with the
+// License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+//
+//**************************************************************************
+
+//***************************************************************************
+// Included Files
+//***************************************************************************
+
+#include "crypto/controlse/csecure_element_queue.hxx"
+
+namespace Controlse
+{
+
+//***************************************************************************
+// Class Method Implementations
+//***************************************************************************
+
+CSecureElementQueue::CSecureElementQueue(const ISecureElement &se,
+                                         size_t depth)
+    : m_se(se), m_requests(new Request[depth > 0 ? depth : 1]),
+      m_depth(depth > 0 ? depth : 1)
+{
+  pthread_mutex_init(&m_lock, NULL);
+  pthread_cond_init(&m_changed, NULL);
+  m_running = 0 == pthread_create(&m_thread, NULL, Worker, this);
+}
+
+CSecureElementQueue::~CSecureElementQueue()
+{
+  if (m_running)
+    {
+      pthread_mutex_lock(&m_lock);
+      m_stop = true;
+      pthread_cond_broadcast(&m_changed);
+      pthread_mutex_unlock(&m_lock);
+      pthread_join(m_thread, NULL);
+    }
+
+  pthread_cond_destroy(&m_changed);
+  pthread_mutex_destroy(&m_lock);
+  delete[] m_requests;
+}
+
+bool CSecureElementQueue::IsReady() const
+{
+  return m_running && m_se.IsReady();
+}
+
+bool CSecureElementQueue::GenerateKey(
+    struct se05x_generate_keypair_s &args) const
+{
+  return Call(OPERATION_GENERATE_KEY, &args);
+}
+
+bool CSecureElementQueue::SetKey(struct se05x_key_transmission_s &args) const
+{
+  return Call(OPERATION_SET_KEY, &args);
+}
+
+bool CSecureElementQueue::GetKey(struct se05x_key_transmission_s &args) const
+{
+  return Call(OPERATION_GET_KEY, &args);
+}
+
+bool CSecureElementQueue::DeleteKey(uint32_t id) const
+{
+  return Call(OPERATION_DELETE_KEY, nullptr, id);
+}
+
+bool CSecureElementQueue::SetData(
+    struct se05x_key_transmission_s &args) const
+{
+  return Call(OPERATION_SET_DATA, &args);
+}
+
+bool CSecureElementQueue::GetData(
+    struct se05x_key_transmission_s &args) const
+{
+  return Call(OPERATION_GET_DATA, &args);
+}
+
+bool CSecureElementQueue::CreateSignature(
+    struct se05x_signature_s &args) const
+{
+  return Call(OPERATION_CREATE_SIGNATURE, &args);
+}
+
+bool CSecureElementQueue::Verify(struct se05x_signature_s &args) const
+{
+  return Call(OPERATION_VERIFY, &args);
+}
+
+bool CSecureElementQueue::DeriveSymmetricalKey(
+    struct se05x_derive_key_s &args) const
+{
+  return Call(OPERATION_DERIVE_SYMMETRICAL_KEY, &args);
+}
+
+bool CSecureElementQueue::GetUid(struct se05x_uid_s &args) const
+{
+  return Call(OPERATION_GET_UID, &args);
+}
+
+bool CSecureElementQueue::GetInfo(struct se05x_info_s &args) const
+{
+  return Call(OPERATION_GET_INFO, &args);
+}
+
+bool CSecureElementQueue::SubmitSignature(struct se05x_signature_s &args,
+                                          Completion done, void *arg) const
+{
+  return Submit(OPERATION_CREATE_SIGNATURE, &args, 0, done, arg);
+}
+
+bool CSecureElementQueue::SubmitVerify(struct se05x_signature_s &args,
+                                       Completion done, void *arg) const
+{
+  return Submit(OPERATION_VERIFY, &args, 0, done, arg);
+}
+
+void CSecureElementQueue::Flush() const
+{
+  pthread_mutex_lock(&m_lock);
+  while (m_count > 0 || m_busy)
+    {
+      pthread_cond_wait(&m_changed, &m_lock);
+    }
+
+  pthread_mutex_unlock(&m_lock);
+}
+
+bool CSecureElementQueue::Submit(Operation operation, void *args,
+                                 uint32_t id, Completion done,
+                                 void *arg) const
+{
+  if (!m_running)
+    {
+      return false;
+    }
+
+  pthread_mutex_lock(&m_lock);
+  while (m_count == m_depth)
+    {
+      pthread_cond_wait(&m_changed, &m_lock);
+    }
+
+  Request &request = m_requests[(m_head + m_count) % m_depth];
+  request.operation = operation;
+  request.args = args;
+  request.id = id;
+  request.done = done;
+  request.arg = arg;
+  m_count++;
+
+  pthread_cond_broadcast(&m_changed);
+  pthread_mutex_unlock(&m_lock);
+  return true;
+}
+
+bool CSecureElementQueue::Call(Operation operation, void *args,
+                               uint32_t id) const
+{
+  Waiter waiter = { this, false, false };
+  if (!Submit(operation, args, id, Wake, &waiter))
+    {
+      return false;
+    }
+
+  pthread_mutex_lock(&m_lock);
+  while (!waiter.finished)
+    {
+      pthread_cond_wait(&m_changed, &m_lock);
+    }
+
+  pthread_mutex_unlock(&m_lock);
+  return waiter.result;
+}
+
+bool CSecureElementQueue::Execute(const Request &request) const
+{
+  switch (request.operation)
+    {
+    case OPERATION_GENERATE_KEY:
+      return m_se.GenerateKey(
+          *static_cast<struct se05x_generate_keypair_s *>(request.args));
+    case OPERATION_SET_KEY:
+      return m_se.SetKey(
+          *static_cast<struct se05x_key_transmission_s *>(request.args));
+    case OPERATION_GET_KEY:
+      return m_se.GetKey(
+          *static_cast<struct se05x_key_transmission_s *>(request.args));
+    case OPERATION_DELETE_KEY:
+      return m_se.DeleteKey(request.id);
+    case OPERATION_SET_DATA:
+      return m_se.SetData(
+          *static_cast<struct se05x_key_transmission_s *>(request.args));
+    case OPERATION_GET_DATA:
+      return m_se.GetData(
+          *static_cast<struct se05x_key_transmission_s *>(request.args));
+    case OPERATION_CREATE_SIGNATURE:
+      return m_se.CreateSignature(
+          *static_cast<struct se05x_signature_s *>(request.args));
+    case OPERATION_VERIFY:
+      return m_se.Verify(
+          *static_cast<struct se05x_signature_s *>(request.args));
+    case OPERATION_DERIVE_SYMMETRICAL_KEY:
+      return m_se.DeriveSymmetricalKey(
+          *static_cast<struct se05x_derive_key_s *>(request.args));
+    case OPERATION_GET_UID:
+      return m_se.GetUid(*static_cast<struct se05x_uid_s *>(request.args));
+    case OPERATION_GET_INFO:
+      return m_se.GetInfo(*static_cast<struct se05x_info_s *>(request.args));
+    }
+
+  return false;
+}
+
+void *CSecureElementQueue::Worker(void *arg)
+{
+  auto queue = static_cast<CSecureElementQueue *>(arg);
+
+  pthread_mutex_lock(&queue->m_lock);
+  while (true)
+    {
+      while (queue->m_count == 0 && !queue->m_stop)
+        {
+          pthread_cond_wait(&queue->m_changed, &queue->m_lock);
+        }
+
+      // Requests still queued when stopping are run, their callers are
+      // waiting for them
+
+      if (queue->m_count == 0)
+        {
+          break;
+        }
+
+      Request request = queue->m_requests[queue->m_head];
+      queue->m_head = (queue->m_head + 1) % queue->m_depth;
+      queue->m_count--;
+      queue->m_busy = true;
+      pthread_cond_broadcast(&queue->m_changed);
+      pthread_mutex_unlock(&queue->m_lock);
+
+      bool result = queue->Execute(request);
+      if (request.done)
+        {
+          request.done(result, request.arg);
+        }
+
+      pthread_mutex_lock(&queue->m_lock);
+      queue->m_busy = false;
+      pthread_cond_broadcast(&queue->m_changed);
+    }
+
+  pthread_mutex_unlock(&queue->m_lock);
+  return NULL;
+}
+
+void CSecureElementQueue::Wake(bool result, void *arg)
+{
+  auto waiter = static_cast<Waiter *>(arg);
+  auto queue = waiter->queue;
+
+  // The waiter may return as soon as the lock is dropped, it must not be
+  // touched after setting finished
+
+  pthread_mutex_lock(&queue->m_lock);
+  waiter->result = result;
+  waiter->finished = true;
+  pthread_cond_broadcast(&queue->m_changed);
+  pthread_mutex_unlock(&queue->m_lock);
+}
+
+} // namespace Controlse
@@ -0,0 +1,349 @@
+//***************************************************************************
+// apps/crypto/controlse/csoft_secure_element.cxx
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed to the Apache Software Foundation (ASF) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.  The
+// ASF licenses this file to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance with the
+// License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+//
+//**************************************************************************
+
+//***************************************************************************
+// Included Files
+//***************************************************************************
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#include "crypto/controlse/csoft_secure_element.hxx"
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ecdsa.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/entropy.h>
+#include <string.h>
+
+namespace Controlse
+{
+
+//***************************************************************************
+// Private Data
+//***************************************************************************
+
+static constexpr char personalization[] = "controlse";
+
+//***************************************************************************
+// Class Method Implementations
+//***************************************************************************
+
+CSoftSecureElement::CSoftSecureElement()
+    : entropy(new mbedtls_entropy_context),
+      ctr_drbg(new mbedtls_ctr_drbg_context)
+{
+  mbedtls_entropy_init(entropy);
+  mbedtls_ctr_drbg_init(ctr_drbg);
+  is_ready = 0
+             == mbedtls_ctr_drbg_seed(
+                 ctr_drbg, mbedtls_entropy_func, entropy,
+                 reinterpret_cast<const uint8_t *>(personalization),
+                 sizeof(personalization) - 1);
+}
+
+CSoftSecureElement::~CSoftSecureElement()
+{
+  for (auto &object : objects)
+    {
+      Delete(object);
+    }
+
+  mbedtls_ctr_drbg_free(ctr_drbg);
+  mbedtls_entropy_free(entropy);
+  delete ctr_drbg;
+  delete entropy;
+}
+
+bool CSoftSecureElement::IsReady() const { return is_ready; }
+
+bool CSoftSecureElement::GenerateKey(
+    struct se05x_generate_keypair_s &args) const
+{
+  if (!is_ready || args.cipher != SE05X_ASYM_CIPHER_EC_NIST_P_256)
+    {
+      return false;
+    }
+
+  auto key = new mbedtls_ecp_keypair;
+  mbedtls_ecp_keypair_init(key);
+  bool result = 0
+                == mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, key,
+                                       mbedtls_ctr_drbg_random, ctr_drbg);
+
+  auto object = result ? Create(args.id) : nullptr;
+  if (object)
+    {
+      object->key = key;
+      object->has_private_key = true;
+    }
+  else
+    {
+      mbedtls_ecp_keypair_free(key);
+      delete key;
+    }
+
+  return object != nullptr;
+}
+
+bool CSoftSecureElement::SetKey(struct se05x_key_transmission_s &args) const
+{
+  if (args.entry.cipher != SE05X_ASYM_CIPHER_EC_NIST_P_256)
+    {
+      return false;
+    }
+
+  // Only public keys can be written
+
+  auto key = new mbedtls_ecp_keypair;
+  mbedtls_ecp_keypair_init(key);
+  int result = mbedtls_ecp_group_load(&key->grp, MBEDTLS_ECP_DP_SECP256R1);
+  if (result == 0)
+    {
+      result = mbedtls_ecp_point_read_binary(&key->grp, &key->Q,
+                                             args.content.buffer,
+                                             args.content.buffer_content_size);
+    }
+
+  if (result == 0)
+    {
+      result = mbedtls_ecp_check_pubkey(&key->grp, &key->Q);
+    }
+
+  auto object = result == 0 ? Create(args.entry.id) : nullptr;
+  if (object)
+    {
+      object->key = key;
+    }
+  else
+    {
+      mbedtls_ecp_keypair_free(key);
+      delete key;
+    }
+
+  return object != nullptr;
+}
+
+bool CSoftSecureElement::GetKey(struct se05x_key_transmission_s &args) const
+{
+  auto object = Find(args.entry.id);
+  if (!object || !object->key)
+    {
+      return false;
+    }
+
+  size_t size;
+  bool result = 0
+                == mbedtls_ecp_point_write_binary(
+                    &object->key->grp, &object->key->Q,
+                    MBEDTLS_ECP_PF_UNCOMPRESSED, &size, args.content.buffer,
+                    args.content.buffer_size);
+  if (result)
+    {
+      args.content.buffer_content_size = size;
+    }
+
+  return result;
+}
+
+bool CSoftSecureElement::DeleteKey(uint32_t id) const
+{
+  auto object = Find(id);
+  if (object)
+    {
+      Delete(*object);
+    }
+
+  return object != nullptr;
+}
+
+bool CSoftSecureElement::SetData(struct se05x_key_transmission_s &args) const
+{
+  auto object = Create(args.entry.id);
+  if (object)
+    {
+      object->size = args.content.buffer_content_size;
+      object->data = new uint8_t[object->size];
+      memcpy(object->data, args.content.buffer, object->size);
+    }
+
+  return object != nullptr;
+}
+
+bool CSoftSecureElement::GetData(struct se05x_key_transmission_s &args) const
+{
+  auto object = Find(args.entry.id);
+  if (!object || !object->data || object->size > args.content.buffer_size)
+    {
+      return false;
+    }
+
+  memcpy(args.content.buffer, object->data, object->size);
+  args.content.buffer_content_size = object->size;
+  return true;
+}
+
+bool CSoftSecureElement::CreateSignature(struct se05x_signature_s &args) const
+{
+  auto object = Find(args.key_id);
+  if (!is_ready || !object || !object->has_private_key)
+    {
+      return false;
+    }
+
+  size_t size;
+  bool result = 0
+                == mbedtls_ecdsa_write_signature(
+                    object->key, MBEDTLS_MD_SHA256, args.tbs.buffer,
+                    args.tbs.buffer_content_size, args.signature.buffer,
+                    args.signature.buffer_size, &size,
+                    mbedtls_ctr_drbg_random, ctr_drbg);
+  if (result)
+    {
+      args.signature.buffer_content_size = size;
+    }
+
+  return result;
+}
+
+bool CSoftSecureElement::Verify(struct se05x_signature_s &args) const
+{
+  auto object = Find(args.key_id);
+  if (!object || !object->key)
+    {
+      return false;
+    }
+
+  return 0
+         == mbedtls_ecdsa_read_signature(
+             object->key, args.tbs.buffer, args.tbs.buffer_content_size,
+             args.signature.buffer, args.signature.buffer_content_size);
+}
+
+bool CSoftSecureElement::DeriveSymmetricalKey(
+    struct se05x_derive_key_s &args) const
+{
+  auto private_key = Find(args.private_key_id);
+  auto public_key = Find(args.public_key_id);
+  if (!is_ready || !private_key || !private_key->has_private_key
+      || !public_key || !public_key->key)
+    {
+      return false;
+    }
+
+  // Shared secret is the x coordinate of d * Q, as the SE05x returns it
+
+  auto &grp = private_key->key->grp;
+  size_t size = mbedtls_mpi_size(&grp.P);
+  if (size > args.content.buffer_size)
+    {
+      return false;
+    }
+
+  mbedtls_ecp_point shared;
+  mbedtls_ecp_point_init(&shared);
+  bool result = 0
+                == mbedtls_ecp_mul(&grp, &shared, &private_key->key->d,
+                                   &public_key->key->Q,
+                                   mbedtls_ctr_drbg_random, ctr_drbg);
+  if (result)
+    {
+      result = 0
+               == mbedtls_mpi_write_binary(&shared.X, args.content.buffer,
+                                           size);
+    }
+
+  if (result)
+    {
+      args.content.buffer_content_size = size;
+    }
+
+  mbedtls_ecp_point_free(&shared);
+  return result;
+}
+
+bool CSoftSecureElement::GetUid(struct se05x_uid_s &args) const
+{
+  memset(&args, 0, sizeof(args));
+  return true;
+}
+
+bool CSoftSecureElement::GetInfo(struct se05x_info_s &args) const
+{
+  memset(&args, 0, sizeof(args));
+  return true;
+}
+
+CSoftSecureElement::Object *CSoftSecureElement::Find(uint32_t id) const
+{
+  for (auto &object : objects)
+    {
+      if (object.in_use && object.id == id)
+        {
+          return &object;
+        }
+    }
+
+  return nullptr;
+}
+
+// Returns an empty object for id, replacing what was stored there
+// returns nullptr when all objects are in use
+
+CSoftSecureElement::Object *CSoftSecureElement::Create(uint32_t id) const
+{
+  auto object = Find(id);
+  if (object)
+    {
+      Delete(*object);
+    }
+  else
+    {
+      for (auto &free_object : objects)
+        {
+          if (!free_object.in_use)
+            {
+              object = &free_object;
+              break;
+            }
+        }
+    }
+
+  if (object)
+    {
+      object->in_use = true;
+      object->id = id;
+    }
+
+  return object;
+}
+
+void CSoftSecureElement::Delete(Object &object) const
+{
+  if (object.key)
+    {
+      mbedtls_ecp_keypair_free(object.key);
+      delete object.key;
+    }
+
+  delete[] object.data;
+  object = {};
+}
+
+} // namespace Controlse
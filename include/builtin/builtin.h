@@ -81,6 +81,24 @@ extern "C"
 int exec_builtin(FAR const char *appname, FAR char * const *argv,
                  FAR const struct nsh_param_s *param);
 
+/****************************************************************************
+ * Name: builtin_find
+ *
+ * Description:
+ *   Same as builtin_isavail(), but uses a binary search when the builtin
+ *   list was generated sorted by name.
+ *
+ * Input Parameter:
+ *   appname       - Name of the builtin application.
+ *
+ * Returned Value:
+ *   The index of the application, or -1 (ERROR) with errno set to ENOENT
+ *   if there is no such application.
+ *
+ ****************************************************************************/
+
+int builtin_find(FAR const char *appname);
+
 #undef EXTERN
 #if defined(__cplusplus)
 }
@@ -27,7 +27,11 @@
 // Included Files
 //***************************************************************************
 
+#include <nuttx/config.h>
+
 #include "crypto/controlse/isecure_element.hxx"
+#include <pthread.h>
+#include <stddef.h>
 
 namespace Controlse
 {
@@ -46,7 +50,7 @@ public:
   explicit CSecureElement(const char *se05x_device);
   explicit CSecureElement(int fd);
   CSecureElement(const CSecureElement &) = delete;
-  CSecureElement(CSecureElement &&) = default;
+  CSecureElement(CSecureElement &&other);
   ~CSecureElement();
 
   CSecureElement &operator=(const CSecureElement &other) = delete;
@@ -64,10 +68,43 @@ public:
   bool GetUid(struct se05x_uid_s &args) const;
   bool GetInfo(struct se05x_info_s &args) const;
 
+  // Get certificate or public key stored at keystore_id
+  // returns pointer to the object when successful otherwise NULL
+  // note: must be deleted by caller when not NULL
+  // note: the last CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES objects read are
+  //       served from memory until written through this object
   CCertificate *GetCertificate(uint32_t keystore_id);
   CPublicKey *GetPublicKey(uint32_t keystore_id);
 
 private:
+#if CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES > 0
+  struct CacheEntry
+  {
+    uint32_t keystore_id;
+    bool is_certificate;
+    uint32_t last_used;
+    uint8_t *data;
+    size_t size;
+  };
+
+  // cache_lock must be held by the caller of CacheLookup() for as long as
+  // the returned entry is used
+  const CacheEntry *CacheLookup(uint32_t keystore_id,
+                                bool is_certificate) const;
+  void CacheInsert(uint32_t keystore_id, bool is_certificate, uint8_t *data,
+                   size_t size, uint32_t generation) const;
+  void CacheInvalidate(uint32_t keystore_id) const;
+
+  // Get/Set/Delete may run from a CSecureElementQueue worker while other
+  // threads read, so the cache is protected by cache_lock.
+  // cache_generation counts writes, an object read before a write must not
+  // be inserted after it.
+  mutable pthread_mutex_t cache_lock;
+  mutable CacheEntry cache[CONFIG_CRYPTO_CONTROLSE_CACHE_ENTRIES] = {};
+  mutable uint32_t cache_clock = 0;
+  mutable uint32_t cache_generation = 0;
+#endif
+
   const int se05x_fd;
   const bool close_device_at_destructor;
 };
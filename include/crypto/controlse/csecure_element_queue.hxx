@@ -0,0 +1,138 @@
+//***************************************************************************
+// apps/include/crypto/controlse/csecure_element_queue.hxx
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed to the Apache Software Foundation (ASF) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.  The
+// ASF licenses this file to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance with the
+// License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+//
+//**************************************************************************
+
+#pragma once
+
+//***************************************************************************
+// Included Files
+//***************************************************************************
+
+#include "crypto/controlse/isecure_element.hxx"
+#include <pthread.h>
+#include <stddef.h>
+
+namespace Controlse
+{
+
+//***************************************************************************
+// Class definitions
+//***************************************************************************
+
+// Runs the requests for a secure element on a worker thread.
+//
+// The ISecureElement methods queue the request and wait for its result,
+// so several threads can share one element.  SubmitSignature() and
+// SubmitVerify() return as soon as the request is queued and report the
+// result through a callback on the worker thread.  The queue holds at
+// most 'depth' requests, submitting to a full queue waits for room.
+//
+// Callbacks must not call back into the queue synchronously.
+
+class CSecureElementQueue : public ISecureElement
+{
+public:
+  typedef void (*Completion)(bool result, void *arg);
+
+  CSecureElementQueue(const ISecureElement &se, size_t depth);
+  CSecureElementQueue(const CSecureElementQueue &) = delete;
+  ~CSecureElementQueue();
+
+  CSecureElementQueue &operator=(const CSecureElementQueue &other) = delete;
+
+  bool IsReady() const;
+  bool GenerateKey(struct se05x_generate_keypair_s &args) const;
+  bool SetKey(struct se05x_key_transmission_s &args) const;
+  bool GetKey(struct se05x_key_transmission_s &args) const;
+  bool DeleteKey(uint32_t id) const;
+  bool SetData(struct se05x_key_transmission_s &args) const;
+  bool GetData(struct se05x_key_transmission_s &args) const;
+  bool CreateSignature(struct se05x_signature_s &args) const;
+  bool Verify(struct se05x_signature_s &args) const;
+  bool DeriveSymmetricalKey(struct se05x_derive_key_s &args) const;
+  bool GetUid(struct se05x_uid_s &args) const;
+  bool GetInfo(struct se05x_info_s &args) const;
+
+  // Queue a request without waiting for it
+  // args and the buffers it points to must stay valid until done is
+  // called, done may be nullptr
+  // returns false when the worker is not running
+  bool SubmitSignature(struct se05x_signature_s &args, Completion done,
+                       void *arg) const;
+  bool SubmitVerify(struct se05x_signature_s &args, Completion done,
+                    void *arg) const;
+
+  // Wait until every queued request has completed
+  void Flush() const;
+
+private:
+  enum Operation
+  {
+    OPERATION_GENERATE_KEY,
+    OPERATION_SET_KEY,
+    OPERATION_GET_KEY,
+    OPERATION_DELETE_KEY,
+    OPERATION_SET_DATA,
+    OPERATION_GET_DATA,
+    OPERATION_CREATE_SIGNATURE,
+    OPERATION_VERIFY,
+    OPERATION_DERIVE_SYMMETRICAL_KEY,
+    OPERATION_GET_UID,
+    OPERATION_GET_INFO,
+  };
+
+  struct Request
+  {
+    Operation operation;
+    void *args;
+    uint32_t id;
+    Completion done;
+    void *arg;
+  };
+
+  struct Waiter
+  {
+    const CSecureElementQueue *queue;
+    bool finished;
+    bool result;
+  };
+
+  bool Submit(Operation operation, void *args, uint32_t id, Completion done,
+              void *arg) const;
+  bool Call(Operation operation, void *args, uint32_t id = 0) const;
+  bool Execute(const Request &request) const;
+
+  static void *Worker(void *arg);
+  static void Wake(bool result, void *arg);
+
+  const ISecureElement &m_se;
+  Request *const m_requests;
+  const size_t m_depth;
+  mutable size_t m_head = 0;
+  mutable size_t m_count = 0;
+  mutable bool m_busy = false;
+  bool m_stop = false;
+  bool m_running = false;
+  mutable pthread_mutex_t m_lock;
+  mutable pthread_cond_t m_changed;
+  pthread_t m_thread;
+};
+} // namespace Controlse
@@ -0,0 +1,93 @@
+//***************************************************************************
+// apps/include/crypto/controlse/csoft_secure_element.hxx
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed to the Apache Software Foundation (ASF) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.  The
+// ASF licenses this file to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance with the
+// License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+// License for the specific language governing permissions and limitations
+// under the License.
+//
+//**************************************************************************
+
+#pragma once
+
+//***************************************************************************
+// Included Files
+//***************************************************************************
+
+#include "crypto/controlse/isecure_element.hxx"
+#include <stddef.h>
+
+struct mbedtls_ecp_keypair;
+struct mbedtls_ctr_drbg_context;
+struct mbedtls_entropy_context;
+
+namespace Controlse
+{
+
+//***************************************************************************
+// Class definitions
+//***************************************************************************
+
+// Secure element emulated in software with mbedTLS
+//
+// Keeps NIST P-256 keys and data objects in RAM, so that code using
+// ISecureElement can be run and measured without an SE05x.  It offers no
+// protection for the keys and is meant for testing only.
+
+class CSoftSecureElement : public ISecureElement
+{
+public:
+  CSoftSecureElement();
+  CSoftSecureElement(const CSoftSecureElement &) = delete;
+  ~CSoftSecureElement();
+
+  CSoftSecureElement &operator=(const CSoftSecureElement &other) = delete;
+
+  bool IsReady() const;
+  bool GenerateKey(struct se05x_generate_keypair_s &args) const;
+  bool SetKey(struct se05x_key_transmission_s &args) const;
+  bool GetKey(struct se05x_key_transmission_s &args) const;
+  bool DeleteKey(uint32_t id) const;
+  bool SetData(struct se05x_key_transmission_s &args) const;
+  bool GetData(struct se05x_key_transmission_s &args) const;
+  bool CreateSignature(struct se05x_signature_s &args) const;
+  bool Verify(struct se05x_signature_s &args) const;
+  bool DeriveSymmetricalKey(struct se05x_derive_key_s &args) const;
+  bool GetUid(struct se05x_uid_s &args) const;
+  bool GetInfo(struct se05x_info_s &args) const;
+
+  static constexpr size_t MAX_OBJECTS = 16;
+
+private:
+  struct Object
+  {
+    bool in_use;
+    uint32_t id;
+    bool has_private_key;
+    mbedtls_ecp_keypair *key;
+    uint8_t *data;
+    size_t size;
+  };
+
+  Object *Find(uint32_t id) const;
+  Object *Create(uint32_t id) const;
+  void Delete(Object &object) const;
+
+  mutable Object objects[MAX_OBJECTS] = {};
+  mbedtls_entropy_context *entropy;
+  mbedtls_ctr_drbg_context *ctr_drbg;
+  bool is_ready = false;
+};
+} // namespace Controlse
@@ -31,6 +31,8 @@
 
 #include <dspb16.h>
 
+#include "industry/foc/foc_common.h"
+
 #ifdef CONFIG_INDUSTRY_FOC_CORDIC
 #  include "industry/foc/fixed16/foc_cordic.h"
 #endif
@@ -187,6 +189,57 @@ struct foc_mod_cfg_b16_s
   b16_t pwm_duty_max;  /* Maximum allowed PWM duty cycle */
 };
 
+#ifdef CONFIG_INDUSTRY_FOC_HANDLER_BATCH
+/* FOC handler for a batch of motors.
+ *
+ * Runs the PI controller and SVM3 modulation for up to
+ * CONFIG_INDUSTRY_FOC_HANDLER_BATCH_MOTORS motors in one call.  Every
+ * per-motor quantity is an array indexed by motor, so the control loop is
+ * a single pass over all motors that the compiler can vectorize.  The
+ * caller fills the input arrays, calls foc_handler_batch_run_b16() and
+ * takes the duty cycles from the duty arrays.
+ */
+
+struct foc_handler_batch_b16_s
+{
+  int   n;                                  /* Number of motors */
+
+  /* Input */
+
+  b16_t current[CONFIG_MOTOR_FOC_PHASES][FOC_BATCH_MOTORS];
+  b16_t angle[FOC_BATCH_MOTORS];            /* Phase angle */
+  b16_t vbus[FOC_BATCH_MOTORS];             /* Bus voltage */
+  b16_t ref_d[FOC_BATCH_MOTORS];            /* DQ reference */
+  b16_t ref_q[FOC_BATCH_MOTORS];
+  b16_t comp_d[FOC_BATCH_MOTORS];           /* DQ voltage compensation */
+  b16_t comp_q[FOC_BATCH_MOTORS];
+  int   mode[FOC_BATCH_MOTORS];             /* enum foc_handler_mode_e */
+
+  /* Output */
+
+  b16_t duty[CONFIG_MOTOR_FOC_PHASES][FOC_BATCH_MOTORS];
+
+  /* Controller state */
+
+  b16_t i_d[FOC_BATCH_MOTORS];              /* DQ current */
+  b16_t i_q[FOC_BATCH_MOTORS];
+  b16_t v_d[FOC_BATCH_MOTORS];              /* DQ voltage */
+  b16_t v_q[FOC_BATCH_MOTORS];
+  b16_t int_d[FOC_BATCH_MOTORS];            /* PI integral parts */
+  b16_t int_q[FOC_BATCH_MOTORS];
+  b16_t sin[FOC_BATCH_MOTORS];              /* Phase angle sine and cosine */
+  b16_t cos[FOC_BATCH_MOTORS];
+
+  /* Configuration */
+
+  b16_t kp_d[FOC_BATCH_MOTORS];             /* PI gains */
+  b16_t ki_d[FOC_BATCH_MOTORS];
+  b16_t kp_q[FOC_BATCH_MOTORS];
+  b16_t ki_q[FOC_BATCH_MOTORS];
+  b16_t duty_max[FOC_BATCH_MOTORS];         /* Maximum PWM duty cycle */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -253,4 +306,28 @@ void foc_handler_state_b16(FAR foc_handler_b16_t *h,
 void foc_handler_state_print_b16(FAR struct foc_state_b16_s *state);
 #endif
 
+#ifdef CONFIG_INDUSTRY_FOC_HANDLER_BATCH
+/****************************************************************************
+ * Name: foc_handler_batch_init_b16
+ ****************************************************************************/
+
+int foc_handler_batch_init_b16(FAR struct foc_handler_batch_b16_s *h,
+                               int n);
+
+/****************************************************************************
+ * Name: foc_handler_batch_cfg_b16
+ ****************************************************************************/
+
+void foc_handler_batch_cfg_b16(FAR struct foc_handler_batch_b16_s *h,
+                               int motor,
+                               FAR struct foc_initdata_b16_s *ctrl_cfg,
+                               FAR struct foc_mod_cfg_b16_s *mod_cfg);
+
+/****************************************************************************
+ * Name: foc_handler_batch_run_b16
+ ****************************************************************************/
+
+void foc_handler_batch_run_b16(FAR struct foc_handler_batch_b16_s *h);
+#endif
+
 #endif /* __INDUSTRY_FOC_FIXED16_FOC_HANDLER_H */
@@ -31,6 +31,8 @@
 
 #include <dsp.h>
 
+#include "industry/foc/foc_common.h"
+
 #ifdef CONFIG_INDUSTRY_FOC_CORDIC
 #  include "industry/foc/float/foc_cordic.h"
 #endif
@@ -188,6 +190,57 @@ struct foc_mod_cfg_f32_s
   float pwm_duty_max;  /* Maximum allowed PWM duty cycle */
 };
 
+#ifdef CONFIG_INDUSTRY_FOC_HANDLER_BATCH
+/* FOC handler for a batch of motors.
+ *
+ * Runs the PI controller and SVM3 modulation for up to
+ * CONFIG_INDUSTRY_FOC_HANDLER_BATCH_MOTORS motors in one call.  Every
+ * per-motor quantity is an array indexed by motor, so the control loop is
+ * a single pass over all motors that the compiler can vectorize.  The
+ * caller fills the input arrays, calls foc_handler_batch_run_f32() and
+ * takes the duty cycles from the duty arrays.
+ */
+
+struct foc_handler_batch_f32_s
+{
+  int   n;                                  /* Number of motors */
+
+  /* Input */
+
+  float current[CONFIG_MOTOR_FOC_PHASES][FOC_BATCH_MOTORS];
+  float angle[FOC_BATCH_MOTORS];            /* Phase angle */
+  float vbus[FOC_BATCH_MOTORS];             /* Bus voltage */
+  float ref_d[FOC_BATCH_MOTORS];            /* DQ reference */
+  float ref_q[FOC_BATCH_MOTORS];
+  float comp_d[FOC_BATCH_MOTORS];           /* DQ voltage compensation */
+  float comp_q[FOC_BATCH_MOTORS];
+  int   mode[FOC_BATCH_MOTORS];             /* enum foc_handler_mode_e */
+
+  /* Output */
+
+  float duty[CONFIG_MOTOR_FOC_PHASES][FOC_BATCH_MOTORS];
+
+  /* Controller state */
+
+  float i_d[FOC_BATCH_MOTORS];              /* DQ current */
+  float i_q[FOC_BATCH_MOTORS];
+  float v_d[FOC_BATCH_MOTORS];              /* DQ voltage */
+  float v_q[FOC_BATCH_MOTORS];
+  float int_d[FOC_BATCH_MOTORS];            /* PI integral parts */
+  float int_q[FOC_BATCH_MOTORS];
+  float sin[FOC_BATCH_MOTORS];              /* Phase angle sine and cosine */
+  float cos[FOC_BATCH_MOTORS];
+
+  /* Configuration */
+
+  float kp_d[FOC_BATCH_MOTORS];             /* PI gains */
+  float ki_d[FOC_BATCH_MOTORS];
+  float kp_q[FOC_BATCH_MOTORS];
+  float ki_q[FOC_BATCH_MOTORS];
+  float duty_max[FOC_BATCH_MOTORS];         /* Maximum PWM duty cycle */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -254,4 +307,28 @@ void foc_handler_state_f32(FAR foc_handler_f32_t *h,
 void foc_handler_state_print_f32(FAR struct foc_state_f32_s *state);
 #endif
 
+#ifdef CONFIG_INDUSTRY_FOC_HANDLER_BATCH
+/****************************************************************************
+ * Name: foc_handler_batch_init_f32
+ ****************************************************************************/
+
+int foc_handler_batch_init_f32(FAR struct foc_handler_batch_f32_s *h,
+                               int n);
+
+/****************************************************************************
+ * Name: foc_handler_batch_cfg_f32
+ ****************************************************************************/
+
+void foc_handler_batch_cfg_f32(FAR struct foc_handler_batch_f32_s *h,
+                               int motor,
+                               FAR struct foc_initdata_f32_s *ctrl_cfg,
+                               FAR struct foc_mod_cfg_f32_s *mod_cfg);
+
+/****************************************************************************
+ * Name: foc_handler_batch_run_f32
+ ****************************************************************************/
+
+void foc_handler_batch_run_f32(FAR struct foc_handler_batch_f32_s *h);
+#endif
+
 #endif /* __INDUSTRY_FOC_FLOAT_FOC_HANDLER_H */
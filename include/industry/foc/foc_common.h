@@ -36,6 +36,12 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifdef CONFIG_INDUSTRY_FOC_HANDLER_BATCH
+/* Size of the motor arrays in the batched FOC handler */
+
+#  define FOC_BATCH_MOTORS CONFIG_INDUSTRY_FOC_HANDLER_BATCH_MOTORS
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
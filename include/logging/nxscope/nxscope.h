@@ -106,7 +106,7 @@ enum nxscope_info_flags_e
 {
   NXSCOPE_FLAGS_DIVIDER_SUPPORT   = (1 << 0),
   NXSCOPE_FLAGS_ACK_SUPPORT       = (1 << 1),
-  NXSCOPE_FLAGS_RES2              = (1 << 2),
+  NXSCOPE_FLAGS_DELTA_SUPPORT     = (1 << 2),
   NXSCOPE_FLAGS_RES3              = (1 << 3),
   NXSCOPE_FLAGS_RES4              = (1 << 4),
   NXSCOPE_FLAGS_RES5              = (1 << 5),
@@ -118,7 +118,20 @@ enum nxscope_info_flags_e
 
 enum nxscope_stream_flags_s
 {
-  NXSCOPE_STREAM_FLAGS_OVERFLOW = (1 << 0)
+  NXSCOPE_STREAM_FLAGS_OVERFLOW = (1 << 0),
+  NXSCOPE_STREAM_FLAGS_DELTA    = (1 << 1)   /* Delta-encoded samples */
+};
+
+/* Nxscope start frame values */
+
+enum nxscope_start_e
+{
+  NXSCOPE_START_STOP  = 0,               /* Stop stream */
+  NXSCOPE_START_RAW   = 1,               /* Start stream */
+  NXSCOPE_START_DELTA = 2                /* Start delta-encoded stream,
+                                          *   only if
+                                          *   NXSCOPE_FLAGS_DELTA_SUPPORT
+                                          */
 };
 
 /* Nxscope start frame data */
@@ -223,6 +236,17 @@ begin_packed_struct struct nxscope_info_cmn_s
  *   [1] - sizeof(channel_type) * channel_vdim
  *         NOTE: sample data always little-endian !
  *
+ * Delta-encoded sample data (NXSCOPE_STREAM_FLAGS_DELTA set):
+ *
+ *   Each vector element of a 16, 32 and 64 bit type is sent as a varint
+ *   (7 bits per byte, LSB first, MSB set if more bytes follow) of:
+ *     - integer and fixed-point types: zigzag of the difference from the
+ *       previous element value,
+ *     - float and double: XOR with the previous element bits.
+ *   8-bit, char and user types are sent unchanged.  Previous values are
+ *   per channel element and start from 0 in each stream frame, so every
+ *   frame can be decoded on its own.
+ *
  */
 
 struct nxscope_sample_s
@@ -263,6 +287,12 @@ struct nxscope_callbacks_s
   CODE int (*start)(FAR void *priv, bool start);
 };
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+/* Nxscope per-channel sample ring, see nxscope_internals.h */
+
+struct nxscope_chanbuf_s;
+#endif
+
 /* Nxscope general configuration */
 
 struct nxscope_cfg_s
@@ -372,6 +402,20 @@ struct nxscope_s
   size_t                       stream_i;
   bool                         stream_retry;
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  /* Delta encoding, previous values for each channel element */
+
+  bool                         delta;
+  FAR uint8_t                **delta_prev;
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Per-channel sample rings, chmax elements */
+
+  FAR struct nxscope_chanbuf_s *chanbuf;
+  size_t                       chanbuf_len;
+#endif
+
 #ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   /* Critical buffer data */
 
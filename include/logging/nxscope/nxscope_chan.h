@@ -174,6 +174,13 @@ int nxscope_chan_all_en(FAR struct nxscope_s *s, bool en);
  * Description:
  *   Put a vector with metadata on the stream buffer
  *
+ *   With CONFIG_LOGGING_NXSCOPE_LOCKFREE, samples of non-critical channels
+ *   are queued without taking the nxscope lock.  The channel validation
+ *   and the divider counter are then not serialized either, so a given
+ *   channel must have a single producer: it must not be written from more
+ *   than one thread at a time, nor while nxscope_chan_init() reconfigures
+ *   it.
+ *
  * Input Parameters:
  *   s    - a pointer to a nxscope instance
  *   ch   - a channel id
@@ -43,6 +43,7 @@
 
 #include <nuttx/net/tcp.h>
 
+#include <sys/types.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <limits.h>
@@ -122,6 +123,16 @@ struct httpd_state
   FAR char *ht_scriptptr;
   uint16_t ht_scriptlen;
   uint16_t ht_sndlen;
+  uint16_t ht_rcvlen;                   /* Bytes pending in ht_buffer */
+  uint8_t ht_parse;                     /* Request parser state */
+#ifdef CONFIG_NETUTILS_HTTPD_EVENTLOOP
+  uint8_t ht_phase;                     /* Receiving or sending */
+  uint16_t ht_hdrlen;                   /* Length of ht_header */
+  uint16_t ht_hdrsent;                  /* Bytes of ht_header sent */
+  off_t ht_offset;                      /* Bytes of ht_file sent */
+  time_t ht_lastio;                     /* Time of the last activity */
+  char ht_header[HTTPD_MAX_HEADERLEN];  /* Pending response headers */
+#endif
 };
 
 struct httpd_fsdata_file
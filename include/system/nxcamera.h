@@ -33,6 +33,7 @@
 #include <nuttx/video/fb.h>
 #include <mqueue.h>
 #include <pthread.h>
+#include <time.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -47,6 +48,18 @@
  * Public Type Declarations
  ****************************************************************************/
 
+/* Display path statistics of the current (or last) stream */
+
+struct nxcamera_stats_s
+{
+  uint32_t              frames;      /* Frames displayed */
+  uint32_t              conv_min;    /* Fastest conversion (us) */
+  uint32_t              conv_max;    /* Slowest conversion (us) */
+  uint64_t              conv_total;  /* Sum of conversions (us) */
+  uint32_t              gap_max;     /* Longest frame interval (us) */
+  uint64_t              elapsed;     /* First to last frame (us) */
+};
+
 /* This structure describes the internal state of the nxcamera */
 
 struct nxcamera_s
@@ -72,6 +85,9 @@ struct nxcamera_s
   size_t                nbuffers;                    /* Number of buffers */
   FAR size_t            *buf_sizes;                  /* Buffer lengths */
   FAR uint8_t           **bufs;                      /* Buffer pointers */
+  FAR uint8_t           *convbuf;                    /* I420 scratch frame */
+  struct nxcamera_stats_s stats;                     /* Display statistics */
+  struct timespec       last;                        /* Last frame start */
 };
 
 struct video_msg_s
@@ -249,6 +265,24 @@ int nxcamera_setfb(FAR struct nxcamera_s *pcam, FAR const char *device);
 int nxcamera_setfile(FAR struct nxcamera_s *pcam, FAR const char *pfile,
                      bool isimage);
 
+/****************************************************************************
+ * Name: nxcamera_getstats
+ *
+ *   Returns the display statistics of the current stream, or of the last
+ *   one if the camera is idle.
+ *
+ * Input Parameters:
+ *   pcam      - Pointer to the nxcamera context
+ *   stats     - Location to return the statistics
+ *
+ * Returned Value:
+ *   OK if the statistics were returned.
+ *
+ ****************************************************************************/
+
+int nxcamera_getstats(FAR struct nxcamera_s *pcam,
+                      FAR struct nxcamera_stats_s *stats);
+
 #undef EXTERN
 #ifdef __cplusplus
 }
@@ -48,6 +48,22 @@ struct nxplayer_dec_ops_s
   CODE int (*fill_data)(int fd, FAR struct ap_buffer_s *apb);
 };
 
+/* Read-ahead statistics of the last (or current) playback */
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+struct nxplayer_stats_s
+{
+  uint32_t window;     /* Prefetch window in buffers */
+  uint32_t buffers;    /* Buffers handed to the audio device */
+  uint32_t late;       /* Device requests that found the window empty */
+  uint32_t underruns;  /* Times the device ran out of queued buffers */
+  uint32_t lowwater;   /* Fewest buffers ready on a device request */
+  uint32_t maxread;    /* Slowest buffer read in microseconds */
+};
+
+struct nxplayer_prefetch_s;
+#endif
+
 /* This structure describes the internal state of the NxPlayer */
 
 struct nxplayer_s
@@ -83,6 +99,10 @@ struct nxplayer_s
 #endif
 
   FAR const struct nxplayer_dec_ops_s *ops;
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  FAR struct nxplayer_prefetch_s *prefetch;    /* Read-ahead state */
+  struct nxplayer_stats_s stats;               /* Read-ahead statistics */
+#endif
 };
 
 typedef int (*nxplayer_func)(FAR struct nxplayer_s *pplayer, char *pargs);
@@ -540,6 +560,26 @@ int nxplayer_parse_sbc(int fd, FAR uint32_t *samplerate,
 
 int nxplayer_fill_mp3(int fd, FAR struct ap_buffer_s *apb);
 
+/****************************************************************************
+ * Name: nxplayer_getstats
+ *
+ *   Returns the read-ahead statistics of the current playback, or of the
+ *   last one if the player is idle.
+ *
+ * Input Parameters:
+ *   pplayer   - Pointer to the context to initialize
+ *   stats     - Location to return the statistics
+ *
+ * Returned Value:
+ *   OK if the statistics were returned.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+int nxplayer_getstats(FAR struct nxplayer_s *pplayer,
+                      FAR struct nxplayer_stats_s *stats);
+#endif
+
 /****************************************************************************
  * Name: nxplayer_fill_common
  *
@@ -85,6 +85,7 @@ enum storage_type_e
 {
   STORAGE_BINARY = 0,
   STORAGE_TEXT,
+  STORAGE_JOURNAL,
 };
 
 /****************************************************************************
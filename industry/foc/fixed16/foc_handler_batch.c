@@ -0,0 +1,316 @@
+/****************************************************************************
+ * apps/industry/foc/fixed16/foc_handler_batch.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "industry/foc/foc_common.h"
+#include "industry/foc/fixed16/foc_handler.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if CONFIG_MOTOR_FOC_PHASES != 3
+#  error
+#endif
+
+/* Enable current samples correction if 3-shunts */
+
+#if CONFIG_MOTOR_FOC_SHUNTS == 3
+#  define FOC_CORRECT_CURRENT_SAMPLES 1
+#endif
+
+#define FOC_BATCH_ONE_BY_SQRT3  ftob16(0.57735026919f)
+#define FOC_BATCH_TWO_BY_SQRT3  ftob16(1.15470053838f)
+#define FOC_BATCH_SQRT3_BY_TWO  ftob16(0.86602540378f)
+
+/* PI anti-windup gain, the same as the single motor controller uses */
+
+#define FOC_BATCH_PI_KC         ftob16(0.99f)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: foc_handler_batch_init_b16
+ *
+ * Description:
+ *   Initialize the batched FOC handler (fixed16)
+ *
+ * Input Parameter:
+ *   h - pointer to batched FOC handler
+ *   n - number of motors
+ *
+ ****************************************************************************/
+
+int foc_handler_batch_init_b16(FAR struct foc_handler_batch_b16_s *h,
+                               int n)
+{
+  DEBUGASSERT(h);
+
+  if (n <= 0 || n > FOC_BATCH_MOTORS)
+    {
+      return -EINVAL;
+    }
+
+  memset(h, 0, sizeof(struct foc_handler_batch_b16_s));
+
+  h->n = n;
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: foc_handler_batch_cfg_b16
+ *
+ * Description:
+ *   Configure one motor of the batched FOC handler and reset its
+ *   controller state (fixed16)
+ *
+ * Input Parameter:
+ *   h        - pointer to batched FOC handler
+ *   motor    - motor index
+ *   ctrl_cfg - pointer to PI controller configuration data
+ *   mod_cfg  - pointer to modulation configuration data
+ *
+ ****************************************************************************/
+
+void foc_handler_batch_cfg_b16(FAR struct foc_handler_batch_b16_s *h,
+                               int motor,
+                               FAR struct foc_initdata_b16_s *ctrl_cfg,
+                               FAR struct foc_mod_cfg_b16_s *mod_cfg)
+{
+  DEBUGASSERT(h);
+  DEBUGASSERT(motor >= 0 && motor < h->n);
+  DEBUGASSERT(ctrl_cfg);
+  DEBUGASSERT(mod_cfg);
+
+  h->kp_d[motor]     = ctrl_cfg->id_kp;
+  h->ki_d[motor]     = ctrl_cfg->id_ki;
+  h->kp_q[motor]     = ctrl_cfg->iq_kp;
+  h->ki_q[motor]     = ctrl_cfg->iq_ki;
+  h->duty_max[motor] = mod_cfg->pwm_duty_max;
+
+  h->int_d[motor] = 0;
+  h->int_q[motor] = 0;
+  h->v_d[motor]   = 0;
+  h->v_q[motor]   = 0;
+  h->mode[motor]  = FOC_HANDLER_MODE_INIT;
+}
+
+/****************************************************************************
+ * Name: foc_handler_batch_run_b16
+ *
+ * Description:
+ *   Run the FOC handler for all motors in the batch (fixed16).
+ *
+ *   Each motor gets the same processing as foc_handler_run_b16() with the
+ *   PI controller and SVM3 modulation.  Motors that are not in the
+ *   current or voltage mode get zero duty.
+ *
+ * Input Parameter:
+ *   h - pointer to batched FOC handler
+ *
+ ****************************************************************************/
+
+void foc_handler_batch_run_b16(FAR struct foc_handler_batch_b16_s *h)
+{
+  phase_angle_b16_t angle;
+  int               i = 0;
+
+  DEBUGASSERT(h);
+
+  /* Phase angle sine and cosine */
+
+  for (i = 0; i < h->n; i++)
+    {
+      phase_angle_update_b16(&angle, h->angle[i]);
+
+      h->sin[i] = angle.sin;
+      h->cos[i] = angle.cos;
+    }
+
+#ifdef FOC_CORRECT_CURRENT_SAMPLES
+  /* The phase with the longest duty cycle in the last PWM period had the
+   * shortest current sampling window, get its current from the other two.
+   */
+
+  for (i = 0; i < h->n; i++)
+    {
+      b16_t ia   = h->current[0][i];
+      b16_t ib   = h->current[1][i];
+      b16_t ic   = h->current[2][i];
+      bool  umax = ((h->duty[0][i] >= h->duty[1][i]) &
+                    (h->duty[0][i] >= h->duty[2][i]));
+      bool  vmax = (!umax & (h->duty[1][i] >= h->duty[2][i]));
+
+      h->current[0][i] = umax ? -(ib + ic) : ia;
+      h->current[1][i] = vmax ? -(ia + ic) : ib;
+      h->current[2][i] = (umax | vmax) ? ic : -(ia + ib);
+    }
+#endif
+
+  for (i = 0; i < h->n; i++)
+    {
+      bool    current = (h->mode[i] == FOC_HANDLER_MODE_CURRENT);
+      bool    active  = (current |
+                         (h->mode[i] == FOC_HANDLER_MODE_VOLTAGE));
+      b16_t   sin     = h->sin[i];
+      b16_t   cos     = h->cos[i];
+      b16_t   i_a     = 0;
+      b16_t   i_b     = 0;
+      b16_t   i_d     = 0;
+      b16_t   i_q     = 0;
+      b16_t   mag_max = 0;
+      b16_t   scale   = 0;
+      b16_t   err_d   = 0;
+      b16_t   err_q   = 0;
+      b16_t   int_d   = 0;
+      b16_t   int_q   = 0;
+      b16_t   out_d   = 0;
+      b16_t   out_q   = 0;
+      b16_t   sat_d   = 0;
+      b16_t   sat_q   = 0;
+      b16_t   v_d     = 0;
+      b16_t   v_q     = 0;
+      b32_t   mag_sq  = 0;
+      b16_t   k       = 0;
+      b16_t   v_a     = 0;
+      b16_t   v_b     = 0;
+      b16_t   v_u     = 0;
+      b16_t   v_v     = 0;
+      b16_t   v_w     = 0;
+      b16_t   v_max   = 0;
+      b16_t   v_min   = 0;
+      b16_t   offset  = 0;
+      b16_t   d_u     = 0;
+      b16_t   d_v     = 0;
+      b16_t   d_w     = 0;
+
+      /* Clarke and Park transform of the phase currents */
+
+      i_a = h->current[0][i];
+      i_b = (b16mulb16(FOC_BATCH_ONE_BY_SQRT3, h->current[0][i]) +
+             b16mulb16(FOC_BATCH_TWO_BY_SQRT3, h->current[1][i]));
+      i_d = b16mulb16(i_a, cos) + b16mulb16(i_b, sin);
+      i_q = b16mulb16(i_b, cos) - b16mulb16(i_a, sin);
+
+      /* The DQ voltage magnitude is limited to the SVM3 base voltage */
+
+      mag_max = b16mulb16(h->vbus[i], FOC_BATCH_ONE_BY_SQRT3);
+      mag_max = mag_max > 0 ? mag_max : 0;
+
+      /* No division by zero when there is no bus voltage */
+
+      if (mag_max > 0)
+        {
+          scale = b16divb16(b16ONE, mag_max);
+        }
+
+      /* PI current controller with anti-windup, the integral parts are
+       * only updated in current mode
+       */
+
+      err_d = h->ref_d[i] - i_d;
+      err_q = h->ref_q[i] - i_q;
+      int_d = h->int_d[i] + b16mulb16(h->ki_d[i], err_d);
+      int_q = h->int_q[i] + b16mulb16(h->ki_q[i], err_q);
+      out_d = b16mulb16(h->kp_d[i], err_d) + int_d;
+      out_q = b16mulb16(h->kp_q[i], err_q) + int_q;
+      sat_d = out_d > mag_max ? mag_max : out_d;
+      sat_d = sat_d < -mag_max ? -mag_max : sat_d;
+      sat_q = out_q > mag_max ? mag_max : out_q;
+      sat_q = sat_q < -mag_max ? -mag_max : sat_q;
+      int_d = int_d - b16mulb16(FOC_BATCH_PI_KC, out_d - sat_d);
+      int_q = int_q - b16mulb16(FOC_BATCH_PI_KC, out_q - sat_q);
+
+      h->int_d[i] = current ? int_d : h->int_d[i];
+      h->int_q[i] = current ? int_q : h->int_q[i];
+
+      /* DQ voltage reference from the controller or from the caller */
+
+      v_d = current ? sat_d - h->comp_d[i] : h->ref_d[i];
+      v_q = current ? sat_q - h->comp_q[i] : h->ref_q[i];
+
+      /* Saturate DQ voltage vector, compare the squares to get the square
+       * root only when saturating
+       */
+
+      mag_sq = (b32_t)v_d * v_d + (b32_t)v_q * v_q;
+
+      if (mag_sq > (b32_t)mag_max * mag_max)
+        {
+          k   = b16divb16(mag_max, ub32sqrtub16((ub32_t)mag_sq));
+          v_d = b16mulb16(v_d, k);
+          v_q = b16mulb16(v_q, k);
+        }
+
+      /* Inverse Park transform and scale to the modulation range */
+
+      v_a = b16mulb16(b16mulb16(v_d, cos) - b16mulb16(v_q, sin), scale);
+      v_b = b16mulb16(b16mulb16(v_d, sin) + b16mulb16(v_q, cos), scale);
+
+      /* SVM3 as min-max zero sequence injection, which gives the same
+       * duty cycles as the sector based svm3()
+       */
+
+      v_u    = v_a;
+      v_v    = -(v_a >> 1) + b16mulb16(FOC_BATCH_SQRT3_BY_TWO, v_b);
+      v_w    = -(v_a >> 1) - b16mulb16(FOC_BATCH_SQRT3_BY_TWO, v_b);
+      v_max  = v_u > v_v ? v_u : v_v;
+      v_max  = v_max > v_w ? v_max : v_w;
+      v_min  = v_u < v_v ? v_u : v_v;
+      v_min  = v_min < v_w ? v_min : v_w;
+      offset = (v_max + v_min) >> 1;
+      d_u    = b16HALF + b16mulb16(v_u - offset, FOC_BATCH_ONE_BY_SQRT3);
+      d_v    = b16HALF + b16mulb16(v_v - offset, FOC_BATCH_ONE_BY_SQRT3);
+      d_w    = b16HALF + b16mulb16(v_w - offset, FOC_BATCH_ONE_BY_SQRT3);
+
+      /* Saturate duty cycle */
+
+      d_u = d_u > h->duty_max[i] ? h->duty_max[i] : d_u;
+      d_v = d_v > h->duty_max[i] ? h->duty_max[i] : d_v;
+      d_w = d_w > h->duty_max[i] ? h->duty_max[i] : d_w;
+      d_u = d_u < 0 ? 0 : d_u;
+      d_v = d_v < 0 ? 0 : d_v;
+      d_w = d_w < 0 ? 0 : d_w;
+
+      h->duty[0][i] = active ? d_u : 0;
+      h->duty[1][i] = active ? d_v : 0;
+      h->duty[2][i] = active ? d_w : 0;
+
+      h->i_d[i] = i_d;
+      h->i_q[i] = i_q;
+      h->v_d[i] = active ? v_d : h->v_d[i];
+      h->v_q[i] = active ? v_q : h->v_q[i];
+    }
+}
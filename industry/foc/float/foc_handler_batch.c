@@ -0,0 +1,307 @@
+/****************************************************************************
+ * apps/industry/foc/float/foc_handler_batch.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "industry/foc/foc_common.h"
+#include "industry/foc/float/foc_handler.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if CONFIG_MOTOR_FOC_PHASES != 3
+#  error
+#endif
+
+/* Enable current samples correction if 3-shunts */
+
+#if CONFIG_MOTOR_FOC_SHUNTS == 3
+#  define FOC_CORRECT_CURRENT_SAMPLES 1
+#endif
+
+#define FOC_BATCH_ONE_BY_SQRT3  (0.57735026919f)
+#define FOC_BATCH_TWO_BY_SQRT3  (1.15470053838f)
+#define FOC_BATCH_SQRT3_BY_TWO  (0.86602540378f)
+
+/* PI anti-windup gain, the same as the single motor controller uses */
+
+#define FOC_BATCH_PI_KC         (0.99f)
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: foc_handler_batch_init_f32
+ *
+ * Description:
+ *   Initialize the batched FOC handler (float32)
+ *
+ * Input Parameter:
+ *   h - pointer to batched FOC handler
+ *   n - number of motors
+ *
+ ****************************************************************************/
+
+int foc_handler_batch_init_f32(FAR struct foc_handler_batch_f32_s *h,
+                               int n)
+{
+  DEBUGASSERT(h);
+
+  if (n <= 0 || n > FOC_BATCH_MOTORS)
+    {
+      return -EINVAL;
+    }
+
+  memset(h, 0, sizeof(struct foc_handler_batch_f32_s));
+
+  h->n = n;
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: foc_handler_batch_cfg_f32
+ *
+ * Description:
+ *   Configure one motor of the batched FOC handler and reset its
+ *   controller state (float32)
+ *
+ * Input Parameter:
+ *   h        - pointer to batched FOC handler
+ *   motor    - motor index
+ *   ctrl_cfg - pointer to PI controller configuration data
+ *   mod_cfg  - pointer to modulation configuration data
+ *
+ ****************************************************************************/
+
+void foc_handler_batch_cfg_f32(FAR struct foc_handler_batch_f32_s *h,
+                               int motor,
+                               FAR struct foc_initdata_f32_s *ctrl_cfg,
+                               FAR struct foc_mod_cfg_f32_s *mod_cfg)
+{
+  DEBUGASSERT(h);
+  DEBUGASSERT(motor >= 0 && motor < h->n);
+  DEBUGASSERT(ctrl_cfg);
+  DEBUGASSERT(mod_cfg);
+
+  h->kp_d[motor]     = ctrl_cfg->id_kp;
+  h->ki_d[motor]     = ctrl_cfg->id_ki;
+  h->kp_q[motor]     = ctrl_cfg->iq_kp;
+  h->ki_q[motor]     = ctrl_cfg->iq_ki;
+  h->duty_max[motor] = mod_cfg->pwm_duty_max;
+
+  h->int_d[motor] = 0.0f;
+  h->int_q[motor] = 0.0f;
+  h->v_d[motor]   = 0.0f;
+  h->v_q[motor]   = 0.0f;
+  h->mode[motor]  = FOC_HANDLER_MODE_INIT;
+}
+
+/****************************************************************************
+ * Name: foc_handler_batch_run_f32
+ *
+ * Description:
+ *   Run the FOC handler for all motors in the batch (float32).
+ *
+ *   Each motor gets the same processing as foc_handler_run_f32() with the
+ *   PI controller and SVM3 modulation.  The mode selects the work per
+ *   motor without branching, motors that are not in the current or
+ *   voltage mode get zero duty.
+ *
+ * Input Parameter:
+ *   h - pointer to batched FOC handler
+ *
+ ****************************************************************************/
+
+void foc_handler_batch_run_f32(FAR struct foc_handler_batch_f32_s *h)
+{
+  phase_angle_f32_t angle;
+  int               i = 0;
+
+  DEBUGASSERT(h);
+
+  /* Phase angle sine and cosine.  This is the only scalar part,
+   * so it has a loop of its own.
+   */
+
+  for (i = 0; i < h->n; i++)
+    {
+      phase_angle_update(&angle, h->angle[i]);
+
+      h->sin[i] = angle.sin;
+      h->cos[i] = angle.cos;
+    }
+
+#ifdef FOC_CORRECT_CURRENT_SAMPLES
+  /* The phase with the longest duty cycle in the last PWM period had the
+   * shortest current sampling window, get its current from the other two.
+   */
+
+  for (i = 0; i < h->n; i++)
+    {
+      float ia   = h->current[0][i];
+      float ib   = h->current[1][i];
+      float ic   = h->current[2][i];
+      bool  umax = ((h->duty[0][i] >= h->duty[1][i]) &
+                    (h->duty[0][i] >= h->duty[2][i]));
+      bool  vmax = (!umax & (h->duty[1][i] >= h->duty[2][i]));
+
+      h->current[0][i] = umax ? -(ib + ic) : ia;
+      h->current[1][i] = vmax ? -(ia + ic) : ib;
+      h->current[2][i] = (umax | vmax) ? ic : -(ia + ib);
+    }
+#endif
+
+  for (i = 0; i < h->n; i++)
+    {
+      bool  current = (h->mode[i] == FOC_HANDLER_MODE_CURRENT);
+      bool  active  = (current | (h->mode[i] == FOC_HANDLER_MODE_VOLTAGE));
+      float sin     = h->sin[i];
+      float cos     = h->cos[i];
+      float i_a     = 0.0f;
+      float i_b     = 0.0f;
+      float i_d     = 0.0f;
+      float i_q     = 0.0f;
+      float mag_max = 0.0f;
+      float scale   = 0.0f;
+      float err_d   = 0.0f;
+      float err_q   = 0.0f;
+      float int_d   = 0.0f;
+      float int_q   = 0.0f;
+      float out_d   = 0.0f;
+      float out_q   = 0.0f;
+      float sat_d   = 0.0f;
+      float sat_q   = 0.0f;
+      float v_d     = 0.0f;
+      float v_q     = 0.0f;
+      float mag     = 0.0f;
+      float k       = 0.0f;
+      float v_a     = 0.0f;
+      float v_b     = 0.0f;
+      float v_u     = 0.0f;
+      float v_v     = 0.0f;
+      float v_w     = 0.0f;
+      float v_max   = 0.0f;
+      float v_min   = 0.0f;
+      float offset  = 0.0f;
+      float d_u     = 0.0f;
+      float d_v     = 0.0f;
+      float d_w     = 0.0f;
+
+      /* Clarke and Park transform of the phase currents */
+
+      i_a = h->current[0][i];
+      i_b = (FOC_BATCH_ONE_BY_SQRT3 * h->current[0][i] +
+             FOC_BATCH_TWO_BY_SQRT3 * h->current[1][i]);
+      i_d = i_a * cos + i_b * sin;
+      i_q = i_b * cos - i_a * sin;
+
+      /* The DQ voltage magnitude is limited to the SVM3 base voltage */
+
+      mag_max = h->vbus[i] * FOC_BATCH_ONE_BY_SQRT3;
+      mag_max = mag_max > 0.0f ? mag_max : 0.0f;
+      scale   = mag_max > 0.0f ? 1.0f / mag_max : 0.0f;
+
+      /* PI current controller with anti-windup, the integral parts are
+       * only updated in current mode
+       */
+
+      err_d = h->ref_d[i] - i_d;
+      err_q = h->ref_q[i] - i_q;
+      int_d = h->int_d[i] + h->ki_d[i] * err_d;
+      int_q = h->int_q[i] + h->ki_q[i] * err_q;
+      out_d = h->kp_d[i] * err_d + int_d;
+      out_q = h->kp_q[i] * err_q + int_q;
+      sat_d = out_d > mag_max ? mag_max : out_d;
+      sat_d = sat_d < -mag_max ? -mag_max : sat_d;
+      sat_q = out_q > mag_max ? mag_max : out_q;
+      sat_q = sat_q < -mag_max ? -mag_max : sat_q;
+      int_d = int_d - FOC_BATCH_PI_KC * (out_d - sat_d);
+      int_q = int_q - FOC_BATCH_PI_KC * (out_q - sat_q);
+
+      h->int_d[i] = current ? int_d : h->int_d[i];
+      h->int_q[i] = current ? int_q : h->int_q[i];
+
+      /* DQ voltage reference from the controller or from the caller */
+
+      v_d = current ? sat_d - h->comp_d[i] : h->ref_d[i];
+      v_q = current ? sat_q - h->comp_q[i] : h->ref_q[i];
+
+      /* Saturate DQ voltage vector */
+
+      mag = sqrtf(v_d * v_d + v_q * v_q);
+      k   = mag > mag_max ? mag_max / mag : 1.0f;
+      v_d = v_d * k;
+      v_q = v_q * k;
+
+      /* Inverse Park transform and scale to the modulation range */
+
+      v_a = (v_d * cos - v_q * sin) * scale;
+      v_b = (v_d * sin + v_q * cos) * scale;
+
+      /* SVM3 as min-max zero sequence injection, which gives the same
+       * duty cycles as the sector based svm3()
+       */
+
+      v_u    = v_a;
+      v_v    = -0.5f * v_a + FOC_BATCH_SQRT3_BY_TWO * v_b;
+      v_w    = -0.5f * v_a - FOC_BATCH_SQRT3_BY_TWO * v_b;
+      v_max  = v_u > v_v ? v_u : v_v;
+      v_max  = v_max > v_w ? v_max : v_w;
+      v_min  = v_u < v_v ? v_u : v_v;
+      v_min  = v_min < v_w ? v_min : v_w;
+      offset = 0.5f * (v_max + v_min);
+      d_u    = 0.5f + (v_u - offset) * FOC_BATCH_ONE_BY_SQRT3;
+      d_v    = 0.5f + (v_v - offset) * FOC_BATCH_ONE_BY_SQRT3;
+      d_w    = 0.5f + (v_w - offset) * FOC_BATCH_ONE_BY_SQRT3;
+
+      /* Saturate duty cycle */
+
+      d_u = d_u > h->duty_max[i] ? h->duty_max[i] : d_u;
+      d_v = d_v > h->duty_max[i] ? h->duty_max[i] : d_v;
+      d_w = d_w > h->duty_max[i] ? h->duty_max[i] : d_w;
+      d_u = d_u < 0.0f ? 0.0f : d_u;
+      d_v = d_v < 0.0f ? 0.0f : d_v;
+      d_w = d_w < 0.0f ? 0.0f : d_w;
+
+      h->duty[0][i] = active ? d_u : 0.0f;
+      h->duty[1][i] = active ? d_v : 0.0f;
+      h->duty[2][i] = active ? d_w : 0.0f;
+
+      h->i_d[i] = i_d;
+      h->i_q[i] = i_q;
+      h->v_d[i] = active ? v_d : h->v_d[i];
+      h->v_q[i] = active ? v_q : h->v_q[i];
+    }
+}
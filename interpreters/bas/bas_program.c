@@ -210,6 +210,85 @@ static void printName(const void *k, struct Program *p, int chn)
     }
 }
 
+/* The line index lists the code[] positions of all numbered lines.  If
+ * their numbers ascend through code[], which is the normal case, lines are
+ * looked up with a binary search instead of a scan of the whole program.
+ * The index is dropped whenever code[] changes and built again on the next
+ * lookup.
+ */
+
+static void buildIndex(struct Program *self)
+{
+  int i;
+
+  self->lineIndexSize = 0;
+  self->lineIndexOrdered = 1;
+  if (self->lineIndexCapacity < self->size)
+    {
+      int *index = realloc(self->lineIndex, sizeof(int) * self->size);
+
+      if (index == (int *)0)
+        {
+          self->lineIndexValid = 0;
+          return;
+        }
+
+      self->lineIndex = index;
+      self->lineIndexCapacity = self->size;
+    }
+
+  for (i = 0; i < self->size; ++i)
+    {
+      if (self->code[i]->type == T_INTEGER)
+        {
+          if (self->lineIndexSize > 0 &&
+              self->code[self->lineIndex[self->lineIndexSize - 1]]->
+              u.integer >= self->code[i]->u.integer)
+            {
+              self->lineIndexOrdered = 0;
+            }
+
+          self->lineIndex[self->lineIndexSize++] = i;
+        }
+    }
+
+  self->lineIndexValid = 1;
+}
+
+static int useIndex(struct Program *self)
+{
+  if (!self->lineIndexValid)
+    {
+      buildIndex(self);
+    }
+
+  return self->lineIndexValid && self->lineIndexOrdered;
+}
+
+/* Return the first index position whose line number is >= line */
+
+static int findIndex(struct Program *self, long int line)
+{
+  int low = 0;
+  int high = self->lineIndexSize;
+
+  while (low < high)
+    {
+      int mid = (low + high) / 2;
+
+      if (self->code[self->lineIndex[mid]]->u.integer < line)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  return low;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -224,6 +303,11 @@ struct Program *Program_new(struct Program *self)
   self->unsaved = 0;
   self->code = (struct Token **)0;
   self->scope = (struct Scope *)0;
+  self->lineIndex = (int *)0;
+  self->lineIndexSize = 0;
+  self->lineIndexCapacity = 0;
+  self->lineIndexValid = 1;
+  self->lineIndexOrdered = 1;
   String_new(&self->name);
   return self;
 }
@@ -240,8 +324,12 @@ void Program_destroy(struct Program *self)
       free(self->code);
     }
 
+  free(self->lineIndex);
   self->code = (struct Token **)0;
   self->scope = (struct Scope *)0;
+  self->lineIndex = (int *)0;
+  self->lineIndexCapacity = 0;
+  self->lineIndexValid = 0;
   String_destroy(&self->name);
 }
 
@@ -263,6 +351,41 @@ void Program_store(struct Program *self, struct Token *line, long int where)
       self->numbered = 0;
     }
 
+  /* Appending a line after the last one, as when loading a program, keeps
+   * the index valid.
+   */
+
+  if (where && line->type == T_INTEGER && self->lineIndexValid &&
+      self->lineIndexOrdered && self->lineIndexSize == self->size &&
+      (self->size == 0 ||
+       where > self->code[self->size - 1]->u.integer))
+    {
+      if (self->lineIndexCapacity <= self->size)
+        {
+          int capacity = self->size < 128 ? 256 : self->size * 2;
+          int *index = realloc(self->lineIndex, sizeof(int) * capacity);
+
+          if (index == (int *)0)
+            {
+              self->lineIndexValid = 0;
+            }
+          else
+            {
+              self->lineIndex = index;
+              self->lineIndexCapacity = capacity;
+            }
+        }
+
+      if (self->lineIndexValid)
+        {
+          self->lineIndex[self->lineIndexSize++] = self->size;
+        }
+    }
+  else
+    {
+      self->lineIndexValid = 0;
+    }
+
   if (where)
     {
       int last = -1;
@@ -325,6 +448,7 @@ void Program_delete(struct Program *self, const struct Pc *from,
 
   self->runnable = 0;
   self->unsaved = 1;
+  self->lineIndexValid = 0;
   first = from ? from->line : 0;
   last = to ? to->line : self->size - 1;
   for (i = first; i <= last; ++i)
@@ -354,6 +478,20 @@ struct Pc *Program_goLine(struct Program *self, long int line, struct Pc *pc)
 {
   int i;
 
+  if (useIndex(self))
+    {
+      i = findIndex(self, line);
+      if (i == self->lineIndexSize ||
+          self->code[self->lineIndex[i]]->u.integer != line)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->lineIndex[i];
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = 0; i < self->size; ++i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -373,6 +511,19 @@ struct Pc *Program_fromLine(struct Program *self, long int line,
 {
   int i;
 
+  if (useIndex(self))
+    {
+      i = findIndex(self, line);
+      if (i == self->lineIndexSize)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->lineIndex[i];
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = 0; i < self->size; ++i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -391,6 +542,25 @@ struct Pc *Program_toLine(struct Program *self, long int line, struct Pc *pc)
 {
   int i;
 
+  if (useIndex(self))
+    {
+      i = findIndex(self, line);
+      if (i == self->lineIndexSize ||
+          self->code[self->lineIndex[i]]->u.integer != line)
+        {
+          --i;
+        }
+
+      if (i < 0)
+        {
+          return (struct Pc *)0;
+        }
+
+      pc->line = self->lineIndex[i];
+      pc->token = self->code[pc->line] + 1;
+      return pc;
+    }
+
   for (i = self->size - 1; i >= 0; --i)
     {
       if (self->code[i]->type == T_INTEGER &&
@@ -868,6 +1038,7 @@ void Program_renum(struct Program *self, int first, int inc)
       self->code[i]->u.integer = first + i * inc;
     }
 
+  self->lineIndexValid = 0;
   self->numbered = 1;
   self->runnable = 0;
   self->unsaved = 1;
@@ -924,6 +1095,7 @@ void Program_unnum(struct Program *self)
     }
 
   free(ref);
+  self->lineIndexValid = 0;
   self->runnable = 0;
   self->unsaved = 1;
 }
@@ -62,6 +62,11 @@ struct Program
   struct String name;
   struct Token **code;
   struct Scope *scope;
+  int *lineIndex;               /* code[] positions of numbered lines */
+  int lineIndexSize;
+  int lineIndexCapacity;
+  int lineIndexValid;           /* lineIndex[] matches code[] */
+  int lineIndexOrdered;         /* Line numbers ascend through code[] */
 };
 
 #endif /* __APPS_EXAMPLES_BAS_BAS_PROGRAMTYPES_H */
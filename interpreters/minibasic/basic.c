@@ -159,6 +159,43 @@
 
 #define MAXFORS 32              /* Maximum number of nested fors */
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+#  define MAXSTACK 32           /* Maximum depth of the bytecode stack */
+
+/* Bytecode operations.  Operands follow the opcode in the code stream. */
+
+#  define BC_END 0              /* end of line, continue with the next */
+#  define BC_CONST 1            /* k: push constant k */
+#  define BC_LOAD 2             /* r: push scalar variable r */
+#  define BC_DIMREF 3           /* r: check that array r exists */
+#  define BC_LOADDIM 4          /* r n: pop n subscripts, push element */
+#  define BC_INT 5              /* check that the top is an integer */
+#  define BC_LVAL 6             /* r: scalar variable r is the target */
+#  define BC_LVALDIM 7          /* r n: pop n subscripts, element is target */
+#  define BC_STORE 8            /* pop into the target */
+#  define BC_NEG 9
+#  define BC_ADD 10
+#  define BC_SUB 11
+#  define BC_MUL 12
+#  define BC_DIV 13
+#  define BC_MOD 14
+#  define BC_POW 15
+#  define BC_FACT 16
+#  define BC_FUNC 17            /* f: apply function token f to the top */
+#  define BC_CMP 18             /* rop: compare the two top values */
+#  define BC_AND 19
+#  define BC_OR 20
+#  define BC_PRINTNUM 21        /* pop and print a number */
+#  define BC_PRINTSTR 22        /* s: print string literal s */
+#  define BC_PRINTSEP 23        /* print the separator of a comma */
+#  define BC_PRINTEOL 24        /* print the newline ending a PRINT */
+#  define BC_FLUSH 25           /* flush output after a PRINT ending in ; */
+#  define BC_JUMPIF 26          /* i: pop, jump to line index i if true */
+#  define BC_GOTO 27            /* i: jump to line index i */
+#  define BC_FOR 28             /* r i: pop step, to and init, skip to i */
+#  define BC_NEXT 29            /* r: step the innermost loop */
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -167,6 +204,9 @@ struct mb_line_s
 {
   int no;                       /* Line number */
   FAR const char *str;          /* Points to start of line */
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+  int pc;                       /* Offset of its bytecode, -1 if none */
+#endif
 };
 
 struct mb_variable_s
@@ -197,10 +237,21 @@ struct mb_forloop_s
 {
   char id[32];                  /* Id of control variable */
   int nextline;                 /* Line below FOR to which control passes */
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+  int nextindex;                /* Index of nextline, -1 if not looked up */
+#endif
   double toval;                 /* Terminal value */
   double step;                  /* Step size */
 };
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+struct mb_ref_s
+{
+  char id[32];                  /* Id of variable referenced by bytecode */
+  int index;                    /* Its index in the table, -1 if not found */
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -236,6 +287,19 @@ static int g_token;                             /* Current token (lookahead) */
 static int g_errorflag;                         /* Set when error in input encountered */
 static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+static FAR int *g_code;                         /* Bytecode of all lines */
+static int g_ncode;                             /* Words of bytecode */
+static int g_codealloc;                         /* Words allocated */
+static FAR double *g_consts;                    /* Numeric constants */
+static int g_nconsts;                           /* Number of constants */
+static FAR char **g_strs;                       /* String literals */
+static int g_nstrs;                             /* Number of literals */
+static FAR struct mb_ref_s *g_refs;             /* Variable references */
+static int g_nrefs;                             /* Number of references */
+static int g_depth;                             /* Compile time stack depth */
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -256,6 +320,7 @@ static void doinput(void);
 static void dorem(void);
 static int dofor(void);
 static int donext(void);
+static FAR const char *findnext(FAR const char *id);
 
 static void lvalue(FAR struct mb_lvalue_s *lv);
 
@@ -308,6 +373,30 @@ static FAR char *mystrdup(FAR const char *str);
 static FAR char *mystrconcat(FAR const char *str, FAR const char *cat);
 static double factorial(double x);
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+static void compile(void);
+static void cline(void);
+static void cprint(void);
+static void clvalue(void);
+static int cjump(void);
+static void cfor(void);
+static void cnext(void);
+static void cboolexpr(void);
+static void cboolfactor(void);
+static void cexpr(void);
+static void cterm(void);
+static void cfactor(void);
+static int csubscripts(void);
+static void cconst(double x);
+static int addref(FAR const char *id);
+static void emit(int word);
+static void emitop(int op, int depth);
+static int execute(int curline);
+static double function(int tok, double x);
+static FAR double *dimelement(FAR struct mb_dimvar_s *dv,
+                              FAR const double *index);
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -465,6 +554,28 @@ static void cleanup(void)
 
   g_lines = 0;
   nlines = 0;
+
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+  for (i = 0; i < g_nstrs; i++)
+    {
+      free(g_strs[i]);
+    }
+
+  free(g_strs);
+  free(g_refs);
+  free(g_consts);
+  free(g_code);
+
+  g_strs = 0;
+  g_nstrs = 0;
+  g_refs = 0;
+  g_nrefs = 0;
+  g_consts = 0;
+  g_nconsts = 0;
+  g_code = 0;
+  g_ncode = 0;
+  g_codealloc = 0;
+#endif
 }
 
 /****************************************************************************
@@ -1016,12 +1127,12 @@ static int dofor(void)
 {
   struct mb_lvalue_s lv;
   char id[32];
-  char nextid[32];
   int len;
   double initval;
   double toval;
   double stepval;
   FAR const char *savestring;
+  FAR const char *str;
   int answer;
 
   match(FOR);
@@ -1061,28 +1172,16 @@ static int dofor(void)
       (stepval > 0 && initval > toval))
     {
       savestring = g_string;
-      while ((g_string = strchr(g_string, '\n')) != NULL)
+      str = findnext(id);
+      g_string = savestring;
+      g_token = gettoken(g_string);
+      if (str)
         {
-          g_errorflag = 0;
-          g_token = gettoken(g_string);
-          match(VALUE);
-          if (g_token == NEXT)
-            {
-              match(NEXT);
-              if (g_token == FLTID || g_token == DIMFLTID)
-                {
-                  getid(g_string, nextid, &len);
-                  if (!strcmp(id, nextid))
-                    {
-                      answer = getnextline(g_string);
-                      g_string = savestring;
-                      g_token = gettoken(g_string);
-                      return answer ? answer : -1;
-                    }
-                }
-            }
+          answer = getnextline(str);
+          return answer ? answer : -1;
         }
 
+      g_errorflag = 0;
       seterror(ERR_NONEXT);
       return -1;
     }
@@ -1090,6 +1189,9 @@ static int dofor(void)
     {
       strlcpy(g_forstack[nfors].id, id, sizeof(g_forstack[nfors].id));
       g_forstack[nfors].nextline = getnextline(g_string);
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+      g_forstack[nfors].nextindex = -1;
+#endif
       g_forstack[nfors].step = stepval;
       g_forstack[nfors].toval = toval;
       nfors++;
@@ -1145,6 +1247,45 @@ static int donext(void)
     }
 }
 
+/****************************************************************************
+ * Name: findnext
+ *
+ * Description:
+ *   Scan forwards from g_string for the NEXT matching a FOR.
+ *   Params: id - id of the control variable
+ *   Returns: position just after the id of the NEXT, NULL if none.
+ *   Notes: moves g_string and clears g_errorflag, callers restore them.
+ *
+ ****************************************************************************/
+
+static FAR const char *findnext(FAR const char *id)
+{
+  char nextid[32];
+  int len;
+
+  while ((g_string = strchr(g_string, '\n')) != NULL)
+    {
+      g_string++;
+      g_errorflag = 0;
+      g_token = gettoken(g_string);
+      match(VALUE);
+      if (g_token == NEXT)
+        {
+          match(NEXT);
+          if (g_token == FLTID || g_token == DIMFLTID)
+            {
+              getid(g_string, nextid, &len);
+              if (!strcmp(id, nextid))
+                {
+                  return g_string;
+                }
+            }
+        }
+    }
+
+  return NULL;
+}
+
 /****************************************************************************
  * Name: doinput
  *
@@ -4059,44 +4200,1314 @@ static double factorial(double x)
   return answer;
 }
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
 /****************************************************************************
- * Public Functions
+ * Name: compile
+ *
+ * Description:
+ *   Translate every line that the bytecode can express.
+ *   Lines that fail to compile keep pc -1 and are interpreted from the
+ *   text as before, so syntax errors are still reported when reached.
+ *
  ****************************************************************************/
 
+static void compile(void)
+{
+  int start;
+  int i;
+
+  for (i = 0; i < nlines; i++)
+    {
+      g_string = g_lines[i].str;
+      g_token = gettoken(g_string);
+      g_errorflag = 0;
+      g_depth = 0;
+
+      start = g_ncode;
+      cline();
+      if (g_errorflag)
+        {
+          g_ncode = start;
+          g_lines[i].pc = -1;
+        }
+      else
+        {
+          g_lines[i].pc = start;
+        }
+    }
+
+  g_errorflag = 0;
+}
+
 /****************************************************************************
- * Name: basic
+ * Name: cline
  *
  * Description:
- *   Interpret a BASIC script
+ *   Compile a line.  Mirrors line(); any error means "not compiled".
  *
- * Input Parameters:
- *   script - the script to run
- *   in     - input stream
- *   out    - output stream
- *   err    - error stream
+ ****************************************************************************/
+
+static void cline(void)
+{
+  FAR const char *str;
+
+  match(VALUE);
+
+  switch (g_token)
+    {
+    case PRINT:
+      cprint();
+      break;
+
+    case LET:
+      match(LET);
+      clvalue();
+      match(EQUALS);
+      cexpr();
+      emitop(BC_STORE, -1);
+      break;
+
+    case IF:
+      match(IF);
+      cboolexpr();
+      match(THEN);
+      emitop(BC_JUMPIF, -1);
+      emit(cjump());
+      break;
+
+    case GOTO:
+      match(GOTO);
+      emitop(BC_GOTO, 0);
+      emit(cjump());
+      break;
+
+    case REM:
+      emitop(BC_END, 0);
+      return;
+
+    case FOR:
+      cfor();
+      break;
+
+    case NEXT:
+      cnext();
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      return;
+    }
+
+  if (g_token != EOS)
+    {
+      str = g_string;
+      while (isspace(*str))
+        {
+          if (*str == '\n')
+            {
+              break;
+            }
+
+          str++;
+        }
+
+      if (*str != '\n')
+        {
+          seterror(ERR_SYNTAX);
+        }
+    }
+
+  emitop(BC_END, 0);
+}
+
+/****************************************************************************
+ * Name: cprint
  *
- * Returned Value:
- *   Returns: 0 on success, 1 on error condition.
+ * Description:
+ *   Compile a PRINT of numbers and string literals
  *
  ****************************************************************************/
 
-int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
+static void cprint(void)
 {
-  int curline = 0;
-  int nextline;
-  int answer = 0;
+  FAR char **strs;
+  FAR char *str;
 
-  g_fpin = in;
-  g_fpout = out;
-  g_fperr = err;
+  match(PRINT);
 
-  if (setup(script) == -1)
+  while (1)
     {
-      return 1;
+      if (isstring(g_token))
+        {
+          if (g_token != QUOTE)
+            {
+              seterror(ERR_SYNTAX);
+              return;
+            }
+
+          str = stringliteral();
+          if (!str || g_token == PLUS)
+            {
+              free(str);
+              seterror(ERR_SYNTAX);
+              return;
+            }
+
+          strs = realloc(g_strs, (g_nstrs + 1) * sizeof(FAR char *));
+          if (!strs)
+            {
+              free(str);
+              seterror(ERR_OUTOFMEMORY);
+              return;
+            }
+
+          g_strs = strs;
+          g_strs[g_nstrs] = str;
+          emitop(BC_PRINTSTR, 0);
+          emit(g_nstrs++);
+        }
+      else
+        {
+          cexpr();
+          emitop(BC_PRINTNUM, -1);
+        }
+
+      if (g_token == COMMA)
+        {
+          emitop(BC_PRINTSEP, 0);
+          match(COMMA);
+        }
+      else
+        {
+          break;
+        }
     }
 
-  while (curline != -1)
+  if (g_token == SEMICOLON)
+    {
+      match(SEMICOLON);
+      emitop(BC_FLUSH, 0);
+    }
+  else
+    {
+      emitop(BC_PRINTEOL, 0);
+    }
+}
+
+/****************************************************************************
+ * Name: clvalue
+ *
+ * Description:
+ *   Compile a numeric lvalue.  The target is selected before the value
+ *   is computed, in the same order as lvalue() then expr().
+ *
+ ****************************************************************************/
+
+static void clvalue(void)
+{
+  char id[32];
+  int len;
+  int ref;
+  int n;
+
+  switch (g_token)
+    {
+    case FLTID:
+      getid(g_string, id, &len);
+      match(FLTID);
+      emitop(BC_LVAL, 0);
+      emit(addref(id));
+      break;
+
+    case DIMFLTID:
+      getid(g_string, id, &len);
+      match(DIMFLTID);
+      ref = addref(id);
+      emitop(BC_DIMREF, 0);
+      emit(ref);
+      n = csubscripts();
+      emitop(BC_LVALDIM, -n);
+      emit(ref);
+      emit(n);
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      break;
+    }
+}
+
+/****************************************************************************
+ * Name: cjump
+ *
+ * Description:
+ *   Compile the constant target of IF ... THEN or GOTO
+ *   Returns: index of the target line
+ *
+ ****************************************************************************/
+
+static int cjump(void)
+{
+  double x;
+  int len;
+  int target = -1;
+
+  if (g_token == VALUE)
+    {
+      x = getvalue(g_string, &len);
+      if (x >= 1 && x <= INT_MAX && x == floor(x))
+        {
+          target = findline((int)x);
+        }
+    }
+
+  match(VALUE);
+  if (target < 0)
     {
+      seterror(ERR_SYNTAX);
+    }
+
+  return target;
+}
+
+/****************************************************************************
+ * Name: cfor
+ *
+ * Description:
+ *   Compile a FOR.  Where control goes if the loop is not entered is
+ *   found once here instead of scanning the text each time.
+ *
+ ****************************************************************************/
+
+static void cfor(void)
+{
+  FAR const char *savestring;
+  FAR const char *str;
+  char id[32];
+  int errorflag;
+  int token;
+  int len;
+  int skip;
+
+  match(FOR);
+  if (g_token != FLTID)
+    {
+      seterror(ERR_SYNTAX);
+      return;
+    }
+
+  getid(g_string, id, &len);
+  clvalue();
+  match(EQUALS);
+  cexpr();
+  match(TO);
+  cexpr();
+
+  if (g_token == STEP)
+    {
+      match(STEP);
+      cexpr();
+    }
+  else
+    {
+      cconst(1.0);
+    }
+
+  savestring = g_string;
+  token = g_token;
+  errorflag = g_errorflag;
+
+  str = findnext(id);
+
+  g_string = savestring;
+  g_token = token;
+  g_errorflag = errorflag;
+
+  skip = -1;
+  if (str == NULL)
+    {
+      seterror(ERR_SYNTAX);
+    }
+  else if ((len = getnextline(str)) != 0)
+    {
+      skip = findline(len);
+    }
+
+  emitop(BC_FOR, -3);
+  emit(addref(id));
+  emit(skip);
+}
+
+/****************************************************************************
+ * Name: cnext
+ *
+ * Description:
+ *   Compile a NEXT
+ *
+ ****************************************************************************/
+
+static void cnext(void)
+{
+  char id[32];
+  int len;
+
+  match(NEXT);
+  if (g_token != FLTID)
+    {
+      seterror(ERR_SYNTAX);
+      return;
+    }
+
+  getid(g_string, id, &len);
+  match(FLTID);
+  emitop(BC_NEXT, 0);
+  emit(addref(id));
+}
+
+/****************************************************************************
+ * Name: cboolexpr
+ *
+ * Description:
+ *   Compile a boolean expression.  Mirrors boolexpr(), including its
+ *   right associativity and evaluation of both operands.
+ *
+ ****************************************************************************/
+
+static void cboolexpr(void)
+{
+  cboolfactor();
+
+  switch (g_token)
+    {
+    case AND:
+      match(AND);
+      cboolexpr();
+      emitop(BC_AND, -1);
+      break;
+
+    case OR:
+      match(OR);
+      cboolexpr();
+      emitop(BC_OR, -1);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/****************************************************************************
+ * Name: cboolfactor
+ *
+ * Description:
+ *   Compile a numeric comparison or ( boolexpr )
+ *
+ ****************************************************************************/
+
+static void cboolfactor(void)
+{
+  int op;
+
+  if (g_token == OPAREN)
+    {
+      match(OPAREN);
+      cboolexpr();
+      match(CPAREN);
+    }
+  else if (isstring(g_token))
+    {
+      seterror(ERR_SYNTAX);
+    }
+  else
+    {
+      cexpr();
+      op = relop();
+      cexpr();
+      emitop(BC_CMP, -1);
+      emit(op);
+    }
+}
+
+/****************************************************************************
+ * Name: cexpr
+ *
+ * Description:
+ *   Compile an expression
+ *
+ ****************************************************************************/
+
+static void cexpr(void)
+{
+  cterm();
+
+  while (1)
+    {
+      switch (g_token)
+        {
+        case PLUS:
+          match(PLUS);
+          cterm();
+          emitop(BC_ADD, -1);
+          break;
+
+        case MINUS:
+          match(MINUS);
+          cterm();
+          emitop(BC_SUB, -1);
+          break;
+
+        default:
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: cterm
+ *
+ * Description:
+ *   Compile a term
+ *
+ ****************************************************************************/
+
+static void cterm(void)
+{
+  cfactor();
+
+  while (1)
+    {
+      switch (g_token)
+        {
+        case MULT:
+          match(MULT);
+          cfactor();
+          emitop(BC_MUL, -1);
+          break;
+
+        case DIV:
+          match(DIV);
+          cfactor();
+          emitop(BC_DIV, -1);
+          break;
+
+        case MOD:
+          match(MOD);
+          cfactor();
+          emitop(BC_MOD, -1);
+          break;
+
+        default:
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: cfactor
+ *
+ * Description:
+ *   Compile a numeric factor.  String functions are not compiled.
+ *
+ ****************************************************************************/
+
+static void cfactor(void)
+{
+  char id[32];
+  int len;
+  int tok;
+  int ref;
+  int n;
+
+  switch (g_token)
+    {
+    case OPAREN:
+      match(OPAREN);
+      cexpr();
+      match(CPAREN);
+      break;
+
+    case VALUE:
+      cconst(getvalue(g_string, &len));
+      match(VALUE);
+      break;
+
+    case MINUS:
+      match(MINUS);
+      cfactor();
+      emitop(BC_NEG, 0);
+      break;
+
+    case FLTID:
+      getid(g_string, id, &len);
+      match(FLTID);
+      emitop(BC_LOAD, 1);
+      emit(addref(id));
+      break;
+
+    case DIMFLTID:
+      getid(g_string, id, &len);
+      match(DIMFLTID);
+      ref = addref(id);
+      emitop(BC_DIMREF, 0);
+      emit(ref);
+      n = csubscripts();
+      emitop(BC_LOADDIM, 1 - n);
+      emit(ref);
+      emit(n);
+      break;
+
+    case E:
+      match(E);
+      cconst(exp(1.0));
+      break;
+
+    case PI:
+      match(PI);
+      cconst(acos(0.0) * 2.0);
+      break;
+
+    case SIN:
+    case COS:
+    case TAN:
+    case LN:
+    case SQRT:
+    case ABS:
+    case ASIN:
+    case ACOS:
+    case ATAN:
+    case INT:
+    case RND:
+      tok = g_token;
+      match(tok);
+      match(OPAREN);
+      cexpr();
+      match(CPAREN);
+      emitop(BC_FUNC, 0);
+      emit(tok);
+      break;
+
+    case POW:
+      match(POW);
+      match(OPAREN);
+      cexpr();
+      match(COMMA);
+      cexpr();
+      match(CPAREN);
+      emitop(BC_POW, -1);
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      return;
+    }
+
+  while (g_token == SHRIEK)
+    {
+      match(SHRIEK);
+      emitop(BC_FACT, 0);
+    }
+}
+
+/****************************************************************************
+ * Name: csubscripts
+ *
+ * Description:
+ *   Compile the subscripts of an array up to the closing parenthesis
+ *   Returns: number of subscripts
+ *
+ ****************************************************************************/
+
+static int csubscripts(void)
+{
+  int n = 0;
+
+  while (1)
+    {
+      cexpr();
+      emitop(BC_INT, 0);
+      n++;
+
+      if (g_token != COMMA)
+        {
+          break;
+        }
+
+      match(COMMA);
+    }
+
+  match(CPAREN);
+
+  /* getdimvar() is only called with up to four subscripts */
+
+  if (n > 4)
+    {
+      seterror(ERR_SYNTAX);
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: cconst
+ *
+ * Description:
+ *   Compile pushing a constant
+ *
+ ****************************************************************************/
+
+static void cconst(double x)
+{
+  FAR double *consts;
+
+  consts = realloc(g_consts, (g_nconsts + 1) * sizeof(double));
+  if (!consts)
+    {
+      seterror(ERR_OUTOFMEMORY);
+      return;
+    }
+
+  g_consts = consts;
+  g_consts[g_nconsts] = x;
+  emitop(BC_CONST, 1);
+  emit(g_nconsts++);
+}
+
+/****************************************************************************
+ * Name: addref
+ *
+ * Description:
+ *   Get the reference for a variable, shared by all uses of the id.
+ *   The variable itself is looked up when the bytecode first runs.
+ *   Returns: index of the reference
+ *
+ ****************************************************************************/
+
+static int addref(FAR const char *id)
+{
+  FAR struct mb_ref_s *refs;
+  int i;
+
+  for (i = 0; i < g_nrefs; i++)
+    {
+      if (!strcmp(g_refs[i].id, id))
+        {
+          return i;
+        }
+    }
+
+  refs = realloc(g_refs, (g_nrefs + 1) * sizeof(struct mb_ref_s));
+  if (!refs)
+    {
+      seterror(ERR_OUTOFMEMORY);
+      return 0;
+    }
+
+  g_refs = refs;
+  strlcpy(g_refs[g_nrefs].id, id, sizeof(g_refs[g_nrefs].id));
+  g_refs[g_nrefs].index = -1;
+  return g_nrefs++;
+}
+
+/****************************************************************************
+ * Name: emit
+ *
+ * Description:
+ *   Append a word to the bytecode
+ *
+ ****************************************************************************/
+
+static void emit(int word)
+{
+  FAR int *code;
+  int alloc;
+
+  if (g_ncode == g_codealloc)
+    {
+      alloc = g_codealloc ? g_codealloc * 2 : 256;
+      code = realloc(g_code, alloc * sizeof(int));
+      if (!code)
+        {
+          seterror(ERR_OUTOFMEMORY);
+          return;
+        }
+
+      g_code = code;
+      g_codealloc = alloc;
+    }
+
+  g_code[g_ncode++] = word;
+}
+
+/****************************************************************************
+ * Name: emitop
+ *
+ * Description:
+ *   Append an operation and track the stack depth it leaves
+ *   Params: op - the operation
+ *           depth - values it pushes less values it pops
+ *
+ ****************************************************************************/
+
+static void emitop(int op, int depth)
+{
+  emit(op);
+
+  g_depth += depth;
+  if (g_depth > MAXSTACK)
+    {
+      seterror(ERR_SYNTAX);
+    }
+}
+
+/****************************************************************************
+ * Name: execute
+ *
+ * Description:
+ *   Run the bytecode of a line.
+ *   Like line(), execution continues after most errors so the output
+ *   matches, and the caller checks g_errorflag.  Errors that would have
+ *   thrown the parser out of step (a missing array, a wrong number of
+ *   subscripts) stop the line at once.
+ *   Params: curline - index of the line
+ *   Returns: index of the line to run next, -1 to end the program,
+ *            -2 on an error already reported.
+ *
+ ****************************************************************************/
+
+static int execute(int curline)
+{
+  double stack[MAXSTACK];
+  FAR double *sp = stack;
+  FAR const int *pc = &g_code[g_lines[curline].pc];
+  FAR struct mb_variable_s *var;
+  FAR struct mb_dimvar_s *dv;
+  FAR struct mb_forloop_s *loop;
+  FAR struct mb_ref_s *ref;
+  FAR double *lv = NULL;
+  FAR double *ptr;
+  double x;
+  int n;
+
+  while (1)
+    {
+      switch (*pc++)
+        {
+        case BC_END:
+          return curline + 1;
+
+        case BC_CONST:
+          *sp++ = g_consts[*pc++];
+          break;
+
+        case BC_LOAD:
+          ref = &g_refs[*pc++];
+          if (ref->index < 0)
+            {
+              var = findvariable(ref->id);
+              if (!var)
+                {
+                  seterror(ERR_NOSUCHVARIABLE);
+                  *sp++ = 0.0;
+                  break;
+                }
+
+              ref->index = var - g_variables;
+            }
+
+          *sp++ = g_variables[ref->index].dval;
+          break;
+
+        case BC_DIMREF:
+          ref = &g_refs[*pc++];
+          if (ref->index < 0)
+            {
+              dv = finddimvar(ref->id);
+              if (!dv)
+                {
+                  seterror(ERR_NOSUCHVARIABLE);
+                  return curline + 1;
+                }
+
+              ref->index = dv - g_dimvariables;
+            }
+          break;
+
+        case BC_LOADDIM:
+        case BC_LVALDIM:
+          dv = &g_dimvariables[g_refs[pc[0]].index];
+          n = pc[1];
+          sp -= n;
+          if (n != dv->ndims)
+            {
+              seterror(ERR_SYNTAX);
+              return curline + 1;
+            }
+
+          if (pc[-1] == BC_LVALDIM)
+            {
+              lv = g_errorflag ? NULL : dimelement(dv, sp);
+            }
+          else
+            {
+              ptr = dimelement(dv, sp);
+              *sp++ = ptr ? *ptr : 0.0;
+            }
+
+          pc += 2;
+          break;
+
+        case BC_INT:
+          sp[-1] = integer(sp[-1]);
+          break;
+
+        case BC_LVAL:
+          ref = &g_refs[*pc++];
+          if (ref->index < 0)
+            {
+              var = findvariable(ref->id);
+              if (!var)
+                {
+                  var = addfloat(ref->id);
+                }
+
+              if (!var)
+                {
+                  seterror(ERR_OUTOFMEMORY);
+                  lv = NULL;
+                  break;
+                }
+
+              ref->index = var - g_variables;
+            }
+
+          lv = &g_variables[ref->index].dval;
+          break;
+
+        case BC_STORE:
+          x = *--sp;
+          if (lv)
+            {
+              *lv = x;
+            }
+          break;
+
+        case BC_NEG:
+          sp[-1] = -sp[-1];
+          break;
+
+        case BC_ADD:
+          sp--;
+          sp[-1] += sp[0];
+          break;
+
+        case BC_SUB:
+          sp--;
+          sp[-1] -= sp[0];
+          break;
+
+        case BC_MUL:
+          sp--;
+          sp[-1] *= sp[0];
+          break;
+
+        case BC_DIV:
+          sp--;
+          if (sp[0] != 0.0)
+            {
+              sp[-1] /= sp[0];
+            }
+          else
+            {
+              seterror(ERR_DIVIDEBYZERO);
+            }
+          break;
+
+        case BC_MOD:
+          sp--;
+          sp[-1] = fmod(sp[-1], sp[0]);
+          break;
+
+        case BC_POW:
+          sp--;
+          sp[-1] = pow(sp[-1], sp[0]);
+          break;
+
+        case BC_FACT:
+          sp[-1] = factorial(sp[-1]);
+          break;
+
+        case BC_FUNC:
+          sp[-1] = function(*pc++, sp[-1]);
+          break;
+
+        case BC_CMP:
+          sp--;
+          switch (*pc++)
+            {
+            case ROP_EQ:
+              n = sp[-1] == sp[0];
+              break;
+
+            case ROP_NEQ:
+              n = sp[-1] != sp[0];
+              break;
+
+            case ROP_LT:
+              n = sp[-1] < sp[0];
+              break;
+
+            case ROP_LTE:
+              n = sp[-1] <= sp[0];
+              break;
+
+            case ROP_GT:
+              n = sp[-1] > sp[0];
+              break;
+
+            default:
+              n = sp[-1] >= sp[0];
+              break;
+            }
+
+          sp[-1] = n;
+          break;
+
+        case BC_AND:
+          sp--;
+          sp[-1] = (sp[-1] != 0.0 && sp[0] != 0.0) ? 1 : 0;
+          break;
+
+        case BC_OR:
+          sp--;
+          sp[-1] = (sp[-1] != 0.0 || sp[0] != 0.0) ? 1 : 0;
+          break;
+
+        case BC_PRINTNUM:
+          fprintf(g_fpout, "%g", *--sp);
+          break;
+
+        case BC_PRINTSTR:
+          fprintf(g_fpout, "%s", g_strs[*pc++]);
+          break;
+
+        case BC_PRINTSEP:
+          fprintf(g_fpout, " ");
+          break;
+
+        case BC_PRINTEOL:
+          fprintf(g_fpout, "\n");
+          break;
+
+        case BC_FLUSH:
+          fflush(g_fpout);
+          break;
+
+        case BC_JUMPIF:
+          if (*--sp != 0.0)
+            {
+              return *pc;
+            }
+
+          pc++;
+          break;
+
+        case BC_GOTO:
+          return *pc;
+
+        case BC_FOR:
+          sp -= 3;
+          if (lv == NULL)
+            {
+              return -1;
+            }
+
+          *lv = sp[0];
+
+          if (nfors > MAXFORS - 1)
+            {
+              seterror(ERR_TOOMANYFORS);
+              return -1;
+            }
+
+          if ((sp[2] < 0 && sp[0] < sp[1]) || (sp[2] > 0 && sp[0] > sp[1]))
+            {
+              /* Not entered, dofor() forgets earlier errors here too */
+
+              g_errorflag = 0;
+              return pc[1];
+            }
+
+          loop = &g_forstack[nfors++];
+          strlcpy(loop->id, g_refs[pc[0]].id, sizeof(loop->id));
+          if (curline + 1 < nlines)
+            {
+              loop->nextline = g_lines[curline + 1].no;
+              loop->nextindex = curline + 1;
+            }
+          else
+            {
+              loop->nextline = 0;
+              loop->nextindex = -1;
+            }
+
+          loop->toval = sp[1];
+          loop->step = sp[2];
+          pc += 2;
+          break;
+
+        case BC_NEXT:
+          if (!nfors)
+            {
+              seterror(ERR_NOFOR);
+              return -1;
+            }
+
+          ref = &g_refs[*pc++];
+          if (ref->index < 0)
+            {
+              var = findvariable(ref->id);
+              if (!var)
+                {
+                  var = addfloat(ref->id);
+                }
+
+              if (!var)
+                {
+                  seterror(ERR_OUTOFMEMORY);
+                  return -1;
+                }
+
+              ref->index = var - g_variables;
+            }
+
+          loop = &g_forstack[nfors - 1];
+          x = g_variables[ref->index].dval + loop->step;
+          g_variables[ref->index].dval = x;
+          if ((loop->step < 0 && x < loop->toval) ||
+              (loop->step > 0 && x > loop->toval))
+            {
+              nfors--;
+              break;
+            }
+
+          if (loop->nextline == 0)
+            {
+              break;
+            }
+
+          if (loop->nextindex < 0)
+            {
+              loop->nextindex = findline(loop->nextline);
+              if (loop->nextindex < 0)
+                {
+                  if (g_fperr)
+                    {
+                      fprintf(g_fperr, "line %d not found\n",
+                              loop->nextline);
+                    }
+
+                  return -2;
+                }
+            }
+
+          return loop->nextindex;
+
+        default:
+          assert(0);
+          return -1;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: function
+ *
+ * Description:
+ *   Apply a one argument function the way factor() does
+ *   Params: tok - the function token
+ *           x - the argument
+ *
+ ****************************************************************************/
+
+static double function(int tok, double x)
+{
+  switch (tok)
+    {
+    case SIN:
+      return sin(x);
+
+    case COS:
+      return cos(x);
+
+    case TAN:
+      return tan(x);
+
+    case LN:
+      if (x > 0)
+        {
+          return log(x);
+        }
+
+      seterror(ERR_NEGLOG);
+      return x;
+
+    case SQRT:
+      if (x >= 0.0)
+        {
+          return sqrt(x);
+        }
+
+      seterror(ERR_NEGSQRT);
+      return x;
+
+    case ABS:
+      return fabs(x);
+
+    case ASIN:
+    case ACOS:
+      if (x >= -1 && x <= 1)
+        {
+          return tok == ASIN ? asin(x) : acos(x);
+        }
+
+      seterror(ERR_BADSINCOS);
+      return x;
+
+    case ATAN:
+      return atan(x);
+
+    case INT:
+      return floor(x);
+
+    case RND:
+      x = integer(x);
+      if (x > 1)
+        {
+          return floor(rand() / (RAND_MAX + 1.0) * x);
+        }
+      else if (x == 1)
+        {
+          return rand() / (RAND_MAX + 1.0);
+        }
+
+      if (x < 0)
+        {
+          srand((unsigned)-x);
+        }
+
+      return 0;
+
+    default:
+      assert(0);
+      return 0;
+    }
+}
+
+/****************************************************************************
+ * Name: dimelement
+ *
+ * Description:
+ *   Get an element of a numeric array
+ *   Params: dv - the array
+ *           index - its subscripts, dv->ndims of them
+ *   Returns: pointer to the element, NULL (and error set) if out of range
+ *
+ ****************************************************************************/
+
+static FAR double *dimelement(FAR struct mb_dimvar_s *dv,
+                              FAR const double *index)
+{
+  switch (dv->ndims)
+    {
+    case 1:
+      return getdimvar(dv, (int)index[0]);
+
+    case 2:
+      return getdimvar(dv, (int)index[0], (int)index[1]);
+
+    case 3:
+      return getdimvar(dv, (int)index[0], (int)index[1], (int)index[2]);
+
+    case 4:
+      return getdimvar(dv, (int)index[0], (int)index[1], (int)index[2],
+                       (int)index[3]);
+
+    default:
+      return NULL;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: basic
+ *
+ * Description:
+ *   Interpret a BASIC script
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
+{
+  int curline = 0;
+  int nextline;
+  int answer = 0;
+
+  g_fpin = in;
+  g_fpout = out;
+  g_fperr = err;
+
+  if (setup(script) == -1)
+    {
+      return 1;
+    }
+
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+  compile();
+#endif
+
+  while (curline != -1)
+    {
+#ifdef CONFIG_INTERPRETER_MINIBASIC_COMPILE
+      if (g_lines[curline].pc >= 0)
+        {
+          g_errorflag = 0;
+          nextline = execute(curline);
+          if (g_errorflag)
+            {
+              reporterror(g_lines[curline].no);
+              answer = 1;
+              break;
+            }
+
+          if (nextline == -2)
+            {
+              answer = 1;
+              break;
+            }
+
+          if (nextline == -1 || nextline == nlines)
+            {
+              break;
+            }
+
+          curline = nextline;
+          continue;
+        }
+#endif
+
       g_string = g_lines[curline].str;
       g_token = gettoken(g_string);
       g_errorflag = 0;
@@ -45,6 +45,12 @@
 #define CHINFO_DATA_SIZE_MAX (sizeof(struct nxscope_chinfo_s) -   \
                               sizeof(char *) + CHAN_NAMELEN_MAX + 1)
 
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static void nxscope_stream_reset(FAR struct nxscope_s *s);
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -415,6 +421,17 @@ static int nxscope_start_set(FAR struct nxscope_s *s, bool start)
 {
   int ret = OK;
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Drop samples left from the previous stream session, before producers
+   * can see the stream started.
+   */
+
+  if (start && !s->start)
+    {
+      nxscope_chanbuf_reset(s);
+    }
+#endif
+
   s->start = start;
 
   /* User specific callback */
@@ -431,6 +448,28 @@ static int nxscope_start_set(FAR struct nxscope_s *s, bool start)
   return ret;
 }
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+/****************************************************************************
+ * Name: nxscope_delta_set
+ *
+ * NOTE: This function assumes that we have exclusive access to the nxscope
+ *       instance
+ *
+ ****************************************************************************/
+
+static void nxscope_delta_set(FAR struct nxscope_s *s, bool delta)
+{
+  if (s->delta != delta)
+    {
+      /* Pending samples were encoded for the other format */
+
+      s->delta        = delta;
+      s->stream_retry = false;
+      nxscope_stream_reset(s);
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: nxscope_start_req
  *
@@ -447,11 +486,23 @@ static int nxscope_start_req(FAR struct nxscope_s *s,
   DEBUGASSERT(s);
   DEBUGASSERT(data);
 
-  if (data->start == 0 || data->start == 1)
+  if (data->start == NXSCOPE_START_STOP ||
+      data->start == NXSCOPE_START_RAW)
     {
       _info("data->start=%d\n", data->start);
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+      nxscope_delta_set(s, false);
+#endif
       ret = nxscope_start_set(s, data->start);
     }
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  else if (data->start == NXSCOPE_START_DELTA)
+    {
+      _info("data->start=%d\n", data->start);
+      nxscope_delta_set(s, true);
+      ret = nxscope_start_set(s, true);
+    }
+#endif
 
   return ret;
 }
@@ -475,6 +526,16 @@ static void nxscope_stream_reset(FAR struct nxscope_s *s)
   /* Reset flags */
 
   s->streambuf[s->proto_stream->hdrlen] = 0;
+
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  /* Each frame starts a new delta encoding */
+
+  if (s->delta)
+    {
+      s->streambuf[s->proto_stream->hdrlen] |= NXSCOPE_STREAM_FLAGS_DELTA;
+      nxscope_delta_reset(s);
+    }
+#endif
 }
 
 /****************************************************************************
@@ -833,6 +894,39 @@ int nxscope_init(FAR struct nxscope_s *s, FAR struct nxscope_cfg_s *cfg)
       goto errout;
     }
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  /* Allocate memory for delta encoding references */
+
+  s->delta_prev = zalloc(cfg->channels * sizeof(FAR uint8_t *));
+  if (s->delta_prev == NULL)
+    {
+      ret = -errno;
+      _err("ERROR: delta_prev zalloc failed %d\n", ret);
+      goto errout;
+    }
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Allocate memory for channel rings, ring memory follows the array */
+
+  s->chanbuf_len = CONFIG_LOGGING_NXSCOPE_CHANBUF_LEN;
+
+  s->chanbuf = zalloc(cfg->channels * (sizeof(struct nxscope_chanbuf_s) +
+                                       s->chanbuf_len));
+  if (s->chanbuf == NULL)
+    {
+      ret = -errno;
+      _err("ERROR: chanbuf zalloc failed %d\n", ret);
+      goto errout;
+    }
+
+  for (i = 0; i < cfg->channels; i++)
+    {
+      s->chanbuf[i].buf = ((FAR uint8_t *)&s->chanbuf[cfg->channels] +
+                           i * s->chanbuf_len);
+    }
+#endif
+
 #ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   /* Allocate memory for critical channels buffer */
 
@@ -870,6 +964,9 @@ int nxscope_init(FAR struct nxscope_s *s, FAR struct nxscope_cfg_s *cfg)
 #ifdef CONFIG_LOGGING_NXSCOPE_ACKFRAMES
   s->cmninfo.flags |= NXSCOPE_FLAGS_ACK_SUPPORT;
 #endif
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  s->cmninfo.flags |= NXSCOPE_FLAGS_DELTA_SUPPORT;
+#endif
 
   s->cmninfo.rx_padding = cfg->rx_padding;
 
@@ -911,6 +1008,25 @@ errout:
       free(s->txbuf);
     }
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  if (s->delta_prev != NULL)
+    {
+      for (i = 0; i < s->cmninfo.chmax; i++)
+        {
+          free(s->delta_prev[i]);
+        }
+
+      free(s->delta_prev);
+    }
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  if (s->chanbuf != NULL)
+    {
+      free(s->chanbuf);
+    }
+#endif
+
 #ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   if (s->cribuf != NULL)
     {
@@ -934,6 +1050,10 @@ errout:
 
 void nxscope_deinit(FAR struct nxscope_s *s)
 {
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  int i = 0;
+#endif
+
   DEBUGASSERT(s);
 
   /* Free mutex */
@@ -959,6 +1079,25 @@ void nxscope_deinit(FAR struct nxscope_s *s)
     }
 #endif
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  if (s->delta_prev != NULL)
+    {
+      for (i = 0; i < s->cmninfo.chmax; i++)
+        {
+          free(s->delta_prev[i]);
+        }
+
+      free(s->delta_prev);
+    }
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  if (s->chanbuf != NULL)
+    {
+      free(s->chanbuf);
+    }
+#endif
+
 #ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   if (s->cribuf != NULL)
     {
@@ -1037,6 +1176,17 @@ int nxscope_stream(FAR struct nxscope_s *s)
       goto errout;
     }
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Merge samples queued by put interfaces.  Nothing is merged while a
+   * frame waits for retransmission, it is already finalized.
+   */
+
+  if (!s->stream_retry)
+    {
+      nxscope_chanbuf_drain(s);
+    }
+#endif
+
   /* Do nothing if no data */
 
   if (nxscope_stream_empty(s))
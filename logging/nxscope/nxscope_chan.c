@@ -30,6 +30,7 @@
 #include <debug.h>
 #include <endian.h>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -102,6 +103,92 @@ static void nxscope_stream_overflow(FAR struct nxscope_s *s)
   s->streambuf[s->proto_stream->hdrlen] |= NXSCOPE_STREAM_FLAGS_OVERFLOW;
 }
 
+/****************************************************************************
+ * Name: nxscope_type_size
+ ****************************************************************************/
+
+static size_t nxscope_type_size(uint8_t type)
+{
+  union nxscope_chinfo_type_u utype;
+
+  /* Get utype */
+
+  utype.u8 = type;
+
+#ifdef CONFIG_LOGGING_NXSCOPE_USERTYPES
+  if (type >= NXSCOPE_TYPE_USER)
+    {
+      return 1;
+    }
+#endif
+
+  return g_type_size[utype.s.dtype];
+}
+
+/****************************************************************************
+ * Name: nxscope_stream_size
+ *
+ * Description:
+ *   Get the maximum size of a sample in the stream buffer
+ *
+ ****************************************************************************/
+
+static size_t nxscope_stream_size(FAR struct nxscope_s *s, uint8_t type,
+                                  uint8_t d, uint8_t mlen)
+{
+  size_t type_size = nxscope_type_size(type);
+
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  union nxscope_chinfo_type_u utype;
+
+  utype.u8 = type;
+
+  /* Worst case varint length */
+
+  if (s->delta)
+    {
+      switch (utype.s.dtype)
+        {
+          case NXSCOPE_TYPE_UINT16:
+          case NXSCOPE_TYPE_INT16:
+          case NXSCOPE_TYPE_B8:
+          case NXSCOPE_TYPE_UB8:
+            {
+              type_size = 3;
+              break;
+            }
+
+          case NXSCOPE_TYPE_UINT32:
+          case NXSCOPE_TYPE_INT32:
+          case NXSCOPE_TYPE_FLOAT:
+          case NXSCOPE_TYPE_B16:
+          case NXSCOPE_TYPE_UB16:
+            {
+              type_size = 5;
+              break;
+            }
+
+          case NXSCOPE_TYPE_UINT64:
+          case NXSCOPE_TYPE_INT64:
+          case NXSCOPE_TYPE_DOUBLE:
+          case NXSCOPE_TYPE_B32:
+          case NXSCOPE_TYPE_UB32:
+            {
+              type_size = 10;
+              break;
+            }
+
+          default:
+            {
+              break;
+            }
+        }
+    }
+#endif
+
+  return 1 + type_size * d + mlen;
+}
+
 /****************************************************************************
  * Name: nxscope_ch_validate
  ****************************************************************************/
@@ -109,10 +196,11 @@ static void nxscope_stream_overflow(FAR struct nxscope_s *s)
 static int nxscope_ch_validate(FAR struct nxscope_s *s, uint8_t ch,
                                uint8_t type, uint8_t d, uint8_t mlen)
 {
+#ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   union nxscope_chinfo_type_u utype;
+#endif
   size_t                      next_i    = 0;
   int                         ret       = OK;
-  size_t                      type_size = 0;
 
   DEBUGASSERT(s);
 
@@ -184,28 +272,18 @@ static int nxscope_ch_validate(FAR struct nxscope_s *s, uint8_t ch,
     }
 #endif
 
+  /* Check buffer size */
+
+#ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   /* Get utype */
 
   utype.u8 = type;
 
-  /* Check buffer size */
-
-#ifdef CONFIG_LOGGING_NXSCOPE_USERTYPES
-  if (type >= NXSCOPE_TYPE_USER)
-    {
-      type_size = 1;
-    }
-  else
-#endif
-    {
-      type_size = g_type_size[utype.s.dtype];
-    }
-
-#ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   if (utype.s.cri)
     {
 #  ifdef CONFIG_DEBUG_FEATURES
-      next_i = (s->proto_stream->hdrlen + 1 + type_size * d + mlen +
+      next_i = (s->proto_stream->hdrlen + 1 +
+                nxscope_type_size(type) * d + mlen +
                 s->proto_stream->footlen);
 
       /* Verify the size of the critical channels buffer  */
@@ -228,7 +306,24 @@ static int nxscope_ch_validate(FAR struct nxscope_s *s, uint8_t ch,
     }
 #endif
 
-  next_i = (s->stream_i + 1 + type_size * d + mlen +
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* The sample is queued in the channel ring, the stream buffer is not
+   * touched here.  Verify only that the ring holds at least one sample
+   * and that the sample fits in an empty stream frame.
+   */
+
+  next_i = 1 + nxscope_type_size(type) * d + mlen;
+
+  if (2 * next_i > s->chanbuf_len ||
+      (s->proto_stream->hdrlen + 1 + nxscope_stream_size(s, type, d, mlen) +
+       s->proto_stream->footlen > s->streambuf_len))
+    {
+      _err("ERROR: no space for sample %zu\n", next_i);
+      ret = -ENOBUFS;
+      goto errout;
+    }
+#else
+  next_i = (s->stream_i + nxscope_stream_size(s, type, d, mlen) +
             s->proto_stream->footlen);
 
   if (next_i > s->streambuf_len)
@@ -238,6 +333,7 @@ static int nxscope_ch_validate(FAR struct nxscope_s *s, uint8_t ch,
       ret = -ENOBUFS;
       goto errout;
     }
+#endif
 
 errout:
   return ret;
@@ -441,6 +537,282 @@ static void nxscope_put_sample(FAR uint8_t *buff, FAR size_t *buff_i,
   *buff_i += i;
 }
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+/****************************************************************************
+ * Name: nxscope_put_varint
+ ****************************************************************************/
+
+static int nxscope_put_varint(FAR uint8_t *buff, uintmax_t val)
+{
+  int j = 0;
+
+  while (val >= 0x80)
+    {
+      buff[j++] = (val & 0x7f) | 0x80;
+      val >>= 7;
+    }
+
+  buff[j++] = val;
+
+  return j;
+}
+
+/****************************************************************************
+ * Name: nxscope_zigzag
+ ****************************************************************************/
+
+static uintmax_t nxscope_zigzag(intmax_t val)
+{
+  return ((uintmax_t)val << 1) ^ (val < 0 ? UINTMAX_MAX : 0);
+}
+
+/****************************************************************************
+ * Name: nxscope_put_vector_delta
+ *
+ * NOTE: This function assumes that we have exclusive access to the nxscope
+ *       stream buffer
+ *
+ * NOTE: val is read as bytes, so it can point to a packed little-endian
+ *       vector as well
+ *
+ ****************************************************************************/
+
+static int nxscope_put_vector_delta(FAR uint8_t *buff, uint8_t type,
+                                    FAR void *val, uint8_t d,
+                                    FAR uint8_t *prev)
+{
+  FAR uint8_t *src = val;
+  int          i   = 0;
+  int          j   = 0;
+
+  switch (type)
+    {
+      case NXSCOPE_TYPE_UINT16:
+      case NXSCOPE_TYPE_INT16:
+      case NXSCOPE_TYPE_B8:
+      case NXSCOPE_TYPE_UB8:
+        {
+          uint16_t u16  = 0;
+          uint16_t p16  = 0;
+
+          for (i = 0; i < d; i++)
+            {
+              memcpy(&u16, &src[i * 2], 2);
+              memcpy(&p16, &prev[i * 2], 2);
+              memcpy(&prev[i * 2], &u16, 2);
+
+              j += nxscope_put_varint(&buff[j],
+                                      nxscope_zigzag((int16_t)(u16 - p16)));
+            }
+
+          break;
+        }
+
+      case NXSCOPE_TYPE_UINT32:
+      case NXSCOPE_TYPE_INT32:
+      case NXSCOPE_TYPE_FLOAT:
+      case NXSCOPE_TYPE_B16:
+      case NXSCOPE_TYPE_UB16:
+        {
+          uint32_t u32  = 0;
+          uint32_t p32  = 0;
+
+          for (i = 0; i < d; i++)
+            {
+              memcpy(&u32, &src[i * 4], 4);
+              memcpy(&p32, &prev[i * 4], 4);
+              memcpy(&prev[i * 4], &u32, 4);
+
+              if (type == NXSCOPE_TYPE_FLOAT)
+                {
+                  j += nxscope_put_varint(&buff[j], u32 ^ p32);
+                }
+              else
+                {
+                  j += nxscope_put_varint(&buff[j],
+                                          nxscope_zigzag((int32_t)(u32 -
+                                                                   p32)));
+                }
+            }
+
+          break;
+        }
+
+#ifdef CONFIG_HAVE_LONG_LONG
+      case NXSCOPE_TYPE_UINT64:
+      case NXSCOPE_TYPE_INT64:
+      case NXSCOPE_TYPE_DOUBLE:
+      case NXSCOPE_TYPE_B32:
+      case NXSCOPE_TYPE_UB32:
+        {
+          uint64_t u64  = 0;
+          uint64_t p64  = 0;
+
+          for (i = 0; i < d; i++)
+            {
+              memcpy(&u64, &src[i * 8], 8);
+              memcpy(&p64, &prev[i * 8], 8);
+              memcpy(&prev[i * 8], &u64, 8);
+
+              if (type == NXSCOPE_TYPE_DOUBLE)
+                {
+                  j += nxscope_put_varint(&buff[j], u64 ^ p64);
+                }
+              else
+                {
+                  j += nxscope_put_varint(&buff[j],
+                                          nxscope_zigzag((int64_t)(u64 -
+                                                                   p64)));
+                }
+            }
+
+          break;
+        }
+#endif
+
+      default:
+        {
+          /* Other types are not encoded */
+
+          j = nxscope_put_vector(buff, type, val, d);
+          break;
+        }
+    }
+
+  return j;
+}
+
+/****************************************************************************
+ * Name: nxscope_put_sample_delta
+ *
+ * NOTE: This function assumes that we have exclusive access to the nxscope
+ *       stream buffer
+ *
+ ****************************************************************************/
+
+static void nxscope_put_sample_delta(FAR struct nxscope_s *s, uint8_t type,
+                                     uint8_t ch, FAR void *val, uint8_t d,
+                                     FAR uint8_t *meta, uint8_t mlen)
+{
+  FAR uint8_t *buff = s->streambuf;
+  size_t       i    = 0;
+
+  DEBUGASSERT(s->delta_prev[ch]);
+  DEBUGASSERT(d <= s->chinfo[ch].vdim);
+
+  /* Channel ID */
+
+  buff[s->stream_i++] = ch;
+
+  /* Vector sample data encoded against the previous channel sample */
+
+  i = nxscope_put_vector_delta(&buff[s->stream_i], type, val, d,
+                               s->delta_prev[ch]);
+  s->stream_i += i;
+
+  /* Meta data */
+
+  i = nxscope_put_meta(&buff[s->stream_i], meta, mlen);
+  s->stream_i += i;
+}
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+/****************************************************************************
+ * Name: nxscope_chanbuf_esize
+ ****************************************************************************/
+
+static size_t nxscope_chanbuf_esize(FAR struct nxscope_chinfo_s *chinfo)
+{
+  return 1 + nxscope_type_size(chinfo->type.u8) * chinfo->vdim +
+         chinfo->mlen;
+}
+
+/****************************************************************************
+ * Name: nxscope_chanbuf_flush
+ *
+ * NOTE: This function assumes that we have exclusive access to the nxscope
+ *       instance and that no producer writes to the channel.  Both indexes
+ *       are reset, a head left from another sample size could point past
+ *       the end of the ring.
+ *
+ ****************************************************************************/
+
+static void nxscope_chanbuf_flush(FAR struct nxscope_chanbuf_s *cb)
+{
+  atomic_store_explicit(&cb->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&cb->tail, 0, memory_order_release);
+  atomic_store_explicit(&cb->overflow, false, memory_order_relaxed);
+}
+
+/****************************************************************************
+ * Name: nxscope_chanbuf_put
+ *
+ * NOTE: This function never takes the nxscope lock.  Only one thread can
+ *       put samples on a given channel at a time.
+ *
+ ****************************************************************************/
+
+static int nxscope_chanbuf_put(FAR struct nxscope_s *s, uint8_t type,
+                               uint8_t ch, FAR void *val, uint8_t d,
+                               FAR uint8_t *meta, uint8_t mlen)
+{
+  FAR struct nxscope_chanbuf_s *cb     = NULL;
+  size_t                        esize  = 0;
+  size_t                        i      = 0;
+  unsigned int                  nslots = 0;
+  unsigned int                  head   = 0;
+  unsigned int                  next   = 0;
+  int                           ret    = OK;
+
+  DEBUGASSERT(s);
+
+  /* Validate data */
+
+  ret = nxscope_ch_validate(s, ch, type, d, mlen);
+  if (ret != OK)
+    {
+      goto errout;
+    }
+
+  /* All samples of a channel have the same size, the one the consumer
+   * derives from the channel info.  Anything else would break the ring.
+   */
+
+  cb     = &s->chanbuf[ch];
+  esize  = 1 + nxscope_type_size(type) * d + mlen;
+  if (esize != nxscope_chanbuf_esize(&s->chinfo[ch]))
+    {
+      ret = -EINVAL;
+      goto errout;
+    }
+
+  nslots = s->chanbuf_len / esize;
+
+  head = atomic_load_explicit(&cb->head, memory_order_relaxed);
+  next = (head + 1 < nslots) ? head + 1 : 0;
+
+  if (next == atomic_load_explicit(&cb->tail, memory_order_acquire))
+    {
+      /* Ring full, reported with the next stream frame */
+
+      atomic_store_explicit(&cb->overflow, true, memory_order_relaxed);
+      ret = -ENOBUFS;
+      goto errout;
+    }
+
+  /* Encode sample in the free slot and publish it */
+
+  nxscope_put_sample(&cb->buf[head * esize], &i, type, ch, val, d,
+                     meta, mlen);
+
+  atomic_store_explicit(&cb->head, next, memory_order_release);
+
+errout:
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: nxscope_put_common_m
  ****************************************************************************/
@@ -459,6 +831,15 @@ static int nxscope_put_common_m(FAR struct nxscope_s *s, uint8_t type,
 
   DEBUGASSERT(s);
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Non-critical samples are queued in the channel ring */
+
+  if (!NXSCOPE_IS_CRICHAN(type))
+    {
+      return nxscope_chanbuf_put(s, type, ch, val, d, meta, mlen);
+    }
+#endif
+
 #ifndef CONFIG_LOGGING_NXSCOPE_DISABLE_PUTLOCK
   nxscope_lock(s);
 #endif
@@ -493,7 +874,16 @@ static int nxscope_put_common_m(FAR struct nxscope_s *s, uint8_t type,
 
   /* Put sample on buffer */
 
-  nxscope_put_sample(buff, buff_i, type, ch, val, d, meta, mlen);
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  if (s->delta && buff == s->streambuf)
+    {
+      nxscope_put_sample_delta(s, type, ch, val, d, meta, mlen);
+    }
+  else
+#endif
+    {
+      nxscope_put_sample(buff, buff_i, type, ch, val, d, meta, mlen);
+    }
 
 #ifdef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   if (utype.s.cri)
@@ -521,6 +911,164 @@ errout:
  * Public Functions
  ****************************************************************************/
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+/****************************************************************************
+ * Name: nxscope_chanbuf_drain
+ *
+ * Description:
+ *   Move samples from the channel rings to the stream buffer.
+ *
+ *   Channels are drained one sample at a time in a round-robin manner, so
+ *   that a fast channel cannot starve the others when the stream buffer
+ *   is too small for all pending samples.  Samples that do not fit stay
+ *   in their ring until the next call.
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_chanbuf_drain(FAR struct nxscope_s *s)
+{
+  FAR struct nxscope_chanbuf_s *cb       = NULL;
+  FAR struct nxscope_chinfo_s  *chinfo   = NULL;
+  FAR uint8_t                  *slot     = NULL;
+  size_t                        maxlen   = 0;
+  size_t                        esize    = 0;
+  unsigned int                  tail     = 0;
+  bool                          progress = false;
+  int                           ch       = 0;
+
+  DEBUGASSERT(s);
+
+  maxlen = s->streambuf_len - s->proto_stream->footlen;
+
+  /* Report dropped samples */
+
+  for (ch = 0; ch < s->cmninfo.chmax; ch++)
+    {
+      if (atomic_exchange_explicit(&s->chanbuf[ch].overflow, false,
+                                   memory_order_relaxed))
+        {
+          nxscope_stream_overflow(s);
+        }
+    }
+
+  do
+    {
+      progress = false;
+
+      for (ch = 0; ch < s->cmninfo.chmax; ch++)
+        {
+          cb   = &s->chanbuf[ch];
+          tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+
+          if (tail == atomic_load_explicit(&cb->head, memory_order_acquire))
+            {
+              continue;
+            }
+
+          chinfo = &s->chinfo[ch];
+          esize  = nxscope_chanbuf_esize(chinfo);
+          if (s->stream_i + nxscope_stream_size(s, chinfo->type.u8,
+                                                chinfo->vdim,
+                                                chinfo->mlen) > maxlen)
+            {
+              continue;
+            }
+
+          slot = &cb->buf[tail * esize];
+
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+          if (s->delta)
+            {
+              nxscope_put_sample_delta(s, chinfo->type.s.dtype, ch,
+                                       &slot[1], chinfo->vdim,
+                                       &slot[esize - chinfo->mlen],
+                                       chinfo->mlen);
+            }
+          else
+#endif
+            {
+              memcpy(&s->streambuf[s->stream_i], slot, esize);
+              s->stream_i += esize;
+            }
+
+          /* Release the slot to the producer */
+
+          tail = (tail + 1 < s->chanbuf_len / esize) ? tail + 1 : 0;
+          atomic_store_explicit(&cb->tail, tail, memory_order_release);
+
+          progress = true;
+        }
+    }
+  while (progress);
+}
+
+/****************************************************************************
+ * Name: nxscope_chanbuf_reset
+ *
+ * Description:
+ *   Drop all samples queued in the channel rings.
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance and that the stream is stopped, so that no
+ *         producer writes to the rings
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_chanbuf_reset(FAR struct nxscope_s *s)
+{
+  int ch = 0;
+
+  DEBUGASSERT(s);
+
+  for (ch = 0; ch < s->cmninfo.chmax; ch++)
+    {
+      nxscope_chanbuf_flush(&s->chanbuf[ch]);
+    }
+}
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+/****************************************************************************
+ * Name: nxscope_delta_reset
+ *
+ * Description:
+ *   Reset the delta encoding reference, called for each new stream frame
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_delta_reset(FAR struct nxscope_s *s)
+{
+  int ch = 0;
+
+  DEBUGASSERT(s);
+
+  for (ch = 0; ch < s->cmninfo.chmax; ch++)
+    {
+      if (s->delta_prev[ch] != NULL)
+        {
+          memset(s->delta_prev[ch], 0,
+                 nxscope_type_size(s->chinfo[ch].type.u8) *
+                 s->chinfo[ch].vdim);
+        }
+    }
+}
+#endif
+
 /****************************************************************************
  * Name: nxscope_chan_init
  *
@@ -540,7 +1088,10 @@ errout:
 int nxscope_chan_init(FAR struct nxscope_s *s, uint8_t ch, FAR char *name,
                       uint8_t type, uint8_t vdim, uint8_t mlen)
 {
-  int ret = OK;
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  FAR uint8_t *prev = NULL;
+#endif
+  int          ret  = OK;
 
   DEBUGASSERT(s);
   DEBUGASSERT(name);
@@ -552,8 +1103,6 @@ int nxscope_chan_init(FAR struct nxscope_s *s, uint8_t ch, FAR char *name,
       goto errout;
     }
 
-  nxscope_lock(s);
-
 #ifndef CONFIG_LOGGING_NXSCOPE_CRICHANNELS
   if (NXSCOPE_IS_CRICHAN(type))
     {
@@ -563,6 +1112,20 @@ int nxscope_chan_init(FAR struct nxscope_s *s, uint8_t ch, FAR char *name,
     }
 #endif
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  /* Previous values for the delta encoding, at least one byte */
+
+  prev = zalloc(nxscope_type_size(type) * vdim + 1);
+  if (prev == NULL)
+    {
+      ret = -errno;
+      _err("ERROR: delta_prev zalloc failed %d\n", ret);
+      goto errout;
+    }
+#endif
+
+  nxscope_lock(s);
+
   /* Reset channel data */
 
   memset(&s->chinfo[ch], 0, sizeof(struct nxscope_chinfo_s));
@@ -574,6 +1137,17 @@ int nxscope_chan_init(FAR struct nxscope_s *s, uint8_t ch, FAR char *name,
   s->chinfo[ch].mlen    = mlen;
   s->chinfo[ch].name    = name;
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+  free(s->delta_prev[ch]);
+  s->delta_prev[ch] = prev;
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+  /* Samples queued with the previous channel layout are not valid */
+
+  nxscope_chanbuf_flush(&s->chanbuf[ch]);
+#endif
+
   nxscope_unlock(s);
 
 errout:
@@ -31,6 +31,10 @@
 
 #include <logging/nxscope/nxscope.h>
 
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+#  include <stdatomic.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -51,6 +55,28 @@
 #define INTF_RECV(s, intf, buff, i)             \
   (s)->intf_stream->ops->recv(intf, buff, i)
 
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+/* Single-producer/single-consumer ring of encoded channel samples.
+ *
+ * All samples of a channel have the same size, so the ring holds
+ * fixed-size slots.  head is written only by the producer (put
+ * interfaces), tail only by the consumer (nxscope_stream() with the
+ * nxscope lock held).  One slot is always left empty.
+ */
+
+struct nxscope_chanbuf_s
+{
+  FAR uint8_t *buf;                     /* Ring memory, chanbuf_len bytes */
+  atomic_uint  head;                    /* Next slot to write */
+  atomic_uint  tail;                    /* Next slot to read */
+  atomic_bool  overflow;                /* Samples dropped since last read */
+};
+#endif
+
 /****************************************************************************
  * Public Function Puttypes
  ****************************************************************************/
@@ -71,4 +97,57 @@
 int nxscope_stream_send(FAR struct nxscope_s *s, FAR uint8_t *buff,
                         FAR size_t *buff_i);
 
+#ifdef CONFIG_LOGGING_NXSCOPE_DELTA
+/****************************************************************************
+ * Name: nxscope_delta_reset
+ *
+ * Description:
+ *   Reset the delta encoding reference, called for each new stream frame
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_delta_reset(FAR struct nxscope_s *s);
+#endif
+
+#ifdef CONFIG_LOGGING_NXSCOPE_LOCKFREE
+/****************************************************************************
+ * Name: nxscope_chanbuf_drain
+ *
+ * Description:
+ *   Move samples from the channel rings to the stream buffer.
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_chanbuf_drain(FAR struct nxscope_s *s);
+
+/****************************************************************************
+ * Name: nxscope_chanbuf_reset
+ *
+ * Description:
+ *   Drop all samples queued in the channel rings.
+ *
+ *   NOTE: This function assumes that we have exclusive access to the
+ *         nxscope instance and that the stream is stopped, so that no
+ *         producer writes to the rings
+ *
+ * Input Parameters:
+ *   s - a pointer to a nxscope instance
+ *
+ ****************************************************************************/
+
+void nxscope_chanbuf_reset(FAR struct nxscope_s *s);
+#endif
+
 #endif  /* __APPS_LOGGING_NXSCOPE_NXSCOPE_INTERNALS_H */
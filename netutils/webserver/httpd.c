@@ -54,10 +54,20 @@
 #include <errno.h>
 #include <debug.h>
 
-#ifndef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+#if !defined(CONFIG_NETUTILS_HTTPD_SINGLECONNECT) && \
+    !defined(CONFIG_NETUTILS_HTTPD_EVENTLOOP)
 #  include <pthread.h>
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_EVENTLOOP
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <time.h>
+#  ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
+#    include <sys/sendfile.h>
+#  endif
+#endif
+
 #include <arpa/inet.h>
 
 #include "netutils/netlib.h"
@@ -114,6 +124,20 @@
 #  endif
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_EVENTLOOP
+#  ifndef CONFIG_NETUTILS_HTTPD_MAXCONN
+#    define CONFIG_NETUTILS_HTTPD_MAXCONN 8
+#  endif
+
+/* With a timeout, poll() wakes up every second to expire idle connections */
+
+#  if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+#    define HTTPD_EV_TICK 1000
+#  else
+#    define HTTPD_EV_TICK -1
+#  endif
+#endif
+
 #ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
 #  ifndef CONFIG_NETUTILS_HTTPD_INDEX
 #    ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
@@ -124,6 +148,29 @@
 #  endif
 #endif
 
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Request parser state, kept in ht_parse */
+
+enum
+{
+  STATE_METHOD,
+  STATE_HEADER,
+  STATE_BODY
+};
+
+#ifdef CONFIG_NETUTILS_HTTPD_EVENTLOOP
+/* Connection phase, kept in ht_phase */
+
+enum
+{
+  PHASE_RECV,                           /* Receiving the request */
+  PHASE_SEND                            /* Sending ht_header and ht_file */
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -344,6 +391,165 @@ static int handle_script(struct httpd_state *pstate)
 }
 #endif
 
+/****************************************************************************
+ * Name: httpd_format_headers
+ *
+ * Description:
+ *   Format the HTTP headers into a HTTPD_MAX_HEADERLEN buffer.
+ *
+ * Returned Value:
+ *   The length of the headers.
+ *
+ ****************************************************************************/
+
+static int httpd_format_headers(struct httpd_state *pstate, int status,
+                                int len, char *header)
+{
+  const char *mime;
+  const char *ptr;
+  char contentlen[HTTPD_MAX_CONTENTLEN] =
+    {
+      0
+    };
+
+  int i;
+
+  static const struct
+  {
+    const char *ext;
+    const char *mime;
+  }
+
+  a[] =
+    {
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
+    {
+      "shtml", "text/html"
+    },
+#endif
+
+    {
+      "html",  "text/html"
+    },
+
+    {
+      "css",   "text/css"
+    },
+
+    {
+      "txt",   "text/plain"
+    },
+
+    {
+      "json",  "application/json"
+    },
+
+    {
+      "js",    "text/javascript"
+    },
+
+    {
+      "png",   "image/png"
+    },
+
+    {
+      "gif",   "image/gif"
+    },
+
+    {
+      "jpeg",  "image/jpeg"
+    },
+
+    {
+      "jpg",   "image/jpeg"
+    },
+
+    {
+      "mp3",   "audio/mpeg"
+    },
+    };
+
+  ptr = strrchr(pstate->ht_filename, ISO_PERIOD);
+  if (ptr == NULL)
+    {
+      mime = "application/octet-stream";
+    }
+  else
+    {
+      mime = "text/plain";
+
+      for (i = 0; i < nitems(a); i++)
+        {
+          if (strncmp(a[i].ext, ptr + 1, strlen(a[i].ext)) == 0)
+            {
+              mime = a[i].mime;
+              break;
+            }
+        }
+    }
+
+#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
+  if (false == httpd_is_file(pstate->ht_filename))
+    {
+      /* we assume that it's a directory */
+
+      mime = "text/html";
+    }
+#endif
+
+  if (len >= 0)
+    {
+      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
+               "Content-Length: %d\r\n", len);
+    }
+  else
+    {
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+      /* Length unknown ahead of time */
+
+      pstate->ht_keepalive = false;
+#endif
+#if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
+      /* Turn on chunked encoding */
+
+      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
+               "Transfer-Encoding: chunked\r\n");
+      pstate->ht_chunked = true;
+#endif
+    }
+
+  if (status == 413)
+    {
+      /* TODO: here we "SHOULD" include a Retry-After header */
+    }
+
+  /* Construct the header.
+   *
+   * REVISIT:  Wouldn't asprintf be a better option than a large stack
+   * array?
+   */
+
+  return snprintf(header, HTTPD_MAX_HEADERLEN,
+                    "HTTP/1.0 %d %s\r\n"
+#ifndef CONFIG_NETUTILS_HTTPD_SERVERHEADER_DISABLE
+                    "Server: uIP/NuttX http://nuttx.org/\r\n"
+#endif
+                    "Connection: %s\r\n"
+                    "Content-type: %s\r\n"
+                    "%s"
+                    "\r\n",
+                    status,
+                    status >= 400 ? "Error" : "OK",
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+                    pstate->ht_keepalive ? "keep-alive" : "close",
+#else
+                    "close",
+#endif
+                    mime,
+                    contentlen
+                    );
+}
+
 static int send_chunk(struct httpd_state *pstate, const char *buf, int len)
 {
   int ret;
@@ -496,168 +702,150 @@ done:
   return ret;
 }
 
-static inline int httpd_parse(struct httpd_state *pstate)
+/****************************************************************************
+ * Name: httpd_parse_lines
+ *
+ * Description:
+ *   Process the complete lines received so far in ht_buffer.  Whatever
+ *   follows the last complete line is moved to the start of the buffer.
+ *
+ * Returned Value:
+ *   0 if more data is needed, 200 once the request has been parsed, or
+ *   the HTTP error status.
+ *
+ ****************************************************************************/
+
+static int httpd_parse_lines(struct httpd_state *pstate)
 {
-  char *o;
+  char *o = pstate->ht_buffer + pstate->ht_rcvlen;
+  char *start;
+  char *end;
+
+  /* Here o marks the end of the total block currently awaiting
+   * processing.  There may be multiple lines in a block; next we deal
+   * with each in turn.
+   */
 
-  enum
+  for (start = pstate->ht_buffer;
+       (end = memchr(start, '\r', o - start)), end != NULL;
+       start = end)
     {
-      STATE_METHOD,
-      STATE_HEADER,
-      STATE_BODY
-    } state;
+      *end = '\0';
+      end++;
 
-  state = STATE_METHOD;
-  o = pstate->ht_buffer;
+      /* Here start and end are a single line within the current block */
 
-  do
-    {
-      char *start;
-      char *end;
+      httpd_dumpbuffer("Incoming HTTP line", start, end - start);
 
-      if (o == pstate->ht_buffer + sizeof pstate->ht_buffer)
+      if (end == o)
         {
-          nerr("ERROR: ht_buffer overflow\n");
-          return 413;
+          /* The LF has not been received yet */
+
+          *--end = '\r';
+          break;
         }
 
+      if (*end != '\n')
         {
-          ssize_t r;
+          nwarn("WARNING: expected CRLF\n");
+          return 400;
+        }
 
-          r = recv(pstate->ht_sockfd, o,
-            sizeof pstate->ht_buffer - (o - pstate->ht_buffer), 0);
-          if (r == 0)
-            {
-              nwarn("WARNING: [%d] connection lost\n", pstate->ht_sockfd);
-              return ERROR;
-            }
+      end++;
 
-#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
-          if (r == -1 && errno == EWOULDBLOCK)
-            {
-              nwarn("WARNING: recv timeout\n");
-              return 408;
-            }
-#endif
+      switch (pstate->ht_parse)
+      {
+      char *v;
 
-          if (r == -1)
-            {
-              nerr("ERROR: [%d] recv failed: %d\n",
-                   pstate->ht_sockfd, errno);
-              return 400;
-            }
+      case STATE_METHOD:
+        if (0 != strncmp(start, "GET ", 4))
+          {
+            nwarn("WARNING: method not supported\n");
+            return 501;
+          }
 
-          o += r;
-        }
+        start += 4;
+        v = start + strcspn(start, " ");
 
-      /* Here o marks the end of the total block currently awaiting
-       * processing.  There may be multiple lines in a block; next we deal
-       * with each in turn.
-       */
+        if (0 != strcmp(v, " HTTP/1.0") && 0 != strcmp(v, " HTTP/1.1"))
+          {
+            nwarn("WARNING: HTTP version not supported\n");
+            return 505;
+          }
 
-      for (start = pstate->ht_buffer;
-           (end = memchr(start, '\r', o - start)), end != NULL;
-           start = end)
-        {
-          *end = '\0';
-          end++;
+        /* TODO: url decoding */
 
-          /* Here start and end are a single line within the current block */
+        if (v - start >= sizeof pstate->ht_filename)
+          {
+            nerr("ERROR: ht_filename overflow\n");
+            return 414;
+          }
 
-          httpd_dumpbuffer("Incoming HTTP line", start, end - start);
+        *v = '\0';
+        strlcpy(pstate->ht_filename, start, sizeof(pstate->ht_filename));
+        pstate->ht_parse = STATE_HEADER;
+        break;
 
-          if (*end != '\n')
-            {
-              nwarn("WARNING: expected CRLF\n");
-              return 400;
-            }
+      case STATE_HEADER:
+        if (*start == '\0')
+          {
+            pstate->ht_parse = STATE_BODY;
+            break;
+          }
 
-          end++;
+        v = start + strcspn(start, ":");
+        if (*v != '\0')
+          {
+            *v = '\0', v++;
+            v += strspn(v, ": ");
+          }
 
-          switch (state)
+        if (*start == '\0' || *v == '\0')
           {
-          char *v;
-
-          case STATE_METHOD:
-            if (0 != strncmp(start, "GET ", 4))
-              {
-                nwarn("WARNING: method not supported\n");
-                return 501;
-              }
-
-            start += 4;
-            v = start + strcspn(start, " ");
-
-            if (0 != strcmp(v, " HTTP/1.0") && 0 != strcmp(v, " HTTP/1.1"))
-              {
-                nwarn("WARNING: HTTP version not supported\n");
-                return 505;
-              }
-
-            /* TODO: url decoding */
-
-            if (v - start >= sizeof pstate->ht_filename)
-              {
-                nerr("ERROR: ht_filename overflow\n");
-                return 414;
-              }
-
-            *v = '\0';
-            strlcpy(pstate->ht_filename, start, sizeof(pstate->ht_filename));
-            state = STATE_HEADER;
-            break;
+            nwarn("WARNING: header parse error\n");
+            return 400;
+          }
 
-          case STATE_HEADER:
-            if (*start == '\0')
-              {
-                state = STATE_BODY;
-                break;
-              }
-
-            v = start + strcspn(start, ":");
-            if (*v != '\0')
-              {
-                *v = '\0', v++;
-                v += strspn(v, ": ");
-              }
-
-            if (*start == '\0' || *v == '\0')
-              {
-                nwarn("WARNING: header parse error\n");
-                return 400;
-              }
-
-            ninfo("[%d] Request header %s: %s\n",
-                  pstate->ht_sockfd, start, v);
-
-            if (0 == strcasecmp(start, "Content-Length") && 0 != atoi(v))
-              {
-                nwarn("WARNING: non-zero request length\n");
-                return 413;
-              }
+        ninfo("[%d] Request header %s: %s\n",
+              pstate->ht_sockfd, start, v);
+
+        if (0 == strcasecmp(start, "Content-Length") && 0 != atoi(v))
+          {
+            nwarn("WARNING: non-zero request length\n");
+            return 413;
+          }
 #ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-            else if (0 == strcasecmp(start, "Connection") &&
-                     0 == strcasecmp(v, "keep-alive"))
-              {
-                pstate->ht_keepalive = true;
-              }
+        else if (0 == strcasecmp(start, "Connection") &&
+                 0 == strcasecmp(v, "keep-alive"))
+          {
+            pstate->ht_keepalive = true;
+          }
 #endif
-            break;
+        break;
 
-          case STATE_BODY:
+      case STATE_BODY:
 
-            /* Not implemented */
+        /* Not implemented */
 
-            break;
-          }
-       }
+        break;
+      }
+    }
+
+  /* Shuffle down for the next block */
 
-      /* Shuffle down for the next block */
+  memmove(pstate->ht_buffer, start, o - start);
+  pstate->ht_rcvlen = o - start;
 
-      memmove(pstate->ht_buffer, start, o - start);
-      o -= (start - pstate->ht_buffer);
+  if (pstate->ht_parse != STATE_BODY)
+    {
+      if (pstate->ht_rcvlen == sizeof pstate->ht_buffer)
+        {
+          nerr("ERROR: ht_buffer overflow\n");
+          return 413;
+        }
+
+      return 0;
     }
-  while (state != STATE_BODY);
 
 #ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
   if (0 == strcmp(pstate->ht_filename, "/"))
@@ -672,6 +860,49 @@ static inline int httpd_parse(struct httpd_state *pstate)
   return 200;
 }
 
+static inline int httpd_parse(struct httpd_state *pstate)
+{
+  int status;
+
+  pstate->ht_parse  = STATE_METHOD;
+  pstate->ht_rcvlen = 0;
+
+  do
+    {
+      ssize_t r;
+
+      r = recv(pstate->ht_sockfd, pstate->ht_buffer + pstate->ht_rcvlen,
+               sizeof pstate->ht_buffer - pstate->ht_rcvlen, 0);
+      if (r == 0)
+        {
+          nwarn("WARNING: [%d] connection lost\n", pstate->ht_sockfd);
+          return ERROR;
+        }
+
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+      if (r == -1 && errno == EWOULDBLOCK)
+        {
+          nwarn("WARNING: recv timeout\n");
+          return 408;
+        }
+#endif
+
+      if (r == -1)
+        {
+          nerr("ERROR: [%d] recv failed: %d\n",
+               pstate->ht_sockfd, errno);
+          return 400;
+        }
+
+      pstate->ht_rcvlen += r;
+      status = httpd_parse_lines(pstate);
+    }
+  while (status == 0);
+
+  return status;
+}
+
+#ifndef CONFIG_NETUTILS_HTTPD_EVENTLOOP
 /****************************************************************************
  * Name: httpd_handler
  *
@@ -735,7 +966,10 @@ static void *httpd_handler(void *arg)
   return NULL;
 }
 
-#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+#endif
+
+#if defined(CONFIG_NETUTILS_HTTPD_SINGLECONNECT) && \
+    !defined(CONFIG_NETUTILS_HTTPD_EVENTLOOP)
 static void single_server(uint16_t portno, pthread_startroutine_t handler,
                           int stacksize)
 {
@@ -814,6 +1048,450 @@ static void single_server(uint16_t portno, pthread_startroutine_t handler,
 }
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_EVENTLOOP
+/****************************************************************************
+ * Name: httpd_ev_now
+ ****************************************************************************/
+
+static time_t httpd_ev_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/****************************************************************************
+ * Name: httpd_ev_setblocking
+ ****************************************************************************/
+
+static void httpd_ev_setblocking(int sockfd, bool blocking)
+{
+  int flags = fcntl(sockfd, F_GETFL, 0);
+
+  if (flags >= 0)
+    {
+      flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+      fcntl(sockfd, F_SETFL, flags);
+    }
+}
+
+/****************************************************************************
+ * Name: httpd_ev_respond
+ *
+ * Description:
+ *   Start the response to a parsed request.  Plain files are opened and
+ *   their headers formatted into ht_header, to be sent by httpd_ev_send()
+ *   as the socket drains.  Errors, CGI functions, scripts and directory
+ *   listings produce their output in a single call, so they are sent with
+ *   the blocking httpd_senderror() / httpd_sendfile() instead.
+ *
+ * Returned Value:
+ *   1 if ht_header and ht_file are ready to be sent, 0 if the response
+ *   has already been sent.
+ *
+ ****************************************************************************/
+
+static int httpd_ev_respond(struct httpd_state *pstate, int status)
+{
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
+  char *ptr;
+#endif
+  int len;
+
+  pstate->ht_sndlen = 0;
+
+  if (status >= 400)
+    {
+      goto blocking;
+    }
+
+#ifdef CONFIG_NETUTILS_HTTPD_CGIPATH
+  if (httpd_cgi(pstate->ht_filename) != NULL)
+    {
+      goto blocking;
+    }
+#endif
+
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
+  ptr = strchr(pstate->ht_filename, ISO_PERIOD);
+  if (ptr != NULL &&
+      strncmp(ptr, ".shtml", strlen(".shtml")) == 0)
+    {
+      goto blocking;
+    }
+#endif
+
+  if (httpd_openindex(pstate) != OK)
+    {
+      nwarn("WARNING: [%d] '%s' not found\n",
+           pstate->ht_sockfd, pstate->ht_filename);
+      status = 404;
+      goto blocking;
+    }
+
+#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
+  if (pstate->ht_file.fd == -1)
+    {
+      httpd_close(&pstate->ht_file);
+      goto blocking;
+    }
+
+  len = -1;
+#else
+  len = pstate->ht_file.len;
+  status = len == 0 ? 204 : 200;
+#endif
+
+  ninfo("[%d] sending file '%s'\n", pstate->ht_sockfd, pstate->ht_filename);
+
+  pstate->ht_hdrlen  = httpd_format_headers(pstate, status, len,
+                                            pstate->ht_header);
+  pstate->ht_hdrsent = 0;
+  pstate->ht_offset  = 0;
+  return 1;
+
+blocking:
+  httpd_ev_setblocking(pstate->ht_sockfd, true);
+
+  if (status >= 400)
+    {
+      httpd_senderror(pstate, status);
+    }
+  else
+    {
+      httpd_sendfile(pstate);
+    }
+
+  httpd_ev_setblocking(pstate->ht_sockfd, false);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: httpd_ev_send
+ *
+ * Description:
+ *   Send as much of ht_header and then ht_file as the socket accepts.
+ *   The file data goes straight from the classic or mapped image, or from
+ *   the file with sendfile(), at most HTTPD_IOBUFFER_SIZE bytes per call.
+ *
+ * Returned Value:
+ *   1 when everything has been sent, 0 if the socket is full, or ERROR.
+ *
+ ****************************************************************************/
+
+static int httpd_ev_send(struct httpd_state *pstate)
+{
+  ssize_t ret;
+  size_t len;
+
+  while (pstate->ht_hdrsent < pstate->ht_hdrlen)
+    {
+      ret = send(pstate->ht_sockfd, pstate->ht_header + pstate->ht_hdrsent,
+                 pstate->ht_hdrlen - pstate->ht_hdrsent, 0);
+      if (ret < 0)
+        {
+          goto error;
+        }
+
+      pstate->ht_hdrsent += ret;
+    }
+
+  while (pstate->ht_offset < pstate->ht_file.len)
+    {
+      len = MIN(pstate->ht_file.len - pstate->ht_offset,
+                HTTPD_IOBUFFER_SIZE);
+
+#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
+      ret = sendfile(pstate->ht_sockfd, pstate->ht_file.fd,
+                     &pstate->ht_offset, len);
+#else
+      ret = send(pstate->ht_sockfd,
+                 pstate->ht_file.data + pstate->ht_offset, len, 0);
+#endif
+      if (ret < 0)
+        {
+          goto error;
+        }
+      else if (ret == 0)
+        {
+          return ERROR;
+        }
+
+#ifndef CONFIG_NETUTILS_HTTPD_SENDFILE
+      pstate->ht_offset += ret;
+#endif
+    }
+
+  return 1;
+
+error:
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    {
+      return 0;
+    }
+
+  nerr("ERROR: [%d] send failed: %d\n", pstate->ht_sockfd, errno);
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: httpd_ev_process
+ *
+ * Description:
+ *   Advance the state machine of one connection after poll().
+ *
+ * Returned Value:
+ *   true if the connection stays open, false if it has to be closed.
+ *
+ ****************************************************************************/
+
+static bool httpd_ev_process(struct httpd_state *pstate, short revents,
+                             time_t now)
+{
+  ssize_t r;
+  int status;
+  int ret;
+
+  if (revents == 0)
+    {
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+      if (now - pstate->ht_lastio >= CONFIG_NETUTILS_HTTPD_TIMEOUT)
+        {
+          nwarn("WARNING: [%d] timeout\n", pstate->ht_sockfd);
+          if (pstate->ht_phase == PHASE_RECV)
+            {
+              httpd_ev_respond(pstate, 408);
+            }
+
+          return false;
+        }
+#endif
+
+      return true;
+    }
+
+  pstate->ht_lastio = now;
+
+  if ((revents & (POLLERR | POLLNVAL)) != 0)
+    {
+      return false;
+    }
+
+  if (pstate->ht_phase == PHASE_RECV)
+    {
+      r = recv(pstate->ht_sockfd, pstate->ht_buffer + pstate->ht_rcvlen,
+               sizeof pstate->ht_buffer - pstate->ht_rcvlen, 0);
+      if (r == 0)
+        {
+          ninfo("[%d] connection closed\n", pstate->ht_sockfd);
+          return false;
+        }
+
+      if (r < 0)
+        {
+          return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+      pstate->ht_rcvlen += r;
+      status = httpd_parse_lines(pstate);
+      if (status == 0)
+        {
+          return true;
+        }
+
+      if (httpd_ev_respond(pstate, status) == 0)
+        {
+          goto done;
+        }
+
+      pstate->ht_phase = PHASE_SEND;
+    }
+
+  ret = httpd_ev_send(pstate);
+  if (ret <= 0)
+    {
+      return ret == 0;
+    }
+
+  httpd_close(&pstate->ht_file);
+
+done:
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+  if (pstate->ht_keepalive)
+    {
+      /* Wait for the next request on this connection */
+
+      pstate->ht_phase     = PHASE_RECV;
+      pstate->ht_parse     = STATE_METHOD;
+      pstate->ht_rcvlen    = 0;
+      pstate->ht_keepalive = false;
+      return true;
+    }
+#endif
+
+  pstate->ht_phase = PHASE_RECV;
+  return false;
+}
+
+/****************************************************************************
+ * Name: httpd_ev_close
+ ****************************************************************************/
+
+static void httpd_ev_close(struct httpd_state *pstate)
+{
+  ninfo("[%d] Exiting\n", pstate->ht_sockfd);
+
+  if (pstate->ht_phase == PHASE_SEND)
+    {
+      httpd_close(&pstate->ht_file);
+    }
+
+  close(pstate->ht_sockfd);
+  free(pstate);
+}
+
+/****************************************************************************
+ * Name: httpd_ev_accept
+ ****************************************************************************/
+
+static struct httpd_state *httpd_ev_accept(int listensd, time_t now)
+{
+  struct httpd_state *pstate;
+  struct sockaddr_in myaddr;
+  socklen_t addrlen;
+  int acceptsd;
+#ifdef CONFIG_NET_SOLINGER
+  struct linger ling;
+#endif
+
+  addrlen = sizeof(struct sockaddr_in);
+  acceptsd = accept4(listensd, (FAR struct sockaddr *)&myaddr, &addrlen,
+                     SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (acceptsd < 0)
+    {
+      nerr("ERROR: accept failure: %d\n", errno);
+      return NULL;
+    }
+
+#ifdef CONFIG_NET_SOLINGER
+  /* Configure to "linger" until all data is sent when the socket is
+   * closed
+   */
+
+  ling.l_onoff  = 1;
+  ling.l_linger = 30;     /* timeout is seconds */
+  if (setsockopt(acceptsd, SOL_SOCKET, SO_LINGER, &ling,
+                 sizeof(struct linger)) < 0)
+    {
+      nerr("ERROR: setsockopt SO_LINGER failure: %d\n", errno);
+      close(acceptsd);
+      return NULL;
+    }
+#endif
+
+  pstate = (struct httpd_state *)zalloc(sizeof(struct httpd_state));
+  if (pstate == NULL)
+    {
+      close(acceptsd);
+      return NULL;
+    }
+
+  ninfo("[%d] Started\n", acceptsd);
+
+  pstate->ht_sockfd = acceptsd;
+  pstate->ht_lastio = now;
+  return pstate;
+}
+
+/****************************************************************************
+ * Name: httpd_ev_server
+ *
+ * Description:
+ *   Serve up to CONFIG_NETUTILS_HTTPD_MAXCONN connections from a single
+ *   thread.  Each connection is a state machine driven by poll(); the
+ *   listening socket is only polled while there is room for another one.
+ *
+ ****************************************************************************/
+
+static void httpd_ev_server(uint16_t portno)
+{
+  struct httpd_state *conn[CONFIG_NETUTILS_HTTPD_MAXCONN];
+  struct pollfd fds[CONFIG_NETUTILS_HTTPD_MAXCONN + 1];
+  time_t now;
+  int listensd;
+  int nconn = 0;
+  int ret;
+  int i;
+
+  listensd = netlib_listenon(portno);
+  if (listensd < 0)
+    {
+      return;
+    }
+
+  fds[0].events = POLLIN;
+
+  for (; ; )
+    {
+      fds[0].fd = nconn < CONFIG_NETUTILS_HTTPD_MAXCONN ? listensd : -1;
+      fds[0].revents = 0;
+
+      ret = poll(fds, nconn + 1, HTTPD_EV_TICK);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          nerr("ERROR: poll failure: %d\n", errno);
+          break;
+        }
+
+      now = httpd_ev_now();
+
+      for (i = 0; i < nconn; )
+        {
+          if (!httpd_ev_process(conn[i], fds[i + 1].revents, now))
+            {
+              /* Move the last connection into the free slot, it is
+               * processed in the next iteration.
+               */
+
+              httpd_ev_close(conn[i]);
+              nconn--;
+              conn[i]    = conn[nconn];
+              fds[i + 1] = fds[nconn + 1];
+              continue;
+            }
+
+          fds[i + 1].events = conn[i]->ht_phase == PHASE_SEND ?
+                              POLLOUT : POLLIN;
+          i++;
+        }
+
+      if ((fds[0].revents & POLLIN) != 0)
+        {
+          conn[nconn] = httpd_ev_accept(listensd, now);
+          if (conn[nconn] != NULL)
+            {
+              fds[nconn + 1].fd     = conn[nconn]->ht_sockfd;
+              fds[nconn + 1].events = POLLIN;
+              nconn++;
+            }
+        }
+    }
+
+  for (i = 0; i < nconn; i++)
+    {
+      httpd_ev_close(conn[i]);
+    }
+
+  close(listensd);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -837,7 +1515,9 @@ int httpd_listen(void)
 {
   /* Execute httpd_handler on each connection to port 80 */
 
-#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+#if defined(CONFIG_NETUTILS_HTTPD_EVENTLOOP)
+  httpd_ev_server(HTONS(80));
+#elif defined(CONFIG_NETUTILS_HTTPD_SINGLECONNECT)
   single_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
 #else
   netlib_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
@@ -908,151 +1588,9 @@ int httpd_send_datachunk(int sockfd, void *data, int len, bool chunked)
 
 int httpd_send_headers(struct httpd_state *pstate, int status, int len)
 {
-  const char *mime;
-  const char *ptr;
-  char contentlen[HTTPD_MAX_CONTENTLEN] =
-    {
-      0
-    };
-
   char header[HTTPD_MAX_HEADERLEN];
   int hdrlen;
-  int i;
-
-  static const struct
-  {
-    const char *ext;
-    const char *mime;
-  }
-
-  a[] =
-    {
-#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
-    {
-      "shtml", "text/html"
-    },
-#endif
-
-    {
-      "html",  "text/html"
-    },
-
-    {
-      "css",   "text/css"
-    },
-
-    {
-      "txt",   "text/plain"
-    },
-
-    {
-      "json",  "application/json"
-    },
-
-    {
-      "js",    "text/javascript"
-    },
-
-    {
-      "png",   "image/png"
-    },
-
-    {
-      "gif",   "image/gif"
-    },
-
-    {
-      "jpeg",  "image/jpeg"
-    },
-
-    {
-      "jpg",   "image/jpeg"
-    },
-
-    {
-      "mp3",   "audio/mpeg"
-    },
-    };
-
-  ptr = strrchr(pstate->ht_filename, ISO_PERIOD);
-  if (ptr == NULL)
-    {
-      mime = "application/octet-stream";
-    }
-  else
-    {
-      mime = "text/plain";
-
-      for (i = 0; i < nitems(a); i++)
-        {
-          if (strncmp(a[i].ext, ptr + 1, strlen(a[i].ext)) == 0)
-            {
-              mime = a[i].mime;
-              break;
-            }
-        }
-    }
-
-#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
-  if (false == httpd_is_file(pstate->ht_filename))
-    {
-      /* we assume that it's a directory */
-
-      mime = "text/html";
-    }
-#endif
-
-  if (len >= 0)
-    {
-      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
-               "Content-Length: %d\r\n", len);
-    }
-  else
-    {
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-      /* Length unknown ahead of time */
-
-      pstate->ht_keepalive = false;
-#endif
-#if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
-      /* Turn on chunked encoding */
-
-      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
-               "Transfer-Encoding: chunked\r\n");
-      pstate->ht_chunked = true;
-#endif
-    }
-
-  if (status == 413)
-    {
-      /* TODO: here we "SHOULD" include a Retry-After header */
-    }
-
-  /* Construct the header.
-   *
-   * REVISIT:  Wouldn't asprintf be a better option than a large stack
-   * array?
-   */
-
-  hdrlen = snprintf(header, HTTPD_MAX_HEADERLEN,
-                    "HTTP/1.0 %d %s\r\n"
-#ifndef CONFIG_NETUTILS_HTTPD_SERVERHEADER_DISABLE
-                    "Server: uIP/NuttX http://nuttx.org/\r\n"
-#endif
-                    "Connection: %s\r\n"
-                    "Content-type: %s\r\n"
-                    "%s"
-                    "\r\n",
-                    status,
-                    status >= 400 ? "Error" : "OK",
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-                    pstate->ht_keepalive ? "keep-alive" : "close",
-#else
-                    "close",
-#endif
-                    mime,
-                    contentlen
-                    );
 
+  hdrlen = httpd_format_headers(pstate, status, len, header);
   return send_chunk(pstate, header, hdrlen);
 }
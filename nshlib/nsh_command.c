@@ -28,12 +28,17 @@
 
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 
 #ifdef CONFIG_NSH_BUILTIN_APPS
 #  include <nuttx/lib/builtin.h>
 #endif
 
+#ifdef CONFIG_NSH_BUILTIN_AS_COMMAND
+#  include "builtin/builtin.h"
+#endif
+
 #if defined(CONFIG_SYSTEM_READLINE) && defined(CONFIG_READLINE_HAVE_EXTMATCH)
 #  include "system/readline.h"
 #endif
@@ -100,6 +105,7 @@ static int cmd_expr(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv);
 
 static int  cmd_unrecognized(FAR struct nsh_vtbl_s *vtbl, int argc,
                              FAR char **argv);
+static FAR const struct cmdmap_s *nsh_cmdfind(FAR const char *cmd);
 
 /****************************************************************************
  * Private Data
@@ -680,10 +686,91 @@ static const struct cmdmap_s g_cmdmap[] =
   CMD_MAP(NULL,       NULL,         1, 1, NULL)
 };
 
+/* g_cmdmap[] is grouped by configuration rather than strictly sorted.
+ * Lookups use this index, sorted by command name on first use.
+ */
+
+static_assert(NUM_CMDS <= UINT8_MAX + 1, "g_cmdindex is too narrow");
+
+static uint8_t        g_cmdindex[NUM_CMDS];
+static pthread_once_t g_cmdonce = PTHREAD_ONCE_INIT;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nsh_cmdindex
+ *
+ * Description:
+ *   Sort g_cmdindex[] by command name.  Run through pthread_once(), which
+ *   also makes the sorted index visible to sessions on other CPUs.
+ *
+ ****************************************************************************/
+
+static void nsh_cmdindex(void)
+{
+  FAR const char *cmd;
+  int i;
+  int j;
+
+  for (i = 0; i < (int)NUM_CMDS; i++)
+    {
+      cmd = g_cmdmap[i].cmd;
+      for (j = i;
+           j > 0 && strcmp(g_cmdmap[g_cmdindex[j - 1]].cmd, cmd) > 0;
+           j--)
+        {
+          g_cmdindex[j] = g_cmdindex[j - 1];
+        }
+
+      g_cmdindex[j] = i;
+    }
+}
+
+/****************************************************************************
+ * Name: nsh_cmdfind
+ *
+ * Description:
+ *   Find a command in g_cmdmap[] with a binary search of g_cmdindex[].
+ *
+ * Returned Value:
+ *   The command map entry, or NULL if there is no such command.
+ *
+ ****************************************************************************/
+
+static FAR const struct cmdmap_s *nsh_cmdfind(FAR const char *cmd)
+{
+  FAR const struct cmdmap_s *cmdmap;
+  int lo = 0;
+  int hi = NUM_CMDS;
+  int mid;
+  int cmp;
+
+  pthread_once(&g_cmdonce, nsh_cmdindex);
+
+  while (lo < hi)
+    {
+      mid    = (lo + hi) / 2;
+      cmdmap = &g_cmdmap[g_cmdindex[mid]];
+      cmp    = strcmp(cmd, cmdmap->cmd);
+      if (cmp == 0)
+        {
+          return cmdmap;
+        }
+      else if (cmp < 0)
+        {
+          hi = mid;
+        }
+      else
+        {
+          lo = mid + 1;
+        }
+    }
+
+  return NULL;
+}
+
 /****************************************************************************
  * Name: help_cmdlist
  ****************************************************************************/
@@ -838,18 +925,12 @@ static int help_cmd(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd)
 
   /* Find the command in the command table */
 
-  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+  cmdmap = nsh_cmdfind(cmd);
+  if (cmdmap != NULL)
     {
-      /* Is this the one we are looking for? */
-
-      if (strcmp(cmdmap->cmd, cmd) == 0)
-        {
-          /* Yes... show it */
-
-          nsh_output(vtbl, "%s usage:", cmd);
-          help_showcmd(vtbl, cmdmap);
-          return OK;
-        }
+      nsh_output(vtbl, "%s usage:", cmd);
+      help_showcmd(vtbl, cmdmap);
+      return OK;
     }
 
   nsh_error(vtbl, g_fmtcmdnotfound, cmd);
@@ -1235,9 +1316,9 @@ int nsh_command(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char *argv[])
 #ifdef CONFIG_NSH_BUILTIN_AS_COMMAND
   /* Check if the command is available in the builtin list */
 
-  index = builtin_isavail(cmd);
+  index = builtin_find(cmd);
 
-  if (index > 0)
+  if (index >= 0)
     {
       /* Get the builtin structure by index */
 
@@ -1251,39 +1332,34 @@ int nsh_command(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char *argv[])
 
   /* See if the command is one that we understand */
 
-  for (cmdmap = g_cmdmap; cmdmap->cmd; cmdmap++)
+  cmdmap = nsh_cmdfind(cmd);
+  if (cmdmap != NULL)
     {
-      if (strcmp(cmdmap->cmd, cmd) == 0)
+      /* Check if a valid number of arguments was provided.  We
+       * do this simple, imperfect checking here so that it does
+       * not have to be performed in each command.
+       */
+
+      if (argc < cmdmap->minargs)
         {
-          /* Check if a valid number of arguments was provided.  We
-           * do this simple, imperfect checking here so that it does
-           * not have to be performed in each command.
-           */
+          /* Fewer than the minimum number were provided */
 
-          if (argc < cmdmap->minargs)
-            {
-              /* Fewer than the minimum number were provided */
+          nsh_error(vtbl, g_fmtargrequired, cmd);
+          return ERROR;
+        }
+      else if (argc > cmdmap->maxargs)
+        {
+          /* More than the maximum number were provided */
 
-              nsh_error(vtbl, g_fmtargrequired, cmd);
-              return ERROR;
-            }
-          else if (argc > cmdmap->maxargs)
-            {
-              /* More than the maximum number were provided */
+          nsh_error(vtbl, g_fmttoomanyargs, cmd);
+          return ERROR;
+        }
 
-              nsh_error(vtbl, g_fmttoomanyargs, cmd);
-              return ERROR;
-            }
-          else
-            {
-              /* A valid number of arguments were provided (this does
-               * not mean they are right).
-               */
+      /* A valid number of arguments were provided (this does not mean
+       * they are right).
+       */
 
-              handler = cmdmap->handler;
-              break;
-            }
-        }
+      handler = cmdmap->handler;
     }
 
   ret = handler(vtbl, argc, argv);
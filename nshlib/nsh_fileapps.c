@@ -40,6 +40,7 @@
 #include <fcntl.h>
 
 #include <nuttx/lib/builtin.h>
+#include "builtin/builtin.h"
 
 #include "nsh.h"
 #include "nsh_console.h"
@@ -183,7 +184,7 @@ int nsh_fileapp(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
   /* Check if a builtin application with this name exists */
 
   appname = basename((FAR char *)cmd);
-  index = builtin_isavail(appname);
+  index = builtin_find(appname);
   if (index >= 0)
     {
       FAR const struct builtin_s *builtin;
@@ -28,6 +28,8 @@
 
 #include <fcntl.h>
 #include <sched.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "nsh.h"
@@ -37,6 +39,32 @@
 
 #ifndef CONFIG_NSH_DISABLESCRIPT
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if !defined(CONFIG_NSH_DISABLE_LOOPS) && CONFIG_NSH_LOOP_CACHE > 0
+#  define NSH_HAVE_LOOP_CACHE 1
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+#ifdef NSH_HAVE_LOOP_CACHE
+/* A script line inside a while/until loop.  Each iteration seeks back to
+ * the top of the loop, the cached lines are then not read again from the
+ * script file.
+ */
+
+struct nsh_loopline_s
+{
+  long      offs;              /* File offset of the line */
+  long      next;              /* File offset of the following line */
+  FAR char *line;              /* The line as read from the file */
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -81,6 +109,28 @@ static int nsh_script_redirect(FAR struct nsh_vtbl_s *vtbl,
 }
 #endif
 
+/****************************************************************************
+ * Name: nsh_loopline_find
+ ****************************************************************************/
+
+#ifdef NSH_HAVE_LOOP_CACHE
+static FAR struct nsh_loopline_s *
+nsh_loopline_find(FAR struct nsh_loopline_s *cache, int ncached, long offs)
+{
+  int i;
+
+  for (i = 0; i < ncached; i++)
+    {
+      if (cache[i].offs == offs)
+        {
+          return &cache[i];
+        }
+    }
+
+  return NULL;
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -99,6 +149,16 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const FAR char *cmd,
   FAR char *fullpath;
   int savestream;
   FAR char *buffer;
+#ifdef NSH_HAVE_LOOP_CACHE
+  FAR struct nsh_loopline_s *cache = NULL;
+  FAR struct nsh_loopline_s *cached;
+  FAR char *line;
+  long offs;
+  long next = -1;
+  long top = -1;
+  bool inloop;
+  int ncached = 0;
+#endif
   int ret = ERROR;
 
   /* The path to the script may relative to the current working directory */
@@ -160,9 +220,52 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const FAR char *cmd,
             }
 #endif
 
-          /* Now read the next line from the script file */
+#ifdef NSH_HAVE_LOOP_CACHE
+          /* Take the line from the loop cache if it was read before */
+
+          line   = NULL;
+          cached = NULL;
+          offs   = vtbl->np.np_foffs;
+          if (offs >= 0)
+            {
+              cached = nsh_loopline_find(cache, ncached, offs);
+            }
+
+          if (cached != NULL)
+            {
+              ret = strlcpy(buffer, cached->line, LINE_MAX);
+              if (lseek(vtbl->np.np_fd, cached->next, SEEK_SET) < 0)
+                {
+                  ret = ERROR;
+                }
+            }
+          else
+#endif
+            {
+              /* Now read the next line from the script file */
+
+              ret = readline_fd(buffer, LINE_MAX, vtbl->np.np_fd, -1);
+            }
+
+#ifdef NSH_HAVE_LOOP_CACHE
+          /* Keep a copy of lines inside a loop body and of the 'while' or
+           * 'until' line at its top, which is read again on each
+           * iteration.  Parsing modifies the buffer.  Lines outside of
+           * loops cost nothing extra.
+           */
+
+          inloop = vtbl->np.np_lpndx > 0;
+          if (ret >= 0 && cached == NULL && offs >= 0 &&
+              (inloop || offs == top) && ncached < CONFIG_NSH_LOOP_CACHE)
+            {
+              next = lseek(vtbl->np.np_fd, 0, SEEK_CUR);
+              if (next >= 0)
+                {
+                  line = strdup(buffer);
+                }
+            }
+#endif
 
-          ret = readline_fd(buffer, LINE_MAX, vtbl->np.np_fd, -1);
           if (ret >= 0)
             {
               /* Parse process the command.  NOTE:  this is recursive...
@@ -184,9 +287,47 @@ int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const FAR char *cmd,
                   ret = nsh_parse(vtbl, buffer);
                 }
             }
+
+#ifdef NSH_HAVE_LOOP_CACHE
+          /* An outermost loop starts at this line */
+
+          if (!inloop && vtbl->np.np_lpndx > 0)
+            {
+              top = offs;
+            }
+
+          if (line != NULL)
+            {
+              if (cache == NULL)
+                {
+                  cache = malloc(CONFIG_NSH_LOOP_CACHE *
+                                 sizeof(struct nsh_loopline_s));
+                }
+
+              if (cache != NULL)
+                {
+                  cache[ncached].offs = offs;
+                  cache[ncached].next = next;
+                  cache[ncached].line = line;
+                  ncached++;
+                  line = NULL;
+                }
+            }
+
+          free(line);
+#endif
         }
       while (ret >= 0);
 
+#ifdef NSH_HAVE_LOOP_CACHE
+      while (ncached > 0)
+        {
+          free(cache[--ncached].line);
+        }
+
+      free(cache);
+#endif
+
       /* Close the script file */
 
       close(vtbl->np.np_fd);
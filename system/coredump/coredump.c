@@ -28,13 +28,27 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/param.h>
 #include <stdlib.h>
 #include <syslog.h>
 #include <dirent.h>
+#include <errno.h>
 #include <elf.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef CONFIG_SYSTEM_COREDUMP_NET
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#endif
+
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+#  include <zlib.h>
+#endif
 
 #include <nuttx/binfmt/binfmt.h>
 #include <nuttx/streams.h>
@@ -53,6 +67,38 @@
 
 #define COREDUMP_FILE_SUFFIX_LEN (sizeof(COREDUMP_FILE_SUFFIX) - 1)
 
+#ifndef CONFIG_SYSTEM_COREDUMP_ZERO_BLOCKSIZE
+#  define CONFIG_SYSTEM_COREDUMP_ZERO_BLOCKSIZE 1024
+#endif
+
+/* Zero elided streams start with COREDUMP_ZERO_MAGIC followed by records,
+ * each a little endian 32 bit header: the length, with COREDUMP_ZERO_RUN
+ * set for a run of zeros, or followed by as many data bytes otherwise.
+ */
+
+#define COREDUMP_ZERO_MAGIC      "NXCZ\x01\x00\x00\x00"
+#define COREDUMP_ZERO_MAGIC_LEN  8
+#define COREDUMP_ZERO_RUN        0x80000000u
+#define COREDUMP_ZERO_MAXRUN     0x7fffffffu
+
+#define COREDUMP_CODEC_NONE      0
+#define COREDUMP_CODEC_LZF       1
+#define COREDUMP_CODEC_ZLIB      2
+
+#ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
+#  define COREDUMP_CODEC_DEFAULT COREDUMP_CODEC_LZF
+#else
+#  define COREDUMP_CODEC_DEFAULT COREDUMP_CODEC_NONE
+#endif
+
+#ifdef CONFIG_SYSTEM_COREDUMP_ELIDE_ZERO
+#  define COREDUMP_ELIDE_DEFAULT true
+#else
+#  define COREDUMP_ELIDE_DEFAULT false
+#endif
+
+#define COREDUMP_ZLIB_CHUNK      512
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -60,6 +106,42 @@
 typedef CODE void (*dumpfile_cb_t)(FAR char *path, FAR const char *filename,
                                    FAR void *arg);
 
+/* Replaces zero blocks of the core image with zero run records */
+
+struct coredump_zerostream_s
+{
+  struct lib_outstream_s common;
+  FAR struct lib_outstream_s *backend;
+  size_t   fill;                      /* Bytes in block */
+  uint32_t zeros;                     /* Pending run of zeros */
+  uintptr_t block[CONFIG_SYSTEM_COREDUMP_ZERO_BLOCKSIZE /
+                  sizeof(uintptr_t)];
+};
+
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+struct coredump_zlibstream_s
+{
+  struct lib_outstream_s common;
+  FAR struct lib_outstream_s *backend;
+  z_stream zs;
+  int      error;                     /* Deflate failed */
+  uint8_t  out[COREDUMP_ZLIB_CHUNK];
+};
+#endif
+
+struct coredump_streams_s
+{
+  struct lib_stdoutstream_s out;
+  struct lib_hexdumpstream_s hex;
+#ifdef CONFIG_LIBC_LZF
+  struct lib_lzfoutstream_s lzf;
+#endif
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+  struct coredump_zlibstream_s zlib;
+#endif
+  struct coredump_zerostream_s zero;
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -366,21 +448,373 @@ blkfd_err:
 #endif
 
 /****************************************************************************
- * coredump_now
+ * coredump_zero_emit
  ****************************************************************************/
 
-static int coredump_now(int pid, FAR char *filename)
+static void coredump_zero_emit(FAR struct coredump_zerostream_s *zstream,
+                               uint32_t header, FAR const void *buf,
+                               size_t len)
 {
-  FAR struct lib_stdoutstream_s *outstream;
-  FAR struct lib_hexdumpstream_s *hstream;
-#ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
-  FAR struct lib_lzfoutstream_s *lstream;
+  uint8_t le[4];
+
+  le[0] = header & 0xff;
+  le[1] = (header >> 8) & 0xff;
+  le[2] = (header >> 16) & 0xff;
+  le[3] = header >> 24;
+
+  lib_stream_puts(zstream->backend, le, sizeof(le));
+  if (len > 0)
+    {
+      lib_stream_puts(zstream->backend, buf, len);
+    }
+}
+
+/****************************************************************************
+ * coredump_zero_block
+ *
+ * Description:
+ *   Emit the buffered block, or add it to the pending zero run.
+ *
+ ****************************************************************************/
+
+static void coredump_zero_block(FAR struct coredump_zerostream_s *zstream)
+{
+  size_t nwords = (zstream->fill + sizeof(uintptr_t) - 1) /
+                  sizeof(uintptr_t);
+  size_t i = 0;
+
+  /* A partial last word was zero filled by the caller */
+
+  while (i < nwords && zstream->block[i] == 0)
+    {
+      i++;
+    }
+
+  if (i == nwords && zstream->zeros <= COREDUMP_ZERO_MAXRUN - zstream->fill)
+    {
+      zstream->zeros += zstream->fill;
+    }
+  else
+    {
+      if (zstream->zeros > 0)
+        {
+          coredump_zero_emit(zstream, COREDUMP_ZERO_RUN | zstream->zeros,
+                             NULL, 0);
+          zstream->zeros = 0;
+        }
+
+      if (i == nwords)
+        {
+          zstream->zeros = zstream->fill;
+        }
+      else
+        {
+          coredump_zero_emit(zstream, zstream->fill, zstream->block,
+                             zstream->fill);
+        }
+    }
+
+  zstream->fill = 0;
+}
+
+/****************************************************************************
+ * coredump_zero_puts
+ ****************************************************************************/
+
+static ssize_t coredump_zero_puts(FAR struct lib_outstream_s *self,
+                                  FAR const void *buf, size_t len)
+{
+  FAR struct coredump_zerostream_s *zstream =
+    (FAR struct coredump_zerostream_s *)self;
+  FAR const uint8_t *ptr = buf;
+  size_t remain = len;
+  size_t n;
+
+  while (remain > 0)
+    {
+      n = MIN(remain, sizeof(zstream->block) - zstream->fill);
+      memcpy((FAR uint8_t *)zstream->block + zstream->fill, ptr, n);
+      zstream->fill += n;
+      ptr           += n;
+      remain        -= n;
+
+      if (zstream->fill == sizeof(zstream->block))
+        {
+          coredump_zero_block(zstream);
+        }
+    }
+
+  self->nput += len;
+  return len;
+}
+
+/****************************************************************************
+ * coredump_zero_putc
+ ****************************************************************************/
+
+static void coredump_zero_putc(FAR struct lib_outstream_s *self, int ch)
+{
+  uint8_t byte = ch;
+
+  coredump_zero_puts(self, &byte, 1);
+}
+
+/****************************************************************************
+ * coredump_zero_flush
+ ****************************************************************************/
+
+static int coredump_zero_flush(FAR struct lib_outstream_s *self)
+{
+  FAR struct coredump_zerostream_s *zstream =
+    (FAR struct coredump_zerostream_s *)self;
+
+  if (zstream->fill > 0)
+    {
+      memset((FAR uint8_t *)zstream->block + zstream->fill, 0,
+             sizeof(zstream->block) - zstream->fill);
+      coredump_zero_block(zstream);
+    }
+
+  if (zstream->zeros > 0)
+    {
+      coredump_zero_emit(zstream, COREDUMP_ZERO_RUN | zstream->zeros,
+                         NULL, 0);
+      zstream->zeros = 0;
+    }
+
+  return lib_stream_flush(zstream->backend);
+}
+
+/****************************************************************************
+ * coredump_zerostream
+ ****************************************************************************/
+
+static void coredump_zerostream(FAR struct coredump_zerostream_s *zstream,
+                                FAR struct lib_outstream_s *backend)
+{
+  memset(zstream, 0, sizeof(*zstream));
+  zstream->common.putc  = coredump_zero_putc;
+  zstream->common.puts  = coredump_zero_puts;
+  zstream->common.flush = coredump_zero_flush;
+  zstream->backend      = backend;
+
+  lib_stream_puts(backend, COREDUMP_ZERO_MAGIC, COREDUMP_ZERO_MAGIC_LEN);
+}
+
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+/****************************************************************************
+ * coredump_zlib_deflate
+ ****************************************************************************/
+
+static int coredump_zlib_deflate(FAR struct coredump_zlibstream_s *zstream,
+                                 int flush)
+{
+  int ret;
+
+  do
+    {
+      zstream->zs.next_out  = zstream->out;
+      zstream->zs.avail_out = sizeof(zstream->out);
+
+      ret = deflate(&zstream->zs, flush);
+      if (ret == Z_STREAM_ERROR)
+        {
+          zstream->error = -EIO;
+          return zstream->error;
+        }
+
+      lib_stream_puts(zstream->backend, zstream->out,
+                      sizeof(zstream->out) - zstream->zs.avail_out);
+    }
+  while (zstream->zs.avail_out == 0);
+
+  return OK;
+}
+
+/****************************************************************************
+ * coredump_zlib_puts
+ ****************************************************************************/
+
+static ssize_t coredump_zlib_puts(FAR struct lib_outstream_s *self,
+                                  FAR const void *buf, size_t len)
+{
+  FAR struct coredump_zlibstream_s *zstream =
+    (FAR struct coredump_zlibstream_s *)self;
+
+  if (zstream->error < 0)
+    {
+      return zstream->error;
+    }
+
+  zstream->zs.next_in  = (FAR Bytef *)buf;
+  zstream->zs.avail_in = len;
+  if (coredump_zlib_deflate(zstream, Z_NO_FLUSH) < 0)
+    {
+      return zstream->error;
+    }
+
+  self->nput += len;
+  return len;
+}
+
+/****************************************************************************
+ * coredump_zlib_putc
+ ****************************************************************************/
+
+static void coredump_zlib_putc(FAR struct lib_outstream_s *self, int ch)
+{
+  uint8_t byte = ch;
+
+  coredump_zlib_puts(self, &byte, 1);
+}
+
+/****************************************************************************
+ * coredump_zlib_flush
+ *
+ * Description:
+ *   A sync flush keeps the stream open, coredump_zlib_close() ends it.
+ *
+ ****************************************************************************/
+
+static int coredump_zlib_flush(FAR struct lib_outstream_s *self)
+{
+  FAR struct coredump_zlibstream_s *zstream =
+    (FAR struct coredump_zlibstream_s *)self;
+
+  if (zstream->error == 0)
+    {
+      zstream->zs.avail_in = 0;
+      coredump_zlib_deflate(zstream, Z_SYNC_FLUSH);
+    }
+
+  lib_stream_flush(zstream->backend);
+  return zstream->error;
+}
+
+/****************************************************************************
+ * coredump_zlibstream
+ ****************************************************************************/
+
+static int coredump_zlibstream(FAR struct coredump_zlibstream_s *zstream,
+                               FAR struct lib_outstream_s *backend)
+{
+  int ret;
+
+  memset(zstream, 0, sizeof(*zstream));
+  zstream->common.putc  = coredump_zlib_putc;
+  zstream->common.puts  = coredump_zlib_puts;
+  zstream->common.flush = coredump_zlib_flush;
+  zstream->backend      = backend;
+
+  /* A small window keeps the deflate state in a few tens of KB */
+
+  ret = deflateInit2(&zstream->zs, CONFIG_SYSTEM_COREDUMP_ZLIB_LEVEL,
+                     Z_DEFLATED, CONFIG_SYSTEM_COREDUMP_ZLIB_WINDOWBITS,
+                     CONFIG_SYSTEM_COREDUMP_ZLIB_WINDOWBITS - 6,
+                     Z_DEFAULT_STRATEGY);
+  return ret == Z_OK ? OK : -ENOMEM;
+}
+
+/****************************************************************************
+ * coredump_zlib_close
+ ****************************************************************************/
+
+static void coredump_zlib_close(FAR struct coredump_zlibstream_s *zstream)
+{
+  if (zstream->error == 0)
+    {
+      zstream->zs.avail_in = 0;
+      coredump_zlib_deflate(zstream, Z_FINISH);
+      lib_stream_flush(zstream->backend);
+    }
+
+  deflateEnd(&zstream->zs);
+}
 #endif
-  FAR void *stream;
+
+#ifdef CONFIG_SYSTEM_COREDUMP_NET
+/****************************************************************************
+ * coredump_connect
+ *
+ * Description:
+ *   Connect to a TCP server given as "ip:port", e.g. one started with
+ *   'nc -l 5555 > core.bin' on the host.
+ *
+ ****************************************************************************/
+
+static FAR FILE *coredump_connect(FAR const char *target)
+{
+  struct sockaddr_in addr;
+  char host[INET_ADDRSTRLEN];
+  FAR const char *colon;
+  FAR FILE *file;
+  int sd;
+
+  colon = strrchr(target, ':');
+  if (colon == NULL || colon - target >= sizeof(host))
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  strlcpy(host, target, colon - target + 1);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons(atoi(colon + 1));
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  sd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sd < 0)
+    {
+      return NULL;
+    }
+
+  if (connect(sd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      close(sd);
+      return NULL;
+    }
+
+  file = fdopen(sd, "w");
+  if (file == NULL)
+    {
+      close(sd);
+    }
+
+  return file;
+}
+#endif
+
+/****************************************************************************
+ * coredump_now
+ ****************************************************************************/
+
+static int coredump_now(int pid, FAR char *filename, FAR const char *target,
+                        int codec, bool elide)
+{
+  FAR struct coredump_streams_s *streams;
+  FAR struct lib_outstream_s *stream;
   FAR FILE *file;
   int logmask;
+  int ret = OK;
 
-  if (filename != NULL)
+  if (target != NULL)
+    {
+#ifdef CONFIG_SYSTEM_COREDUMP_NET
+      file = coredump_connect(target);
+      if (file == NULL)
+        {
+          return -errno;
+        }
+#else
+      return -ENOSYS;
+#endif
+    }
+  else if (filename != NULL)
     {
       file = fopen(filename, "w");
       if (file == NULL)
@@ -393,55 +827,65 @@ static int coredump_now(int pid, FAR char *filename)
       file = stdout;
     }
 
-#ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
-  hstream = malloc(sizeof(*hstream) + sizeof(*lstream) +
-                   sizeof(*outstream));
-#else
-  hstream = malloc(sizeof(*hstream) + sizeof(*outstream));
-#endif
-
-  if (hstream == NULL)
+  streams = malloc(sizeof(*streams));
+  if (streams == NULL)
     {
-      if (filename != NULL)
-        {
-          fclose(file);
-        }
-
-      return -ENOMEM;
+      ret = -ENOMEM;
+      goto errout;
     }
 
-#ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
-  lstream = (FAR void *)(hstream + 1);
-  outstream = (FAR void *)(lstream + 1);
-#else
-  outstream = (FAR void *)(hstream + 1);
-#endif
-
   printf("Start coredump:\n");
   logmask = setlogmask(LOG_UPTO(LOG_ALERT));
 
-  /* Initialize hex output stream */
+  /* The sink, hex encoded on the console */
 
-  lib_stdoutstream(outstream, file);
+  lib_stdoutstream(&streams->out, file);
   if (file == stdout)
     {
-      lib_hexdumpstream(hstream, (FAR void *)outstream);
-      stream = hstream;
+      lib_hexdumpstream(&streams->hex, &streams->out.common);
+      stream = &streams->hex.common;
     }
   else
     {
-      stream = outstream;
+      stream = &streams->out.common;
     }
 
-#ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
-
-  /* Initialize LZF compression stream */
+  /* Then the compressor */
 
-  lib_lzfoutstream(lstream, stream);
-  stream = lstream;
+  switch (codec)
+    {
+#ifdef CONFIG_LIBC_LZF
+      case COREDUMP_CODEC_LZF:
+        lib_lzfoutstream(&streams->lzf, stream);
+        stream = &streams->lzf.common;
+        break;
+#endif
 
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+      case COREDUMP_CODEC_ZLIB:
+        ret = coredump_zlibstream(&streams->zlib, stream);
+        if (ret < 0)
+          {
+            setlogmask(logmask);
+            goto errout_with_streams;
+          }
+
+        stream = &streams->zlib.common;
+        break;
 #endif
 
+      default:
+        break;
+    }
+
+  /* Zero blocks are dropped before they cost compression time */
+
+  if (elide)
+    {
+      coredump_zerostream(&streams->zero, stream);
+      stream = &streams->zero.common;
+    }
+
   /* Do core dump */
 
 #ifdef CONFIG_BOARD_MEMORY_RANGE
@@ -450,20 +894,30 @@ static int coredump_now(int pid, FAR char *filename)
   coredump(NULL, stream, pid);
 #endif
 
+  lib_stream_flush(stream);
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+  if (codec == COREDUMP_CODEC_ZLIB)
+    {
+      coredump_zlib_close(&streams->zlib);
+    }
+#endif
+
   setlogmask(logmask);
-#  ifdef CONFIG_BOARD_COREDUMP_COMPRESSION
-  printf("Finish coredump (Compression Enabled).\n");
-#  else
-  printf("Finish coredump.\n");
-#  endif
+  printf("Finish coredump (codec %s%s).\n",
+         codec == COREDUMP_CODEC_LZF ? "lzf" :
+         codec == COREDUMP_CODEC_ZLIB ? "zlib" : "none",
+         elide ? ", zero blocks elided" : "");
 
-  free(hstream);
-  if (filename != NULL)
+errout_with_streams:
+  free(streams);
+
+errout:
+  if (file != stdout)
     {
       fclose(file);
     }
 
-  return 0;
+  return ret;
 }
 
 /****************************************************************************
@@ -476,6 +930,21 @@ static void usage(FAR const char *progname, int exitcode)
   fprintf(stderr, "Default usage, will coredump directly\n");
   fprintf(stderr, "\t -p, --pid <pid>, Default, all thread\n");
   fprintf(stderr, "\t -f, --filename <filename>, Default stdout\n");
+#ifdef CONFIG_SYSTEM_COREDUMP_NET
+  fprintf(stderr, "\t -n, --net <ip:port>, Stream to a TCP server\n");
+#endif
+  fprintf(stderr, "\t -c, --codec <none"
+#ifdef CONFIG_LIBC_LZF
+                  "|lzf"
+#endif
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+                  "|zlib"
+#endif
+                  ">, Compression, Default %s\n",
+                  COREDUMP_CODEC_DEFAULT == COREDUMP_CODEC_LZF ?
+                  "lzf" : "none");
+  fprintf(stderr, "\t -z, --zero <0|1>, Elide zero blocks, Default %d\n",
+                  COREDUMP_ELIDE_DEFAULT);
 
 #ifdef CONFIG_SYSTEM_COREDUMP_RESTORE
   fprintf(stderr, "Second usage, will restore coredump"
@@ -503,6 +972,9 @@ int main(int argc, FAR char *argv[])
   size_t maxfile = 1;
 #endif
   char *name = NULL;
+  FAR const char *target = NULL;
+  int codec = COREDUMP_CODEC_DEFAULT;
+  bool elide = COREDUMP_ELIDE_DEFAULT;
   int pid = INVALID_PROCESS_ID;
   int ret;
 
@@ -510,6 +982,9 @@ int main(int argc, FAR char *argv[])
     {
       {"pid", 1, NULL, 'p'},
       {"filename", 1, NULL, 'f'},
+      {"net", 1, NULL, 'n'},
+      {"codec", 1, NULL, 'c'},
+      {"zero", 1, NULL, 'z'},
 #ifdef CONFIG_SYSTEM_COREDUMP_RESTORE
       {"savepath", 1, NULL, 's'},
       {"maxfile", 1, NULL, 'm'},
@@ -517,7 +992,7 @@ int main(int argc, FAR char *argv[])
       {"help", 0, NULL, 'h'}
     };
 
-  while ((ret = getopt_long(argc, argv, "p:f:s:m:h", options, NULL))
+  while ((ret = getopt_long(argc, argv, "p:f:n:c:z:s:m:h", options, NULL))
          != ERROR)
     {
       switch (ret)
@@ -528,6 +1003,34 @@ int main(int argc, FAR char *argv[])
           case 'f':
             name = optarg;
             break;
+          case 'n':
+            target = optarg;
+            break;
+          case 'c':
+            if (strcmp(optarg, "none") == 0)
+              {
+                codec = COREDUMP_CODEC_NONE;
+              }
+#ifdef CONFIG_LIBC_LZF
+            else if (strcmp(optarg, "lzf") == 0)
+              {
+                codec = COREDUMP_CODEC_LZF;
+              }
+#endif
+#ifdef CONFIG_SYSTEM_COREDUMP_ZLIB
+            else if (strcmp(optarg, "zlib") == 0)
+              {
+                codec = COREDUMP_CODEC_ZLIB;
+              }
+#endif
+            else
+              {
+                usage(argv[0], EXIT_FAILURE);
+              }
+            break;
+          case 'z':
+            elide = atoi(optarg) != 0;
+            break;
 #ifdef CONFIG_SYSTEM_COREDUMP_RESTORE
           case 's':
             savepath = optarg;
@@ -551,7 +1054,12 @@ int main(int argc, FAR char *argv[])
   else
 #endif
     {
-      coredump_now(pid, name);
+      ret = coredump_now(pid, name, target, codec, elide);
+      if (ret < 0)
+        {
+          fprintf(stderr, "Coredump failed: %d\n", ret);
+          return EXIT_FAILURE;
+        }
     }
 
   return 0;
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+############################################################################
+# apps/system/coredump/coredump.py
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.  The
+# ASF licenses this file to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance with the
+# License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+############################################################################
+"""Expand a 'coredump' capture back to an ELF core file
+
+The codec (none, lzf or zlib) and zero block elision are detected from the
+stream itself.  Hex dumps copied from the console are accepted as well.  A
+TCP stream from 'coredump -n' can be captured with e.g.
+'nc -l 5555 > core.bin'.
+"""
+
+import argparse
+import string
+import struct
+import sys
+import zlib
+
+ELF_MAGIC = b"\x7fELF"
+LZF_MAGIC = b"ZV"
+ZERO_MAGIC = b"NXCZ\x01\x00\x00\x00"
+ZERO_RUN = 0x80000000
+HEXCHARS = string.hexdigits + string.whitespace
+
+
+def lzf_decompress(data, size):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        ctrl = data[i]
+        i += 1
+        if ctrl < 32:
+            out += data[i : i + ctrl + 1]
+            i += ctrl + 1
+            continue
+
+        length = ctrl >> 5
+        if length == 7:
+            length += data[i]
+            i += 1
+
+        ref = len(out) - ((ctrl & 0x1F) << 8) - data[i] - 1
+        i += 1
+        if ref < 0:
+            raise ValueError("lzf: back reference out of range")
+
+        for _ in range(length + 2):
+            out.append(out[ref])
+            ref += 1
+
+    if len(out) != size:
+        raise ValueError("lzf: block size mismatch")
+
+    return bytes(out)
+
+
+def lzf_decode(data):
+    out = bytearray()
+    i = 0
+    while i + 5 <= len(data) and data[i : i + 2] == LZF_MAGIC:
+        if data[i + 2] == 0:
+            size = (data[i + 3] << 8) | data[i + 4]
+            out += data[i + 5 : i + 5 + size]
+            i += 5 + size
+        elif data[i + 2] == 1:
+            csize = (data[i + 3] << 8) | data[i + 4]
+            size = (data[i + 5] << 8) | data[i + 6]
+            out += lzf_decompress(data[i + 7 : i + 7 + csize], size)
+            i += 7 + csize
+        else:
+            raise ValueError("lzf: unknown block type %d" % data[i + 2])
+
+    return bytes(out)
+
+
+def zero_expand(data):
+    out = bytearray()
+    i = len(ZERO_MAGIC)
+    while i + 4 <= len(data):
+        (header,) = struct.unpack_from("<I", data, i)
+        i += 4
+        if header & ZERO_RUN:
+            out += bytes(header & ~ZERO_RUN)
+        else:
+            out += data[i : i + header]
+            i += header
+
+    return bytes(out)
+
+
+def is_zlib(data):
+    if len(data) < 2 or data[0] & 0x0F != 8:
+        return False
+
+    return (data[0] << 8 | data[1]) % 31 == 0
+
+
+def decode(data):
+    text = data.strip()
+    if text and all(chr(c) in HEXCHARS for c in text):
+        data = bytes.fromhex(text.decode())
+
+    if data.startswith(LZF_MAGIC):
+        data = lzf_decode(data)
+    elif is_zlib(data):
+        data = zlib.decompressobj().decompress(data)
+
+    if data.startswith(ZERO_MAGIC):
+        data = zero_expand(data)
+
+    if not data.startswith(ELF_MAGIC):
+        raise ValueError("not a coredump stream")
+
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("input", help="stream captured from the target")
+    parser.add_argument("-o", "--output", help="output file, default stdout")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        core = decode(f.read())
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(core)
+    else:
+        sys.stdout.buffer.write(core)
+
+
+if __name__ == "__main__":
+    main()
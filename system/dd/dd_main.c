@@ -35,6 +35,9 @@
 #include <debug.h>
 #endif
 #include <inttypes.h>
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+#include <pthread.h>
+#endif
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -68,12 +71,26 @@
 #define NSEC_PER_SEC 1000000000
 #endif
 
+#ifndef CONFIG_SYSTEM_DD_BUFFERS
+#define CONFIG_SYSTEM_DD_BUFFERS 1
+#endif
+
 #define g_dd CONFIG_SYSTEM_DD_PROGNAME
 
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_SYSTEM_DD_STATS
+struct dd_lat_s
+{
+  uint64_t     total;      /* Sum of the latencies in usec */
+  uint32_t     count;      /* Number of calls */
+  uint32_t     min;        /* Shortest call in usec */
+  uint32_t     max;        /* Longest call in usec */
+};
+#endif
+
 struct dd_s
 {
   int          infd;       /* File descriptor of the input device */
@@ -86,28 +103,163 @@ struct dd_s
   size_t       sectsize;   /* Size of one sector */
   size_t       nbytes;     /* Number of valid bytes in the buffer */
   FAR uint8_t *buffer;     /* Buffer of data to write to the output file */
+  int          nbufs;      /* Number of pipeline buffers, 1: no pipeline */
+  uint32_t     nwritten;   /* Number of sectors written */
+#ifdef CONFIG_SYSTEM_DD_STATS
+  uint64_t     total;      /* Number of bytes written */
+  uint64_t     start;      /* Transfer start time in usec */
+  uint64_t     shown;      /* Last progress display in usec */
+  bool         progress;   /* Display the progress every second */
+  struct dd_lat_s rdlat;   /* Latency of dd_read() */
+  struct dd_lat_s wrlat;   /* Latency of dd_write() */
+#endif
+};
+
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+struct dd_slot_s
+{
+  FAR uint8_t *buffer;     /* Data read from the input file */
+  size_t       nbytes;     /* Number of valid bytes in the buffer */
+  uint32_t     sector;     /* Input sector number */
+};
+
+/* The main thread reads the input into the ring while the sink thread
+ * writes (or verifies) the filled slots in order.
+ */
+
+struct dd_pipe_s
+{
+  FAR struct dd_s      *dd;
+  FAR struct dd_slot_s *slots;
+  FAR uint8_t          *cmpbuf;   /* Output data read back by verify */
+  pthread_mutex_t       lock;
+  pthread_cond_t        cond;
+  int                   head;     /* Next slot to fill */
+  int                   count;    /* Number of filled slots */
+  bool                  verify;   /* Compare instead of write */
+  bool                  done;     /* No more slots will be filled */
+  bool                  error;    /* The sink failed */
+  uint32_t              srcwait;  /* Times the sink waited for the source */
+  uint32_t              sinkwait; /* Times the source waited for the sink */
 };
+#endif
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
+#ifdef CONFIG_SYSTEM_DD_STATS
+/****************************************************************************
+ * Name: dd_now
+ ****************************************************************************/
+
+static uint64_t dd_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / NSEC_PER_USEC;
+}
+
+/****************************************************************************
+ * Name: dd_lat_add
+ ****************************************************************************/
+
+static void dd_lat_add(FAR struct dd_lat_s *lat, uint64_t start)
+{
+  uint32_t usec = dd_now() - start;
+
+  if (lat->count == 0 || usec < lat->min)
+    {
+      lat->min = usec;
+    }
+
+  if (usec > lat->max)
+    {
+      lat->max = usec;
+    }
+
+  lat->total += usec;
+  lat->count++;
+}
+
+/****************************************************************************
+ * Name: dd_lat_print
+ ****************************************************************************/
+
+static void dd_lat_print(FAR const char *name,
+                         FAR const struct dd_lat_s *lat)
+{
+  if (lat->count > 0)
+    {
+      fprintf(stderr, "%s latency: min %" PRIu32 " avg %" PRIu64
+              " max %" PRIu32 " usec\n", name, lat->min,
+              lat->total / lat->count, lat->max);
+    }
+}
+
+/****************************************************************************
+ * Name: dd_rate
+ *
+ * Description:
+ *   Transfer rate in KB/s.
+ *
+ ****************************************************************************/
+
+static unsigned int dd_rate(uint64_t bytes, uint64_t usec)
+{
+  return usec > 0 ? (unsigned int)(bytes * USEC_PER_SEC / 1024 / usec) : 0;
+}
+#endif
+
+/****************************************************************************
+ * Name: dd_account
+ *
+ * Description:
+ *   Account one written sector and display the progress when requested.
+ *   Called by the thread writing the output.
+ *
+ ****************************************************************************/
+
+static void dd_account(FAR struct dd_s *dd, size_t nbytes)
+{
+  dd->nwritten++;
+
+#ifdef CONFIG_SYSTEM_DD_STATS
+  dd->total += nbytes;
+  if (dd->progress)
+    {
+      uint64_t now = dd_now();
+
+      if (now - dd->shown >= USEC_PER_SEC)
+        {
+          dd->shown = now;
+          fprintf(stderr, "\r%" PRIu64 " bytes, %u KB/s ", dd->total,
+                  dd_rate(dd->total, now - dd->start));
+        }
+    }
+#endif
+}
+
 /****************************************************************************
  * Name: dd_write
  ****************************************************************************/
 
-static int dd_write(FAR struct dd_s *dd)
+static int dd_write(FAR struct dd_s *dd, FAR const uint8_t *buffer,
+                    size_t size)
 {
-  FAR uint8_t *buffer = dd->buffer;
   size_t written;
   ssize_t nbytes;
+#ifdef CONFIG_SYSTEM_DD_STATS
+  uint64_t start = dd_now();
+#endif
 
   /* Is the out buffer full (or is this the last one)? */
 
   written = 0;
   do
     {
-      nbytes = write(dd->outfd, buffer, dd->nbytes - written);
+      nbytes = write(dd->outfd, buffer, size - written);
       if (nbytes < 0)
         {
           fprintf(stderr, "%s: failed to write: %s\n", g_dd,
@@ -118,8 +270,11 @@ static int dd_write(FAR struct dd_s *dd)
       written += nbytes;
       buffer  += nbytes;
     }
-  while (written < dd->nbytes);
+  while (written < size);
 
+#ifdef CONFIG_SYSTEM_DD_STATS
+  dd_lat_add(&dd->wrlat, start);
+#endif
   return OK;
 }
 
@@ -131,6 +286,9 @@ static int dd_read(FAR struct dd_s *dd)
 {
   FAR uint8_t *buffer = dd->buffer;
   ssize_t nbytes;
+#ifdef CONFIG_SYSTEM_DD_STATS
+  uint64_t start = dd_now();
+#endif
 
   dd->nbytes = 0;
   do
@@ -157,6 +315,9 @@ static int dd_read(FAR struct dd_s *dd)
     }
   while (dd->nbytes < dd->sectsize && nbytes != 0);
 
+#ifdef CONFIG_SYSTEM_DD_STATS
+  dd_lat_add(&dd->rdlat, start);
+#endif
   return OK;
 }
 
@@ -206,6 +367,261 @@ static inline int dd_outfopen(FAR const char *name, FAR struct dd_s *dd)
   return OK;
 }
 
+/****************************************************************************
+ * Name: dd_compare
+ *
+ * Description:
+ *   Read back one sector of the output and compare it with the input data.
+ *
+ ****************************************************************************/
+
+static int dd_compare(FAR struct dd_s *dd, FAR const uint8_t *inbuf,
+                      FAR uint8_t *outbuf, size_t nbytes, unsigned sector)
+{
+  ssize_t ret;
+
+  ret = read(dd->outfd, outbuf, nbytes);
+  if (ret != nbytes)
+    {
+      fprintf(stderr, "%s: failed to outfd read: %d\n",
+             g_dd, ret < 0 ? errno : (int)ret);
+      return ERROR;
+    }
+
+  if (memcmp(inbuf, outbuf, nbytes) != 0)
+    {
+#ifdef __NuttX__
+      char msg[32];
+      snprintf(msg, sizeof(msg), "infile sector %d", sector);
+      lib_dumpbuffer(msg, inbuf, nbytes);
+      snprintf(msg, sizeof(msg), "\noutfile sector %d", sector);
+      lib_dumpbuffer(msg, outbuf, nbytes);
+#else
+      fprintf(stderr, "%s: sector %d differs unexpectedly\n", g_dd,
+          sector);
+#endif
+      return ERROR;
+    }
+
+  return OK;
+}
+
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+/****************************************************************************
+ * Name: dd_sink
+ *
+ * Description:
+ *   Sink thread of the pipeline, writes or verifies the filled slots in
+ *   the order they were read.
+ *
+ ****************************************************************************/
+
+static FAR void *dd_sink(FAR void *arg)
+{
+  FAR struct dd_pipe_s *pipe = arg;
+  FAR struct dd_s *dd = pipe->dd;
+  FAR struct dd_slot_s *slot;
+  int tail = 0;
+  int ret;
+
+  for (; ; )
+    {
+      pthread_mutex_lock(&pipe->lock);
+      if (pipe->count == 0 && !pipe->done)
+        {
+          pipe->srcwait++;
+          do
+            {
+              pthread_cond_wait(&pipe->cond, &pipe->lock);
+            }
+          while (pipe->count == 0 && !pipe->done);
+        }
+
+      if (pipe->count == 0)
+        {
+          pthread_mutex_unlock(&pipe->lock);
+          break;
+        }
+
+      pthread_mutex_unlock(&pipe->lock);
+
+      /* The slot is not touched by the source until it is released */
+
+      slot = &pipe->slots[tail];
+      if (pipe->verify)
+        {
+          ret = dd_compare(dd, slot->buffer, pipe->cmpbuf, slot->nbytes,
+                           slot->sector);
+        }
+      else
+        {
+          ret = dd_write(dd, slot->buffer, slot->nbytes);
+          if (ret >= 0)
+            {
+              dd_account(dd, slot->nbytes);
+            }
+        }
+
+      pthread_mutex_lock(&pipe->lock);
+      if (ret < 0)
+        {
+          pipe->error = true;
+          pthread_cond_signal(&pipe->cond);
+          pthread_mutex_unlock(&pipe->lock);
+          break;
+        }
+
+      tail = (tail + 1) % dd->nbufs;
+      pipe->count--;
+      pthread_cond_signal(&pipe->cond);
+      pthread_mutex_unlock(&pipe->lock);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: dd_pipeline
+ *
+ * Description:
+ *   Transfer (or verify) dd->nsectors sectors through a ring of dd->nbufs
+ *   buffers, so that the input and the output are accessed concurrently.
+ *
+ ****************************************************************************/
+
+static int dd_pipeline(FAR struct dd_s *dd, bool verify)
+{
+  struct dd_pipe_s pipe;
+  FAR struct dd_slot_s *slot;
+  FAR uint8_t *saved = dd->buffer;
+  FAR uint8_t *buffers;
+  pthread_t sink;
+  uint32_t sector = 0;
+  bool error;
+  int ret = OK;
+  int i;
+
+  memset(&pipe, 0, sizeof(pipe));
+  pipe.dd     = dd;
+  pipe.verify = verify;
+
+  pipe.slots = malloc(dd->nbufs * sizeof(struct dd_slot_s));
+  buffers    = malloc(dd->nbufs * dd->sectsize);
+  if (verify)
+    {
+      pipe.cmpbuf = malloc(dd->sectsize);
+    }
+
+  if (pipe.slots == NULL || buffers == NULL ||
+      (verify && pipe.cmpbuf == NULL))
+    {
+      fprintf(stderr, "%s: failed to malloc: %s\n", g_dd, strerror(ENOMEM));
+      ret = ERROR;
+      goto errout;
+    }
+
+  for (i = 0; i < dd->nbufs; i++)
+    {
+      pipe.slots[i].buffer = buffers + i * dd->sectsize;
+    }
+
+  pthread_mutex_init(&pipe.lock, NULL);
+  pthread_cond_init(&pipe.cond, NULL);
+
+  ret = pthread_create(&sink, NULL, dd_sink, &pipe);
+  if (ret != 0)
+    {
+      fprintf(stderr, "%s: failed to create thread: %s\n", g_dd,
+          strerror(ret));
+      ret = ERROR;
+      goto errout_with_lock;
+    }
+
+  while (!dd->eof && sector < dd->nsectors)
+    {
+      /* Wait for a free slot */
+
+      pthread_mutex_lock(&pipe.lock);
+      if (pipe.count == dd->nbufs && !pipe.error)
+        {
+          pipe.sinkwait++;
+          do
+            {
+              pthread_cond_wait(&pipe.cond, &pipe.lock);
+            }
+          while (pipe.count == dd->nbufs && !pipe.error);
+        }
+
+      error = pipe.error;
+      pthread_mutex_unlock(&pipe.lock);
+      if (error)
+        {
+          ret = ERROR;
+          break;
+        }
+
+      slot = &pipe.slots[pipe.head];
+      dd->buffer = slot->buffer;
+      ret = dd_read(dd);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      if (dd->nbytes == 0)
+        {
+          continue;
+        }
+
+      slot->nbytes = dd->nbytes;
+      slot->sector = sector++;
+
+      pthread_mutex_lock(&pipe.lock);
+      pipe.head = (pipe.head + 1) % dd->nbufs;
+      pipe.count++;
+      pthread_cond_signal(&pipe.cond);
+      pthread_mutex_unlock(&pipe.lock);
+    }
+
+  /* Let the sink drain the ring and exit */
+
+  pthread_mutex_lock(&pipe.lock);
+  pipe.done = true;
+  pthread_cond_signal(&pipe.cond);
+  pthread_mutex_unlock(&pipe.lock);
+
+  pthread_join(sink, NULL);
+  if (pipe.error)
+    {
+      ret = ERROR;
+    }
+
+#ifdef CONFIG_SYSTEM_DD_STATS
+  if (!verify)
+    {
+      fprintf(stderr, "pipeline: %d buffers, output waited %" PRIu32
+              " times, input waited %" PRIu32 " times\n", dd->nbufs,
+              pipe.srcwait, pipe.sinkwait);
+    }
+#endif
+
+errout_with_lock:
+  pthread_cond_destroy(&pipe.cond);
+  pthread_mutex_destroy(&pipe.lock);
+
+errout:
+  dd->buffer = saved;
+  free(pipe.cmpbuf);
+  free(buffers);
+  free(pipe.slots);
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: dd_verify
+ ****************************************************************************/
+
 static int dd_verify(FAR struct dd_s *dd)
 {
   FAR uint8_t *buffer;
@@ -229,6 +645,19 @@ static int dd_verify(FAR struct dd_s *dd)
       return ret;
     }
 
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+  if (dd->nbufs > 1)
+    {
+      ret = dd_pipeline(dd, true);
+      if (ret < 0)
+        {
+          fprintf(stderr, "%s: failed to dd verify: %d\n", g_dd, ret);
+        }
+
+      return ret;
+    }
+#endif
+
   buffer = malloc(dd->sectsize);
   if (buffer == NULL)
     {
@@ -243,27 +672,9 @@ static int dd_verify(FAR struct dd_s *dd)
           break;
         }
 
-      ret = read(dd->outfd, buffer, dd->nbytes);
-      if (ret != dd->nbytes)
-        {
-          fprintf(stderr, "%s: failed to outfd read: %d\n",
-                 g_dd, ret < 0 ? errno : ret);
-          break;
-        }
-
-      if (memcmp(dd->buffer, buffer, dd->nbytes) != 0)
+      ret = dd_compare(dd, dd->buffer, buffer, dd->nbytes, sector);
+      if (ret < 0)
         {
-#ifdef __NuttX__
-          char msg[32];
-          snprintf(msg, sizeof(msg), "infile sector %d", sector);
-          lib_dumpbuffer(msg, dd->buffer, dd->nbytes);
-          snprintf(msg, sizeof(msg), "\noutfile sector %d", sector);
-          lib_dumpbuffer(msg, buffer, dd->nbytes);
-#else
-          fprintf(stderr, "%s: sector %d differs unexpectedly\n", g_dd,
-              sector);
-#endif
-          ret = ERROR;
           break;
         }
 
@@ -288,7 +699,14 @@ static void print_usage(FAR FILE *stream)
   fprintf(stream, "usage:\n");
   fprintf(stream, "  %s [if=<infile>] [of=<outfile>] [bs=<sectsize>] "
          "[count=<sectors>] [skip=<sectors>] [seek=<sectors>] [verify] "
-         "[conv=<nocreat,notrunc>]\n", g_dd);
+         "[conv=<nocreat,notrunc>]"
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+         " [bufs=<buffers>]"
+#endif
+#ifdef CONFIG_SYSTEM_DD_STATS
+         " [status=progress]"
+#endif
+         "\n", g_dd);
 }
 
 /****************************************************************************
@@ -301,10 +719,7 @@ int main(int argc, FAR char **argv)
   FAR char *infile = NULL;
   FAR char *outfile = NULL;
 #ifdef CONFIG_SYSTEM_DD_STATS
-  struct timespec ts0;
-  struct timespec ts1;
   uint64_t elapsed;
-  uint64_t total = 0;
 #endif
   uint32_t sector = 0;
   int ret = ERROR;
@@ -317,6 +732,7 @@ int main(int argc, FAR char **argv)
   dd.sectsize  = DEFAULT_SECTSIZE;  /* Sector size if 'bs=' not provided */
   dd.nsectors  = 0xffffffff;        /* MAX_UINT32 */
   dd.oflags    = O_WRONLY | O_CREAT | O_TRUNC;
+  dd.nbufs     = CONFIG_SYSTEM_DD_BUFFERS;
 
   /* Parse command line parameters */
 
@@ -346,6 +762,23 @@ int main(int argc, FAR char **argv)
         {
           dd.seek = atoi(&argv[i][5]);
         }
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+      else if (strncmp(argv[i], "bufs=", 5) == 0)
+        {
+          dd.nbufs = atoi(&argv[i][5]);
+          if (dd.nbufs < 1)
+            {
+              print_usage(stderr);
+              goto errout_with_paths;
+            }
+        }
+#endif
+#ifdef CONFIG_SYSTEM_DD_STATS
+      else if (strcmp(argv[i], "status=progress") == 0)
+        {
+          dd.progress = true;
+        }
+#endif
       else if (strncmp(argv[i], "verify", 6) == 0)
         {
           dd.oflags |= O_RDONLY;
@@ -461,10 +894,22 @@ int main(int argc, FAR char **argv)
   /* Then perform the data transfer */
 
 #ifdef CONFIG_SYSTEM_DD_STATS
-  clock_gettime(CLOCK_MONOTONIC, &ts0);
+  dd.start = dd_now();
+  dd.shown = dd.start;
 #endif
 
-  while (!dd.eof && sector < dd.nsectors)
+#ifdef CONFIG_SYSTEM_DD_PIPELINE
+  if (dd.nbufs > 1)
+    {
+      ret = dd_pipeline(&dd, false);
+      if (ret < 0)
+        {
+          goto errout_with_outf;
+        }
+    }
+#endif
+
+  while (dd.nbufs == 1 && !dd.eof && sector < dd.nsectors)
     {
       /* Read one sector from from the input */
 
@@ -480,7 +925,7 @@ int main(int argc, FAR char **argv)
         {
           /* Write one sector to the output file */
 
-          ret = dd_write(&dd);
+          ret = dd_write(&dd, dd.buffer, dd.nbytes);
           if (ret < 0)
             {
               goto errout_with_outf;
@@ -489,26 +934,24 @@ int main(int argc, FAR char **argv)
           /* Increment the sector number */
 
           sector++;
-#ifdef CONFIG_SYSTEM_DD_STATS
-          total += dd.nbytes;
-#endif
+          dd_account(&dd, dd.nbytes);
         }
     }
 
   ret = OK;
 
 #ifdef CONFIG_SYSTEM_DD_STATS
-  clock_gettime(CLOCK_MONOTONIC, &ts1);
-
-  elapsed  = (((uint64_t)ts1.tv_sec * NSEC_PER_SEC) + ts1.tv_nsec);
-  elapsed -= (((uint64_t)ts0.tv_sec * NSEC_PER_SEC) + ts0.tv_nsec);
-  elapsed /= NSEC_PER_USEC; /* usec */
+  elapsed = dd_now() - dd.start;
+  if (dd.progress)
+    {
+      fprintf(stderr, "\n");
+    }
 
   fprintf(stderr, "%" PRIu64 " bytes (%" PRIu32 " blocks) copied, %u usec, ",
-         total, sector, (unsigned int)elapsed);
-  fprintf(stderr, "%u KB/s\n" ,
-         (unsigned int)(((double)total / 1024)
-         / ((double)elapsed / USEC_PER_SEC)));
+         dd.total, dd.nwritten, (unsigned int)elapsed);
+  fprintf(stderr, "%u KB/s\n", dd_rate(dd.total, elapsed));
+  dd_lat_print("read", &dd.rdlat);
+  dd_lat_print("write", &dd.wrlat);
 #endif
 
   if (ret == 0 && (dd.oflags & O_RDONLY) != 0)
@@ -37,6 +37,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <poll.h>
 
@@ -86,109 +87,315 @@ static void pan_display(int fb_device, FAR struct fb_planeinfo_s *plane_info)
     }
 }
 
-static int show_image(FAR struct nxcamera_s *pcam, FAR v4l2_buffer_t *buf)
+/****************************************************************************
+ * yuv_to_rgb
+ *
+ *   BT.601 limited range YUV to RGB in 8.8 fixed point.
+ *
+ ****************************************************************************/
+
+static inline uint8_t clamp_rgb(int value)
+{
+  return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+static inline void put_rgb(FAR uint8_t **dst, uint8_t fmt,
+                           int y, int u, int v)
 {
+  int c = 298 * (y - 16) + 128;
+  uint8_t r = clamp_rgb((c + 409 * (v - 128)) >> 8);
+  uint8_t g = clamp_rgb((c - 100 * (u - 128) - 208 * (v - 128)) >> 8);
+  uint8_t b = clamp_rgb((c + 516 * (u - 128)) >> 8);
+  FAR uint8_t *p = *dst;
+
+  switch (fmt)
+    {
+      case FB_FMT_RGB16_565:
+        *(FAR uint16_t *)p = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) |
+                             (b >> 3);
+        *dst = p + 2;
+        break;
+
+      case FB_FMT_RGB24:
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+        *dst = p + 3;
+        break;
+
+      default:
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+        p[3] = 0xff;
+        *dst = p + 4;
+        break;
+    }
+}
+
+/****************************************************************************
+ * convert_direct
+ *
+ *   Convert the common camera formats to the framebuffer in a single pass,
+ *   without an intermediate I420 frame.  uoff/voff are the chroma offsets
+ *   in a packed YUYV-style macropixel, or in an NV12-style UV pair.
+ *   Returns -ENOTSUP for pairs of formats that are not handled here.
+ *
+ ****************************************************************************/
+
+static int convert_direct(FAR struct nxcamera_s *pcam,
+                          FAR const uint8_t *src)
+{
+  uint32_t pixfmt = pcam->fmt.fmt.pix.pixelformat;
+  uint8_t dfmt = pcam->display_vinfo.fmt;
+  uint32_t sw = pcam->fmt.fmt.pix.width;
+  uint32_t sh = pcam->fmt.fmt.pix.height;
+  uint32_t w = MIN(sw, pcam->display_vinfo.xres) & ~1;
+  uint32_t h = MIN(sh, pcam->display_vinfo.yres) & ~1;
+  FAR const uint8_t *uv;
+  FAR uint8_t *dst;
+  int yoff;
+  int uoff;
+  int voff;
+  uint32_t x;
+  uint32_t y;
+
+  if (dfmt != FB_FMT_RGB16_565 && dfmt != FB_FMT_RGB24 &&
+      dfmt != FB_FMT_RGB32)
+    {
+      return -ENOTSUP;
+    }
+
+  switch (pixfmt)
+    {
+      case V4L2_PIX_FMT_YUYV:
+      case V4L2_PIX_FMT_UYVY:
+        yoff = pixfmt == V4L2_PIX_FMT_YUYV ? 0 : 1;
+        uoff = pixfmt == V4L2_PIX_FMT_YUYV ? 1 : 0;
+        voff = uoff + 2;
+
+        for (y = 0; y < h; y++)
+          {
+            FAR const uint8_t *p = src + y * sw * 2;
+
+            dst = (FAR uint8_t *)pcam->display_pinfo.fbmem +
+                  y * pcam->display_pinfo.stride;
+            for (x = 0; x < w; x += 2, p += 4)
+              {
+                put_rgb(&dst, dfmt, p[yoff], p[uoff], p[voff]);
+                put_rgb(&dst, dfmt, p[yoff + 2], p[uoff], p[voff]);
+              }
+          }
+
+        return 0;
+
+      case V4L2_PIX_FMT_NV12:
+      case V4L2_PIX_FMT_NV21:
+      case V4L2_PIX_FMT_YUV420:
+        for (y = 0; y < h; y++)
+          {
+            FAR const uint8_t *py = src + y * sw;
+            FAR const uint8_t *pu;
+            FAR const uint8_t *pv;
+            int step;
+
+            if (pixfmt == V4L2_PIX_FMT_YUV420)
+              {
+                /* Planar: U and V planes of (w/2 * h/2) each */
+
+                uv   = src + sw * sh;
+                pu   = uv + (y / 2) * (sw / 2);
+                pv   = pu + (sw / 2) * (sh / 2);
+                step = 1;
+              }
+            else
+              {
+                /* Semi-planar: interleaved UV (NV12) or VU (NV21) */
+
+                uv   = src + sw * sh + (y / 2) * sw;
+                pu   = uv + (pixfmt == V4L2_PIX_FMT_NV21);
+                pv   = uv + (pixfmt == V4L2_PIX_FMT_NV12);
+                step = 2;
+              }
+
+            dst = (FAR uint8_t *)pcam->display_pinfo.fbmem +
+                  y * pcam->display_pinfo.stride;
+            for (x = 0; x < w; x += 2, py += 2, pu += step, pv += step)
+              {
+                put_rgb(&dst, dfmt, py[0], *pu, *pv);
+                put_rgb(&dst, dfmt, py[1], *pu, *pv);
+              }
+          }
+
+        return 0;
+
+      case V4L2_PIX_FMT_RGB565:
+        if (dfmt != FB_FMT_RGB16_565)
+          {
+            return -ENOTSUP;
+          }
+
+        for (y = 0; y < h; y++)
+          {
+            memcpy((FAR uint8_t *)pcam->display_pinfo.fbmem +
+                   y * pcam->display_pinfo.stride,
+                   src + y * sw * 2, w * 2);
+          }
+
+        return 0;
+
+      default:
+        return -ENOTSUP;
+    }
+}
+
+/****************************************************************************
+ * convert_image
+ ****************************************************************************/
+
+static int convert_image(FAR struct nxcamera_s *pcam,
+                         FAR v4l2_buffer_t *buf)
+{
+  FAR uint8_t *src = pcam->bufs[buf->index];
 #ifdef CONFIG_LIBYUV
+  uint32_t width = pcam->fmt.fmt.pix.width;
+  uint32_t height = pcam->fmt.fmt.pix.height;
+  FAR uint8_t *i420;
+  int ret;
+
+  /* libyuv converts anything to ARGB in one (SIMD) pass */
+
   if (pcam->display_vinfo.fmt == FB_FMT_RGB32)
     {
-      return ConvertToARGB(pcam->bufs[buf->index],
+      return ConvertToARGB(src,
                            pcam->buf_sizes[buf->index],
                            pcam->display_pinfo.fbmem,
                            pcam->display_pinfo.stride,
                            0,
                            0,
-                           pcam->fmt.fmt.pix.width,
-                           pcam->fmt.fmt.pix.height,
-                           pcam->fmt.fmt.pix.width,
-                           pcam->fmt.fmt.pix.height,
+                           width,
+                           height,
+                           width,
+                           height,
                            0,
                            pcam->fmt.fmt.pix.pixelformat);
     }
-  else if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565)
+
+  if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565 &&
+      pcam->fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420)
     {
-      if (pcam->fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420)
-        {
-          return ConvertFromI420(pcam->bufs[buf->index],
-                                 pcam->fmt.fmt.pix.width,
-                                 &pcam->bufs[buf->index][
-                                            pcam->fmt.fmt.pix.width *
-                                            pcam->fmt.fmt.pix.height],
-                                 pcam->fmt.fmt.pix.width / 2,
-                                 &pcam->bufs[buf->index][
-                                      pcam->fmt.fmt.pix.width *
-                                      pcam->fmt.fmt.pix.height * 5 / 4],
-                                 pcam->fmt.fmt.pix.width / 2,
-                                 pcam->display_pinfo.fbmem,
-                                 pcam->display_pinfo.stride,
-                                 pcam->fmt.fmt.pix.width,
-                                 pcam->fmt.fmt.pix.height,
-                                 V4L2_PIX_FMT_RGB565);
-        }
-      else
-        {
-          int ret;
-          FAR uint8_t *dst = malloc(pcam->fmt.fmt.pix.width *
-                                    pcam->fmt.fmt.pix.height * 3 / 2);
-          if (!dst)
-            {
-              return -ENOMEM;
-            }
+      return ConvertFromI420(src,
+                             width,
+                             &src[width * height],
+                             width / 2,
+                             &src[width * height * 5 / 4],
+                             width / 2,
+                             pcam->display_pinfo.fbmem,
+                             pcam->display_pinfo.stride,
+                             width,
+                             height,
+                             V4L2_PIX_FMT_RGB565);
+    }
+#endif
 
-          ret = ConvertToI420(pcam->bufs[buf->index],
-                              pcam->buf_sizes[buf->index],
-                              dst,
-                              pcam->fmt.fmt.pix.width,
-                              &dst[pcam->fmt.fmt.pix.width *
-                                        pcam->fmt.fmt.pix.height],
-                              pcam->fmt.fmt.pix.width / 2,
-                              &dst[pcam->fmt.fmt.pix.width *
-                                        pcam->fmt.fmt.pix.height * 5 / 4],
-                              pcam->fmt.fmt.pix.width / 2,
-                              0,
-                              0,
-                              pcam->fmt.fmt.pix.width,
-                              pcam->fmt.fmt.pix.height,
-                              pcam->fmt.fmt.pix.width,
-                              pcam->fmt.fmt.pix.height,
-                              0,
-                              pcam->fmt.fmt.pix.pixelformat);
-          if (ret < 0)
-            {
-              goto err;
-            }
+  if (convert_direct(pcam, src) == 0)
+    {
+      return 0;
+    }
 
-          ret = ConvertFromI420(dst,
-                                pcam->fmt.fmt.pix.width,
-                                &dst[pcam->fmt.fmt.pix.width *
-                                            pcam->fmt.fmt.pix.height],
-                                pcam->fmt.fmt.pix.width / 2,
-                                &dst[pcam->fmt.fmt.pix.width *
-                                     pcam->fmt.fmt.pix.height * 5 / 4],
-                                pcam->fmt.fmt.pix.width / 2,
-                                pcam->display_pinfo.fbmem,
-                                pcam->display_pinfo.stride,
-                                pcam->fmt.fmt.pix.width,
-                                pcam->fmt.fmt.pix.height,
-                                V4L2_PIX_FMT_RGB565);
-          if (ret < 0)
-            {
-              goto err;
-            }
+#ifdef CONFIG_LIBYUV
+  /* Anything else (e.g. MJPEG) goes through the I420 frame that was
+   * allocated when the stream started.
+   */
 
-err:
-          free(dst);
-          return ret;
-        }
+  i420 = pcam->convbuf;
+  if (pcam->display_vinfo.fmt != FB_FMT_RGB16_565 || i420 == NULL)
+    {
+      return 0;
     }
 
-  return 0;
+  ret = ConvertToI420(src,
+                      pcam->buf_sizes[buf->index],
+                      i420,
+                      width,
+                      &i420[width * height],
+                      width / 2,
+                      &i420[width * height * 5 / 4],
+                      width / 2,
+                      0,
+                      0,
+                      width,
+                      height,
+                      width,
+                      height,
+                      0,
+                      pcam->fmt.fmt.pix.pixelformat);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return ConvertFromI420(i420,
+                         width,
+                         &i420[width * height],
+                         width / 2,
+                         &i420[width * height * 5 / 4],
+                         width / 2,
+                         pcam->display_pinfo.fbmem,
+                         pcam->display_pinfo.stride,
+                         width,
+                         height,
+                         V4L2_PIX_FMT_RGB565);
 #else
-  FAR uint32_t *pbuf = (FAR uint32_t *)pcam->bufs[buf->index];
-  vinfo("show image from %p: %" PRIx32 " %" PRIx32, pbuf, pbuf[0], pbuf[1]);
+  vinfo("no conversion from %" PRIx32 " to display format %d\n",
+        pcam->fmt.fmt.pix.pixelformat, pcam->display_vinfo.fmt);
   return 0;
 #endif
 }
 
+/****************************************************************************
+ * show_image
+ ****************************************************************************/
+
+static int show_image(FAR struct nxcamera_s *pcam, FAR v4l2_buffer_t *buf)
+{
+  FAR struct nxcamera_stats_s *stats = &pcam->stats;
+  struct timespec start;
+  struct timespec end;
+  uint32_t conv;
+  uint32_t gap;
+  int ret;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = convert_image(pcam, buf);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  conv = (end.tv_sec - start.tv_sec) * 1000000 +
+         (end.tv_nsec - start.tv_nsec) / 1000;
+
+  pthread_mutex_lock(&pcam->mutex);
+  if (stats->frames > 0)
+    {
+      gap = (start.tv_sec - pcam->last.tv_sec) * 1000000 +
+            (start.tv_nsec - pcam->last.tv_nsec) / 1000;
+      stats->gap_max  = MAX(stats->gap_max, gap);
+      stats->elapsed += gap;
+      stats->conv_min = MIN(stats->conv_min, conv);
+    }
+  else
+    {
+      stats->conv_min = conv;
+    }
+
+  stats->conv_max    = MAX(stats->conv_max, conv);
+  stats->conv_total += conv;
+  stats->frames++;
+  pcam->last = start;
+  pthread_mutex_unlock(&pcam->mutex);
+
+  return ret;
+}
+
 /****************************************************************************
  * Name: nxcamera_opendevice
  *
@@ -439,6 +646,8 @@ err_out:
 
   free(pcam->bufs);
   free(pcam->buf_sizes);
+  free(pcam->convbuf);
+  pcam->convbuf = NULL;
   pthread_mutex_unlock(&pcam->mutex);     /* Unlock the mutex */
 
   vinfo("Exit\n");
@@ -788,6 +997,34 @@ int nxcamera_stream(FAR struct nxcamera_s *pcam,
       pcam->buf_sizes[i] = buf.length;
     }
 
+#ifdef CONFIG_LIBYUV
+  /* Formats without a direct conversion are decoded to I420 first.  Take
+   * that frame now rather than for every displayed frame.
+   */
+
+  if (pcam->display_vinfo.fmt == FB_FMT_RGB16_565 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUV420 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_UYVY &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_NV12 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_NV21 &&
+      pcam->fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_RGB565)
+    {
+      pcam->convbuf = malloc(pcam->fmt.fmt.pix.width *
+                             pcam->fmt.fmt.pix.height * 3 / 2);
+      if (pcam->convbuf == NULL)
+        {
+          verr("Cannot allocate conversion frame\n");
+          ret = -ENOMEM;
+          goto err_out;
+        }
+    }
+#endif
+
+  pthread_mutex_lock(&pcam->mutex);
+  memset(&pcam->stats, 0, sizeof(pcam->stats));
+  pthread_mutex_unlock(&pcam->mutex);
+
   /* Create a message queue for the loopthread */
 
   memset(&attr, 0, sizeof(attr));
@@ -859,9 +1096,31 @@ err_out:
       free(pcam->buf_sizes);
     }
 
+  free(pcam->convbuf);
+  pcam->convbuf = NULL;
   return ret;
 }
 
+/****************************************************************************
+ * Name: nxcamera_getstats
+ *
+ *   nxcamera_getstats() returns the display statistics of the current or
+ *   last stream.
+ *
+ ****************************************************************************/
+
+int nxcamera_getstats(FAR struct nxcamera_s *pcam,
+                      FAR struct nxcamera_stats_s *stats)
+{
+  DEBUGASSERT(pcam != NULL && stats != NULL);
+
+  pthread_mutex_lock(&pcam->mutex);
+  *stats = pcam->stats;
+  pthread_mutex_unlock(&pcam->mutex);
+
+  return OK;
+}
+
 /****************************************************************************
  * Name: nxcamera_create
  *
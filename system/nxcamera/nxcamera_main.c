@@ -28,6 +28,7 @@
 #include <nuttx/video/video.h>
 
 #include <sys/types.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -74,6 +75,7 @@ static int nxcamera_cmd_stream(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_input(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_output(FAR struct nxcamera_s *pcam, FAR char *parg);
 static int nxcamera_cmd_stop(FAR struct nxcamera_s *pcam, FAR char *parg);
+static int nxcamera_cmd_stats(FAR struct nxcamera_s *pcam, FAR char *parg);
 #ifdef CONFIG_NXCAMERA_INCLUDE_HELP
 static int nxcamera_cmd_help(FAR struct nxcamera_s *pcam, FAR char *parg);
 #endif
@@ -122,6 +124,12 @@ static const struct nxcamera_cmd_s g_nxcamera_cmds[] =
     nxcamera_cmd_stop,
     NXCAMERA_HELP_TEXT("Stop stream")
   },
+  {
+    "stats",
+    "",
+    nxcamera_cmd_stats,
+    NXCAMERA_HELP_TEXT("Show frame rate and conversion time")
+  },
   {
     "q",
     "",
@@ -214,6 +222,34 @@ static int nxcamera_cmd_stop(FAR struct nxcamera_s *pcam, FAR char *parg)
   return nxcamera_stop(pcam);
 }
 
+/****************************************************************************
+ * Name: nxcamera_cmd_stats
+ *
+ *   nxcamera_cmd_stats() shows the frame rate and the time spent converting
+ *   frames for the display.
+ *
+ ****************************************************************************/
+
+static int nxcamera_cmd_stats(FAR struct nxcamera_s *pcam, FAR char *parg)
+{
+  struct nxcamera_stats_s stats;
+
+  nxcamera_getstats(pcam, &stats);
+  if (stats.frames == 0)
+    {
+      printf("No frames displayed\n");
+      return OK;
+    }
+
+  printf("frames %" PRIu32 " fps %" PRIu64 "\n", stats.frames,
+         stats.elapsed ? (stats.frames - 1) * UINT64_C(1000000) /
+                         stats.elapsed : 0);
+  printf("convert us avg %" PRIu64 " min %" PRIu32 " max %" PRIu32 "\n",
+         stats.conv_total / stats.frames, stats.conv_min, stats.conv_max);
+  printf("max frame gap us %" PRIu32 "\n", stats.gap_max);
+  return OK;
+}
+
 /****************************************************************************
  * Name: nxcamera_cmd_input
  *
@@ -145,6 +145,13 @@ int nxcodec_init(FAR nxcodec_t *codec)
       goto err0;
     }
 
+  ret = nxcodec_context_open_stream(&codec->output);
+  if (ret < 0)
+    {
+      printf("nxcodec can't allocate the input stream buffer\n");
+      goto err1;
+    }
+
   codec->capture.format.type = codec->capture.type;
 
   ret = nxcodec_context_set_format(&codec->capture);
@@ -169,6 +176,7 @@ int nxcodec_init(FAR nxcodec_t *codec)
   return 0;
 
 err1:
+  nxcodec_context_close_stream(&codec->output);
   close(codec->output.fd);
 err0:
   close(codec->fd);
@@ -255,6 +263,7 @@ int nxcodec_stop(FAR nxcodec_t *codec)
 
 int nxcodec_uninit(FAR nxcodec_t *codec)
 {
+  nxcodec_context_close_stream(&codec->output);
   close(codec->capture.fd);
   close(codec->output.fd);
   close(codec->fd);
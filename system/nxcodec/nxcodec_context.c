@@ -26,8 +26,11 @@
 
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -43,6 +46,10 @@
 
 #define NXCODEC_CONTEXT_BUFNUMBER 3
 
+#ifndef CONFIG_SYSTEM_NXCODEC_STREAM_BUFSIZE
+#  define CONFIG_SYSTEM_NXCODEC_STREAM_BUFSIZE 65536
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -126,59 +133,155 @@ static int nxcodec_context_read_yuv_data(FAR nxcodec_context_t *ctx,
   return 0;
 }
 
-static int nxcodec_context_read_h264_data(FAR nxcodec_context_t *ctx,
-                                          FAR char *buf,
-                                          FAR uint32_t *bytesused)
+/* Return the length of the Annex-B start code (00 00 01 or 00 00 00 01)
+ * at the given position, or 0 if there is none.
+ */
+
+static size_t nxcodec_context_start_code(FAR const uint8_t *data,
+                                         size_t size)
 {
-  char start_code[4];
+  if (size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1)
+    {
+      return 3;
+    }
+
+  if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 &&
+      data[3] == 1)
+    {
+      return 4;
+    }
+
+  return 0;
+}
+
+/* Find the start code ending the unit at data[0], searching from offset
+ * "from" on.  Start codes are located by memchr() for their 0x01 byte, so
+ * the scan runs at memory speed instead of byte by byte.  Returns the
+ * offset of the next start code, or size if there is none in the window.
+ */
+
+static size_t nxcodec_context_find_unit_end(FAR const uint8_t *data,
+                                            size_t size, size_t from)
+{
+  FAR const uint8_t *begin = data + nxcodec_context_start_code(data, size);
+  FAR const uint8_t *end = data + size;
+  FAR const uint8_t *p = MAX(data + from, begin);
+
+  while (end - p >= 3)
+    {
+      p = memchr(p + 2, 0x01, end - p - 2);
+      if (p == NULL)
+        {
+          break;
+        }
+
+      if (p[-1] == 0 && p[-2] == 0)
+        {
+          /* Prefer the four byte form: 00 00 00 01 */
+
+          p -= (p - 3 >= begin && p[-3] == 0) ? 3 : 2;
+          return p - data;
+        }
+
+      p--;
+    }
+
+  return size;
+}
+
+/* Top up the read buffer, keeping the current unit at its start.  The
+ * buffer grows when a single unit does not fit.
+ */
+
+static int nxcodec_context_fill_stream(FAR nxcodec_context_t *ctx)
+{
+  FAR nxcodec_context_stream_t *stream = &ctx->stream;
+  FAR uint8_t *data;
   ssize_t ret;
-  int size;
 
-  memset(start_code, 0, 4);
+  if (stream->pos > 0)
+    {
+      stream->size -= stream->pos;
+      memmove(stream->data, stream->data + stream->pos, stream->size);
+      stream->pos = 0;
+    }
 
-  ret = read(ctx->fd, buf, 4);
-  if (ret <= 0)
+  if (stream->size == stream->bufsize)
+    {
+      data = realloc(stream->data, stream->bufsize * 2);
+      if (data == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      stream->data = data;
+      stream->bufsize *= 2;
+    }
+
+  ret = read(ctx->fd, stream->data + stream->size,
+             stream->bufsize - stream->size);
+  if (ret < 0)
     {
       return -errno;
     }
+  else if (ret == 0)
+    {
+      stream->eof = true;
+    }
 
-  if (buf[0] == 0x00 && buf[1] == 0x00 &&
-      buf[2] == 0x00 && buf[3] == 0x01)
+  stream->size += ret;
+  return 0;
+}
+
+static int nxcodec_context_read_h264_data(FAR nxcodec_context_t *ctx,
+                                          FAR char *buf, size_t buflen,
+                                          FAR uint32_t *bytesused)
+{
+  FAR nxcodec_context_stream_t *stream = &ctx->stream;
+  size_t scanned = 0;
+  size_t len;
+  int ret;
+
+  while (1)
     {
-      size = 4;
-      while (1)
+      len = nxcodec_context_find_unit_end(stream->data + stream->pos,
+                                          stream->size - stream->pos,
+                                          scanned);
+      if (len < stream->size - stream->pos || stream->eof)
         {
-          ret = read(ctx->fd, buf + size, 1);
-          if (ret < 0)
-            {
-              return -errno;
-            }
-          else if (ret == 0)
-            {
-              break;
-            }
+          break;
+        }
 
-          start_code[0] = start_code[1];
-          start_code[1] = start_code[2];
-          start_code[2] = start_code[3];
-          start_code[3] = *(buf + size);
-          size++;
+      /* Rescan the tail in case a start code straddles the next read */
 
-          if (start_code[0] == 0x00 && start_code[1] == 0x00 &&
-              start_code[2] == 0x00 && start_code[3] == 0x01)
-            {
-              size -= 4;
-              lseek(ctx->fd, -4, SEEK_CUR);
-              break;
-            }
+      scanned = len > 3 ? len - 3 : 0;
+      ret = nxcodec_context_fill_stream(ctx);
+      if (ret < 0)
+        {
+          return ret;
         }
     }
-  else
+
+  if (len == 0)
+    {
+      return -ENODATA;
+    }
+
+  if (!nxcodec_context_start_code(stream->data + stream->pos, len))
     {
       return -EINVAL;
     }
 
-  *bytesused = size;
+  if (len > buflen)
+    {
+      printf("nxcodec NAL unit of %zu bytes exceeds buffer of %zu\n",
+             len, buflen);
+      return -E2BIG;
+    }
+
+  memcpy(buf, stream->data + stream->pos, len);
+  stream->pos += len;
+  *bytesused = len;
 
   return 0;
 }
@@ -210,6 +313,7 @@ int nxcodec_context_enqueue_frame(FAR nxcodec_context_t *ctx)
     {
       ret = nxcodec_context_read_h264_data(ctx,
                                            buf->addr,
+                                           buf->length,
                                            &buf->buf.bytesused);
       if (ret < 0)
         {
@@ -411,3 +515,60 @@ void nxcodec_context_uninit(FAR nxcodec_context_t *ctx)
 
   free(ctx->buf);
 }
+
+int nxcodec_context_open_stream(FAR nxcodec_context_t *ctx)
+{
+  FAR nxcodec_context_stream_t *stream = &ctx->stream;
+#ifdef CONFIG_SYSTEM_NXCODEC_STREAM_MMAP
+  struct stat st;
+#endif
+
+  memset(stream, 0, sizeof(*stream));
+
+  if (ctx->format.fmt.pix.pixelformat != V4L2_PIX_FMT_H264)
+    {
+      return 0;
+    }
+
+#ifdef CONFIG_SYSTEM_NXCODEC_STREAM_MMAP
+  /* Parse straight out of the file when the filesystem can map it */
+
+  if (fstat(ctx->fd, &st) == 0 && st.st_size > 0)
+    {
+      stream->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+                          ctx->fd, 0);
+      if (stream->data != MAP_FAILED)
+        {
+          stream->size = st.st_size;
+          stream->eof = true;
+          return 0;
+        }
+    }
+#endif
+
+  stream->bufsize = CONFIG_SYSTEM_NXCODEC_STREAM_BUFSIZE;
+  stream->data = malloc(stream->bufsize);
+  if (stream->data == NULL)
+    {
+      stream->bufsize = 0;
+      return -ENOMEM;
+    }
+
+  return 0;
+}
+
+void nxcodec_context_close_stream(FAR nxcodec_context_t *ctx)
+{
+  FAR nxcodec_context_stream_t *stream = &ctx->stream;
+
+  if (stream->bufsize > 0)
+    {
+      free(stream->data);
+    }
+  else if (stream->data != NULL)
+    {
+      munmap(stream->data, stream->size);
+    }
+
+  memset(stream, 0, sizeof(*stream));
+}
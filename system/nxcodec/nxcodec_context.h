@@ -41,6 +41,19 @@ typedef struct nxcodec_context_buf_s
   bool               free;
 } nxcodec_context_buf_t;
 
+/* Annex-B bitstream window: the whole file when it could be mapped,
+ * otherwise a read buffer that always starts at the unit being parsed.
+ */
+
+typedef struct nxcodec_context_stream_s
+{
+  FAR uint8_t *data;
+  size_t      size;       /* Valid bytes at data */
+  size_t      pos;        /* Start of the next unit */
+  size_t      bufsize;    /* Allocated bytes, 0 when mapped */
+  bool        eof;        /* No more bytes to read from the file */
+} nxcodec_context_stream_t;
+
 typedef struct nxcodec_context_s
 {
   char                      filename[PATH_MAX];
@@ -49,6 +62,7 @@ typedef struct nxcodec_context_s
   struct v4l2_format        format;
   FAR nxcodec_context_buf_t *buf;
   int                       nbuffers;
+  nxcodec_context_stream_t  stream;
 } nxcodec_context_t;
 
 /****************************************************************************
@@ -62,5 +76,7 @@ int nxcodec_context_dequeue_frame(FAR nxcodec_context_t *ctx);
 int nxcodec_context_get_format(FAR nxcodec_context_t *ctx);
 int nxcodec_context_set_format(FAR nxcodec_context_t *ctx);
 void nxcodec_context_uninit(FAR nxcodec_context_t *ctx);
+int nxcodec_context_open_stream(FAR nxcodec_context_t *ctx);
+void nxcodec_context_close_stream(FAR nxcodec_context_t *ctx);
 
 #endif /* __APP_SYSTEM_NXCODEC_NXCODEC_CONTEXT_H */
@@ -41,6 +41,7 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/param.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef CONFIG_NXPLAYER_HTTP_STREAMING_SUPPORT
 #  include <sys/time.h>
@@ -74,6 +75,31 @@
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+/* Read-ahead state.  The prefetch thread owns the media file and fills
+ * slots[head]; the play thread copies slots[tail] into device buffers.
+ * Device buffers returned while no slot is ready are parked until the
+ * prefetch thread catches up and posts AUDIO_MSG_USER.
+ */
+
+struct nxplayer_prefetch_s
+{
+  pthread_t       tid;          /* Prefetch thread */
+  pthread_mutex_t lock;         /* Protects all but parked[] */
+  pthread_cond_t  cond;         /* Slot filled or freed */
+  bool            stop;         /* Play thread is tearing down */
+  bool            eof;          /* No slots after the ready ones */
+  bool            notify;       /* Post AUDIO_MSG_USER on next slot */
+  int             head;         /* Next slot to read into */
+  int             tail;         /* Next slot to copy out */
+  int             nready;       /* Slots holding data */
+  int             nparked;      /* Device buffers waiting for data */
+  int             nbuffers;     /* Device buffers in total */
+  FAR struct ap_buffer_s **parked;
+  struct ap_buffer_s slots[CONFIG_NXPLAYER_PREFETCH_BUFFERS];
+};
+#endif
+
 #ifdef CONFIG_NXPLAYER_FMT_FROM_EXT
 struct nxplayer_ext_fmt_s
 {
@@ -748,6 +774,366 @@ static int nxplayer_enqueuebuffer(FAR struct nxplayer_s *pplayer,
   return OK;
 }
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+/****************************************************************************
+ * Name: nxplayer_prefetchthread
+ *
+ *  Reads the media file into the prefetch window, ahead of the device.
+ *
+ ****************************************************************************/
+
+static FAR void *nxplayer_prefetchthread(pthread_addr_t pvarg)
+{
+  FAR struct nxplayer_s          *pplayer = (FAR struct nxplayer_s *)pvarg;
+  FAR struct nxplayer_prefetch_s *prefetch = pplayer->prefetch;
+  FAR struct ap_buffer_s         *slot;
+  struct audio_msg_s             msg;
+  struct timespec                start;
+  struct timespec                end;
+  uint32_t                       usec;
+  bool                           notify;
+  int                            ret;
+
+  pthread_mutex_lock(&prefetch->lock);
+  while (!prefetch->stop && !prefetch->eof)
+    {
+      if (prefetch->nready == CONFIG_NXPLAYER_PREFETCH_BUFFERS)
+        {
+          pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+          continue;
+        }
+
+      /* The slot is ours until it is counted in nready */
+
+      slot = &prefetch->slots[prefetch->head];
+      pthread_mutex_unlock(&prefetch->lock);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      ret = nxplayer_readbuffer(pplayer, slot);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      usec = (end.tv_sec - start.tv_sec) * 1000000 +
+             (end.tv_nsec - start.tv_nsec) / 1000;
+
+      pthread_mutex_lock(&prefetch->lock);
+      pplayer->stats.maxread = MAX(pplayer->stats.maxread, usec);
+      if (ret == OK)
+        {
+          prefetch->head = (prefetch->head + 1) %
+                           CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+          prefetch->nready++;
+        }
+      else
+        {
+          prefetch->eof = true;
+        }
+
+      pthread_cond_broadcast(&prefetch->cond);
+
+      /* Wake the play thread if device buffers are parked on us */
+
+      notify = prefetch->notify;
+      prefetch->notify = false;
+      if (notify)
+        {
+          pthread_mutex_unlock(&prefetch->lock);
+
+          msg.msg_id = AUDIO_MSG_USER;
+          msg.u.ptr  = NULL;
+          mq_send(pplayer->mq, (FAR const char *)&msg, sizeof(msg),
+                  CONFIG_NXPLAYER_MSG_PRIO);
+
+          pthread_mutex_lock(&prefetch->lock);
+        }
+    }
+
+  pthread_mutex_unlock(&prefetch->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetchstart
+ *
+ *   Allocate the prefetch window and start reading ahead.  On failure the
+ *   player silently falls back to reading in the play thread.
+ *
+ ****************************************************************************/
+
+static int nxplayer_prefetchstart(FAR struct nxplayer_s *pplayer,
+                                  FAR struct ap_buffer_info_s *buf_info)
+{
+  FAR struct nxplayer_prefetch_s *prefetch;
+  FAR uint8_t                    *samp;
+  struct sched_param             sparam;
+  pthread_attr_t                 tattr;
+  int                            x;
+  int                            ret;
+
+  prefetch = zalloc(sizeof(*prefetch) +
+                    buf_info->nbuffers * sizeof(FAR struct ap_buffer_s *) +
+                    CONFIG_NXPLAYER_PREFETCH_BUFFERS *
+                    buf_info->buffer_size);
+  if (prefetch == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  prefetch->nbuffers = buf_info->nbuffers;
+  prefetch->parked   = (FAR struct ap_buffer_s **)(prefetch + 1);
+  samp = (FAR uint8_t *)(prefetch->parked + buf_info->nbuffers);
+
+  for (x = 0; x < CONFIG_NXPLAYER_PREFETCH_BUFFERS; x++)
+    {
+      prefetch->slots[x].nmaxbytes = buf_info->buffer_size;
+      prefetch->slots[x].samp      = samp;
+      samp += buf_info->buffer_size;
+    }
+
+  pthread_mutex_init(&prefetch->lock, NULL);
+  pthread_cond_init(&prefetch->cond, NULL);
+
+  pthread_mutex_lock(&pplayer->mutex);
+  memset(&pplayer->stats, 0, sizeof(pplayer->stats));
+  pplayer->stats.window   = CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+  pplayer->stats.lowwater = CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+  pplayer->prefetch       = prefetch;
+  pthread_mutex_unlock(&pplayer->mutex);
+
+  /* Read ahead just below the play thread, feeding the device from ready
+   * slots must not wait behind a slow read.
+   */
+
+  pthread_attr_init(&tattr);
+  sparam.sched_priority = sched_get_priority_max(SCHED_FIFO) - 10;
+  pthread_attr_setschedparam(&tattr, &sparam);
+  pthread_attr_setstacksize(&tattr, CONFIG_NXPLAYER_PREFETCH_STACKSIZE);
+
+  ret = pthread_create(&prefetch->tid, &tattr, nxplayer_prefetchthread,
+                       (pthread_addr_t)pplayer);
+  pthread_attr_destroy(&tattr);
+  if (ret != OK)
+    {
+      pthread_mutex_lock(&pplayer->mutex);
+      pplayer->prefetch = NULL;
+      pthread_mutex_unlock(&pplayer->mutex);
+
+      pthread_cond_destroy(&prefetch->cond);
+      pthread_mutex_destroy(&prefetch->lock);
+      free(prefetch);
+      return -ret;
+    }
+
+  pthread_setname_np(prefetch->tid, "prefetch");
+  return OK;
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetchstop
+ *
+ *   Stop reading ahead and release the window.  The media file belongs to
+ *   the play thread again afterwards.
+ *
+ ****************************************************************************/
+
+static void nxplayer_prefetchstop(FAR struct nxplayer_s *pplayer)
+{
+  FAR struct nxplayer_prefetch_s *prefetch = pplayer->prefetch;
+
+  if (prefetch == NULL)
+    {
+      return;
+    }
+
+  /* A read already in progress is allowed to complete */
+
+  pthread_mutex_lock(&prefetch->lock);
+  prefetch->stop = true;
+  pthread_cond_broadcast(&prefetch->cond);
+  pthread_mutex_unlock(&prefetch->lock);
+
+  pthread_join(prefetch->tid, NULL);
+
+  pthread_mutex_lock(&pplayer->mutex);
+  pplayer->prefetch = NULL;
+  pthread_mutex_unlock(&pplayer->mutex);
+
+  pthread_cond_destroy(&prefetch->cond);
+  pthread_mutex_destroy(&prefetch->lock);
+  free(prefetch);
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetchwait
+ *
+ *   Wait until the window holds count buffers or the file has ended.
+ *
+ ****************************************************************************/
+
+static void nxplayer_prefetchwait(FAR struct nxplayer_s *pplayer, int count)
+{
+  FAR struct nxplayer_prefetch_s *prefetch = pplayer->prefetch;
+
+  if (prefetch == NULL)
+    {
+      return;
+    }
+
+  count = MIN(count, CONFIG_NXPLAYER_PREFETCH_BUFFERS);
+
+  pthread_mutex_lock(&prefetch->lock);
+  while (prefetch->nready < count && !prefetch->eof)
+    {
+      pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+
+  pthread_mutex_unlock(&prefetch->lock);
+}
+
+/****************************************************************************
+ * Name: nxplayer_prefetchstream
+ *
+ *   Park the device buffer behind any earlier ones, then hand as many
+ *   parked buffers to the device as the window has data for.
+ *
+ ****************************************************************************/
+
+static int nxplayer_prefetchstream(FAR struct nxplayer_s *pplayer,
+                                   FAR struct ap_buffer_s *apb)
+{
+  FAR struct nxplayer_prefetch_s *prefetch = pplayer->prefetch;
+  FAR struct ap_buffer_s         *slot;
+  int                            count = 0;
+  int                            ret;
+
+  pthread_mutex_lock(&prefetch->lock);
+
+  if (apb != NULL)
+    {
+      DEBUGASSERT(prefetch->nparked < prefetch->nbuffers);
+      prefetch->parked[prefetch->nparked++] = apb;
+
+      if (!prefetch->eof)
+        {
+          pplayer->stats.lowwater = MIN(pplayer->stats.lowwater,
+                                        prefetch->nready);
+        }
+
+      if (prefetch->nready == 0 && !prefetch->eof)
+        {
+          pplayer->stats.late++;
+          if (prefetch->nparked == prefetch->nbuffers)
+            {
+              /* Every buffer is back with us, so the device is starving */
+
+              pplayer->stats.underruns++;
+            }
+        }
+    }
+
+  while (prefetch->nparked > 0 && prefetch->nready > 0)
+    {
+      slot = &prefetch->slots[prefetch->tail];
+      apb  = prefetch->parked[0];
+      pthread_mutex_unlock(&prefetch->lock);
+
+      memcpy(apb->samp, slot->samp, slot->nbytes);
+      apb->nbytes  = slot->nbytes;
+      apb->curbyte = 0;
+      apb->flags   = slot->flags;
+
+      pthread_mutex_lock(&prefetch->lock);
+      prefetch->tail = (prefetch->tail + 1) %
+                       CONFIG_NXPLAYER_PREFETCH_BUFFERS;
+      prefetch->nready--;
+      prefetch->nparked--;
+      memmove(prefetch->parked, prefetch->parked + 1,
+              prefetch->nparked * sizeof(FAR struct ap_buffer_s *));
+      pplayer->stats.buffers++;
+      pthread_cond_broadcast(&prefetch->cond);
+      pthread_mutex_unlock(&prefetch->lock);
+
+      ret = nxplayer_enqueuebuffer(pplayer, apb);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      count++;
+      pthread_mutex_lock(&prefetch->lock);
+    }
+
+  if (prefetch->nparked > 0)
+    {
+      if (prefetch->eof)
+        {
+          pthread_mutex_unlock(&prefetch->lock);
+          return count > 0 ? count : -ENODATA;
+        }
+
+      prefetch->notify = true;
+    }
+
+  pthread_mutex_unlock(&prefetch->lock);
+  return count;
+}
+#endif
+
+/****************************************************************************
+ * Name: nxplayer_streambuffer
+ *
+ *   Fill the device buffer with the next block of the media file and
+ *   enqueue it.  Returns the number of buffers enqueued, which may differ
+ *   from one when reading ahead, -ENODATA at the end of the file or the
+ *   error from the audio device.
+ *
+ ****************************************************************************/
+
+static int nxplayer_streambuffer(FAR struct nxplayer_s *pplayer,
+                                 FAR struct ap_buffer_s *apb)
+{
+  int ret;
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  if (pplayer->prefetch != NULL)
+    {
+      return nxplayer_prefetchstream(pplayer, apb);
+    }
+#endif
+
+  if (apb == NULL)
+    {
+      return 0;
+    }
+
+  ret = nxplayer_readbuffer(pplayer, apb);
+  if (ret != OK)
+    {
+      return ret;
+    }
+
+  ret = nxplayer_enqueuebuffer(pplayer, apb);
+  return ret < 0 ? ret : 1;
+}
+
+/****************************************************************************
+ * Name: nxplayer_closefile
+ *
+ *   Close the media file early, after an error from the audio device.
+ *
+ ****************************************************************************/
+
+static void nxplayer_closefile(FAR struct nxplayer_s *pplayer)
+{
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  nxplayer_prefetchstop(pplayer);
+#endif
+
+  if (pplayer->fd >= 0)
+    {
+      close(pplayer->fd);
+      pplayer->fd = -1;
+    }
+}
+
 /****************************************************************************
  * Name: nxplayer_jointhread
  ****************************************************************************/
@@ -847,18 +1233,31 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
         }
     }
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  /* Start reading ahead and let the window fill before the device starts */
+
+  if (nxplayer_prefetchstart(pplayer, &buf_info) < 0)
+    {
+      auderr("ERROR: No prefetch, reading in the play thread\n");
+    }
+
+  nxplayer_prefetchwait(pplayer, buf_info.nbuffers);
+#endif
+
   /* Fill up the pipeline with enqueued buffers */
 
   for (x = 0; x < buf_info.nbuffers; x++)
     {
-      /* Read the next buffer of data */
+      /* Read the next buffer of data and enqueue it by sending it to the
+       * audio driver.
+       */
 
-      ret = nxplayer_readbuffer(pplayer, buffers[x]);
-      if (ret != OK)
+      ret = nxplayer_streambuffer(pplayer, buffers[x]);
+      if (ret == -ENODATA)
         {
-          /* nxplayer_readbuffer will return an error if there is no further
-           * data to be read from the file.  This can happen normally if the
-           * file is very small (less than will fit in
+          /* nxplayer_streambuffer will return an error if there is no
+           * further data to be read from the file.  This can happen
+           * normally if the file is very small (less than will fit in
            * CONFIG_AUDIO_NUM_BUFFERS) or if an error occurs trying to read
            * from the file.
            */
@@ -877,48 +1276,40 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
               running = false;
             }
         }
-
-      /* Enqueue buffer by sending it to the audio driver */
-
-      else
+      else if (ret < 0)
         {
-          ret = nxplayer_enqueuebuffer(pplayer, buffers[x]);
-          if (ret != OK)
-            {
-              /* Failed to enqueue the buffer.
-               * The driver is not happy with the buffer.
-               * Perhaps a decoder has detected something that it
-               * does not like in the stream and has stopped streaming.
-               * This would happen normally if we send a file in the
-               * incorrect format to an audio decoder.
-               *
-               * We must stop streaming as gracefully as possible.  Close the
-               * file so that no further data is read.
-               */
+          /* Failed to enqueue the buffer.
+           * The driver is not happy with the buffer.
+           * Perhaps a decoder has detected something that it
+           * does not like in the stream and has stopped streaming.
+           * This would happen normally if we send a file in the
+           * incorrect format to an audio decoder.
+           *
+           * We must stop streaming as gracefully as possible.  Close the
+           * file so that no further data is read.
+           */
 
-              close(pplayer->fd);
-              pplayer->fd = -1;
+          nxplayer_closefile(pplayer);
 
-              /* We are no longer streaming data from the file.  Be we will
-               * need to wait for any outstanding buffers to be recovered.
-               *  We also still expect the audio driver to send a
-               * AUDIO_MSG_COMPLETE message after all queued buffers have
-               * been returned.
-               */
+          /* We are no longer streaming data from the file.  Be we will
+           * need to wait for any outstanding buffers to be recovered.
+           *  We also still expect the audio driver to send a
+           * AUDIO_MSG_COMPLETE message after all queued buffers have
+           * been returned.
+           */
 
-               streaming = false;
-               failed = true;
-               break;
-            }
+           streaming = false;
+           failed = true;
+           break;
+        }
 #ifdef CONFIG_DEBUG_FEATURES
-          else
-            {
-              /* The audio driver has one more buffer */
+      else
+        {
+          /* The audio driver has more buffers */
 
-              outstanding++;
-            }
-#endif
+          outstanding += ret;
         }
+#endif
     }
 
   audinfo("%d buffers queued, running=%d streaming=%d\n",
@@ -1022,6 +1413,16 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
             outstanding--;
 #endif
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+            /* Fall through */
+
+          /* The prefetch thread has data for buffers that were parked by
+           * an earlier AUDIO_MSG_DEQUEUE.  msg.u.ptr is NULL.
+           */
+
+          case AUDIO_MSG_USER:
+#endif
+
             /* Read data from the file directly into this buffer and
              * re-enqueue it.  streaming == true means that we have
              * not yet hit the end-of-file.
@@ -1029,10 +1430,8 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
 
             if (streaming)
               {
-                /* Read the next buffer of data */
-
-                ret = nxplayer_readbuffer(pplayer, msg.u.ptr);
-                if (ret != OK)
+                ret = nxplayer_streambuffer(pplayer, msg.u.ptr);
+                if (ret == -ENODATA)
                   {
                     /* Out of data.  Stay in the loop until the device sends
                      * us a COMPLETE message, but stop trying to play more
@@ -1041,41 +1440,33 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
 
                     streaming = false;
                   }
+                else if (ret < 0)
+                  {
+                    /* There is some issue from the audio driver.
+                     * Perhaps a problem in the file format?
+                     *
+                     * We must stop streaming as gracefully as possible.
+                     * Close the file so that no further data is read.
+                     */
+
+                    nxplayer_closefile(pplayer);
 
-                /* Enqueue buffer by sending it to the audio driver */
+                    /* Stop streaming and wait for buffers to be
+                     * returned and to receive the AUDIO_MSG_COMPLETE
+                     * indication.
+                     */
 
+                    streaming = false;
+                    failed = true;
+                  }
+#ifdef CONFIG_DEBUG_FEATURES
                 else
                   {
-                    ret = nxplayer_enqueuebuffer(pplayer, msg.u.ptr);
-                    if (ret != OK)
-                      {
-                        /* There is some issue from the audio driver.
-                         * Perhaps a problem in the file format?
-                         *
-                         * We must stop streaming as gracefully as possible.
-                         * Close the file so that no further data is read.
-                         */
-
-                        close(pplayer->fd);
-                        pplayer->fd = -1;
-
-                        /* Stop streaming and wait for buffers to be
-                         * returned and to receive the AUDIO_MSG_COMPLETE
-                         * indication.
-                         */
-
-                        streaming = false;
-                        failed = true;
-                      }
-#ifdef CONFIG_DEBUG_FEATURES
-                    else
-                      {
-                        /* The audio driver has one more buffer */
+                    /* The audio driver has more buffers */
 
-                        outstanding++;
-                      }
-#endif
+                    outstanding += ret;
                   }
+#endif
               }
             break;
 
@@ -1132,6 +1523,12 @@ static FAR void *nxplayer_playthread(pthread_addr_t pvarg)
 err_out:
   audinfo("Clean-up and exit\n");
 
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  /* Stop reading ahead before the file and message queue go away */
+
+  nxplayer_prefetchstop(pplayer);
+#endif
+
   audinfo("Freeing buffers\n");
   for (x = 0; x < buf_info.nbuffers; x++)
     {
@@ -1746,6 +2143,39 @@ int nxplayer_stop(FAR struct nxplayer_s *pplayer)
 }
 #endif /* CONFIG_AUDIO_EXCLUDE_STOP */
 
+/****************************************************************************
+ * Name: nxplayer_getstats
+ *
+ *   nxplayer_getstats() returns the read-ahead statistics of the current
+ *   or last playback.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXPLAYER_PREFETCH
+int nxplayer_getstats(FAR struct nxplayer_s *pplayer,
+                      FAR struct nxplayer_stats_s *stats)
+{
+  DEBUGASSERT(pplayer != NULL && stats != NULL);
+
+  /* The prefetch lock guards the counters while a playback is running */
+
+  pthread_mutex_lock(&pplayer->mutex);
+  if (pplayer->prefetch != NULL)
+    {
+      pthread_mutex_lock(&pplayer->prefetch->lock);
+      *stats = pplayer->stats;
+      pthread_mutex_unlock(&pplayer->prefetch->lock);
+    }
+  else
+    {
+      *stats = pplayer->stats;
+    }
+
+  pthread_mutex_unlock(&pplayer->mutex);
+  return OK;
+}
+#endif
+
 /****************************************************************************
  * Name: nxplayer_playinternal
  *
@@ -2175,6 +2605,10 @@ FAR struct nxplayer_s *nxplayer_create(void)
   pplayer->mq = 0;
   pplayer->play_id = 0;
   pplayer->crefs = 1;
+#ifdef CONFIG_NXPLAYER_PREFETCH
+  pplayer->prefetch = NULL;
+  memset(&pplayer->stats, 0, sizeof(pplayer->stats));
+#endif
 
 #ifndef CONFIG_AUDIO_EXCLUDE_TONE
   pplayer->bass = 50;
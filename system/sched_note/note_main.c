@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include <syslog.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -38,6 +39,10 @@
 
 #include <nuttx/sched_note.h>
 
+#ifdef CONFIG_SYSTEM_NOTE_STREAM
+#  include "note_stream.h"
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -72,7 +77,19 @@ static int note_daemon(int argc, char *argv[])
       goto errout;
     }
 
-  /* Now loop forever, dumping note data to the display */
+#ifdef CONFIG_SYSTEM_NOTE_STREAM
+  /* Stream the notes to a file or socket if requested */
+
+  if (argc > 2)
+    {
+      note_stream(fd, argv[2], strcmp(argv[1], "-s") == 0);
+      goto errout_with_fd;
+    }
+#endif
+
+  /* Now loop forever, dumping note data to the display.  The driver is
+   * drained before sleeping, so that a burst of notes does not overrun it.
+   */
 
   for (; ; )
     {
@@ -80,11 +97,15 @@ static int note_daemon(int argc, char *argv[])
       if (nread > 0)
         {
           syslog(LOG_INFO, "%.*s", (int)nread, g_note_buffer);
+          continue;
         }
 
       usleep(CONFIG_SYSTEM_NOTE_DELAY * 1000L);
     }
 
+#ifdef CONFIG_SYSTEM_NOTE_STREAM
+errout_with_fd:
+#endif
   close(fd);
 
 errout:
@@ -104,8 +125,29 @@ errout:
 
 int main(int argc, FAR char *argv[])
 {
+  FAR char *dargv[3] =
+    {
+      NULL
+    };
+
   int ret;
 
+#ifdef CONFIG_SYSTEM_NOTE_STREAM
+  /* note [-o <file> | -s <ipaddr>:<port>] */
+
+  if (argc == 3 &&
+      (strcmp(argv[1], "-o") == 0 || strcmp(argv[1], "-s") == 0))
+    {
+      dargv[0] = argv[1];
+      dargv[1] = argv[2];
+    }
+  else if (argc != 1)
+    {
+      printf("Usage: %s [-o <file> | -s <ipaddr>:<port>]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+#endif
+
   printf("note_main: Starting the note_daemon\n");
   if (g_note_daemon_started)
     {
@@ -115,7 +157,7 @@ int main(int argc, FAR char *argv[])
 
   ret = task_create("note_daemon", CONFIG_SYSTEM_NOTE_PRIORITY,
                     CONFIG_SYSTEM_NOTE_STACKSIZE, note_daemon,
-                    NULL);
+                    dargv[0] != NULL ? dargv : NULL);
   if (ret < 0)
     {
       int errcode = errno;
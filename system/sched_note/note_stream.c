@@ -0,0 +1,477 @@
+/****************************************************************************
+ * apps/system/sched_note/note_stream.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/note/noteram_driver.h>
+#include <nuttx/sched_note.h>
+
+#include "note_stream.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE
+#  define CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE 4096
+#endif
+
+#ifndef CONFIG_SYSTEM_NOTE_STREAM_DELAY
+#  define CONFIG_SYSTEM_NOTE_STREAM_DELAY 10
+#endif
+
+/* A buffer is handed to the writer once it cannot take the largest note */
+
+#define NOTE_STREAM_MAXNOTE   (UINT8_MAX + 1)
+
+#define NOTE_OFFSET(s, f)     offsetof(struct s, f)
+#define NOTE_SIZE(s, f)       sizeof(((FAR struct s *)0)->f)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct note_stream_s
+{
+  int             fd;                   /* Output file or socket */
+  pthread_t       thread;               /* Background writer */
+  pthread_mutex_t lock;                 /* Protects the fields below */
+  pthread_cond_t  cond;                 /* Signals a full / free buffer */
+  FAR uint8_t    *buf[2];               /* Double buffer */
+  size_t          len[2];               /* Bytes used in each buffer */
+  uint16_t        flags[2];             /* Chunk flags of each buffer */
+  uint32_t        seq;                  /* Next chunk sequence number */
+  int             active;               /* Buffer being filled */
+  bool            pending;              /* The other buffer is full */
+  int             error;                /* First write error */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: note_stream_store
+ ****************************************************************************/
+
+static int note_stream_store(int fd, FAR const void *buf, size_t len)
+{
+  FAR const uint8_t *data = buf;
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = write(fd, data, len);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      data += ret;
+      len  -= ret;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: note_stream_thread
+ ****************************************************************************/
+
+static FAR void *note_stream_thread(FAR void *arg)
+{
+  FAR struct note_stream_s *stream = arg;
+  struct note_stream_chunk_s chunk;
+  int idx;
+  int ret;
+
+  pthread_mutex_lock(&stream->lock);
+  for (; ; )
+    {
+      while (!stream->pending && stream->error == 0)
+        {
+          pthread_cond_wait(&stream->cond, &stream->lock);
+        }
+
+      if (stream->error != 0)
+        {
+          break;
+        }
+
+      /* The reader does not touch the full buffer until pending is
+       * cleared, so it is stored without holding the lock.
+       */
+
+      idx            = stream->active ^ 1;
+      chunk.seq      = stream->seq++;
+      chunk.flags    = stream->flags[idx];
+      chunk.reserved = 0;
+      chunk.size     = stream->len[idx];
+      pthread_mutex_unlock(&stream->lock);
+
+      ret = note_stream_store(stream->fd, &chunk, sizeof(chunk));
+      if (ret >= 0)
+        {
+          ret = note_stream_store(stream->fd, stream->buf[idx],
+                                  stream->len[idx]);
+        }
+
+      pthread_mutex_lock(&stream->lock);
+      if (ret < 0 && stream->error == 0)
+        {
+          stream->error = ret;
+        }
+
+      stream->len[idx] = 0;
+      stream->pending  = false;
+      pthread_cond_signal(&stream->cond);
+    }
+
+  pthread_mutex_unlock(&stream->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: note_stream_submit
+ *
+ * Description:
+ *   Hand the active buffer to the writer and switch to the other one.
+ *   If the writer still holds the other buffer, the reader has to wait and
+ *   the driver may overrun meanwhile; the next chunk is flagged so that
+ *   the gap is visible in the trace.
+ *
+ ****************************************************************************/
+
+static int note_stream_submit(FAR struct note_stream_s *stream)
+{
+  bool stalled = false;
+  int ret;
+
+  pthread_mutex_lock(&stream->lock);
+  while (stream->pending && stream->error == 0)
+    {
+      stalled = true;
+      pthread_cond_wait(&stream->cond, &stream->lock);
+    }
+
+  ret = stream->error;
+  if (ret == 0)
+    {
+      stream->pending = true;
+      stream->active ^= 1;
+      stream->flags[stream->active] = stalled ? NOTE_STREAM_STALLED : 0;
+      pthread_cond_signal(&stream->cond);
+    }
+
+  pthread_mutex_unlock(&stream->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: note_stream_connect
+ ****************************************************************************/
+
+static int note_stream_connect(FAR const char *target)
+{
+  struct sockaddr_in addr;
+  char host[INET_ADDRSTRLEN];
+  FAR const char *port;
+  int sockfd;
+
+  port = strrchr(target, ':');
+  if (port == NULL || port - target >= sizeof(host))
+    {
+      return -EINVAL;
+    }
+
+  memcpy(host, target, port - target);
+  host[port - target] = '\0';
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons(atoi(port + 1));
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+    {
+      return -EINVAL;
+    }
+
+  sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+    {
+      return -errno;
+    }
+
+  if (connect(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      int errcode = errno;
+      close(sockfd);
+      return -errcode;
+    }
+
+  return sockfd;
+}
+
+/****************************************************************************
+ * Name: note_stream_header
+ *
+ * Description:
+ *   Describe the stream.  In binary mode the header carries the offsets of
+ *   the note fields and the note type values of this build, so the host
+ *   converter can decode the notes without the target configuration.
+ *
+ ****************************************************************************/
+
+static void note_stream_header(FAR struct note_stream_header_s *hdr,
+                               int mode)
+{
+  FAR uint8_t *layout = hdr->layout;
+
+  memset(hdr, 0, sizeof(*hdr));
+  memcpy(hdr->magic, NOTE_STREAM_MAGIC, sizeof(NOTE_STREAM_MAGIC));
+  hdr->byteorder = NOTE_STREAM_BYTEORDER;
+  hdr->version   = NOTE_STREAM_VERSION;
+  hdr->mode      = mode;
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_PERFCOUNT
+  hdr->freq = up_perf_getfreq();
+#else
+  hdr->freq = TICK_PER_SEC;
+#endif
+
+  memset(layout, NOTE_LAYOUT_NONE, NOTE_LAYOUT_NFIELDS);
+
+  layout[NOTE_LAYOUT_TYPE]      = NOTE_OFFSET(note_common_s, nc_type);
+  layout[NOTE_LAYOUT_PRIORITY]  = NOTE_OFFSET(note_common_s, nc_priority);
+#ifdef CONFIG_SMP
+  layout[NOTE_LAYOUT_CPU]       = NOTE_OFFSET(note_common_s, nc_cpu);
+#endif
+  layout[NOTE_LAYOUT_PID]       = NOTE_OFFSET(note_common_s, nc_pid);
+  layout[NOTE_LAYOUT_PID_SIZE]  = NOTE_SIZE(note_common_s, nc_pid);
+  layout[NOTE_LAYOUT_TIME]      = NOTE_OFFSET(note_common_s, nc_systime);
+  layout[NOTE_LAYOUT_TIME_SIZE] = NOTE_SIZE(note_common_s, nc_systime);
+#if CONFIG_TASK_NAME_SIZE > 0
+  layout[NOTE_LAYOUT_NAME]      = NOTE_OFFSET(note_start_s, nst_name);
+#endif
+
+  layout[NOTE_LAYOUT_START]     = NOTE_START;
+  layout[NOTE_LAYOUT_STOP]      = NOTE_STOP;
+  layout[NOTE_LAYOUT_SUSPEND]   = NOTE_SUSPEND;
+  layout[NOTE_LAYOUT_RESUME]    = NOTE_RESUME;
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_IRQHANDLER
+  layout[NOTE_LAYOUT_IRQ]       = NOTE_OFFSET(note_irqhandler_s, nih_irq);
+  layout[NOTE_LAYOUT_IRQ_SIZE]  = NOTE_SIZE(note_irqhandler_s, nih_irq);
+  layout[NOTE_LAYOUT_IRQ_ENTER] = NOTE_IRQ_ENTER;
+  layout[NOTE_LAYOUT_IRQ_LEAVE] = NOTE_IRQ_LEAVE;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  layout[NOTE_LAYOUT_SYSCALL]       =
+    NOTE_OFFSET(note_syscall_enter_s, nsc_nr);
+  layout[NOTE_LAYOUT_SYSCALL_SIZE]  =
+    NOTE_SIZE(note_syscall_enter_s, nsc_nr);
+  layout[NOTE_LAYOUT_SYSCALL_ENTER] = NOTE_SYSCALL_ENTER;
+  layout[NOTE_LAYOUT_SYSCALL_LEAVE] = NOTE_SYSCALL_LEAVE;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_CSECTION
+  layout[NOTE_LAYOUT_CSECTION_ENTER] = NOTE_CSECTION_ENTER;
+  layout[NOTE_LAYOUT_CSECTION_LEAVE] = NOTE_CSECTION_LEAVE;
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: note_stream
+ ****************************************************************************/
+
+int note_stream(int notefd, FAR const char *target, bool sock)
+{
+  FAR struct note_stream_s *stream;
+  struct note_stream_header_s hdr;
+  int mode = NOTE_STREAM_ASCII;
+  ssize_t nread;
+  size_t len;
+  int ret;
+
+  stream = calloc(1, sizeof(struct note_stream_s) +
+                     2 * CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE);
+  if (stream == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  stream->buf[0] = (FAR uint8_t *)(stream + 1);
+  stream->buf[1] = stream->buf[0] + CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE;
+
+  if (sock)
+    {
+      stream->fd = note_stream_connect(target);
+    }
+  else
+    {
+      stream->fd = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        0666);
+      if (stream->fd < 0)
+        {
+          stream->fd = -errno;
+        }
+    }
+
+  if (stream->fd < 0)
+    {
+      ret = stream->fd;
+      syslog(LOG_ERR, "note_daemon: ERROR: Failed to open %s: %d\n",
+             target, ret);
+      goto errout;
+    }
+
+  /* Prefer the raw notes, formatting them is left to the host */
+
+#ifdef NOTERAM_SETREADMODE
+  {
+    unsigned int readmode = NOTERAM_MODE_READ_BINARY;
+
+    if (ioctl(notefd, NOTERAM_SETREADMODE, (unsigned long)&readmode) >= 0)
+      {
+        mode = NOTE_STREAM_BINARY;
+      }
+  }
+#endif
+
+  note_stream_header(&hdr, mode);
+  ret = note_stream_store(stream->fd, &hdr, sizeof(hdr));
+  if (ret < 0)
+    {
+      goto errout_with_fd;
+    }
+
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->cond, NULL);
+  ret = pthread_create(&stream->thread, NULL, note_stream_thread, stream);
+  if (ret != 0)
+    {
+      ret = -ret;
+      goto errout_with_lock;
+    }
+
+  syslog(LOG_INFO, "note_daemon: Streaming %s notes to %s\n",
+         mode == NOTE_STREAM_BINARY ? "binary" : "ascii", target);
+
+  /* Drain the driver as long as it has notes, only sleep once it is
+   * empty.  A partially filled buffer is handed over at that point too,
+   * so the output lags by at most one delay.
+   */
+
+  for (; ; )
+    {
+      len   = stream->len[stream->active];
+      nread = read(notefd, stream->buf[stream->active] + len,
+                   CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE - len);
+      if (nread < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          break;
+        }
+
+      len += nread;
+      stream->len[stream->active] = len;
+
+      if (nread > 0 &&
+          CONFIG_SYSTEM_NOTE_STREAM_BUFSIZE - len >= NOTE_STREAM_MAXNOTE)
+        {
+          continue;
+        }
+
+      if (len > 0)
+        {
+          ret = note_stream_submit(stream);
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+
+      if (nread == 0)
+        {
+          usleep(CONFIG_SYSTEM_NOTE_STREAM_DELAY * 1000L);
+        }
+    }
+
+  /* Stop the writer, an error makes it leave its loop */
+
+  pthread_mutex_lock(&stream->lock);
+  if (stream->error == 0)
+    {
+      stream->error = ret;
+    }
+
+  pthread_cond_signal(&stream->cond);
+  pthread_mutex_unlock(&stream->lock);
+  pthread_join(stream->thread, NULL);
+
+  syslog(LOG_ERR, "note_daemon: ERROR: Streaming failed: %d\n",
+         stream->error);
+  ret = stream->error;
+
+errout_with_lock:
+  pthread_cond_destroy(&stream->cond);
+  pthread_mutex_destroy(&stream->lock);
+errout_with_fd:
+  close(stream->fd);
+errout:
+  free(stream);
+  return ret;
+}
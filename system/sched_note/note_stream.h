@@ -0,0 +1,134 @@
+/****************************************************************************
+ * apps/system/sched_note/note_stream.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_SYSTEM_SCHED_NOTE_NOTE_STREAM_H
+#define __APPS_SYSTEM_SCHED_NOTE_NOTE_STREAM_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Stream layout, all fields in target byte order:
+ *
+ *   struct note_stream_header_s
+ *   { struct note_stream_chunk_s, payload[chunk.size] } ...
+ *
+ * The payload is what /dev/note/ram returned: raw notes in binary mode,
+ * ftrace formatted text otherwise.  Binary notes are described by the
+ * header layout table, so the host converter (noteconv.py) needs no
+ * knowledge of the target configuration.
+ */
+
+#define NOTE_STREAM_MAGIC          "NXNOTES"
+#define NOTE_STREAM_VERSION        1
+#define NOTE_STREAM_BYTEORDER      0x01020304
+
+#define NOTE_STREAM_ASCII          0    /* Payload is ftrace text */
+#define NOTE_STREAM_BINARY         1    /* Payload is raw notes */
+
+#define NOTE_STREAM_STALLED        (1 << 0) /* Reader waited on the writer */
+
+/* Layout table, offsets and sizes in bytes, NOTE_LAYOUT_NONE if absent */
+
+#define NOTE_LAYOUT_NONE           0xff
+
+#define NOTE_LAYOUT_TYPE           0    /* Offset of nc_type */
+#define NOTE_LAYOUT_CPU            1    /* Offset of nc_cpu */
+#define NOTE_LAYOUT_PRIORITY       2    /* Offset of nc_priority */
+#define NOTE_LAYOUT_PID            3    /* Offset of nc_pid */
+#define NOTE_LAYOUT_PID_SIZE       4
+#define NOTE_LAYOUT_TIME           5    /* Offset of nc_systime */
+#define NOTE_LAYOUT_TIME_SIZE      6
+#define NOTE_LAYOUT_NAME           7    /* Offset of nst_name */
+#define NOTE_LAYOUT_IRQ            8    /* Offset of nih_irq */
+#define NOTE_LAYOUT_IRQ_SIZE       9
+#define NOTE_LAYOUT_SYSCALL        10   /* Offset of nsc_nr */
+#define NOTE_LAYOUT_SYSCALL_SIZE   11
+#define NOTE_LAYOUT_START          12   /* Note type values */
+#define NOTE_LAYOUT_STOP           13
+#define NOTE_LAYOUT_SUSPEND        14
+#define NOTE_LAYOUT_RESUME         15
+#define NOTE_LAYOUT_IRQ_ENTER      16
+#define NOTE_LAYOUT_IRQ_LEAVE      17
+#define NOTE_LAYOUT_SYSCALL_ENTER  18
+#define NOTE_LAYOUT_SYSCALL_LEAVE  19
+#define NOTE_LAYOUT_CSECTION_ENTER 20
+#define NOTE_LAYOUT_CSECTION_LEAVE 21
+#define NOTE_LAYOUT_NFIELDS        22
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct note_stream_header_s
+{
+  char     magic[8];                      /* NOTE_STREAM_MAGIC */
+  uint32_t byteorder;                     /* NOTE_STREAM_BYTEORDER */
+  uint32_t freq;                          /* Timestamp counts per second */
+  uint8_t  version;                       /* NOTE_STREAM_VERSION */
+  uint8_t  mode;                          /* NOTE_STREAM_ASCII/BINARY */
+  uint8_t  layout[NOTE_LAYOUT_NFIELDS];   /* Binary note layout */
+};
+
+struct note_stream_chunk_s
+{
+  uint32_t seq;                           /* Chunk sequence number */
+  uint16_t flags;                         /* NOTE_STREAM_STALLED */
+  uint16_t reserved;
+  uint32_t size;                          /* Payload size */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: note_stream
+ *
+ * Description:
+ *   Stream the notes of /dev/note/ram until an error occurs.  The daemon
+ *   keeps reading the driver into one buffer while a writer thread stores
+ *   the other one, so a slow file system or link does not hold up the
+ *   reader.
+ *
+ * Input Parameters:
+ *   notefd  - The opened note driver.
+ *   target  - A file path, or "host:port" when sock is true.
+ *   sock    - Stream to a TCP server instead of a file.
+ *
+ * Returned Value:
+ *   Negated errno on failure.
+ *
+ ****************************************************************************/
+
+int note_stream(int notefd, FAR const char *target, bool sock);
+
+#endif /* __APPS_SYSTEM_SCHED_NOTE_NOTE_STREAM_H */
@@ -0,0 +1,282 @@
+#!/usr/bin/env python3
+############################################################################
+# apps/system/sched_note/noteconv.py
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.  The
+# ASF licenses this file to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance with the
+# License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations
+# under the License.
+#
+############################################################################
+"""Convert a 'note -o' / 'note -s' stream to a trace for Perfetto
+
+Binary streams are converted to the Chrome JSON trace format, ASCII streams
+to ftrace text.  Both can be opened with ui.perfetto.dev or
+chrome://tracing.  A TCP stream can be captured with e.g.
+'nc -l 5555 > trace.bin'.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"NXNOTES\0"
+BYTEORDER = 0x01020304
+
+MODE_ASCII = 0
+MODE_BINARY = 1
+
+STALLED = 1 << 0
+
+# Layout table indexes, see note_stream.h
+
+NONE = 0xFF
+(
+    L_TYPE,
+    L_CPU,
+    L_PRIORITY,
+    L_PID,
+    L_PID_SIZE,
+    L_TIME,
+    L_TIME_SIZE,
+    L_NAME,
+    L_IRQ,
+    L_IRQ_SIZE,
+    L_SYSCALL,
+    L_SYSCALL_SIZE,
+    L_START,
+    L_STOP,
+    L_SUSPEND,
+    L_RESUME,
+    L_IRQ_ENTER,
+    L_IRQ_LEAVE,
+    L_SYSCALL_ENTER,
+    L_SYSCALL_LEAVE,
+    L_CSECTION_ENTER,
+    L_CSECTION_LEAVE,
+    L_NFIELDS,
+) = range(23)
+
+HEADER_SIZE = 8 + 4 + 4 + 2 + L_NFIELDS
+CHUNK_SIZE = 12
+
+# Chrome trace tracks
+
+PID_CPU = 0
+PID_TASK = 1
+TID_IRQ = 1000
+TID_CSECTION = 2000
+
+
+class NoteStream:
+    def __init__(self, data):
+        if data[:8] != MAGIC:
+            raise ValueError("not a note stream")
+
+        for endian in "<>":
+            if struct.unpack_from(endian + "I", data, 8)[0] == BYTEORDER:
+                break
+        else:
+            raise ValueError("unknown byte order")
+
+        self.endian = endian
+        self.freq, version, self.mode = struct.unpack_from(
+            endian + "IBB", data, 12
+        )
+        self.layout = data[18 : 18 + L_NFIELDS]
+        self.data = data
+
+        if version != 1:
+            raise ValueError("unsupported version %d" % version)
+
+    def chunks(self):
+        """Yield (seq, flags, payload), warn about gaps"""
+
+        offset = HEADER_SIZE
+        expect = 0
+        while offset + CHUNK_SIZE <= len(self.data):
+            seq, flags, _, size = struct.unpack_from(
+                self.endian + "IHHI", self.data, offset
+            )
+            offset += CHUNK_SIZE
+            payload = self.data[offset : offset + size]
+            offset += size
+
+            if len(payload) != size:
+                sys.stderr.write("warning: truncated chunk %d\n" % seq)
+            if seq != expect:
+                sys.stderr.write("warning: chunks %d-%d lost\n" % (expect, seq - 1))
+            if flags & STALLED:
+                sys.stderr.write("warning: writer stalled before chunk %d\n" % seq)
+
+            expect = seq + 1
+            yield seq, flags, payload
+
+    def field(self, note, index, size_index=None, size=1):
+        offset = self.layout[index]
+        if offset == NONE:
+            return None
+        if size_index is not None:
+            size = self.layout[size_index]
+        if offset + size > len(note):
+            return None
+
+        return int.from_bytes(
+            note[offset : offset + size],
+            "little" if self.endian == "<" else "big",
+        )
+
+    def notes(self):
+        """Yield (flags, note) for each binary note"""
+
+        for _, flags, payload in self.chunks():
+            offset = 0
+            while offset < len(payload):
+                length = payload[offset]
+                if length == 0 or offset + length > len(payload):
+                    sys.stderr.write("warning: bad note length, chunk skipped\n")
+                    break
+
+                yield flags, payload[offset : offset + length]
+                flags = 0
+                offset += length
+
+
+def convert_ascii(stream, out):
+    out.write("# tracer: nop\n#\n")
+    for _, _, payload in stream.chunks():
+        out.write(payload.decode("utf-8", "replace"))
+
+
+def convert_binary(stream, out):
+    layout = stream.layout
+    events = []
+    names = {}
+    running = {}
+    opened = {}
+
+    def usec(note):
+        counts = stream.field(note, L_TIME, L_TIME_SIZE)
+        return None if counts is None else counts * 1e6 / stream.freq
+
+    def begin(key, ts):
+        opened[key] = ts
+
+    def end(key, ts, name, pid, tid, args=None):
+        start = opened.pop(key, None)
+        if start is not None:
+            event = {
+                "name": name,
+                "ph": "X",
+                "ts": start,
+                "dur": ts - start,
+                "pid": pid,
+                "tid": tid,
+            }
+            if args:
+                event["args"] = args
+            events.append(event)
+
+    for flags, note in stream.notes():
+        ntype = stream.field(note, L_TYPE)
+        pid = stream.field(note, L_PID, L_PID_SIZE)
+        cpu = stream.field(note, L_CPU) or 0
+        ts = usec(note)
+        if ts is None:
+            continue
+
+        if flags & STALLED:
+            events.append(
+                {"name": "notes lost", "ph": "i", "s": "g", "ts": ts, "pid": 0}
+            )
+
+        if ntype == layout[L_START]:
+            if layout[L_NAME] != NONE:
+                name = note[layout[L_NAME] :].split(b"\0")[0]
+                names[pid] = name.decode("utf-8", "replace")
+        elif ntype == layout[L_STOP]:
+            end(("cpu", cpu), ts, names.get(pid, str(pid)), PID_CPU, cpu)
+            running.pop(cpu, None)
+        elif ntype == layout[L_RESUME]:
+            if running.get(cpu) is not None:
+                prev = running[cpu]
+                end(("cpu", cpu), ts, names.get(prev, str(prev)), PID_CPU, cpu)
+            running[cpu] = pid
+            begin(("cpu", cpu), ts)
+        elif ntype == layout[L_SUSPEND]:
+            end(("cpu", cpu), ts, names.get(pid, str(pid)), PID_CPU, cpu)
+            running.pop(cpu, None)
+        elif ntype == layout[L_IRQ_ENTER]:
+            begin(("irq", cpu), ts)
+        elif ntype == layout[L_IRQ_LEAVE]:
+            irq = stream.field(note, L_IRQ, L_IRQ_SIZE)
+            end(("irq", cpu), ts, "irq %s" % irq, PID_CPU, TID_IRQ + cpu)
+        elif ntype == layout[L_SYSCALL_ENTER]:
+            begin(("sys", pid), ts)
+        elif ntype == layout[L_SYSCALL_LEAVE]:
+            nr = stream.field(note, L_SYSCALL, L_SYSCALL_SIZE)
+            end(("sys", pid), ts, "syscall %s" % nr, PID_TASK, pid)
+        elif ntype == layout[L_CSECTION_ENTER]:
+            begin(("cs", cpu), ts)
+        elif ntype == layout[L_CSECTION_LEAVE]:
+            end(
+                ("cs", cpu),
+                ts,
+                "csection",
+                PID_CPU,
+                TID_CSECTION + cpu,
+                {"pid": pid},
+            )
+
+    meta = [
+        {"name": "process_name", "ph": "M", "pid": PID_CPU, "args": {"name": "CPUs"}},
+        {"name": "process_name", "ph": "M", "pid": PID_TASK, "args": {"name": "Tasks"}},
+    ]
+    for pid, name in names.items():
+        meta.append(
+            {
+                "name": "thread_name",
+                "ph": "M",
+                "pid": PID_TASK,
+                "tid": pid,
+                "args": {"name": "%s-%d" % (name, pid)},
+            }
+        )
+
+    json.dump({"traceEvents": meta + events, "displayTimeUnit": "ns"}, out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("input", help="stream captured from the target")
+    parser.add_argument("-o", "--output", help="output file, default stdout")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        stream = NoteStream(f.read())
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    if stream.mode == MODE_BINARY:
+        convert_binary(stream, out)
+    else:
+        convert_ascii(stream, out)
+
+    if out is not sys.stdout:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
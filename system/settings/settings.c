@@ -57,6 +57,11 @@
 #  define CONFIG_SYSTEM_SETTINGS_CACHE_TIME_MS 100
 #endif
 
+/* Open addressing index, kept at most half full */
+
+#define INDEX_SIZE     (2 * CONFIG_SYSTEM_SETTINGS_MAP_SIZE)
+#define INDEX_FREE     UINT16_MAX
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -67,6 +72,11 @@
 
 static int      sanity_check(FAR char *str);
 static uint32_t hash_calc(void);
+static uint32_t key_hash(FAR const char *key);
+static int      index_find(FAR const char *key);
+static void     index_add(int idx);
+static void     index_rebuild(void);
+static void     set_dirty(FAR setting_t *setting);
 static int      get_setting(FAR char *key, FAR setting_t **setting);
 static size_t   get_string(FAR setting_t *setting, FAR char *buffer,
                          size_t size);
@@ -96,6 +106,8 @@ static struct
   bool              initialized;
   storage_t         store[CONFIG_SYSTEM_SETTINGS_MAX_STORAGES];
   struct notify_s   notify[CONFIG_SYSTEM_SETTINGS_MAX_SIGNALS];
+  uint16_t          index[INDEX_SIZE];
+  int               count;
 #if defined(CONFIG_SYSTEM_SETTINGS_CACHED_SAVES)
   struct sigevent   sev;
   struct itimerspec trigger;
@@ -105,6 +117,13 @@ static struct
 
 setting_t map[CONFIG_SYSTEM_SETTINGS_MAP_SIZE];
 
+/* Settings changed since the last save. A storage can use them to write
+ * only the changes, unless map_rewrite asks for the whole map.
+ */
+
+uint8_t   map_dirty[(CONFIG_SYSTEM_SETTINGS_MAP_SIZE + 7) / 8];
+bool      map_rewrite;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -127,6 +146,147 @@ static uint32_t hash_calc(void)
   return crc32((FAR uint8_t *)map, sizeof(map));
 }
 
+/****************************************************************************
+ * Name: key_hash
+ *
+ * Description:
+ *    Gets the FNV-1a hash of a key
+ *
+ * Input Parameters:
+ *    key        - the key
+ *
+ * Returned Value:
+ *   The hash of the key
+ *
+ ****************************************************************************/
+
+static uint32_t key_hash(FAR const char *key)
+{
+  uint32_t h = 2166136261u;
+
+  while (*key != '\0')
+    {
+      h ^= (uint8_t)*key++;
+      h *= 16777619u;
+    }
+
+  return h;
+}
+
+/****************************************************************************
+ * Name: index_find
+ *
+ * Description:
+ *    Finds a key in the index
+ *
+ * Input Parameters:
+ *    key        - the key
+ *
+ * Returned Value:
+ *   The map position of the setting, or -ENOENT if not found
+ *
+ ****************************************************************************/
+
+static int index_find(FAR const char *key)
+{
+  uint32_t i = key_hash(key) % INDEX_SIZE;
+  uint16_t idx;
+
+  while ((idx = g_settings.index[i]) != INDEX_FREE)
+    {
+      if (strcmp(map[idx].key, key) == 0)
+        {
+          return idx;
+        }
+
+      i = (i + 1) % INDEX_SIZE;
+    }
+
+  return -ENOENT;
+}
+
+/****************************************************************************
+ * Name: index_add
+ *
+ * Description:
+ *    Adds a map position to the index. Settings are only removed all at
+ *    once, so linear probing needs no tombstones.
+ *
+ * Input Parameters:
+ *    idx        - the map position of the setting
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void index_add(int idx)
+{
+  uint32_t i = key_hash(map[idx].key) % INDEX_SIZE;
+
+  while (g_settings.index[i] != INDEX_FREE)
+    {
+      i = (i + 1) % INDEX_SIZE;
+    }
+
+  g_settings.index[i] = idx;
+}
+
+/****************************************************************************
+ * Name: index_rebuild
+ *
+ * Description:
+ *    Rebuilds the index after the map was changed as a whole (cleared or
+ *    loaded from a storage)
+ *
+ * Input Parameters:
+ *    none
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void index_rebuild(void)
+{
+  int i;
+
+  memset(g_settings.index, 0xff, sizeof(g_settings.index));
+
+  for (i = 0; i < CONFIG_SYSTEM_SETTINGS_MAP_SIZE; i++)
+    {
+      if (map[i].type == SETTING_EMPTY)
+        {
+          break;
+        }
+
+      index_add(i);
+    }
+
+  g_settings.count = i;
+}
+
+/****************************************************************************
+ * Name: set_dirty
+ *
+ * Description:
+ *    Marks a setting as changed since the last save
+ *
+ * Input Parameters:
+ *    setting    - pointer to the setting
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void set_dirty(FAR setting_t *setting)
+{
+  int idx = setting - map;
+
+  map_dirty[idx / 8] |= 1 << (idx % 8);
+}
+
 /****************************************************************************
  * Name: get_setting
  *
@@ -144,31 +304,19 @@ static uint32_t hash_calc(void)
 
 static int get_setting(FAR char *key, FAR setting_t **setting)
 {
-  int i;
-  int ret = OK;
+  int idx;
 
   assert(*setting == NULL);
 
-  for (i = 0; i < CONFIG_SYSTEM_SETTINGS_MAP_SIZE; i++)
+  idx = index_find(key);
+  if (idx < 0)
     {
-      if (map[i].type == SETTING_EMPTY)
-        {
-          ret = -ENOENT;
-          goto exit;
-        }
-
-      if (strcmp(map[i].key, key) == 0)
-        {
-          *setting = &map[i];
-          goto exit;
-        }
+      return idx;
     }
 
-  *setting = NULL;
-  ret = -ENOENT;
+  *setting = &map[idx];
 
-exit:
-  return ret;
+  return OK;
 }
 
 /****************************************************************************
@@ -703,6 +851,9 @@ static void dump_cache(union sigval ptr)
         }
     }
 
+  memset(map_dirty, 0, sizeof(map_dirty));
+  map_rewrite = false;
+
   *wrpend = false;
 
   pthread_mutex_unlock(&g_settings.mtx);
@@ -767,8 +918,11 @@ void settings_init(void)
   pthread_mutex_init(&g_settings.mtx, &attr);
 
   memset(map, 0, sizeof(map));
+  memset(map_dirty, 0, sizeof(map_dirty));
   memset(g_settings.store, 0, sizeof(g_settings.store));
   memset(g_settings.notify, 0, sizeof(g_settings.notify));
+  index_rebuild();
+  map_rewrite = false;
 
 #if defined(CONFIG_SYSTEM_SETTINGS_CACHED_SAVES)
   memset(&g_settings.sev, 0, sizeof(struct sigevent));
@@ -864,6 +1018,13 @@ int settings_setstorage(FAR char *file, enum storage_type_e type)
       }
       break;
 
+    case STORAGE_JOURNAL:
+      {
+        storage->load_fn = load_journal;
+        storage->save_fn = save_journal;
+      }
+      break;
+
     default:
       {
         assert(0);
@@ -873,6 +1034,8 @@ int settings_setstorage(FAR char *file, enum storage_type_e type)
 
   ret = storage->load_fn(storage->file);
 
+  index_rebuild();
+
   h = hash_calc();
 
   /* Only save if there are more than 1 storages. */
@@ -880,6 +1043,7 @@ int settings_setstorage(FAR char *file, enum storage_type_e type)
   if ((storage != &g_settings.store[0]) && ((h != g_settings.hash) ||
       (access(file, F_OK) != 0)))
     {
+      map_rewrite = true;
       signotify();
       save();
     }
@@ -921,6 +1085,7 @@ int settings_sync(bool wait_dump)
     }
 
   ret = load();
+  index_rebuild();
   if (ret < 0) /* All storages failed to load */
     {
       goto done;
@@ -930,6 +1095,7 @@ int settings_sync(bool wait_dump)
   if (h != g_settings.hash)
     {
       g_settings.hash = h;
+      map_rewrite = true;
       signotify();
       save();
     }
@@ -1066,8 +1232,10 @@ int settings_clear(void)
     }
 
   memset(map, 0, sizeof(map));
+  index_rebuild();
   g_settings.hash = 0;
 
+  map_rewrite = true;
   save();
 
   pthread_mutex_unlock(&g_settings.mtx);
@@ -1129,27 +1297,23 @@ int settings_create(FAR char *key, enum settings_type_e type, ...)
       return ret;
     }
 
-  for (j = 0; j < CONFIG_SYSTEM_SETTINGS_MAP_SIZE; j++)
+  j = index_find(key);
+  if (j >= 0)
     {
-      if (strcmp(key, map[j].key) == 0)
-        {
-          setting = &map[j];
-
-          /* We found a setting with this key name */
+      setting = &map[j];
 
-          goto errout;
-        }
+      /* We found a setting with this key name */
 
-      if (map[j].type == SETTING_EMPTY)
-        {
-          setting = &map[j];
-          strncpy(setting->key, key, CONFIG_SYSTEM_SETTINGS_KEY_SIZE);
-          setting->key[CONFIG_SYSTEM_SETTINGS_KEY_SIZE - 1] = '\0';
+      goto errout;
+    }
 
-          /* This setting is empty/unused - we can use it */
+  if (g_settings.count < CONFIG_SYSTEM_SETTINGS_MAP_SIZE)
+    {
+      setting = &map[g_settings.count];
+      strncpy(setting->key, key, CONFIG_SYSTEM_SETTINGS_KEY_SIZE);
+      setting->key[CONFIG_SYSTEM_SETTINGS_KEY_SIZE - 1] = '\0';
 
-         break;
-        }
+      /* This setting is empty/unused - we can use it */
     }
 
   if (setting == NULL)
@@ -1266,6 +1430,8 @@ int settings_create(FAR char *key, enum settings_type_e type, ...)
         }
       else
         {
+          index_add(g_settings.count++);
+          set_dirty(setting);
           g_settings.hash = hash_calc();
           save();
         }
@@ -1434,6 +1600,7 @@ int settings_set(FAR char *key, enum settings_type_e type, ...)
 {
   int ret;
   FAR setting_t *setting = NULL;
+  setting_t old;
   uint32_t h;
 
   assert(g_settings.initialized);
@@ -1452,6 +1619,8 @@ int settings_set(FAR char *key, enum settings_type_e type, ...)
       goto errout;
     }
 
+  memcpy(&old, setting, sizeof(setting_t));
+
   va_list ap;
   va_start(ap, type);
 
@@ -1501,8 +1670,10 @@ int settings_set(FAR char *key, enum settings_type_e type, ...)
 
   va_end(ap);
 
-  if (ret >= 0)
+  if (ret >= 0 && memcmp(&old, setting, sizeof(setting_t)) != 0)
     {
+      set_dirty(setting);
+
       h = hash_calc();
       if (h != g_settings.hash)
         {
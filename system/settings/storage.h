@@ -56,6 +56,11 @@ int save_text(FAR char *file);
 int load_bin(FAR char *file);
 int save_bin(FAR char *file);
 
+/* Journal storage. */
+
+int load_journal(FAR char *file);
+int save_journal(FAR char *file);
+
 /* EEPROM storage. */
 
 int load_eeprom(FAR char *file);
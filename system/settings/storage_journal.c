@@ -0,0 +1,489 @@
+/****************************************************************************
+ * apps/system/settings/storage_journal.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include "system/settings.h"
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <nuttx/crc32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <nuttx/config.h>
+#include <sys/types.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSTEM_SETTINGS_JOURNAL_SLACK
+#  define CONFIG_SYSTEM_SETTINGS_JOURNAL_SLACK 32
+#endif
+
+#define BACKUP_SUFFIX  "~"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* The journal is a header followed by records. A changed setting is
+ * appended as a new record, the last record of a key wins on load.
+ */
+
+begin_packed_struct struct journal_hdr_s
+{
+  uint16_t  valid;                    /* VALID */
+  uint16_t  size;                     /* sizeof(setting_t) */
+} end_packed_struct;
+
+begin_packed_struct struct journal_rec_s
+{
+  setting_t setting;
+  uint32_t  crc;                      /* crc32 of the setting */
+} end_packed_struct;
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: getsetting
+ *
+ * Description:
+ *    Gets the setting information from a given key.
+ *
+ * Input Parameters:
+ *    key        - key of the required setting
+ *
+ * Returned Value:
+ *   The setting
+ *
+ ****************************************************************************/
+
+FAR static setting_t *getsetting(char *key);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Journal file last loaded or written and its number of records, -1 if
+ * not known. With several journal storages, switching between them makes
+ * the next save compact.
+ */
+
+static char g_file[CONFIG_SYSTEM_SETTINGS_MAX_FILENAME];
+static int  g_records = -1;
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+extern setting_t map[CONFIG_SYSTEM_SETTINGS_MAP_SIZE];
+extern uint8_t   map_dirty[(CONFIG_SYSTEM_SETTINGS_MAP_SIZE + 7) / 8];
+extern bool      map_rewrite;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: getsetting
+ *
+ * Description:
+ *    Gets the setting information from a given key.
+ *
+ * Input Parameters:
+ *    key        - key of the required setting
+ *
+ * Returned Value:
+ *   The setting
+ *
+ ****************************************************************************/
+
+FAR setting_t *getsetting(FAR char *key)
+{
+  int i;
+
+  for (i = 0; i < CONFIG_SYSTEM_SETTINGS_MAP_SIZE; i++)
+    {
+      FAR setting_t *setting = &map[i];
+
+      if (strcmp(key, setting->key) == 0)
+        {
+          return setting;
+        }
+
+      if (setting->type == SETTING_EMPTY)
+        {
+          return setting;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: write_all
+ *
+ * Description:
+ *    Writes a buffer, retrying short writes.
+ *
+ * Input Parameters:
+ *    fd               - the file to write to
+ *    buf              - the data
+ *    len              - the data length
+ *
+ * Returned Value:
+ *   Success or negated failure code
+ *
+ ****************************************************************************/
+
+static int write_all(int fd, FAR const void *buf, size_t len)
+{
+  FAR const uint8_t *ptr = buf;
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = write(fd, ptr, len);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      ptr += ret;
+      len -= ret;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: compact
+ *
+ * Description:
+ *    Writes all settings to a backup journal and replaces the old one with
+ *    it. If power is lost in between, load_journal() restores the backup.
+ *
+ * Input Parameters:
+ *    file             - the filename of the storage to use
+ *    count            - number of used settings in the map
+ *
+ * Returned Value:
+ *   Success or negated failure code
+ *
+ ****************************************************************************/
+
+static int compact(FAR char *file, int count)
+{
+  char backup_file[CONFIG_SYSTEM_SETTINGS_MAX_FILENAME +
+                   sizeof(BACKUP_SUFFIX)];
+  struct journal_hdr_s hdr;
+  FAR struct journal_rec_s *recs;
+  int fd;
+  int i;
+  int ret;
+
+  recs = malloc(count * sizeof(struct journal_rec_s) + 1);
+  if (recs == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      memcpy(&recs[i].setting, &map[i], sizeof(setting_t));
+      recs[i].crc = crc32((FAR uint8_t *)&map[i], sizeof(setting_t));
+    }
+
+  snprintf(backup_file, sizeof(backup_file), "%s" BACKUP_SUFFIX, file);
+
+  fd = open(backup_file, (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+  if (fd < 0)
+    {
+      ret = -ENODEV;
+      goto abort;
+    }
+
+  hdr.valid = VALID;
+  hdr.size  = sizeof(setting_t);
+
+  ret = write_all(fd, &hdr, sizeof(hdr));
+  if (ret >= 0)
+    {
+      ret = write_all(fd, recs, count * sizeof(struct journal_rec_s));
+    }
+
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
+
+  close(fd);
+
+  if (ret >= 0)
+    {
+      remove(file);
+      if (rename(backup_file, file) < 0)
+        {
+          ret = -errno;
+        }
+    }
+
+  if (ret < 0)
+    {
+      unlink(backup_file);
+      g_records = -1;
+      goto abort;
+    }
+
+  strlcpy(g_file, file, sizeof(g_file));
+  g_records = count;
+
+abort:
+  free(recs);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: load_journal
+ *
+ * Description:
+ *    Loads settings from a journal file. Records are replayed in order up
+ *    to the first damaged one; a torn tail left by an interrupted append is
+ *    cut off, so that the next append follows the last good record.
+ *
+ * Input Parameters:
+ *    file             - the filename of the storage to use
+ *
+ * Returned Value:
+ *   Success or negated failure code
+ *
+ ****************************************************************************/
+
+int load_journal(FAR char *file)
+{
+  char backup_file[CONFIG_SYSTEM_SETTINGS_MAX_FILENAME +
+                   sizeof(BACKUP_SUFFIX)];
+  struct journal_hdr_s hdr;
+  struct journal_rec_s rec;
+  FAR setting_t *slot;
+  off_t          end;
+  int            fd;
+  int            ret = OK;
+  int            n = 0;
+
+  g_records = -1;
+
+  /* Check that the file exists, if not restore the backup left by an
+   * interrupted compaction.
+   */
+
+  if (access(file, F_OK) != 0)
+    {
+      snprintf(backup_file, sizeof(backup_file), "%s" BACKUP_SUFFIX, file);
+      if (access(backup_file, F_OK) == 0)
+        {
+          rename(backup_file, file);
+        }
+    }
+
+  fd = open(file, O_RDWR);
+  if (fd < 0)
+    {
+      return -ENOENT;
+    }
+
+  if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) || hdr.valid != VALID ||
+      hdr.size != sizeof(setting_t))
+    {
+      ret = -EBADMSG;
+      goto abort; /* Just exit - the settings aren't valid */
+    }
+
+  while (read(fd, &rec, sizeof(rec)) == sizeof(rec))
+    {
+      if (crc32((FAR uint8_t *)&rec.setting, sizeof(setting_t)) != rec.crc)
+        {
+          break;
+        }
+
+      n++;
+
+      rec.setting.key[CONFIG_SYSTEM_SETTINGS_KEY_SIZE - 1] = '\0';
+      if (rec.setting.type == SETTING_EMPTY)
+        {
+          continue;
+        }
+
+      slot = getsetting(rec.setting.key);
+      if (slot == NULL)
+        {
+          continue;
+        }
+
+      memcpy(slot, &rec.setting, sizeof(setting_t));
+    }
+
+  end = sizeof(hdr) + n * sizeof(rec);
+  if (lseek(fd, 0, SEEK_END) != end)
+    {
+      ftruncate(fd, end);
+    }
+
+  strlcpy(g_file, file, sizeof(g_file));
+  g_records = n;
+
+abort:
+  close(fd);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: save_journal
+ *
+ * Description:
+ *    Appends the settings changed since the last save to a journal file,
+ *    in a single write. The journal is compacted instead when it has grown
+ *    CONFIG_SYSTEM_SETTINGS_JOURNAL_SLACK records past the number of
+ *    settings, or when the whole map has to be written.
+ *
+ * Input Parameters:
+ *    file             - the filename of the storage to use
+ *
+ * Returned Value:
+ *   Success or negated failure code
+ *
+ ****************************************************************************/
+
+int save_journal(FAR char *file)
+{
+  FAR struct journal_rec_s *recs;
+  off_t end;
+  int   count;
+  int   ndirty;
+  int   fd;
+  int   i;
+  int   ret;
+
+  count  = 0;
+  ndirty = 0;
+  for (i = 0; i < CONFIG_SYSTEM_SETTINGS_MAP_SIZE; i++)
+    {
+      if (map[i].type == SETTING_EMPTY)
+        {
+          break;
+        }
+
+      if (map_dirty[i / 8] & (1 << (i % 8)))
+        {
+          ndirty++;
+        }
+
+      count++;
+    }
+
+  if (map_rewrite || g_records < 0 || strcmp(g_file, file) != 0 ||
+      g_records + ndirty > count + CONFIG_SYSTEM_SETTINGS_JOURNAL_SLACK)
+    {
+      return compact(file, count);
+    }
+
+  if (ndirty == 0)
+    {
+      return OK;
+    }
+
+  recs = malloc(ndirty * sizeof(struct journal_rec_s));
+  if (recs == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ndirty = 0;
+  for (i = 0; i < count; i++)
+    {
+      if (map_dirty[i / 8] & (1 << (i % 8)))
+        {
+          memcpy(&recs[ndirty].setting, &map[i], sizeof(setting_t));
+          recs[ndirty].crc = crc32((FAR uint8_t *)&map[i],
+                                   sizeof(setting_t));
+          ndirty++;
+        }
+    }
+
+  fd = open(file, O_WRONLY);
+  if (fd < 0)
+    {
+      ret = -ENODEV;
+      goto abort;
+    }
+
+  /* Append right after the last known record */
+
+  end = sizeof(struct journal_hdr_s) +
+        g_records * sizeof(struct journal_rec_s);
+  if (lseek(fd, end, SEEK_SET) != end)
+    {
+      ret = -EIO;
+    }
+  else
+    {
+      ret = write_all(fd, recs, ndirty * sizeof(struct journal_rec_s));
+    }
+
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
+
+  close(fd);
+
+  if (ret >= 0)
+    {
+      g_records += ndirty;
+    }
+  else
+    {
+      /* The file is in an unknown state, rewrite it next time */
+
+      g_records = -1;
+    }
+
+abort:
+  free(recs);
+  return ret;
+}
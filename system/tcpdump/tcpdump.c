@@ -26,13 +26,22 @@
 
 #include <nuttx/config.h>
 
+#include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <net/if.h>
 #include <net/if_arp.h>
+#include <netinet/in.h>
 #include <netpacket/packet.h>
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+#include <pthread.h>
+#endif
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -57,6 +66,24 @@
 #define LINKTYPE_ETHERNET 1   /* IEEE 802.3 Ethernet */
 #define LINKTYPE_RAW      101 /* Raw IP */
 
+/* Filter protocols, IPPROTO_* values or one of these */
+
+#define FILTER_ANY        -1
+#define FILTER_ARP        256
+
+#define ETHTYPE_IP        0x0800
+#define ETHTYPE_ARP       0x0806
+#define ETHTYPE_VLAN      0x8100
+#define ETHTYPE_IPV6      0x86dd
+
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+/* Room reserved in the ring for one packet, the read() buffer must hold a
+ * whole packet to get its length.
+ */
+
+#  define RING_SLOT (sizeof(struct pcap_pkthdr_s) + MAX_NETDEV_PKTSIZE)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -85,17 +112,63 @@ struct tcpdump_args_s
   FAR struct arg_str *interface;
   FAR struct arg_str *file;
   FAR struct arg_int *snaplen;
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+  FAR struct arg_int *bufsize;
+#endif
+  FAR struct arg_str *proto;
+  FAR struct arg_int *port;
+  FAR struct arg_str *host;
   FAR struct arg_end *end;
 };
 
+struct tcpdump_filter_s
+{
+  int      proto;          /* IPPROTO_*, FILTER_ARP or FILTER_ANY */
+  int      port;           /* TCP or UDP port, FILTER_ANY for all */
+  int      addrlen;        /* 4 or 16 to match an address, 0 for all */
+  uint8_t  addr[16];       /* Source or destination address */
+};
+
 struct tcpdump_cfgs_s
 {
   int fd;
   int sd;
   uint32_t snaplen;
   uint32_t linktype;
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+  size_t bufsize;          /* Ring size in bytes */
+#endif
+  struct tcpdump_filter_s filter;
+  unsigned long captured;  /* Packets stored */
+  unsigned long filtered;  /* Packets rejected by the filter */
+  unsigned long dropped;   /* Packets lost for lack of ring space */
 };
 
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+/* Packets are stored in the ring as pcap records.  The capture thread adds
+ * records at head, the writer thread writes the records from tail to head
+ * in one write().  When a record does not fit before the end of the ring,
+ * the capture thread wraps to the start and the writer stops at end.
+ */
+
+struct tcpdump_ring_s
+{
+  FAR const struct tcpdump_cfgs_s *cfgs;
+  FAR uint8_t    *buf;
+  size_t          size;
+  size_t          head;    /* Next record is added here */
+  size_t          tail;    /* Next byte to write */
+  size_t          end;     /* End of the records before a wrap */
+  size_t          pending; /* Bytes not written yet */
+  size_t          batch;   /* Bytes that wake up the writer */
+  bool            wrapped; /* head has wrapped, tail not yet */
+  bool            done;    /* Capture ended, flush and exit */
+  int             error;   /* Write error of the writer thread */
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -235,11 +308,479 @@ static uint32_t get_linktype(FAR const char *ifname)
   return ret;
 }
 
+/****************************************************************************
+ * Name: parse_filter
+ ****************************************************************************/
+
+static int parse_filter(FAR const struct tcpdump_args_s *args,
+                        FAR struct tcpdump_filter_s *filter)
+{
+  filter->proto   = FILTER_ANY;
+  filter->port    = FILTER_ANY;
+  filter->addrlen = 0;
+
+  if (args->proto->count > 0)
+    {
+      FAR const char *proto = args->proto->sval[0];
+
+      if (strcasecmp(proto, "tcp") == 0)
+        {
+          filter->proto = IPPROTO_TCP;
+        }
+      else if (strcasecmp(proto, "udp") == 0)
+        {
+          filter->proto = IPPROTO_UDP;
+        }
+      else if (strcasecmp(proto, "icmp") == 0)
+        {
+          filter->proto = IPPROTO_ICMP;
+        }
+      else if (strcasecmp(proto, "icmp6") == 0)
+        {
+          filter->proto = IPPROTO_ICMPV6;
+        }
+      else if (strcasecmp(proto, "arp") == 0)
+        {
+          filter->proto = FILTER_ARP;
+        }
+      else
+        {
+          printf("Unknown protocol %s\n", proto);
+          return -EINVAL;
+        }
+    }
+
+  if (args->port->count > 0)
+    {
+      filter->port = *args->port->ival;
+      if (filter->port < 0 || filter->port > 65535)
+        {
+          printf("Invalid port %d\n", filter->port);
+          return -EINVAL;
+        }
+    }
+
+  if (args->host->count > 0)
+    {
+      if (inet_pton(AF_INET, args->host->sval[0], filter->addr) == 1)
+        {
+          filter->addrlen = 4;
+        }
+      else if (inet_pton(AF_INET6, args->host->sval[0], filter->addr) == 1)
+        {
+          filter->addrlen = 16;
+        }
+      else
+        {
+          printf("Invalid address %s\n", args->host->sval[0]);
+          return -EINVAL;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: filter_packet
+ *
+ * Description:
+ *   Return true if the packet matches the filter.  Only the fixed IPv4 and
+ *   IPv6 headers are decoded, a port filter rejects fragments and packets
+ *   behind IPv6 extension headers.
+ *
+ ****************************************************************************/
+
+static bool filter_packet(FAR const struct tcpdump_cfgs_s *cfgs,
+                          FAR const uint8_t *pkt, size_t len)
+{
+  FAR const struct tcpdump_filter_s *filter = &cfgs->filter;
+  FAR const uint8_t *src;
+  FAR const uint8_t *dst;
+  FAR const uint8_t *l4;
+  uint16_t type;
+  size_t addrlen;
+  int proto;
+
+  if (filter->proto == FILTER_ANY && filter->port == FILTER_ANY &&
+      filter->addrlen == 0)
+    {
+      return true;
+    }
+
+  /* Find the network layer */
+
+  if (cfgs->linktype == LINKTYPE_ETHERNET)
+    {
+      if (len < 14)
+        {
+          return false;
+        }
+
+      type = (pkt[12] << 8) | pkt[13];
+      pkt += 14;
+      len -= 14;
+
+      if (type == ETHTYPE_VLAN && len >= 4)
+        {
+          type = (pkt[2] << 8) | pkt[3];
+          pkt += 4;
+          len -= 4;
+        }
+    }
+  else if (len > 0)
+    {
+      type = (pkt[0] >> 4) == 6 ? ETHTYPE_IPV6 : ETHTYPE_IP;
+    }
+  else
+    {
+      return false;
+    }
+
+  if (type == ETHTYPE_ARP)
+    {
+      return filter->proto == FILTER_ARP && filter->port == FILTER_ANY &&
+             filter->addrlen == 0;
+    }
+  else if (type == ETHTYPE_IP && len >= 20 && (pkt[0] >> 4) == 4)
+    {
+      proto   = pkt[9];
+      src     = pkt + 12;
+      dst     = pkt + 16;
+      addrlen = 4;
+
+      /* Ports are only in the first fragment */
+
+      l4 = (((pkt[6] << 8) | pkt[7]) & 0x1fff) == 0 ?
+           pkt + (pkt[0] & 0x0f) * 4 : NULL;
+    }
+  else if (type == ETHTYPE_IPV6 && len >= 40)
+    {
+      proto   = pkt[6];
+      src     = pkt + 8;
+      dst     = pkt + 24;
+      addrlen = 16;
+      l4      = pkt + 40;
+    }
+  else
+    {
+      return false;
+    }
+
+  if (filter->proto != FILTER_ANY && filter->proto != proto)
+    {
+      return false;
+    }
+
+  if (filter->addrlen != 0 &&
+      (filter->addrlen != addrlen ||
+       (memcmp(src, filter->addr, addrlen) != 0 &&
+        memcmp(dst, filter->addr, addrlen) != 0)))
+    {
+      return false;
+    }
+
+  if (filter->port != FILTER_ANY)
+    {
+      if ((proto != IPPROTO_TCP && proto != IPPROTO_UDP) || l4 == NULL ||
+          l4 + 4 > pkt + len)
+        {
+          return false;
+        }
+
+      if (((l4[0] << 8) | l4[1]) != filter->port &&
+          ((l4[2] << 8) | l4[3]) != filter->port)
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+/****************************************************************************
+ * Name: ring_writer
+ *
+ * Description:
+ *   Write the pending records in batches of at least ring->batch bytes,
+ *   CONFIG_SYSTEM_TCPDUMP_BATCH but no more than half of the ring, or
+ *   whatever is pending once CONFIG_SYSTEM_TCPDUMP_FLUSH_MS have passed.
+ *
+ ****************************************************************************/
+
+static FAR void *ring_writer(FAR void *arg)
+{
+  FAR struct tcpdump_ring_s *ring = arg;
+  FAR const uint8_t *ptr;
+  struct timespec abstime;
+  ssize_t nwritten;
+  size_t len;
+
+  pthread_mutex_lock(&ring->lock);
+  for (; ; )
+    {
+      if (ring->pending < ring->batch && !ring->done)
+        {
+          clock_gettime(CLOCK_REALTIME, &abstime);
+          abstime.tv_sec  += CONFIG_SYSTEM_TCPDUMP_FLUSH_MS / 1000;
+          abstime.tv_nsec += (CONFIG_SYSTEM_TCPDUMP_FLUSH_MS % 1000) *
+                             1000000;
+          if (abstime.tv_nsec >= 1000000000)
+            {
+              abstime.tv_sec++;
+              abstime.tv_nsec -= 1000000000;
+            }
+
+          while (ring->pending < ring->batch &&
+                 !ring->done)
+            {
+              if (pthread_cond_timedwait(&ring->cond, &ring->lock,
+                                         &abstime) == ETIMEDOUT)
+                {
+                  break;
+                }
+            }
+        }
+
+      if (ring->pending == 0)
+        {
+          if (ring->done)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      /* Write the records up to head, or up to end if head has wrapped */
+
+      ptr = ring->buf + ring->tail;
+      len = (ring->wrapped ? ring->end : ring->head) - ring->tail;
+      pthread_mutex_unlock(&ring->lock);
+
+      while (len > 0)
+        {
+          nwritten = write(ring->cfgs->fd, ptr, len);
+          if (nwritten < 0)
+            {
+              if (errno == EINTR)
+                {
+                  continue;
+                }
+
+              perror("ERROR: write() failed");
+              pthread_mutex_lock(&ring->lock);
+              ring->error = -errno;
+              pthread_mutex_unlock(&ring->lock);
+              return NULL;
+            }
+
+          pthread_mutex_lock(&ring->lock);
+          ring->tail    += nwritten;
+          ring->pending -= nwritten;
+          if (ring->wrapped && ring->tail == ring->end)
+            {
+              ring->tail    = 0;
+              ring->wrapped = false;
+            }
+
+          pthread_mutex_unlock(&ring->lock);
+
+          ptr += nwritten;
+          len -= nwritten;
+        }
+
+      pthread_mutex_lock(&ring->lock);
+    }
+
+  pthread_mutex_unlock(&ring->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ring_reserve
+ *
+ * Description:
+ *   Return room for one record at head, or NULL if the ring is full.  The
+ *   write error of the writer thread is returned in error.
+ *
+ ****************************************************************************/
+
+static FAR uint8_t *ring_reserve(FAR struct tcpdump_ring_s *ring,
+                                 FAR int *error)
+{
+  FAR uint8_t *slot = NULL;
+
+  pthread_mutex_lock(&ring->lock);
+  *error = ring->error;
+
+  /* Restart from the beginning once everything is written */
+
+  if (ring->pending == 0)
+    {
+      ring->head    = 0;
+      ring->tail    = 0;
+      ring->wrapped = false;
+    }
+
+  if (ring->wrapped)
+    {
+      if (ring->head + RING_SLOT <= ring->tail)
+        {
+          slot = ring->buf + ring->head;
+        }
+    }
+  else if (ring->head + RING_SLOT <= ring->size)
+    {
+      slot = ring->buf + ring->head;
+    }
+  else if (RING_SLOT <= ring->tail)
+    {
+      ring->end     = ring->head;
+      ring->head    = 0;
+      ring->wrapped = true;
+      slot = ring->buf;
+    }
+
+  pthread_mutex_unlock(&ring->lock);
+  return slot;
+}
+
+/****************************************************************************
+ * Name: do_capture_ring
+ ****************************************************************************/
+
+static void do_capture_ring(FAR struct tcpdump_cfgs_s *cfgs)
+{
+  FAR struct pcap_pkthdr_s *hdr;
+  struct tcpdump_ring_s ring;
+  FAR uint8_t *scratch;
+  FAR uint8_t *slot;
+  struct timespec ts;
+  pthread_t writer;
+  ssize_t len;
+  size_t reclen;
+  int error = 0;
+  int ret;
+
+  memset(&ring, 0, sizeof(ring));
+  ring.cfgs = cfgs;
+  ring.size = MAX(cfgs->bufsize, 2 * RING_SLOT);
+
+  /* A small ring must be written well before it fills up */
+
+  ring.batch = MIN(CONFIG_SYSTEM_TCPDUMP_BATCH, ring.size / 2);
+  ring.buf  = malloc(ring.size);
+  scratch   = malloc(MAX_NETDEV_PKTSIZE);
+  if (ring.buf == NULL || scratch == NULL)
+    {
+      printf("Failed to allocate a %zu bytes ring\n", ring.size);
+      goto errout;
+    }
+
+  pthread_mutex_init(&ring.lock, NULL);
+  pthread_cond_init(&ring.cond, NULL);
+
+  ret = pthread_create(&writer, NULL, ring_writer, &ring);
+  if (ret != 0)
+    {
+      printf("Failed to create the writer: %d\n", ret);
+      goto errout_with_lock;
+    }
+
+  /* Packets are read straight into the ring, a packet that does not fit
+   * is read into the scratch buffer and dropped if it passes the filter.
+   */
+
+  for (; ; )
+    {
+      slot = ring_reserve(&ring, &error);
+      if (slot == NULL)
+        {
+          len = read(cfgs->sd, scratch, MAX_NETDEV_PKTSIZE);
+        }
+      else
+        {
+          len = read(cfgs->sd, slot + sizeof(struct pcap_pkthdr_s),
+                     MAX_NETDEV_PKTSIZE);
+        }
+
+      if (len < 0 || g_exiting || error < 0)
+        {
+          break;
+        }
+
+      if (len == 0)
+        {
+          continue;
+        }
+
+      if (!filter_packet(cfgs, slot != NULL ?
+                         slot + sizeof(struct pcap_pkthdr_s) : scratch, len))
+        {
+          cfgs->filtered++;
+          continue;
+        }
+
+      if (slot == NULL)
+        {
+          cfgs->dropped++;
+          continue;
+        }
+
+      if (clock_gettime(CLOCK_REALTIME, &ts) < 0)
+        {
+          perror("ERROR: clock_gettime() failed");
+          break;
+        }
+
+      hdr = (FAR struct pcap_pkthdr_s *)slot;
+      hdr->ts_sec  = ts.tv_sec;
+      hdr->ts_nsec = ts.tv_nsec;
+      hdr->caplen  = MIN(cfgs->snaplen, len);
+      hdr->len     = len;
+      reclen       = sizeof(struct pcap_pkthdr_s) + hdr->caplen;
+
+      pthread_mutex_lock(&ring.lock);
+      ring.head    += reclen;
+      ring.pending += reclen;
+      if (ring.pending >= ring.batch)
+        {
+          pthread_cond_signal(&ring.cond);
+        }
+
+      pthread_mutex_unlock(&ring.lock);
+      cfgs->captured++;
+    }
+
+  if (!g_exiting && error == 0)
+    {
+      perror("ERROR: read() failed");
+    }
+
+  /* Flush what is left */
+
+  pthread_mutex_lock(&ring.lock);
+  ring.done = true;
+  pthread_cond_signal(&ring.cond);
+  pthread_mutex_unlock(&ring.lock);
+  pthread_join(writer, NULL);
+
+errout_with_lock:
+  pthread_cond_destroy(&ring.cond);
+  pthread_mutex_destroy(&ring.lock);
+
+errout:
+  free(scratch);
+  free(ring.buf);
+}
+#endif
+
 /****************************************************************************
  * Name: do_capture
  ****************************************************************************/
 
-static void do_capture(FAR const struct tcpdump_cfgs_s *cfgs)
+static void do_capture(FAR struct tcpdump_cfgs_s *cfgs)
 {
   ssize_t len;
   uint8_t buf[MAX_NETDEV_PKTSIZE];
@@ -252,6 +793,14 @@ static void do_capture(FAR const struct tcpdump_cfgs_s *cfgs)
       return;
     }
 
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+  if (cfgs->bufsize > 0)
+    {
+      do_capture_ring(cfgs);
+      return;
+    }
+#endif
+
   /* Dump packets */
 
   while ((len = read(cfgs->sd, buf, sizeof(buf))) >= 0 && !g_exiting)
@@ -261,6 +810,12 @@ static void do_capture(FAR const struct tcpdump_cfgs_s *cfgs)
           continue;
         }
 
+      if (!filter_packet(cfgs, buf, len))
+        {
+          cfgs->filtered++;
+          continue;
+        }
+
       if (clock_gettime(CLOCK_REALTIME, &ts) < 0)
         {
           perror("ERROR: clock_gettime() failed");
@@ -271,6 +826,8 @@ static void do_capture(FAR const struct tcpdump_cfgs_s *cfgs)
         {
           return;
         }
+
+      cfgs->captured++;
     }
 
   if (!g_exiting)
@@ -297,7 +854,17 @@ int main(int argc, FAR char *argv[])
   args.file      = arg_str1("w", NULL, "file", "Path to dump file");
   args.snaplen   = arg_int0("s", "snapshot-length", "snaplen",
                             "Max dump length of each packet");
-  args.end       = arg_end(3);
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+  args.bufsize   = arg_int0("B", "buffer-size", "KiB",
+                            "Capture ring size, at least 1");
+#endif
+  args.proto     = arg_str0("p", "proto", "tcp|udp|icmp|icmp6|arp",
+                            "Capture this protocol only");
+  args.port      = arg_int0(NULL, "port", "port",
+                            "Capture this TCP or UDP port only");
+  args.host      = arg_str0(NULL, "host", "address",
+                            "Capture this source or destination only");
+  args.end       = arg_end(8);
 
   nerrors = arg_parse(argc, argv, (FAR void**)&args);
   if (nerrors != 0)
@@ -308,6 +875,30 @@ int main(int argc, FAR char *argv[])
       goto out;
     }
 
+  memset(&cfgs, 0, sizeof(cfgs));
+  if (parse_filter(&args, &cfgs.filter) < 0)
+    {
+      goto out;
+    }
+
+#ifdef CONFIG_SYSTEM_TCPDUMP_RING
+  if (args.bufsize->count > 0)
+    {
+      if (*args.bufsize->ival <= 0 ||
+          (size_t)*args.bufsize->ival > SIZE_MAX / 1024)
+        {
+          printf("Invalid buffer size %d\n", *args.bufsize->ival);
+          goto out;
+        }
+
+      cfgs.bufsize = *args.bufsize->ival * 1024;
+    }
+  else
+    {
+      cfgs.bufsize = CONFIG_SYSTEM_TCPDUMP_RINGSIZE * 1024;
+    }
+#endif
+
   ifindex = if_nametoindex(args.interface->sval[0]);
   if (ifindex == 0)
     {
@@ -342,6 +933,9 @@ int main(int argc, FAR char *argv[])
 
   do_capture(&cfgs);
 
+  printf("%lu packets captured, %lu filtered, %lu dropped\n",
+         cfgs.captured, cfgs.filtered, cfgs.dropped);
+
   close(cfgs.sd);
   close(cfgs.fd);
 
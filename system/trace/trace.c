@@ -221,6 +221,75 @@ static int trace_cmd_dump(FAR const char *name, int index, int argc,
 }
 #endif
 
+/****************************************************************************
+ * Name: trace_cmd_stat
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSTEM_TRACE_STAT
+static int trace_cmd_stat(FAR const char *name, int index, int argc,
+                          FAR char **argv, int notectlfd)
+{
+  FAR char *endptr;
+  bool changed = false;
+  bool cont = false;
+  int top = 10;
+  int ret;
+
+  /* Usage: trace stat [-c][<top>] */
+
+  if (index < argc)
+    {
+      if (strcmp(argv[index], "-c") == 0)
+        {
+          cont = true;
+          index++;
+        }
+    }
+
+  if (index < argc)
+    {
+      top = strtol(argv[index], &endptr, 0);
+      if (*endptr == '\0')
+        {
+          if (top <= 0 || top > TRACE_STAT_MAXTOP)
+            {
+              fprintf(stderr, "trace stat: <top> must be 1..%d\n",
+                      TRACE_STAT_MAXTOP);
+              return ERROR;
+            }
+
+          index++;
+        }
+      else
+        {
+          top = 10;
+        }
+    }
+
+  /* Stop the tracing before reading the notes */
+
+  if (!cont)
+    {
+      changed = notectl_enable(name, false, notectlfd);
+    }
+
+  ret = trace_stat(stdout, top);
+
+  if (changed)
+    {
+      notectl_enable(name, true, notectlfd);
+    }
+
+  if (ret < 0)
+    {
+      fprintf(stderr, "trace stat: analysis failed\n");
+      return ERROR;
+    }
+
+  return index;
+}
+#endif
+
 /****************************************************************************
  * Name: trace_cmd_cmd
  ****************************************************************************/
@@ -806,6 +875,10 @@ static void show_usage(void)
           " dump    [-a][-c][<filename>]        :"
                                 " Output the trace result\n"
           "                                       [-a] <Android SysTrace>\n"
+#endif
+#ifdef CONFIG_SYSTEM_TRACE_STAT
+          " stat    [-c][<top>]                 :"
+                                " Summarize run time and latencies\n"
 #endif
           " mode    [{+|-}{o|w|s|a|i|d}...]     :"
                                 " Set task trace options\n"
@@ -886,6 +959,12 @@ int main(int argc, FAR char *argv[])
           i = trace_cmd_dump(name, i + 1, argc, argv, notectlfd);
         }
 #endif
+#ifdef CONFIG_SYSTEM_TRACE_STAT
+      else if (strcmp(argv[i], "stat") == 0)
+        {
+          i = trace_cmd_stat(name, i + 1, argc, argv, notectlfd);
+        }
+#endif
 #ifdef CONFIG_SYSTEM_SYSTEM
       else if (strcmp(argv[i], "cmd") == 0)
         {
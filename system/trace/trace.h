@@ -39,6 +39,12 @@ extern "C"
 #define EXTERN extern
 #endif
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TRACE_STAT_MAXTOP 32    /* Maximum entries of a trace stat report */
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -89,6 +95,21 @@ bool trace_dump_get_overwrite(void);
 
 void trace_dump_set_overwrite(bool mode);
 
+#ifdef CONFIG_SYSTEM_TRACE_STAT
+
+/****************************************************************************
+ * Name: trace_stat
+ *
+ * Description:
+ *   Read notes and print per-task run time, latency distributions and the
+ *   longest critical sections, top entries of each table only.
+ *
+ ****************************************************************************/
+
+int trace_stat(FAR FILE *out, int top);
+
+#endif /* CONFIG_SYSTEM_TRACE_STAT */
+
 #else /* CONFIG_DRIVERS_NOTERAM */
 
 #define trace_dump(type,out)
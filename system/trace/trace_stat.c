@@ -0,0 +1,783 @@
+/****************************************************************************
+ * apps/system/trace/trace_stat.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+#include <nuttx/arch.h>
+#include <nuttx/clock.h>
+#include <nuttx/sched.h>
+#include <nuttx/sched_note.h>
+#include <nuttx/note/noteram_driver.h>
+
+#include <sys/ioctl.h>
+#include <sys/param.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSTEM_TRACE_STAT_NTASKS
+#  define CONFIG_SYSTEM_TRACE_STAT_NTASKS 32
+#endif
+
+#ifndef CONFIG_SYSTEM_TRACE_STAT_BUFSIZE
+#  define CONFIG_SYSTEM_TRACE_STAT_BUFSIZE 2048
+#endif
+
+#ifdef CONFIG_SMP
+#  define TRACE_NCPUS           CONFIG_SMP_NCPUS
+#  define TRACE_CPU(n)          ((n)->nc_cpu)
+#else
+#  define TRACE_NCPUS           1
+#  define TRACE_CPU(n)          0
+#endif
+
+#define TRACE_BUCKETS           20  /* Log2 buckets, last is >= 2^18us */
+#define TRACE_NIRQS             32  /* Distinct IRQs accounted */
+#define TRACE_IRQ_DEPTH         4   /* Nested IRQs tracked per CPU */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct trace_hist_s
+{
+  unsigned long count;
+  uint64_t      total;
+  uint32_t      max;
+  unsigned long hist[TRACE_BUCKETS];
+};
+
+struct trace_sum_s
+{
+  unsigned long count;
+  uint64_t      total;
+  uint32_t      max;
+};
+
+struct trace_task_s
+{
+  pid_t         pid;
+  char          name[CONFIG_TASK_NAME_SIZE + 1];
+  uint64_t      runtime;                /* Accumulated run time */
+  unsigned long switches;               /* Times switched in */
+  uint64_t      ready;                  /* Preempted at, 0 if not ready */
+  uint64_t      sysenter;               /* Syscall entered at */
+  int           sysnr;                  /* Syscall in progress, or -1 */
+};
+
+struct trace_cpu_s
+{
+  FAR struct trace_task_s *running;     /* Task running on the CPU */
+  uint64_t      since;                  /* Switched in at */
+  int           irqdepth;
+  uint64_t      irqsince[TRACE_IRQ_DEPTH];
+  int           irq[TRACE_IRQ_DEPTH];
+  uint64_t      cssince;                /* Critical section entered at */
+  pid_t         cspid;                  /* Owner, -1 if not in one */
+};
+
+struct trace_cs_s
+{
+  uint32_t      duration;
+  uint64_t      start;
+  pid_t         pid;
+};
+
+struct trace_irq_s
+{
+  int           irq;
+  struct trace_sum_s sum;
+};
+
+struct trace_stat_s
+{
+  uint64_t      first;
+  uint64_t      last;
+  uint64_t      ticks;                  /* Note time, extended to 64 bit */
+  clock_t       systime;                /* Raw time of the previous note */
+  unsigned long nnotes;
+  unsigned long untracked;              /* Tasks beyond the task table */
+#ifdef CONFIG_SCHED_INSTRUMENTATION_PERFCOUNT
+  uint64_t      freq;
+#endif
+  int           ntasks;
+  int           nirqs;
+  int           ncs;
+  int           top;
+  struct trace_task_s tasks[CONFIG_SYSTEM_TRACE_STAT_NTASKS];
+  struct trace_cpu_s  cpus[TRACE_NCPUS];
+  struct trace_hist_s wakeup;
+  struct trace_hist_s irqlat;
+  struct trace_hist_s syslat;
+  struct trace_irq_s  irqs[TRACE_NIRQS];
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  struct trace_sum_s  sys[SYS_nsyscalls];
+#endif
+  struct trace_cs_s   cs[TRACE_STAT_MAXTOP];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: trace_stat_time
+ *
+ * Description:
+ *   Timestamp of a note in us.  The raw time may be a 32-bit counter that
+ *   wraps within seconds, so it is extended to 64 bits by accumulating the
+ *   distance to the previous note, computed in the counter's own width.
+ *   Notes from other CPUs may be slightly older than the previous one.
+ *
+ ****************************************************************************/
+
+static uint64_t trace_stat_time(FAR struct trace_stat_s *stat,
+                                FAR const struct note_common_s *note)
+{
+  clock_t delta = note->nc_systime - stat->systime;
+  uint64_t ticks;
+
+  if (stat->nnotes == 0 || delta <= (clock_t)-1 / 2)
+    {
+      stat->ticks   = stat->nnotes == 0 ? note->nc_systime :
+                                          stat->ticks + delta;
+      stat->systime = note->nc_systime;
+      ticks         = stat->ticks;
+    }
+  else
+    {
+      ticks = stat->ticks - (clock_t)(stat->systime - note->nc_systime);
+    }
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_PERFCOUNT
+  return ticks / stat->freq * 1000000ull +
+         ticks % stat->freq * 1000000ull / stat->freq;
+#else
+  return TICK2USEC(ticks);
+#endif
+}
+
+/****************************************************************************
+ * Name: trace_stat_add
+ *
+ * Description:
+ *   Account a duration in a histogram: bucket 0 holds 0us, bucket n holds
+ *   [2^(n-1), 2^n) us.
+ *
+ ****************************************************************************/
+
+static void trace_stat_add(FAR struct trace_hist_s *hist, uint64_t value)
+{
+  uint64_t v = value;
+  int bucket = 0;
+
+  while (v != 0 && bucket < TRACE_BUCKETS - 1)
+    {
+      v >>= 1;
+      bucket++;
+    }
+
+  hist->hist[bucket]++;
+  hist->count++;
+  hist->total += value;
+  hist->max    = MAX(hist->max, (uint32_t)MIN(value, UINT32_MAX));
+}
+
+static void trace_stat_sum(FAR struct trace_sum_s *sum, uint64_t value)
+{
+  sum->count++;
+  sum->total += value;
+  sum->max    = MAX(sum->max, (uint32_t)MIN(value, UINT32_MAX));
+}
+
+/****************************************************************************
+ * Name: trace_stat_percentile
+ *
+ * Description:
+ *   Upper bound of the bucket holding the given percentile, in us.
+ *
+ ****************************************************************************/
+
+static unsigned long
+trace_stat_percentile(FAR const struct trace_hist_s *hist,
+                      unsigned int percent)
+{
+  unsigned long target = (hist->count * percent + 99) / 100;
+  unsigned long count = 0;
+  int i;
+
+  for (i = 0; i < TRACE_BUCKETS; i++)
+    {
+      count += hist->hist[i];
+      if (count >= target)
+        {
+          break;
+        }
+    }
+
+  return i == 0 ? 0 : 1ul << MIN(i, TRACE_BUCKETS - 1);
+}
+
+/****************************************************************************
+ * Name: trace_stat_task
+ *
+ * Description:
+ *   Find or add the task entry of a pid.  NULL once the table is full.
+ *
+ ****************************************************************************/
+
+static FAR struct trace_task_s *
+trace_stat_task(FAR struct trace_stat_s *stat, pid_t pid)
+{
+  FAR struct trace_task_s *task;
+  int i;
+
+  for (i = 0; i < stat->ntasks; i++)
+    {
+      if (stat->tasks[i].pid == pid)
+        {
+          return &stat->tasks[i];
+        }
+    }
+
+  if (stat->ntasks >= CONFIG_SYSTEM_TRACE_STAT_NTASKS)
+    {
+      stat->untracked++;
+      return NULL;
+    }
+
+  task = &stat->tasks[stat->ntasks++];
+  task->pid   = pid;
+  task->sysnr = -1;
+  return task;
+}
+
+/****************************************************************************
+ * Name: trace_stat_cs
+ *
+ * Description:
+ *   Keep the stat->top longest critical sections, longest first.
+ *
+ ****************************************************************************/
+
+static void trace_stat_cs(FAR struct trace_stat_s *stat, pid_t pid,
+                          uint64_t start, uint64_t end)
+{
+  uint32_t duration = MIN(end - start, UINT32_MAX);
+  int i;
+
+  for (i = stat->ncs; i > 0 && stat->cs[i - 1].duration < duration; i--)
+    {
+      if (i < stat->top)
+        {
+          stat->cs[i] = stat->cs[i - 1];
+        }
+    }
+
+  if (i < stat->top)
+    {
+      stat->cs[i].duration = duration;
+      stat->cs[i].start    = start;
+      stat->cs[i].pid      = pid;
+      stat->ncs = MIN(stat->ncs + 1, stat->top);
+    }
+}
+
+/****************************************************************************
+ * Name: trace_stat_switch_out
+ ****************************************************************************/
+
+static void trace_stat_switch_out(FAR struct trace_cpu_s *cpu,
+                                  uint64_t now)
+{
+  if (cpu->running != NULL)
+    {
+      cpu->running->runtime += now - cpu->since;
+      cpu->running = NULL;
+    }
+}
+
+/****************************************************************************
+ * Name: trace_stat_note
+ *
+ * Description:
+ *   Account one note.
+ *
+ ****************************************************************************/
+
+static void trace_stat_note(FAR struct trace_stat_s *stat,
+                            FAR const struct note_common_s *note)
+{
+  FAR struct trace_cpu_s *cpu = &stat->cpus[TRACE_CPU(note)];
+  FAR struct trace_task_s *task;
+  uint64_t now = trace_stat_time(stat, note);
+  int i;
+
+  if (stat->nnotes++ == 0)
+    {
+      stat->first = now;
+    }
+
+  stat->last = now;
+  task = trace_stat_task(stat, note->nc_pid);
+
+  switch (note->nc_type)
+    {
+      case NOTE_START:
+        if (task != NULL)
+          {
+#if CONFIG_TASK_NAME_SIZE > 0
+            FAR const struct note_start_s *start =
+              (FAR const struct note_start_s *)note;
+
+            strlcpy(task->name, start->nst_name,
+                    MIN(sizeof(task->name),
+                        note->nc_length -
+                        offsetof(struct note_start_s, nst_name) + 1));
+#endif
+            task->ready = now;
+          }
+        break;
+
+      case NOTE_STOP:
+        trace_stat_switch_out(cpu, now);
+        break;
+
+      case NOTE_SUSPEND:
+        trace_stat_switch_out(cpu, now);
+        if (task != NULL)
+          {
+            FAR const struct note_suspend_s *suspend =
+              (FAR const struct note_suspend_s *)note;
+
+            /* Only a preempted task is known to be ready, the notes do
+             * not tell when a blocked task is woken up.
+             */
+
+            if (suspend->nsu_state == TSTATE_TASK_READYTORUN ||
+                suspend->nsu_state == TSTATE_TASK_PENDING)
+              {
+                task->ready = now;
+              }
+          }
+        break;
+
+      case NOTE_RESUME:
+        trace_stat_switch_out(cpu, now);
+        if (task != NULL)
+          {
+            if (task->ready != 0)
+              {
+                trace_stat_add(&stat->wakeup, now - task->ready);
+                task->ready = 0;
+              }
+
+            task->switches++;
+            cpu->running = task;
+            cpu->since   = now;
+          }
+        break;
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_IRQHANDLER
+      case NOTE_IRQ_ENTER:
+        if (cpu->irqdepth < TRACE_IRQ_DEPTH)
+          {
+            cpu->irqsince[cpu->irqdepth] = now;
+            cpu->irq[cpu->irqdepth] =
+              ((FAR const struct note_irqhandler_s *)note)->nih_irq;
+          }
+
+        cpu->irqdepth++;
+        break;
+
+      case NOTE_IRQ_LEAVE:
+        if (cpu->irqdepth > 0 && --cpu->irqdepth < TRACE_IRQ_DEPTH)
+          {
+            uint64_t duration = now - cpu->irqsince[cpu->irqdepth];
+
+            trace_stat_add(&stat->irqlat, duration);
+            for (i = 0; i < stat->nirqs; i++)
+              {
+                if (stat->irqs[i].irq == cpu->irq[cpu->irqdepth])
+                  {
+                    break;
+                  }
+              }
+
+            if (i == stat->nirqs && i < TRACE_NIRQS)
+              {
+                stat->irqs[i].irq = cpu->irq[cpu->irqdepth];
+                stat->nirqs++;
+              }
+
+            if (i < stat->nirqs)
+              {
+                trace_stat_sum(&stat->irqs[i].sum, duration);
+              }
+          }
+        break;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+      case NOTE_SYSCALL_ENTER:
+        if (task != NULL)
+          {
+            task->sysnr = ((FAR const struct note_syscall_enter_s *)note)->
+                          nsc_nr - CONFIG_SYS_RESERVED;
+            task->sysenter = now;
+          }
+        break;
+
+      case NOTE_SYSCALL_LEAVE:
+        if (task != NULL && task->sysnr >= 0)
+          {
+            trace_stat_add(&stat->syslat, now - task->sysenter);
+            if (task->sysnr < SYS_nsyscalls)
+              {
+                trace_stat_sum(&stat->sys[task->sysnr], now - task->sysenter);
+              }
+
+            task->sysnr = -1;
+          }
+        break;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_CSECTION
+      case NOTE_CSECTION_ENTER:
+        cpu->cssince = now;
+        cpu->cspid   = note->nc_pid;
+        break;
+
+      case NOTE_CSECTION_LEAVE:
+        if (cpu->cspid >= 0)
+          {
+            trace_stat_cs(stat, cpu->cspid, cpu->cssince, now);
+            cpu->cspid = -1;
+          }
+        break;
+#endif
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: trace_stat_hist
+ ****************************************************************************/
+
+static void trace_stat_hist(FAR FILE *out, FAR const char *title,
+                            FAR const struct trace_hist_s *hist)
+{
+  int i;
+
+  if (hist->count == 0)
+    {
+      return;
+    }
+
+  fprintf(out, "\n%s:\n", title);
+  fprintf(out, "  count %lu avg %" PRIu64 " p50 %lu p99 %lu max %" PRIu32
+          " us\n", hist->count, hist->total / hist->count,
+          trace_stat_percentile(hist, 50), trace_stat_percentile(hist, 99),
+          hist->max);
+
+  /* Histogram of the non-empty buckets, as <upper bound>:<count> */
+
+  fprintf(out, "  hist(us):");
+  for (i = 0; i < TRACE_BUCKETS; i++)
+    {
+      if (hist->hist[i] != 0)
+        {
+          fprintf(out, " %s%lu:%lu", i == TRACE_BUCKETS - 1 ? ">" : "<",
+                  i == TRACE_BUCKETS - 1 ? 1ul << (i - 1) : 1ul << i,
+                  hist->hist[i]);
+        }
+    }
+
+  fprintf(out, "\n");
+}
+
+/****************************************************************************
+ * Name: trace_stat_name
+ ****************************************************************************/
+
+static FAR const char *trace_stat_name(FAR struct trace_stat_s *stat,
+                                       pid_t pid)
+{
+  int i;
+
+  for (i = 0; i < stat->ntasks; i++)
+    {
+      if (stat->tasks[i].pid == pid)
+        {
+          return stat->tasks[i].name;
+        }
+    }
+
+  return "";
+}
+
+/****************************************************************************
+ * Name: trace_stat_report
+ ****************************************************************************/
+
+static void trace_stat_report(FAR FILE *out, FAR struct trace_stat_s *stat)
+{
+  uint64_t elapsed = MAX(stat->last - stat->first, 1);
+  FAR struct trace_task_s *task;
+  int best;
+  int i;
+  int j;
+
+  fprintf(out, "%lu notes in %" PRIu64 " us\n", stat->nnotes, elapsed);
+  if (stat->untracked > 0)
+    {
+      fprintf(out, "%lu notes of tasks beyond the %d entry task table\n",
+              stat->untracked, CONFIG_SYSTEM_TRACE_STAT_NTASKS);
+    }
+
+  /* Tasks by run time, selection sort of the top entries in place */
+
+  fprintf(out, "\nTasks by run time:\n");
+  fprintf(out, "  %5s %-*s %12s %6s %8s\n", "PID", CONFIG_TASK_NAME_SIZE,
+          "NAME", "RUN(us)", "%RUN", "SWITCHES");
+
+  for (i = 0; i < MIN(stat->top, stat->ntasks); i++)
+    {
+      best = i;
+      for (j = i + 1; j < stat->ntasks; j++)
+        {
+          if (stat->tasks[j].runtime > stat->tasks[best].runtime)
+            {
+              best = j;
+            }
+        }
+
+      if (best != i)
+        {
+          struct trace_task_s tmp = stat->tasks[i];
+
+          stat->tasks[i]    = stat->tasks[best];
+          stat->tasks[best] = tmp;
+        }
+
+      task = &stat->tasks[i];
+      fprintf(out, "  %5d %-*s %12" PRIu64 " %3" PRIu64 ".%" PRIu64
+              " %8lu\n", task->pid, CONFIG_TASK_NAME_SIZE, task->name,
+              task->runtime, task->runtime * 100 / elapsed,
+              task->runtime * 1000 / elapsed % 10, task->switches);
+    }
+
+  trace_stat_hist(out, "Ready-to-run latency of preempted tasks",
+                  &stat->wakeup);
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_IRQHANDLER
+  trace_stat_hist(out, "IRQ duration", &stat->irqlat);
+  if (stat->nirqs > 0)
+    {
+      fprintf(out, "  %5s %8s %8s %8s\n", "IRQ", "COUNT", "AVG(us)",
+              "MAX(us)");
+      for (i = 0; i < stat->nirqs; i++)
+        {
+          fprintf(out, "  %5d %8lu %8" PRIu64 " %8" PRIu32 "\n",
+                  stat->irqs[i].irq, stat->irqs[i].sum.count,
+                  stat->irqs[i].sum.total / stat->irqs[i].sum.count,
+                  stat->irqs[i].sum.max);
+        }
+    }
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  trace_stat_hist(out, "Syscall duration", &stat->syslat);
+  if (stat->syslat.count > 0)
+    {
+      fprintf(out, "  %-24s %8s %8s %8s\n", "SYSCALL", "COUNT", "AVG(us)",
+              "MAX(us)");
+
+      /* The top syscalls by total time, each pass picks the next one */
+
+      for (i = 0; i < stat->top; i++)
+        {
+          best = -1;
+          for (j = 0; j < SYS_nsyscalls; j++)
+            {
+              if (stat->sys[j].count > 0 &&
+                  (best < 0 || stat->sys[j].total > stat->sys[best].total))
+                {
+                  best = j;
+                }
+            }
+
+          if (best < 0)
+            {
+              break;
+            }
+
+          fprintf(out, "  %-24s %8lu %8" PRIu64 " %8" PRIu32 "\n",
+                  g_funcnames[best], stat->sys[best].count,
+                  stat->sys[best].total / stat->sys[best].count,
+                  stat->sys[best].max);
+          stat->sys[best].count = 0;
+        }
+    }
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_CSECTION
+  if (stat->ncs > 0)
+    {
+      fprintf(out, "\nLongest critical sections:\n");
+      fprintf(out, "  %12s %12s %5s %s\n", "DURATION(us)", "AT(us)", "PID",
+              "NAME");
+      for (i = 0; i < stat->ncs; i++)
+        {
+          fprintf(out, "  %12" PRIu32 " %12" PRIu64 " %5d %s\n",
+                  stat->cs[i].duration, stat->cs[i].start - stat->first,
+                  stat->cs[i].pid,
+                  trace_stat_name(stat, stat->cs[i].pid));
+        }
+    }
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: trace_stat
+ *
+ * Description:
+ *   Read the notes in binary form and print a statistical summary.
+ *
+ ****************************************************************************/
+
+int trace_stat(FAR FILE *out, int top)
+{
+#ifdef NOTERAM_SETREADMODE
+  FAR struct trace_stat_s *stat;
+  FAR const struct note_common_s *note;
+  FAR uint8_t *buf;
+  unsigned int mode;
+  ssize_t nread;
+  ssize_t offset;
+  int ret = OK;
+  int fd;
+  int i;
+
+  stat = zalloc(sizeof(struct trace_stat_s));
+  buf  = malloc(CONFIG_SYSTEM_TRACE_STAT_BUFSIZE);
+  if (stat == NULL || buf == NULL)
+    {
+      fprintf(stderr, "trace: no memory\n");
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  stat->top = MIN(MAX(top, 1), TRACE_STAT_MAXTOP);
+#ifdef CONFIG_SCHED_INSTRUMENTATION_PERFCOUNT
+  stat->freq = up_perf_getfreq();
+#endif
+
+  for (i = 0; i < TRACE_NCPUS; i++)
+    {
+      stat->cpus[i].cspid = -1;
+    }
+
+  fd = open("/dev/note/ram", O_RDONLY);
+  if (fd < 0)
+    {
+      fprintf(stderr, "trace: cannot open /dev/note/ram\n");
+      ret = -errno;
+      goto errout;
+    }
+
+  mode = NOTERAM_MODE_READ_BINARY;
+  if (ioctl(fd, NOTERAM_SETREADMODE, (unsigned long)&mode) < 0)
+    {
+      fprintf(stderr, "trace: binary read not supported\n");
+      ret = -errno;
+      goto errout_with_fd;
+    }
+
+  /* The driver returns whole notes only */
+
+  while ((nread = read(fd, buf, CONFIG_SYSTEM_TRACE_STAT_BUFSIZE)) > 0)
+    {
+      for (offset = 0; offset < nread; offset += note->nc_length)
+        {
+          note = (FAR const struct note_common_s *)(buf + offset);
+          if (note->nc_length < sizeof(struct note_common_s) ||
+              note->nc_length > nread - offset)
+            {
+              break;
+            }
+
+          trace_stat_note(stat, note);
+        }
+    }
+
+  mode = NOTERAM_MODE_READ_ASCII;
+  ioctl(fd, NOTERAM_SETREADMODE, (unsigned long)&mode);
+
+  /* Tasks still running are accounted up to the last note */
+
+  for (i = 0; i < TRACE_NCPUS; i++)
+    {
+      trace_stat_switch_out(&stat->cpus[i], stat->last);
+    }
+
+  if (stat->nnotes == 0)
+    {
+      fprintf(out, "No notes\n");
+    }
+  else
+    {
+      trace_stat_report(out, stat);
+    }
+
+errout_with_fd:
+  close(fd);
+errout:
+  free(buf);
+  free(stat);
+  return ret;
+#else
+  fprintf(stderr, "trace: binary read not supported\n");
+  return -ENOSYS;
+#endif
+}
@@ -35,11 +35,15 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/param.h>
 #include <sys/queue.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include <uORB/uORB.h>
+#ifdef CONFIG_UORB_RECORD
+#  include <uORB/record.h>
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -48,6 +52,7 @@
 #define ORB_MAX_PRINT_NAME 32
 #define ORB_TOP_WAIT_TIME  1000
 #define ORB_DATA_DIR       "/data/uorb/"
+#define ORB_STATS_BUCKETS  20   /* Log2 latency buckets, last is >= 2^18us */
 
 #if defined(CONFIG_DEBUG_UORB) && !defined(CONFIG_LIBC_FLOATINGPOINT)
 #error "Enable CONFIG_LIBC_FLOATINGPOINT, required to see debug output"
@@ -65,10 +70,32 @@ struct listen_object_s
   orb_abstime timestamp;    /* Time of lastest generation */
   unsigned long generation; /* Latest generation */
   FAR FILE *file;
+  FAR struct listen_stats_s *stats;
+#ifdef CONFIG_UORB_RECORD
+  int record_id;            /* Topic id in the binary log */
+  unsigned int nbuffer;     /* Samples fetched per read */
+  FAR uint8_t *buffer;      /* Binary record read buffer */
+#endif
 };
 
 SLIST_HEAD(listen_list_s, listen_object_s);
 
+/* Per-topic delivery statistics gathered by the stats mode */
+
+struct listen_stats_s
+{
+  unsigned long samples;        /* Samples received */
+  unsigned long reads;          /* Reads issued */
+  unsigned long overruns;       /* Samples lost to queue overflow */
+  unsigned long high_water;     /* Largest backlog seen before a read */
+  unsigned long queue_size;     /* Topic queue depth */
+  orb_abstime   lat_min;        /* Publish-to-copy latency, us */
+  orb_abstime   lat_max;
+  orb_abstime   lat_sum;
+  unsigned long hist[ORB_STATS_BUCKETS];
+  FAR uint8_t  *buffer;         /* Read buffer, queue_size samples */
+};
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -84,15 +111,23 @@ static int listener_print(FAR const struct orb_metadata *meta, int fd);
 static void listener_monitor(FAR struct listen_list_s *objlist,
                              int nb_objects, float topic_rate,
                              int topic_latency, int nb_msgs,
-                             int timeout, bool record);
+                             int timeout, bool record, bool binary);
 static int listener_update(FAR struct listen_list_s *objlist,
                            FAR struct orb_object *object);
 static void listener_top(FAR struct listen_list_s *objlist,
                          FAR const char *filter,
                          bool only_once);
+static void listener_stats(FAR struct listen_list_s *objlist,
+                           int nb_objects, int duration);
 static int listener_create_dir(FAR char *dir, size_t size);
 static int listener_record(FAR const struct orb_metadata *meta, int fd,
                            FAR FILE *file);
+#ifdef CONFIG_UORB_RECORD
+static FAR struct orb_recorder_s *
+listener_record_binary_open(FAR struct listen_list_s *objlist);
+static int listener_record_binary(FAR struct listen_object_s *object,
+                                  int fd, FAR struct orb_recorder_s *rec);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -130,14 +165,19 @@ listener <command> [arguments...]\n\
  Commands:\n\
 \t<topics_name> Topic name. Multi name are separated by ','\n\
 \t[-h       ]  Listener commands help\n\
-\t[-f       ]  Record uorb data to file\n\
-\t[-n <val> ]  Number of messages, default: 0\n\
+\t[-f       ]  Record uorb data to file\n"
+#ifdef CONFIG_UORB_RECORD
+"\t[-B       ]  Record uorb data to a binary log for uorb_replay\n"
+#endif
+"\t[-n <val> ]  Number of messages, default: 0\n\
 \t[-r <val> ]  Subscription rate (unlimited if 0), default: 0\n\
 \t[-b <val> ]  Subscription maximum report latency in us(unlimited if 0),\n\
 \t             default: 0\n\
 \t[-t <val> ]  Time of listener, in seconds, default: 5\n\
 \t[-T       ]  Top, continuously print updating objects\n\
 \t[-l       ]  Top only execute once.\n\
+\t[-S       ]  Stats, subscribe for the time given by -t and print the\n\
+\t             latency, backlog and overruns seen by this subscription\n\
   ");
 }
 
@@ -167,14 +207,14 @@ static int listener_create_dir(FAR char *dir, size_t size)
       return -EINVAL;
     }
 
-  if (access(ORB_DATA_DIR, F_OK) != 0)
+  if (access(ORB_DATA_DIR, F_OK) != 0 && mkdir(ORB_DATA_DIR, 0777) < 0)
     {
-      mkdir(ORB_DATA_DIR, 0777);
+      return -errno;
     }
 
-  if (access(dir, F_OK) != 0)
+  if (access(dir, F_OK) != 0 && mkdir(dir, 0777) < 0)
     {
-      mkdir(dir, 0777);
+      return -errno;
     }
 
   return OK;
@@ -244,6 +284,12 @@ static int listener_add_object(FAR struct listen_list_s *objlist,
   tmp->timestamp       = orb_absolute_time();
   tmp->generation      = ret < 0 ? 0 : state.generation;
   tmp->file            = NULL;
+  tmp->stats           = NULL;
+#ifdef CONFIG_UORB_RECORD
+  tmp->record_id       = -1;
+  tmp->nbuffer         = 0;
+  tmp->buffer          = NULL;
+#endif
   SLIST_INSERT_HEAD(objlist, tmp, node);
   return 0;
 }
@@ -564,6 +610,115 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
   return ret;
 }
 
+#ifdef CONFIG_UORB_RECORD
+/****************************************************************************
+ * Name: listener_record_binary_open
+ *
+ * Description:
+ *   Create a binary log in a new record directory and declare all objects
+ *   of the list in it.
+ *
+ * Input Parameters:
+ *   objlist    List of objects to record.
+ *
+ * Returned Value:
+ *   The recorder on success, otherwise NULL.
+ ****************************************************************************/
+
+static FAR struct orb_recorder_s *
+listener_record_binary_open(FAR struct listen_list_s *objlist)
+{
+  FAR struct listen_object_s *tmp;
+  FAR struct orb_recorder_s *rec;
+  struct orb_state state;
+  char path[PATH_MAX];
+  int ret;
+
+  ret = listener_create_dir(path, sizeof(path));
+  if (ret < 0)
+    {
+      uorbinfo_raw("record dir creat failed! err:%d", ret);
+      return NULL;
+    }
+
+  strlcat(path, "record.orb", sizeof(path));
+
+  rec = orb_record_open(path);
+  if (rec == NULL)
+    {
+      uorbinfo_raw("file creat failed![%s] err:%d", path, errno);
+      return NULL;
+    }
+
+  uorbinfo_raw("creat file:[%s]", path);
+
+  /* Read as many samples per wake-up as the topic can queue */
+
+  SLIST_FOREACH(tmp, objlist, node)
+    {
+      tmp->nbuffer = 1;
+      if (listener_get_state(&tmp->object, &state) >= 0 &&
+          state.queue_size > 1)
+        {
+          tmp->nbuffer = state.queue_size;
+        }
+
+      tmp->buffer    = malloc(tmp->nbuffer * tmp->object.meta->o_size);
+      tmp->record_id = orb_record_add_topic(rec, tmp->object.meta,
+                                            tmp->object.instance,
+                                            tmp->nbuffer);
+      if (tmp->buffer == NULL || tmp->record_id < 0)
+        {
+          uorbinfo_raw("record init failed!meta name:%s,instance:%d",
+                       tmp->object.meta->o_name, tmp->object.instance);
+        }
+    }
+
+  return rec;
+}
+
+/****************************************************************************
+ * Name: listener_record_binary
+ *
+ * Description:
+ *   Drain the queued samples of a topic into the binary log.
+ *
+ * Input Parameters:
+ *   object   The object to record.
+ *   fd       Subscriber handle.
+ *   rec      The recorder.
+ *
+ * Returned Value:
+ *   Number of samples read, otherwise -1
+ ****************************************************************************/
+
+static int listener_record_binary(FAR struct listen_object_s *object,
+                                  int fd, FAR struct orb_recorder_s *rec)
+{
+  ssize_t ret;
+
+  if (object->buffer == NULL || object->record_id < 0)
+    {
+      return -1;
+    }
+
+  ret = orb_copy_multi(fd, object->buffer,
+                       object->nbuffer * object->object.meta->o_size);
+  if (ret <= 0)
+    {
+      return -1;
+    }
+
+  if (orb_record_write(rec, object->record_id, object->buffer, ret) < 0)
+    {
+      uorbwarn("Listener record %s dropped samples",
+               object->object.meta->o_name);
+    }
+
+  return ret / object->object.meta->o_size;
+}
+#endif
+
 /****************************************************************************
  * Name: listener_monitor
  *
@@ -577,6 +732,8 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
  *   topic_latency  Subscribe report latency.
  *   nb_msgs        Subscribe amount of messages.
  *   timeout        Maximum poll waiting time , ms.
+ *   record         Record the data to text files.
+ *   binary         Record the data to a binary log.
  *
  * Returned Value:
  *   None
@@ -585,8 +742,11 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
 static void listener_monitor(FAR struct listen_list_s *objlist,
                              int nb_objects, float topic_rate,
                              int topic_latency, int nb_msgs,
-                             int timeout, bool record)
+                             int timeout, bool record, bool binary)
 {
+#ifdef CONFIG_UORB_RECORD
+  FAR struct orb_recorder_s *rec = NULL;
+#endif
   FAR struct pollfd *fds;
   char path[PATH_MAX];
   FAR int *recv_msgs;
@@ -644,7 +804,12 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
 
   if (record)
     {
-      listener_create_dir(path, sizeof(path));
+      if (listener_create_dir(path, sizeof(path)) < 0)
+        {
+          uorbinfo_raw("record dir creat failed!");
+          goto out;
+        }
+
       dir = path + strlen(path);
 
       SLIST_FOREACH(tmp, objlist, node)
@@ -670,6 +835,36 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
         }
     }
 
+#ifdef CONFIG_UORB_RECORD
+  if (binary)
+    {
+      rec = listener_record_binary_open(objlist);
+      if (rec == NULL)
+        {
+          goto out;
+        }
+
+      /* A topic that could not be set up is never read, stop polling it
+       * or its POLLIN would keep the loop spinning.
+       */
+
+      i = 0;
+      SLIST_FOREACH(tmp, objlist, node)
+        {
+          if (fds[i].fd >= 0 &&
+              (tmp->buffer == NULL || tmp->record_id < 0))
+            {
+              orb_unsubscribe(fds[i].fd);
+              fds[i].fd = -1;
+            }
+
+          i++;
+        }
+    }
+#else
+  (void)binary;
+#endif
+
   /* Loop poll and print recieved messages */
 
   while ((!nb_msgs || nb_recv_msgs < nb_msgs) && !g_should_exit)
@@ -681,11 +876,24 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
             {
               if (fds[i].revents & POLLIN)
                 {
-                  nb_recv_msgs++;
-                  recv_msgs[i]++;
+#ifdef CONFIG_UORB_RECORD
+                  if (rec != NULL)
+                    {
+                      int n;
 
+                      n = listener_record_binary(tmp, fds[i].fd, rec);
+                      if (n > 0)
+                        {
+                          nb_recv_msgs += n;
+                          recv_msgs[i] += n;
+                        }
+                    }
+                  else
+#endif
                   if (tmp->file != NULL)
                     {
+                      nb_recv_msgs++;
+                      recv_msgs[i]++;
                       if (listener_record(tmp->object.meta, fds[i].fd,
                                           tmp->file) < 0)
                         {
@@ -695,6 +903,8 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
                     }
                   else
                     {
+                      nb_recv_msgs++;
+                      recv_msgs[i]++;
                       if (listener_print(tmp->object.meta, fds[i].fd) != 0)
                         {
                           uorberr("Listener callback failed");
@@ -718,6 +928,7 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
         }
     }
 
+out:
   i = 0;
   SLIST_FOREACH(tmp, objlist, node)
     {
@@ -745,9 +956,26 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
           fclose(tmp->file);
         }
 
+#ifdef CONFIG_UORB_RECORD
+      free(tmp->buffer);
+      tmp->buffer = NULL;
+#endif
+
       i++;
     }
 
+#ifdef CONFIG_UORB_RECORD
+  if (rec != NULL)
+    {
+      int ret = orb_record_close(rec);
+
+      if (ret != 0)
+        {
+          uorbinfo_raw("Binary record dropped:%d", ret);
+        }
+    }
+#endif
+
   uorbinfo_raw("Total number of received Message:%d/%d",
                nb_recv_msgs, nb_msgs ? nb_msgs : nb_recv_msgs);
   free(fds);
@@ -835,6 +1063,293 @@ static void listener_top(FAR struct listen_list_s *objlist,
   while (!quit && !only_once);
 }
 
+/****************************************************************************
+ * Name: listener_stats_bucket
+ *
+ * Description:
+ *   Map a latency to its log2 histogram bucket: bucket 0 holds 0us,
+ *   bucket n holds [2^(n-1), 2^n) us.
+ ****************************************************************************/
+
+static int listener_stats_bucket(orb_abstime latency)
+{
+  int bucket = 0;
+
+  while (latency != 0 && bucket < ORB_STATS_BUCKETS - 1)
+    {
+      latency >>= 1;
+      bucket++;
+    }
+
+  return bucket;
+}
+
+/****************************************************************************
+ * Name: listener_stats_percentile
+ *
+ * Description:
+ *   Upper bound of the bucket holding the given percentile, in us.  The
+ *   percentile itself lies anywhere in that bucket, it is not interpolated.
+ *   For the open ended last bucket the maximum latency is returned.
+ ****************************************************************************/
+
+static unsigned long
+listener_stats_percentile(FAR const struct listen_stats_s *stats,
+                          unsigned int percent)
+{
+  unsigned long target = (stats->samples * percent + 99) / 100;
+  unsigned long count = 0;
+  int i;
+
+  for (i = 0; i < ORB_STATS_BUCKETS; i++)
+    {
+      count += stats->hist[i];
+      if (count >= target)
+        {
+          break;
+        }
+    }
+
+  /* The last bucket is open ended, the maximum bounds it instead */
+
+  if (i >= ORB_STATS_BUCKETS - 1)
+    {
+      return (unsigned long)stats->lat_max;
+    }
+
+  return i == 0 ? 0 : 1ul << i;
+}
+
+/****************************************************************************
+ * Name: listener_stats_update
+ *
+ * Description:
+ *   Drain a topic and account its backlog, overruns and latencies.
+ *
+ *   The backlog is the distance between the topic generation and the
+ *   generation this subscriber has read up to; whatever exceeds the queue
+ *   depth was overwritten before it could be read.
+ *
+ * Input Parameters:
+ *   object   The object to update.
+ *   fd       Subscriber handle.
+ *
+ * Returned Value:
+ *   Number of samples read, otherwise -1
+ ****************************************************************************/
+
+static int listener_stats_update(FAR struct listen_object_s *object,
+                                 int fd)
+{
+  FAR struct listen_stats_s *stats = object->stats;
+  size_t esize = object->object.meta->o_size;
+  struct sensor_ustate_s ustate;
+  struct orb_state state;
+  unsigned long backlog;
+  orb_abstime timestamp;
+  orb_abstime latency;
+  orb_abstime now;
+  ssize_t ret;
+  int i;
+  int n;
+
+  if (orb_get_state(fd, &state) >= 0 &&
+      orb_ioctl(fd, SNIOC_GET_USTATE,
+                (unsigned long)(uintptr_t)&ustate) >= 0 &&
+      state.generation > ustate.generation)
+    {
+      backlog = state.generation - ustate.generation;
+      stats->high_water = MAX(stats->high_water, backlog);
+      if (backlog > stats->queue_size)
+        {
+          stats->overruns += backlog - stats->queue_size;
+        }
+    }
+
+  ret = orb_copy_multi(fd, stats->buffer, stats->queue_size * esize);
+  now = orb_absolute_time();
+  if (ret < (ssize_t)esize)
+    {
+      return -1;
+    }
+
+  n = ret / esize;
+  stats->reads++;
+  for (i = 0; i < n; i++)
+    {
+      memcpy(&timestamp, stats->buffer + i * esize, sizeof(timestamp));
+      latency = now > timestamp ? now - timestamp : 0;
+
+      stats->hist[listener_stats_bucket(latency)]++;
+      stats->lat_sum += latency;
+      stats->lat_max  = MAX(stats->lat_max, latency);
+      stats->lat_min  = stats->samples ? MIN(stats->lat_min, latency) :
+                                         latency;
+      stats->samples++;
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: listener_stats
+ *
+ * Description:
+ *   Subscribe all objects for a while, then print per-topic throughput,
+ *   publish-to-copy latency distribution, queue high-water mark, overruns
+ *   and reads per sample.
+ *
+ *   Everything is measured on a fresh subscription of the listener itself,
+ *   which drains the topic as fast as it can.  The figures describe how the
+ *   topic is delivered, not how far the other subscribers are behind; a
+ *   high-water mark close to the queue depth or overruns here mean even a
+ *   prompt reader loses samples.
+ *
+ *   Latency is taken from the sample timestamp, so it includes the time
+ *   spent in the publisher after stamping the sample.  Percentiles are
+ *   reported as the upper bound of their log2 histogram bucket.
+ *
+ * Input Parameters:
+ *   objlist      List of objects to subscribe.
+ *   nb_objects   Length of objects list.
+ *   duration     Time to collect, in seconds.
+ *
+ * Returned Value:
+ *   None
+ ****************************************************************************/
+
+static void listener_stats(FAR struct listen_list_s *objlist,
+                           int nb_objects, int duration)
+{
+  FAR struct listen_object_s *tmp;
+  FAR struct listen_stats_s *stats;
+  FAR struct pollfd *fds;
+  struct orb_state state;
+  orb_abstime start;
+  orb_abstime elapsed;
+  char hist[ORB_STATS_BUCKETS * 20];
+  size_t len;
+  int i = 0;
+  int j;
+
+  fds = calloc(nb_objects, sizeof(struct pollfd));
+  if (!fds)
+    {
+      return;
+    }
+
+  SLIST_FOREACH(tmp, objlist, node)
+    {
+      fds[i].fd = -1;
+      tmp->stats = calloc(1, sizeof(struct listen_stats_s));
+      if (tmp->stats != NULL)
+        {
+          stats = tmp->stats;
+          stats->queue_size = 1;
+          if (listener_get_state(&tmp->object, &state) >= 0 &&
+              state.queue_size > 1)
+            {
+              stats->queue_size = state.queue_size;
+            }
+
+          stats->buffer = malloc(stats->queue_size *
+                                 tmp->object.meta->o_size);
+          if (stats->buffer != NULL)
+            {
+              fds[i].fd = orb_subscribe_multi(tmp->object.meta,
+                                              tmp->object.instance);
+              fds[i].events = POLLIN;
+            }
+        }
+
+      i++;
+    }
+
+  uorbinfo_raw("Collecting stats for %d seconds...", duration);
+
+  start = orb_absolute_time();
+  do
+    {
+      if (poll(fds, nb_objects, ORB_TOP_WAIT_TIME) > 0)
+        {
+          i = 0;
+          SLIST_FOREACH(tmp, objlist, node)
+            {
+              if (fds[i].fd >= 0 && (fds[i].revents & POLLIN))
+                {
+                  listener_stats_update(tmp, fds[i].fd);
+                }
+
+              i++;
+            }
+        }
+
+      elapsed = orb_absolute_time() - start;
+    }
+  while (!g_should_exit && elapsed < duration * 1000000ull);
+
+  uorbinfo_raw("%-*s INST    RATE #Q  HWM  OVRUN RD/S  MIN  AVG P50<= "
+               "P99<=  MAX(us)", ORB_MAX_PRINT_NAME - 2, "NAME");
+
+  i = 0;
+  SLIST_FOREACH(tmp, objlist, node)
+    {
+      stats = tmp->stats;
+      if (fds[i].fd >= 0)
+        {
+          orb_unsubscribe(fds[i].fd);
+        }
+
+      if (stats == NULL || stats->samples == 0)
+        {
+          i++;
+          continue;
+        }
+
+      uorbinfo_raw("%-*s %2d %7lu %3lu %4lu %6lu %4lu %4" PRIu64
+                   " %4" PRIu64 " %5lu %5lu %4" PRIu64,
+                   ORB_MAX_PRINT_NAME, tmp->object.meta->o_name,
+                   tmp->object.instance,
+                   (unsigned long)(stats->samples * 1000000ull / elapsed),
+                   stats->queue_size, stats->high_water, stats->overruns,
+                   (unsigned long)(stats->reads * 1000000ull / elapsed),
+                   stats->lat_min, stats->lat_sum / stats->samples,
+                   listener_stats_percentile(stats, 50),
+                   listener_stats_percentile(stats, 99),
+                   stats->lat_max);
+
+      /* Histogram of the non-empty buckets, as <upper bound>:<count> */
+
+      len     = 0;
+      hist[0] = '\0';
+      for (j = 0; j < ORB_STATS_BUCKETS && len < sizeof(hist); j++)
+        {
+          if (stats->hist[j] != 0)
+            {
+              len += snprintf(hist + len, sizeof(hist) - len, " %s%lu:%lu",
+                              j == ORB_STATS_BUCKETS - 1 ? ">" : "<",
+                              j == ORB_STATS_BUCKETS - 1 ?
+                              1ul << (j - 1) : 1ul << j, stats->hist[j]);
+            }
+        }
+
+      uorbinfo_raw("  hist(us):%s", hist);
+      i++;
+    }
+
+  SLIST_FOREACH(tmp, objlist, node)
+    {
+      if (tmp->stats != NULL)
+        {
+          free(tmp->stats->buffer);
+          free(tmp->stats);
+          tmp->stats = NULL;
+        }
+    }
+
+  free(fds);
+}
+
 static void exit_handler(int signo)
 {
   (void)signo;
@@ -855,7 +1370,9 @@ int main(int argc, FAR char *argv[])
   int timeout       = 5;
   bool top          = false;
   bool record       = false;
+  bool binary       = false;
   bool only_once    = false;
+  bool stats        = false;
   FAR char *filter  = NULL;
   int ret;
   int ch;
@@ -868,7 +1385,7 @@ int main(int argc, FAR char *argv[])
 
   /* Pasrse Argument */
 
-  while ((ch = getopt(argc, argv, "r:b:n:t:Tflh")) != EOF)
+  while ((ch = getopt(argc, argv, "r:b:n:t:TfBlSh")) != EOF)
     {
       switch (ch)
       {
@@ -910,6 +1427,12 @@ int main(int argc, FAR char *argv[])
           break;
 #endif
 
+#ifdef CONFIG_UORB_RECORD
+        case 'B':
+          binary = true;
+          break;
+#endif
+
         case 'T':
           top = true;
           break;
@@ -918,6 +1441,10 @@ int main(int argc, FAR char *argv[])
           only_once = true;
           break;
 
+        case 'S':
+          stats = true;
+          break;
+
         case 'h':
         default:
           goto error;
@@ -942,6 +1469,10 @@ int main(int argc, FAR char *argv[])
     {
       listener_top(&objlist, filter, only_once);
     }
+  else if (stats)
+    {
+      listener_stats(&objlist, ret, timeout);
+    }
   else
     {
       uorbinfo_raw("\nMonitor objects num:%d", ret);
@@ -953,7 +1484,7 @@ int main(int argc, FAR char *argv[])
         }
 
       listener_monitor(&objlist, ret, topic_rate, topic_latency,
-                       nb_msgs, timeout, record);
+                       nb_msgs, timeout, record, binary);
     }
 
   listener_delete_object_list(&objlist);
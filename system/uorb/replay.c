@@ -0,0 +1,439 @@
+/****************************************************************************
+ * apps/system/uorb/replay.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/param.h>
+
+#include <uORB/record.h>
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct replay_topic_s
+{
+  FAR const struct orb_metadata *meta;  /* Metadata used to advertise */
+  FAR struct orb_metadata       *owned; /* Metadata built from the log */
+  int                            fd;    /* Advertiser, -1 if unused */
+
+  /* Merge cursor, the next sample of this topic in the log */
+
+  long                           offs;  /* Where to look for the next */
+  FAR uint8_t                   *sample;
+  uint16_t                       size;
+  bool                           pending;
+  orb_abstime                    timestamp;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool g_replay_should_exit = false;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void usage(void)
+{
+  uorbinfo_raw("\n\
+The tool republishes a binary log recorded by 'uorb_listener -B'.\n\
+Topics are advertised again with their recorded instance and samples are\n\
+published with their original timing.\n\
+\n\
+uorb_replay [arguments...] <file>\n\
+  Commands:\n\
+\t[-h       ]  Replay commands help.\n\
+\t[-s <val> ]  Speed factor, 0 publishes as fast as possible, default: 1\n\
+  ");
+}
+
+static void exit_handler(int signo)
+{
+  (void)signo;
+  g_replay_should_exit = true;
+}
+
+/****************************************************************************
+ * Name: replay_add_topic
+ *
+ * Description:
+ *   Advertise a topic declared in the log.  Topics unknown to this image
+ *   are advertised with metadata rebuilt from the log.
+ *
+ * Input Parameters:
+ *   topic    Replay topic slot.
+ *   info     Topic message payload.
+ *
+ * Returned Value:
+ *   0 on success, otherwise negative errno.
+ ****************************************************************************/
+
+static int replay_add_topic(FAR struct replay_topic_s *topic,
+                            FAR const struct orb_record_topic_s *info)
+{
+  int instance = info->instance;
+
+  topic->meta = orb_get_meta(info->name);
+  if (topic->meta == NULL)
+    {
+      topic->owned = calloc(1, sizeof(struct orb_metadata) +
+                               strlen(info->name) + 1);
+      if (topic->owned == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      strcpy((FAR char *)(topic->owned + 1), info->name);
+      topic->owned->o_name = (FAR const char *)(topic->owned + 1);
+      topic->owned->o_size = info->o_size;
+      topic->meta          = topic->owned;
+    }
+  else if (topic->meta->o_size != info->o_size)
+    {
+      uorbinfo_raw("Topic %s size mismatch: log %u, image %u",
+                   info->name, info->o_size, topic->meta->o_size);
+      return -EINVAL;
+    }
+
+  topic->fd = orb_advertise_multi_queue_persist(topic->meta, NULL,
+                                                &instance,
+                                                MAX(info->queue, 1));
+  if (topic->fd < 0)
+    {
+      uorbinfo_raw("Replay orb advertise %s failed[%d]!",
+                   info->name, errno);
+      return -errno;
+    }
+
+  topic->sample = malloc(topic->meta->o_size);
+  if (topic->sample == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  uorbinfo_raw("replay topic:%s%d", info->name, instance);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: replay_next
+ *
+ * Description:
+ *   Load the next sample of a topic, scanning the log from the topic's
+ *   cursor.  Samples of one topic are in time order in the log, samples of
+ *   different topics are not, the recorder writes each drained queue as one
+ *   batch.
+ *
+ * Input Parameters:
+ *   file     The log file.
+ *   topics   All replay topics.
+ *   id       The topic id.
+ *
+ * Returned Value:
+ *   0 on success or at the end of the log, otherwise negative errno.
+ ****************************************************************************/
+
+static int replay_next(FAR FILE *file, FAR struct replay_topic_s *topics,
+                       int id)
+{
+  FAR struct replay_topic_s *topic = &topics[id];
+  struct orb_record_msg_s msg;
+
+  topic->pending = false;
+  if (fseek(file, topic->offs, SEEK_SET) < 0)
+    {
+      return -errno;
+    }
+
+  while (fread(&msg, sizeof(msg), 1, file) == 1)
+    {
+      if (msg.type == ORB_RECORD_DATA && msg.id == id &&
+          msg.size >= sizeof(orb_abstime) &&
+          msg.size <= topic->meta->o_size)
+        {
+          if (fread(topic->sample, 1, msg.size, file) != msg.size)
+            {
+              break;
+            }
+
+          memcpy(&topic->timestamp, topic->sample, sizeof(orb_abstime));
+          topic->size    = msg.size;
+          topic->offs    = ftell(file);
+          topic->pending = true;
+          return 0;
+        }
+
+      if (fseek(file, msg.size, SEEK_CUR) < 0)
+        {
+          return -errno;
+        }
+    }
+
+  topic->offs = ftell(file);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: replay_worker
+ *
+ * Description:
+ *   Publish all samples of a log on the original time line, scaled by the
+ *   speed factor.  Deadlines are absolute, so the publish cost does not
+ *   accumulate into drift.
+ *
+ *   Each topic has its own cursor in the log and the oldest sample of all
+ *   cursors is published next, so topics recorded in batches are replayed
+ *   interleaved as they were published.
+ *
+ * Input Parameters:
+ *   file     The log file.
+ *   speed    Speed factor, 0 for no timing.
+ *
+ * Returned Value:
+ *   Number of published samples on success, otherwise negative errno.
+ ****************************************************************************/
+
+static int replay_worker(FAR FILE *file, float speed)
+{
+  struct orb_record_header_s header;
+  struct orb_record_msg_s msg;
+  FAR struct replay_topic_s *topics;
+  FAR struct replay_topic_s *next;
+  FAR uint8_t *payload;
+  orb_abstime first = 0;
+  orb_abstime start = 0;
+  orb_abstime deadline;
+  orb_abstime now;
+  size_t maxlen;
+  int count = 0;
+  int ret = 0;
+  int id = 0;
+  int i;
+
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, ORB_RECORD_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != ORB_RECORD_VERSION)
+    {
+      uorbinfo_raw("Replay file format error!");
+      return -EINVAL;
+    }
+
+  maxlen  = offsetof(struct orb_record_topic_s, name) + NAME_MAX;
+  topics  = calloc(ORB_RECORD_MAX_TOPICS, sizeof(struct replay_topic_s));
+  payload = malloc(maxlen);
+  if (topics == NULL || payload == NULL)
+    {
+      ret = -ENOMEM;
+      goto out;
+    }
+
+  for (i = 0; i < ORB_RECORD_MAX_TOPICS; i++)
+    {
+      topics[i].fd = -1;
+    }
+
+  /* Advertise the topics, the cursor of each starts at its declaration */
+
+  while (fread(&msg, sizeof(msg), 1, file) == 1)
+    {
+      if (msg.type != ORB_RECORD_TOPIC || topics[msg.id].fd >= 0 ||
+          msg.size <= offsetof(struct orb_record_topic_s, name) ||
+          msg.size > maxlen)
+        {
+          if (fseek(file, msg.size, SEEK_CUR) < 0)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      if (fread(payload, 1, msg.size, file) != msg.size)
+        {
+          uorbinfo_raw("Replay file truncated!");
+          break;
+        }
+
+      payload[msg.size - 1] = '\0';
+      ret = replay_add_topic(&topics[msg.id],
+                             (FAR struct orb_record_topic_s *)payload);
+      if (ret < 0)
+        {
+          goto out;
+        }
+
+      topics[msg.id].offs = ftell(file);
+    }
+
+  for (i = 0; i < ORB_RECORD_MAX_TOPICS && ret >= 0; i++)
+    {
+      if (topics[i].fd >= 0)
+        {
+          ret = replay_next(file, topics, i);
+        }
+    }
+
+  /* Merge the topics by timestamp, the time line starts at the oldest
+   * sample of the log.
+   */
+
+  while (!g_replay_should_exit && ret >= 0)
+    {
+      next = NULL;
+      for (i = 0; i < ORB_RECORD_MAX_TOPICS; i++)
+        {
+          if (topics[i].pending &&
+              (next == NULL || topics[i].timestamp < next->timestamp))
+            {
+              next = &topics[i];
+              id   = i;
+            }
+        }
+
+      if (next == NULL)
+        {
+          break;
+        }
+
+      if (count == 0)
+        {
+          first = next->timestamp;
+          start = orb_absolute_time();
+        }
+      else if (speed > 0 && next->timestamp > first)
+        {
+          deadline = start + (orb_abstime)((next->timestamp - first) /
+                                           speed);
+          now      = orb_absolute_time();
+          if (deadline > now)
+            {
+              usleep(deadline - now);
+            }
+        }
+
+      if (orb_publish_multi(next->fd, next->sample, next->size) !=
+          next->size)
+        {
+          uorbinfo_raw("Topic publish error!");
+          ret = -errno;
+          break;
+        }
+
+      count++;
+      ret = replay_next(file, topics, id);
+    }
+
+out:
+  if (topics != NULL)
+    {
+      for (i = 0; i < ORB_RECORD_MAX_TOPICS; i++)
+        {
+          if (topics[i].fd >= 0)
+            {
+              orb_unadvertise(topics[i].fd);
+            }
+
+          free(topics[i].sample);
+          free(topics[i].owned);
+        }
+    }
+
+  free(topics);
+  free(payload);
+  return ret < 0 ? ret : count;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR FILE *file;
+  float speed = 1.0f;
+  int opt;
+  int ret;
+
+  g_replay_should_exit = false;
+  if (signal(SIGINT, exit_handler) == SIG_ERR)
+    {
+      return 1;
+    }
+
+  while ((opt = getopt(argc, argv, "s:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            speed = atof(optarg);
+            if (speed < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'h':
+          default:
+            goto error;
+        }
+    }
+
+  if (optind >= argc)
+    {
+      goto error;
+    }
+
+  file = fopen(argv[optind], "rb");
+  if (file == NULL)
+    {
+      uorbinfo_raw("Failed to open file:[%s]!", argv[optind]);
+      return ERROR;
+    }
+
+  ret = replay_worker(file, speed);
+  fclose(file);
+  if (ret < 0)
+    {
+      return ERROR;
+    }
+
+  uorbinfo_raw("Total number of replayed Message:%d", ret);
+  return 0;
+
+error:
+  usage();
+  return ERROR;
+}
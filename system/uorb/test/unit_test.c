@@ -1109,6 +1109,220 @@ static int test_queue_poll_notify(void)
   return OK;
 }
 
+static int test_loan(void)
+{
+  const int queue_size = 8;
+  const int nsamples   = 6;
+  FAR const struct orb_test_medium_s *sub_sample;
+  FAR struct orb_test_medium_s *sample;
+  struct orb_loan_s pub;
+  struct orb_loan_s sub;
+  int instance = 0;
+  int ptopic;
+  int sfd;
+  int ret = ERROR;
+  int i;
+
+  test_note("Testing orb loan / borrow");
+
+  ptopic = orb_advertise_multi_queue(ORB_ID(orb_test_medium_loan), NULL,
+                                     &instance, queue_size);
+  if (ptopic < 0)
+    {
+      return test_fail("advertise failed: %d", errno);
+    }
+
+  sfd = orb_subscribe(ORB_ID(orb_test_medium_loan));
+  if (sfd < 0)
+    {
+      orb_unadvertise(ptopic);
+      return test_fail("subscribe failed: %d", errno);
+    }
+
+  if (orb_loan_init(&pub, ptopic, ORB_ID(orb_test_medium_loan), 4) < 0)
+    {
+      test_fail("loan init failed: %d", errno);
+      goto out_topic;
+    }
+
+  if (orb_loan_init(&sub, sfd, ORB_ID(orb_test_medium_loan),
+                    queue_size) < 0)
+    {
+      test_fail("borrow init failed: %d", errno);
+      goto out_pub;
+    }
+
+  /* The first four samples are published when the window fills up,
+   * the remaining two on the explicit flush.
+   */
+
+  for (i = 0; i < nsamples; i++)
+    {
+      sample = orb_loan(&pub);
+      if (sample == NULL)
+        {
+          test_fail("loan(%d) failed: %d", i, errno);
+          goto out;
+        }
+
+      sample->timestamp = orb_absolute_time();
+      sample->val       = i;
+      if (orb_commit(&pub, sample) < 0)
+        {
+          test_fail("commit(%d) failed: %d", i, errno);
+          goto out;
+        }
+    }
+
+  if (orb_loan_flush(&pub) < 0)
+    {
+      test_fail("loan flush failed: %d", errno);
+      goto out;
+    }
+
+  for (i = 0; i < nsamples; i++)
+    {
+      sub_sample = orb_borrow(&sub);
+      if (sub_sample == NULL)
+        {
+          test_fail("borrow(%d) failed: %d", i, errno);
+          goto out;
+        }
+
+      if (sub_sample->val != i)
+        {
+          test_fail("borrow(%d) mismatch: %d", i, sub_sample->val);
+          goto out;
+        }
+
+      orb_release(&sub, sub_sample);
+    }
+
+  ret = test_note("PASS orb loan / borrow");
+
+out:
+  orb_loan_deinit(&sub);
+out_pub:
+  orb_loan_deinit(&pub);
+out_topic:
+  orb_unsubscribe(sfd);
+  orb_unadvertise(ptopic);
+  return ret;
+}
+
+static int test_copy_batch(void)
+{
+  const int queue_size = 4;
+  struct orb_test_medium_s samples[2 * 4];
+  struct orb_test_medium_s sample;
+  unsigned int index[2 * 4];
+  int afds[2];
+  int sfds[2];
+  int instance;
+  int ret = ERROR;
+  int i;
+
+  test_note("Testing orb batched copy");
+
+  for (i = 0; i < 2; i++)
+    {
+      instance = i;
+      afds[i] = orb_advertise_multi_queue(ORB_ID(orb_test_medium_batch),
+                                          NULL, &instance, queue_size);
+      sfds[i] = orb_subscribe_multi(ORB_ID(orb_test_medium_batch), i);
+    }
+
+  if (afds[0] < 0 || afds[1] < 0 || sfds[0] < 0 || sfds[1] < 0)
+    {
+      test_fail("advertise / subscribe failed: %d", errno);
+      goto out;
+    }
+
+  /* Interleave the timestamps of both instances, val is the merge order */
+
+  for (i = 0; i < 2 * queue_size; i++)
+    {
+      sample.timestamp = 1000 + i;
+      sample.val       = i;
+      if (orb_publish(ORB_ID(orb_test_medium_batch), afds[i % 2],
+                      &sample) < 0)
+        {
+          test_fail("publish(%d) failed: %d", i, errno);
+          goto out;
+        }
+    }
+
+  ret = orb_copy_batch(ORB_ID(orb_test_medium_batch), sfds, 2, samples,
+                       2 * queue_size, index);
+  if (ret != 2 * queue_size)
+    {
+      test_fail("copy batch returned %d, expected %d: %d",
+                ret, 2 * queue_size, errno);
+      ret = ERROR;
+      goto out;
+    }
+
+  ret = ERROR;
+  for (i = 0; i < 2 * queue_size; i++)
+    {
+      if (samples[i].val != i || index[i] != (unsigned int)(i % 2))
+        {
+          test_fail("copy batch(%d) mismatch: %d from %u", i,
+                    samples[i].val, index[i]);
+          goto out;
+        }
+    }
+
+  /* Uneven instances: the first has more queued than its share, the
+   * second less, the budget it leaves must go to the first.
+   */
+
+  for (i = 0; i < queue_size + 1; i++)
+    {
+      sample.timestamp = 2000 + i;
+      sample.val       = i;
+      if (orb_publish(ORB_ID(orb_test_medium_batch),
+                      afds[i < queue_size ? 0 : 1], &sample) < 0)
+        {
+          test_fail("publish(%d) failed: %d", i, errno);
+          goto out;
+        }
+    }
+
+  ret = orb_copy_batch(ORB_ID(orb_test_medium_batch), sfds, 2, samples,
+                       queue_size + 1, index);
+  if (ret != queue_size + 1)
+    {
+      test_fail("uneven copy batch returned %d, expected %d: %d",
+                ret, queue_size + 1, errno);
+      ret = ERROR;
+      goto out;
+    }
+
+  ret = ERROR;
+  for (i = 0; i < queue_size + 1; i++)
+    {
+      if (samples[i].val != i ||
+          index[i] != (unsigned int)(i < queue_size ? 0 : 1))
+        {
+          test_fail("uneven copy batch(%d) mismatch: %d from %u", i,
+                    samples[i].val, index[i]);
+          goto out;
+        }
+    }
+
+  ret = test_note("PASS orb batched copy");
+
+out:
+  for (i = 0; i < 2; i++)
+    {
+      orb_unsubscribe(sfds[i]);
+      orb_unadvertise(afds[i]);
+    }
+
+  return ret;
+}
+
 static int test(void)
 {
   int afds[4];
@@ -1157,6 +1371,18 @@ static int test(void)
       return ret;
     }
 
+  ret = test_loan();
+  if (ret != OK)
+    {
+      return ret;
+    }
+
+  ret = test_copy_batch();
+  if (ret != OK)
+    {
+      return ret;
+    }
+
   return test_queue_poll_notify();
 }
 
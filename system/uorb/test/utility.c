@@ -51,6 +51,8 @@ ORB_DEFINE(orb_test_medium_wrap_around, struct orb_test_medium_s,
 ORB_DEFINE(orb_test_medium_queue, struct orb_test_medium_s, orb_test_format);
 ORB_DEFINE(orb_test_medium_queue_poll, struct orb_test_medium_s,
            orb_test_format);
+ORB_DEFINE(orb_test_medium_loan, struct orb_test_medium_s, orb_test_format);
+ORB_DEFINE(orb_test_medium_batch, struct orb_test_medium_s, orb_test_format);
 ORB_DEFINE(orb_test_large, struct orb_test_large_s, orb_test_format);
 
 /****************************************************************************
@@ -65,6 +65,8 @@ ORB_DECLARE(orb_test_medium_multi);
 ORB_DECLARE(orb_test_medium_wrap_around);
 ORB_DECLARE(orb_test_medium_queue);
 ORB_DECLARE(orb_test_medium_queue_poll);
+ORB_DECLARE(orb_test_medium_loan);
+ORB_DECLARE(orb_test_medium_batch);
 
 /****************************************************************************
  * Public Function Prototypes
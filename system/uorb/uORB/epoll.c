@@ -94,50 +94,7 @@ static int orb_loop_epoll_run(FAR struct orb_loop_s *loop)
               return OK;
             }
 
-          if (et[i].events & EPOLLIN)
-            {
-              if (handle->datain_cb != NULL)
-                {
-                  handle->datain_cb(handle, handle->arg);
-                }
-              else
-                {
-                  uorberr("epoll wait data in error! fd:%d", handle->fd);
-                }
-            }
-          else if (et[i].events & EPOLLOUT)
-            {
-              if (handle->dataout_cb != NULL)
-                {
-                  handle->dataout_cb(handle, handle->arg);
-                }
-              else
-                {
-                  uorberr("epoll wait data out error! fd:%d", handle->fd);
-                }
-            }
-          else if (et[i].events & EPOLLPRI)
-            {
-              if (handle->eventpri_cb != NULL)
-                {
-                  handle->eventpri_cb(handle, handle->arg);
-                }
-              else
-                {
-                  uorberr("epoll wait events pri error! fd:%d", handle->fd);
-                }
-            }
-          else if (et[i].events & EPOLLERR)
-            {
-              if (handle->eventerr_cb != NULL)
-                {
-                  handle->eventerr_cb(handle, handle->arg);
-                }
-              else
-                {
-                  uorberr("epoll wait events error! fd:%d", handle->fd);
-                }
-            }
+          orb_loop_epoll_dispatch(handle, et[i].events);
         }
     }
 
@@ -181,3 +138,56 @@ static int orb_loop_epoll_enable(FAR struct orb_loop_s *loop,
 
   return ret;
 }
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void orb_loop_epoll_dispatch(FAR struct orb_handle_s *handle,
+                             uint32_t events)
+{
+  if (events & EPOLLIN)
+    {
+      if (handle->datain_cb != NULL)
+        {
+          handle->datain_cb(handle, handle->arg);
+        }
+      else
+        {
+          uorberr("epoll wait data in error! fd:%d", handle->fd);
+        }
+    }
+  else if (events & EPOLLOUT)
+    {
+      if (handle->dataout_cb != NULL)
+        {
+          handle->dataout_cb(handle, handle->arg);
+        }
+      else
+        {
+          uorberr("epoll wait data out error! fd:%d", handle->fd);
+        }
+    }
+  else if (events & EPOLLPRI)
+    {
+      if (handle->eventpri_cb != NULL)
+        {
+          handle->eventpri_cb(handle, handle->arg);
+        }
+      else
+        {
+          uorberr("epoll wait events pri error! fd:%d", handle->fd);
+        }
+    }
+  else if (events & EPOLLERR)
+    {
+      if (handle->eventerr_cb != NULL)
+        {
+          handle->eventerr_cb(handle, handle->arg);
+        }
+      else
+        {
+          uorberr("epoll wait events error! fd:%d", handle->fd);
+        }
+    }
+}
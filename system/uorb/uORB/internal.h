@@ -34,6 +34,9 @@
  ****************************************************************************/
 
 extern const struct orb_loop_ops_s g_orb_loop_epoll_ops;
+#ifdef CONFIG_UORB_LOOP_POOL
+extern const struct orb_loop_ops_s g_orb_loop_pool_ops;
+#endif
 
 /****************************************************************************
  * Public Types
@@ -48,4 +51,23 @@ struct orb_loop_ops_s
                      FAR struct orb_handle_s *handle, bool en);
 };
 
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: orb_loop_epoll_dispatch
+ *
+ * Description:
+ *   Invoke the user callback of a handle matching the ready epoll events.
+ *
+ * Input Parameters:
+ *   handle   The ready handle.
+ *   events   The epoll events reported for the handle.
+ *
+ ****************************************************************************/
+
+void orb_loop_epoll_dispatch(FAR struct orb_handle_s *handle,
+                             uint32_t events);
+
 #endif /* __APP_SYSTEM_UORB_UORB_INTERNAL_H */
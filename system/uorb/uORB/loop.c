@@ -53,6 +53,12 @@ int orb_loop_init(FAR struct orb_loop_s *loop, enum orb_loop_type_e type)
         loop->ops = &g_orb_loop_epoll_ops;
         break;
 
+#ifdef CONFIG_UORB_LOOP_POOL
+      case ORB_POOL_TYPE:
+        loop->ops = &g_orb_loop_pool_ops;
+        break;
+#endif
+
       default:
         uorberr("loop register type error! type:%d", type);
         return ret;
@@ -154,9 +160,22 @@ int orb_handle_init(FAR struct orb_handle_s *handle, int fd, int events,
   handle->eventerr_cb = err_cb;
   handle->datain_cb   = datain_cb;
   handle->dataout_cb  = dataout_cb;
+#ifdef CONFIG_UORB_LOOP_POOL
+  handle->priority    = 0;
+  handle->revents     = 0;
+  handle->next        = NULL;
+#endif
+
+  return OK;
+}
 
+#ifdef CONFIG_UORB_LOOP_POOL
+int orb_handle_set_priority(FAR struct orb_handle_s *handle, int priority)
+{
+  handle->priority = priority;
   return OK;
 }
+#endif
 
 int orb_handle_start(FAR struct orb_loop_s *loop,
                      FAR struct orb_handle_s *handle)
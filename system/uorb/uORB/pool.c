@@ -0,0 +1,524 @@
+/****************************************************************************
+ * apps/system/uorb/uORB/pool.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "internal.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ORB_POOL_NTHREADS    CONFIG_UORB_LOOP_POOL_NTHREADS
+#define ORB_POOL_URGENT      (EPOLLPRI | EPOLLERR)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct orb_pool_s;
+
+/* Each worker owns a ready queue sorted by priority.  The poller pushes to
+ * the shortest queue, a worker pops from its own queue first and steals
+ * from the longest other queue when its own one is empty.
+ */
+
+struct orb_pool_worker_s
+{
+  pthread_mutex_t          lock;    /* Protects head and count */
+  FAR struct orb_handle_s *head;    /* Ready handles, highest first */
+  unsigned int             count;   /* Number of queued handles */
+  pthread_t                thread;  /* Worker thread */
+  FAR struct orb_pool_s   *pool;    /* Owner pool */
+  FAR struct orb_handle_s *running; /* Handle being dispatched */
+  bool                     skip;    /* Do not re-arm running handle */
+};
+
+/* Lock order: pool->lock, then a worker lock */
+
+struct orb_pool_s
+{
+  FAR struct orb_loop_s   *loop;    /* Owner loop */
+  sem_t                    ready;   /* Counts handles queued in workers */
+  volatile bool            exit;    /* Workers should exit */
+  pthread_mutex_t          lock;    /* Protects running and skip */
+  pthread_cond_t           done;    /* A dispatch has finished */
+  struct orb_pool_worker_s workers[ORB_POOL_NTHREADS];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int orb_loop_pool_init(FAR struct orb_loop_s *loop);
+static int orb_loop_pool_run(FAR struct orb_loop_s *loop);
+static int orb_loop_pool_uninit(FAR struct orb_loop_s *loop);
+static int orb_loop_pool_enable(FAR struct orb_loop_s *loop,
+                                FAR struct orb_handle_s *handle, bool en);
+
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+const struct orb_loop_ops_s g_orb_loop_pool_ops =
+{
+  .init   = orb_loop_pool_init,
+  .run    = orb_loop_pool_run,
+  .uninit = orb_loop_pool_uninit,
+  .enable = orb_loop_pool_enable,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static bool orb_pool_before(FAR struct orb_handle_s *a,
+                            FAR struct orb_handle_s *b)
+{
+  bool urgent_a = (a->revents & ORB_POOL_URGENT) != 0;
+  bool urgent_b = (b->revents & ORB_POOL_URGENT) != 0;
+
+  if (urgent_a != urgent_b)
+    {
+      return urgent_a;
+    }
+
+  return a->priority > b->priority;
+}
+
+static void orb_pool_push(FAR struct orb_pool_s *pool,
+                          FAR struct orb_handle_s *handle)
+{
+  FAR struct orb_pool_worker_s *worker = &pool->workers[0];
+  FAR struct orb_handle_s **pprev;
+  int i;
+
+  for (i = 1; i < ORB_POOL_NTHREADS; i++)
+    {
+      if (pool->workers[i].count < worker->count)
+        {
+          worker = &pool->workers[i];
+        }
+    }
+
+  /* Keep FIFO order between handles of the same priority */
+
+  pthread_mutex_lock(&worker->lock);
+  pprev = &worker->head;
+  while (*pprev != NULL && !orb_pool_before(handle, *pprev))
+    {
+      pprev = &(*pprev)->next;
+    }
+
+  handle->next = *pprev;
+  *pprev       = handle;
+  worker->count++;
+  pthread_mutex_unlock(&worker->lock);
+
+  sem_post(&pool->ready);
+}
+
+static FAR struct orb_handle_s *
+orb_pool_pop(FAR struct orb_pool_worker_s *worker)
+{
+  FAR struct orb_handle_s *handle;
+
+  pthread_mutex_lock(&worker->lock);
+  handle = worker->head;
+  if (handle != NULL)
+    {
+      worker->head = handle->next;
+      worker->count--;
+      handle->next = NULL;
+    }
+
+  pthread_mutex_unlock(&worker->lock);
+  return handle;
+}
+
+static FAR struct orb_handle_s *
+orb_pool_steal(FAR struct orb_pool_s *pool)
+{
+  FAR struct orb_pool_worker_s *victim;
+  FAR struct orb_handle_s *handle;
+  int i;
+
+  /* The counts are read unlocked, they only pick the victim.  Retry while
+   * any handle is queued; nothing is left only if the handle behind the
+   * semaphore count was stopped meanwhile.
+   */
+
+  do
+    {
+      victim = NULL;
+      for (i = 0; i < ORB_POOL_NTHREADS; i++)
+        {
+          if (pool->workers[i].count > 0 &&
+              (victim == NULL || pool->workers[i].count > victim->count))
+            {
+              victim = &pool->workers[i];
+            }
+        }
+
+      if (victim == NULL)
+        {
+          return NULL;
+        }
+
+      handle = orb_pool_pop(victim);
+    }
+  while (handle == NULL);
+
+  return handle;
+}
+
+static void orb_pool_remove(FAR struct orb_pool_s *pool,
+                            FAR struct orb_handle_s *handle)
+{
+  FAR struct orb_pool_worker_s *worker;
+  FAR struct orb_handle_s **pprev;
+  int i;
+
+  /* A stopped handle must not be dispatched anymore.  Its semaphore count
+   * is left behind, the woken worker then finds nothing to steal.
+   */
+
+  for (i = 0; i < ORB_POOL_NTHREADS; i++)
+    {
+      worker = &pool->workers[i];
+      pthread_mutex_lock(&worker->lock);
+      for (pprev = &worker->head; *pprev != NULL; pprev = &(*pprev)->next)
+        {
+          if (*pprev == handle)
+            {
+              *pprev       = handle->next;
+              handle->next = NULL;
+              worker->count--;
+              break;
+            }
+        }
+
+      pthread_mutex_unlock(&worker->lock);
+    }
+}
+
+static int orb_pool_arm(FAR struct orb_loop_s *loop,
+                        FAR struct orb_handle_s *handle, int op)
+{
+  struct epoll_event ev;
+
+  /* One shot, so that a handle is never run by two workers at once */
+
+  ev.events   = handle->events | EPOLLONESHOT;
+  ev.data.ptr = handle;
+  if (epoll_ctl(loop->fd, op, handle->fd, &ev) < 0)
+    {
+      return -errno;
+    }
+
+  return OK;
+}
+
+static void orb_pool_stop(FAR struct orb_pool_s *pool,
+                          FAR struct orb_handle_s *handle)
+{
+  FAR struct orb_pool_worker_s *self = NULL;
+  bool busy;
+  int i;
+
+  /* A handle stopped from a worker callback is not waited for, that could
+   * deadlock two callbacks stopping each other's handle.  It is only kept
+   * from being re-armed.
+   */
+
+  pthread_mutex_lock(&pool->lock);
+  for (i = 0; i < ORB_POOL_NTHREADS; i++)
+    {
+      if (pool->workers[i].running != NULL &&
+          pthread_equal(pool->workers[i].thread, pthread_self()))
+        {
+          self = &pool->workers[i];
+        }
+    }
+
+  do
+    {
+      busy = false;
+      for (i = 0; i < ORB_POOL_NTHREADS; i++)
+        {
+          if (pool->workers[i].running == handle)
+            {
+              pool->workers[i].skip = true;
+              busy |= self == NULL;
+            }
+        }
+
+      if (busy)
+        {
+          pthread_cond_wait(&pool->done, &pool->lock);
+        }
+    }
+  while (busy);
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static FAR void *orb_pool_worker(FAR void *arg)
+{
+  FAR struct orb_pool_worker_s *worker = arg;
+  FAR struct orb_pool_s *pool = worker->pool;
+  FAR struct orb_handle_s *handle;
+
+  while (1)
+    {
+      if (sem_wait(&pool->ready) < 0)
+        {
+          continue;
+        }
+
+      if (pool->exit)
+        {
+          break;
+        }
+
+      /* Take the handle and mark it running in one step under the pool
+       * lock, so that orb_pool_stop() either finds it still queued or
+       * finds it running, never in between.
+       */
+
+      pthread_mutex_lock(&pool->lock);
+      handle = orb_pool_pop(worker);
+      if (handle == NULL)
+        {
+          handle = orb_pool_steal(pool);
+        }
+
+      worker->running = handle;
+      worker->skip    = false;
+      pthread_mutex_unlock(&pool->lock);
+
+      if (handle == NULL)
+        {
+          continue;
+        }
+
+      orb_loop_epoll_dispatch(handle, handle->revents);
+
+      /* Re-arm under the lock, a handle stopped meanwhile is not touched
+       * anymore, its fd may be closed already.
+       */
+
+      pthread_mutex_lock(&pool->lock);
+      if (!worker->skip &&
+          orb_pool_arm(pool->loop, handle, EPOLL_CTL_MOD) < 0)
+        {
+          uorbinfo("pool rearm failed! fd:%d", handle->fd);
+        }
+
+      worker->running = NULL;
+      pthread_cond_broadcast(&pool->done);
+      pthread_mutex_unlock(&pool->lock);
+    }
+
+  return NULL;
+}
+
+static int orb_loop_pool_init(FAR struct orb_loop_s *loop)
+{
+  FAR struct orb_pool_s *pool;
+  int i;
+
+  pool = calloc(1, sizeof(struct orb_pool_s));
+  if (pool == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  loop->fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->fd < 0)
+    {
+      free(pool);
+      return -errno;
+    }
+
+  pool->loop = loop;
+  sem_init(&pool->ready, 0, 0);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (i = 0; i < ORB_POOL_NTHREADS; i++)
+    {
+      pthread_mutex_init(&pool->workers[i].lock, NULL);
+      pool->workers[i].pool = pool;
+    }
+
+  loop->priv = pool;
+  return OK;
+}
+
+static int orb_loop_pool_run(FAR struct orb_loop_s *loop)
+{
+  struct epoll_event et[CONFIG_UORB_LOOP_MAX_EVENTS];
+  FAR struct orb_pool_s *pool = loop->priv;
+  FAR struct orb_handle_s *handle;
+  pthread_attr_t attr;
+  eventfd_t value;
+  int ret = OK;
+  int nfds;
+  int i;
+  int n;
+
+  pool->exit = false;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, CONFIG_UORB_LOOP_POOL_STACKSIZE);
+  for (n = 0; n < ORB_POOL_NTHREADS; n++)
+    {
+      ret = -pthread_create(&pool->workers[n].thread, &attr,
+                            orb_pool_worker, &pool->workers[n]);
+      if (ret < 0)
+        {
+          uorberr("pool worker create failed! ret:%d", ret);
+          break;
+        }
+    }
+
+  pthread_attr_destroy(&attr);
+
+  while (ret == OK)
+    {
+      nfds = epoll_wait(loop->fd, et, CONFIG_UORB_LOOP_MAX_EVENTS, -1);
+      if (nfds == -1 && errno != EINTR)
+        {
+          ret = -errno;
+          break;
+        }
+
+      for (i = 0; i < nfds; i++)
+        {
+          handle = et[i].data.ptr;
+          if (handle == NULL)
+            {
+              continue;
+            }
+          else if (handle == &loop->exit_handle)
+            {
+              read(handle->fd, &value, sizeof(value));
+              orb_pool_arm(loop, handle, EPOLL_CTL_MOD);
+              ret = 1;
+              continue;
+            }
+
+          handle->revents = et[i].events;
+          orb_pool_push(pool, handle);
+        }
+    }
+
+  /* Stop the workers */
+
+  pool->exit = true;
+  for (i = 0; i < n; i++)
+    {
+      sem_post(&pool->ready);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      pthread_join(pool->workers[i].thread, NULL);
+    }
+
+  /* The handles still queued fired their one shot event and nobody
+   * dispatched them, arm them again so that they run after a restart.
+   */
+
+  for (i = 0; i < ORB_POOL_NTHREADS; i++)
+    {
+      while ((handle = orb_pool_pop(&pool->workers[i])) != NULL)
+        {
+          orb_pool_arm(loop, handle, EPOLL_CTL_MOD);
+        }
+    }
+
+  sem_destroy(&pool->ready);
+  sem_init(&pool->ready, 0, 0);
+
+  return ret > 0 ? OK : ret;
+}
+
+static int orb_loop_pool_uninit(FAR struct orb_loop_s *loop)
+{
+  FAR struct orb_pool_s *pool = loop->priv;
+  int ret;
+  int i;
+
+  ret = close(loop->fd);
+  if (ret < 0)
+    {
+      return -errno;
+    }
+
+  for (i = 0; i < ORB_POOL_NTHREADS; i++)
+    {
+      pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+
+  pthread_cond_destroy(&pool->done);
+  pthread_mutex_destroy(&pool->lock);
+
+  sem_destroy(&pool->ready);
+  free(pool);
+  loop->priv = NULL;
+  return ret;
+}
+
+static int orb_loop_pool_enable(FAR struct orb_loop_s *loop,
+                                FAR struct orb_handle_s *handle, bool en)
+{
+  int ret;
+
+  if (en)
+    {
+      return orb_pool_arm(loop, handle, EPOLL_CTL_ADD);
+    }
+
+  /* Delete it first so that it can not fire again, then drop it from the
+   * queues and wait for a worker still dispatching it.
+   */
+
+  ret = epoll_ctl(loop->fd, EPOLL_CTL_DEL, handle->fd, NULL);
+  if (ret < 0)
+    {
+      ret = -errno;
+    }
+
+  orb_pool_remove(loop->priv, handle);
+  orb_pool_stop(loop->priv, handle);
+  return ret;
+}
@@ -0,0 +1,327 @@
+/****************************************************************************
+ * apps/system/uorb/uORB/record.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/param.h>
+
+#include "record.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct orb_recorder_s
+{
+  int             fd;                   /* Log file */
+  pthread_t       thread;               /* Background writer */
+  pthread_mutex_t lock;                 /* Protects the fields below */
+  pthread_cond_t  cond;                 /* Signals a full buffer / exit */
+  FAR uint8_t    *buf[2];               /* Double buffer */
+  size_t          len[2];               /* Bytes used in each buffer */
+  int             active;               /* Buffer being filled */
+  bool            pending;              /* The other buffer is full */
+  bool            exit;                 /* Writer should exit */
+  int             error;                /* First write error */
+  int             dropped;              /* Samples dropped */
+  int             ntopics;              /* Topics declared */
+  uint16_t        esize[ORB_RECORD_MAX_TOPICS];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int orb_record_store(FAR struct orb_recorder_s *rec,
+                            FAR const uint8_t *data, size_t len)
+{
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = write(rec->fd, data, len);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      data += ret;
+      len  -= ret;
+    }
+
+  return 0;
+}
+
+static FAR void *orb_record_thread(FAR void *arg)
+{
+  FAR struct orb_recorder_s *rec = arg;
+  int idx;
+  int ret;
+
+  pthread_mutex_lock(&rec->lock);
+  while (1)
+    {
+      while (!rec->pending && !rec->exit)
+        {
+          pthread_cond_wait(&rec->cond, &rec->lock);
+        }
+
+      if (!rec->pending)
+        {
+          break;
+        }
+
+      /* The producer does not touch the full buffer until pending is
+       * cleared, so it is stored without holding the lock.
+       */
+
+      idx = rec->active ^ 1;
+      pthread_mutex_unlock(&rec->lock);
+      ret = orb_record_store(rec, rec->buf[idx], rec->len[idx]);
+      pthread_mutex_lock(&rec->lock);
+
+      if (ret < 0 && rec->error == 0)
+        {
+          rec->error = ret;
+        }
+
+      rec->len[idx] = 0;
+      rec->pending  = false;
+    }
+
+  pthread_mutex_unlock(&rec->lock);
+  return NULL;
+}
+
+static int orb_record_append(FAR struct orb_recorder_s *rec,
+                             FAR const struct orb_record_msg_s *msg,
+                             FAR const void *payload)
+{
+  size_t need = sizeof(*msg) + msg->size;
+  FAR uint8_t *ptr;
+
+  if (need > CONFIG_UORB_RECORD_BUFSIZE)
+    {
+      return -EMSGSIZE;
+    }
+
+  pthread_mutex_lock(&rec->lock);
+  if (rec->len[rec->active] + need > CONFIG_UORB_RECORD_BUFSIZE)
+    {
+      if (rec->pending)
+        {
+          pthread_mutex_unlock(&rec->lock);
+          return -ENOBUFS;
+        }
+
+      rec->pending = true;
+      rec->active ^= 1;
+      pthread_cond_signal(&rec->cond);
+    }
+
+  ptr = rec->buf[rec->active] + rec->len[rec->active];
+  memcpy(ptr, msg, sizeof(*msg));
+  memcpy(ptr + sizeof(*msg), payload, msg->size);
+  rec->len[rec->active] += need;
+  pthread_mutex_unlock(&rec->lock);
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+FAR struct orb_recorder_s *orb_record_open(FAR const char *path)
+{
+  FAR struct orb_recorder_s *rec;
+  struct orb_record_header_s header;
+  int ret;
+
+  rec = calloc(1, sizeof(struct orb_recorder_s) +
+                 2 * CONFIG_UORB_RECORD_BUFSIZE);
+  if (rec == NULL)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+  rec->buf[0] = (FAR uint8_t *)(rec + 1);
+  rec->buf[1] = rec->buf[0] + CONFIG_UORB_RECORD_BUFSIZE;
+
+  rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (rec->fd < 0)
+    {
+      goto err_rec;
+    }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ORB_RECORD_MAGIC, sizeof(header.magic));
+  header.version   = ORB_RECORD_VERSION;
+  header.timestamp = orb_absolute_time();
+
+  ret = orb_record_store(rec, (FAR const uint8_t *)&header, sizeof(header));
+  if (ret < 0)
+    {
+      errno = -ret;
+      goto err_fd;
+    }
+
+  pthread_mutex_init(&rec->lock, NULL);
+  pthread_cond_init(&rec->cond, NULL);
+  ret = pthread_create(&rec->thread, NULL, orb_record_thread, rec);
+  if (ret != 0)
+    {
+      pthread_cond_destroy(&rec->cond);
+      pthread_mutex_destroy(&rec->lock);
+      errno = ret;
+      goto err_fd;
+    }
+
+  return rec;
+
+err_fd:
+  close(rec->fd);
+err_rec:
+  free(rec);
+  return NULL;
+}
+
+int orb_record_add_topic(FAR struct orb_recorder_s *rec,
+                         FAR const struct orb_metadata *meta, int instance,
+                         unsigned int queue_size)
+{
+  struct
+  {
+    struct orb_record_topic_s topic;
+    char                      name[NAME_MAX];
+  } payload;
+
+  FAR struct orb_record_topic_s *topic = &payload.topic;
+  struct orb_record_msg_s msg;
+  size_t namelen;
+  int ret;
+
+  if (rec->ntopics >= ORB_RECORD_MAX_TOPICS)
+    {
+      return -ENOSPC;
+    }
+
+  namelen = strnlen(meta->o_name, NAME_MAX - 1);
+  topic->o_size   = meta->o_size;
+  topic->instance = instance;
+  topic->queue    = MIN(queue_size, UINT8_MAX);
+  memcpy(topic->name, meta->o_name, namelen);
+  topic->name[namelen] = '\0';
+
+  msg.type = ORB_RECORD_TOPIC;
+  msg.id   = rec->ntopics;
+  msg.size = offsetof(struct orb_record_topic_s, name) + namelen + 1;
+
+  ret = orb_record_append(rec, &msg, topic);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  rec->esize[rec->ntopics] = meta->o_size;
+  return rec->ntopics++;
+}
+
+int orb_record_write(FAR struct orb_recorder_s *rec, int id,
+                     FAR const void *data, size_t len)
+{
+  FAR const uint8_t *sample = data;
+  struct orb_record_msg_s msg;
+  int ret = 0;
+
+  if (id < 0 || id >= rec->ntopics)
+    {
+      return -EINVAL;
+    }
+
+  msg.type = ORB_RECORD_DATA;
+  msg.id   = id;
+  msg.size = rec->esize[id];
+
+  for (; len >= msg.size; len -= msg.size, sample += msg.size)
+    {
+      if (orb_record_append(rec, &msg, sample) < 0)
+        {
+          pthread_mutex_lock(&rec->lock);
+          rec->dropped++;
+          pthread_mutex_unlock(&rec->lock);
+          ret = -ENOBUFS;
+        }
+    }
+
+  return ret;
+}
+
+int orb_record_close(FAR struct orb_recorder_s *rec)
+{
+  int ret;
+
+  pthread_mutex_lock(&rec->lock);
+  rec->exit = true;
+  pthread_cond_signal(&rec->cond);
+  pthread_mutex_unlock(&rec->lock);
+  pthread_join(rec->thread, NULL);
+
+  /* The writer is gone, store what is left in the active buffer */
+
+  ret = orb_record_store(rec, rec->buf[rec->active], rec->len[rec->active]);
+  if (ret == 0)
+    {
+      ret = rec->error;
+    }
+
+  if (close(rec->fd) < 0 && ret == 0)
+    {
+      ret = -errno;
+    }
+
+  if (ret == 0)
+    {
+      ret = rec->dropped;
+    }
+
+  pthread_cond_destroy(&rec->cond);
+  pthread_mutex_destroy(&rec->lock);
+  free(rec);
+  return ret;
+}
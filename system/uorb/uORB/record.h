@@ -0,0 +1,172 @@
+/****************************************************************************
+ * apps/system/uorb/uORB/record.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APP_SYSTEM_UORB_UORB_RECORD_H
+#define __APP_SYSTEM_UORB_UORB_RECORD_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <uORB/uORB.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Binary log layout, all fields in target byte order:
+ *
+ *   struct orb_record_header_s
+ *   { struct orb_record_msg_s, payload[msg.size] } ...
+ *
+ * A topic message declares a topic id before any of its data messages.
+ * A data message carries one raw sample, starting with its timestamp.
+ */
+
+#define ORB_RECORD_MAGIC       "ORBLOG"
+#define ORB_RECORD_VERSION     1
+
+#define ORB_RECORD_TOPIC       1    /* Payload: orb_record_topic_s + name */
+#define ORB_RECORD_DATA        2    /* Payload: one raw sample */
+
+#define ORB_RECORD_MAX_TOPICS  256
+
+#ifndef CONFIG_UORB_RECORD_BUFSIZE
+#  define CONFIG_UORB_RECORD_BUFSIZE 8192
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct orb_record_header_s
+{
+  char        magic[7];     /* ORB_RECORD_MAGIC */
+  uint8_t     version;      /* ORB_RECORD_VERSION */
+  orb_abstime timestamp;    /* Time the log was started */
+};
+
+struct orb_record_msg_s
+{
+  uint16_t    size;         /* Payload size following the message */
+  uint8_t     type;         /* ORB_RECORD_TOPIC / ORB_RECORD_DATA */
+  uint8_t     id;           /* Topic id */
+};
+
+struct orb_record_topic_s
+{
+  uint16_t    o_size;       /* Sample size */
+  uint8_t     instance;     /* Topic instance */
+  uint8_t     queue;        /* Queue depth when recorded, 0 means 1 */
+  char        name[1];      /* NUL terminated topic name */
+};
+
+struct orb_recorder_s;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: orb_record_open
+ *
+ * Description:
+ *   Create a binary log and start its background writer.  Messages are
+ *   collected in one of two CONFIG_UORB_RECORD_BUFSIZE buffers while the
+ *   writer thread stores the other one, so the caller never blocks on the
+ *   storage device.
+ *
+ * Input Parameters:
+ *   path   The path of the log file.
+ *
+ * Returned Value:
+ *   The recorder on success, NULL otherwise with errno set accordingly.
+ ****************************************************************************/
+
+FAR struct orb_recorder_s *orb_record_open(FAR const char *path);
+
+/****************************************************************************
+ * Name: orb_record_add_topic
+ *
+ * Description:
+ *   Declare a topic instance in the log.
+ *
+ * Input Parameters:
+ *   rec          The recorder.
+ *   meta         The uORB metadata.
+ *   instance     The topic instance.
+ *   queue_size   Queue depth of the topic, saturated to UINT8_MAX.
+ *
+ * Returned Value:
+ *   The topic id on success, negative errno on failure.
+ ****************************************************************************/
+
+int orb_record_add_topic(FAR struct orb_recorder_s *rec,
+                         FAR const struct orb_metadata *meta, int instance,
+                         unsigned int queue_size);
+
+/****************************************************************************
+ * Name: orb_record_write
+ *
+ * Description:
+ *   Append samples of a topic to the log.  len may hold several samples,
+ *   as returned by one orb_copy_multi() on a queued topic.
+ *
+ * Input Parameters:
+ *   rec    The recorder.
+ *   id     The topic id from orb_record_add_topic().
+ *   data   The raw samples.
+ *   len    Length of data, a multiple of the topic size.
+ *
+ * Returned Value:
+ *   0 on success, negative errno if samples were dropped.
+ ****************************************************************************/
+
+int orb_record_write(FAR struct orb_recorder_s *rec, int id,
+                     FAR const void *data, size_t len);
+
+/****************************************************************************
+ * Name: orb_record_close
+ *
+ * Description:
+ *   Flush all buffered messages, stop the writer and close the log.
+ *
+ * Input Parameters:
+ *   rec    The recorder.
+ *
+ * Returned Value:
+ *   Number of samples dropped because the writer fell behind, or negative
+ *   errno on failure.
+ ****************************************************************************/
+
+int orb_record_close(FAR struct orb_recorder_s *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APP_SYSTEM_UORB_UORB_RECORD_H */
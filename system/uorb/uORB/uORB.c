@@ -27,14 +27,32 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <time.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/param.h>
 
 #include <nuttx/streams.h>
 #include <uORB/uORB.h>
 
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A run of samples read from one instance with a single read(), ordered
+ * by timestamp
+ */
+
+struct orb_batch_run_s
+{
+  FAR const uint8_t *data;      /* Next sample of the run */
+  unsigned int       count;     /* Samples left in the run */
+  unsigned int       instance;  /* Position of the fd in the fds array */
+  bool               full;      /* The read returned all it was asked */
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -155,6 +173,55 @@ orb_advertise_multi_queue_flags(FAR const struct orb_metadata *meta,
   return fd;
 }
 
+/****************************************************************************
+ * Name: orb_sample_timestamp
+ *
+ * Description:
+ *   Read the leading timestamp of a sample which may be unaligned.
+ ****************************************************************************/
+
+static inline orb_abstime orb_sample_timestamp(FAR const uint8_t *sample)
+{
+  orb_abstime timestamp;
+
+  memcpy(&timestamp, sample, sizeof(timestamp));
+  return timestamp;
+}
+
+/****************************************************************************
+ * Name: orb_batch_read
+ *
+ * Description:
+ *   Read up to count samples of one instance as a new run.  Returns the
+ *   number of samples read, errors other than EAGAIN are kept in err.
+ ****************************************************************************/
+
+static unsigned int orb_batch_read(int fd, unsigned int instance,
+                                   FAR uint8_t *data, unsigned int count,
+                                   size_t esize,
+                                   FAR struct orb_batch_run_s *run,
+                                   FAR int *err)
+{
+  ssize_t ret;
+
+  ret = orb_copy_multi(fd, data, count * esize);
+  if (ret < 0)
+    {
+      if (errno != EAGAIN)
+        {
+          *err = errno;
+        }
+
+      return 0;
+    }
+
+  run->data     = data;
+  run->count    = ret / esize;
+  run->instance = instance;
+  run->full     = run->count == count;
+  return run->count;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -205,6 +272,322 @@ ssize_t orb_copy_multi(int fd, FAR void *buffer, size_t len)
   return read(fd, buffer, len);
 }
 
+ssize_t orb_copy_batch(FAR const struct orb_metadata *meta,
+                       FAR const int *fds, unsigned int nfds,
+                       FAR void *buffer, unsigned int nsamples,
+                       FAR unsigned int *index)
+{
+  FAR struct orb_batch_run_s *runs;
+  FAR struct orb_batch_run_s *run;
+  FAR uint8_t *base = buffer;
+  FAR uint8_t *scratch;
+  struct orb_state state;
+  unsigned int nruns = 0;
+  unsigned int nfull = 0;
+  unsigned int total = 0;
+  unsigned int count;
+  unsigned int first;
+  unsigned int i;
+  unsigned int j;
+  size_t esize;
+  int err = 0;
+
+  if (meta == NULL || fds == NULL || buffer == NULL || nfds == 0 ||
+      meta->o_size < sizeof(orb_abstime))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  if (nsamples == 0)
+    {
+      return 0;
+    }
+
+  /* The instances are read into a scratch area as runs and merged from
+   * there into the caller's buffer.  Every instance is read at most
+   * twice, so there are at most 2 * nfds runs.
+   */
+
+  esize = meta->o_size;
+  runs  = malloc(2 * nfds * sizeof(*runs) + nsamples * esize);
+  if (runs == NULL)
+    {
+      errno = ENOMEM;
+      return -1;
+    }
+
+  scratch = (FAR uint8_t *)&runs[2 * nfds];
+
+  /* First pass: every instance gets an equal part of what is left of the
+   * budget, capped by its queue depth since a read can not return more.
+   * What a short instance leaves over goes to the instances after it.
+   */
+
+  for (i = 0; i < nfds && total < nsamples; i++)
+    {
+      count = MAX((nsamples - total) / (nfds - i), 1);
+      if (orb_get_state(fds[i], &state) >= 0 && state.queue_size > 0)
+        {
+          count = MIN(count, state.queue_size);
+        }
+
+      run = &runs[nruns];
+      if (orb_batch_read(fds[i], i, scratch + total * esize, count,
+                         esize, run, &err) > 0)
+        {
+          total += run->count;
+          nfull += run->full;
+          nruns++;
+        }
+    }
+
+  /* Second pass: give the rest of the budget to the instances that
+   * filled their first read and may have more queued.
+   */
+
+  first = nruns;
+  for (j = 0; j < first && total < nsamples && nfull > 0; j++)
+    {
+      bool updated = false;
+
+      if (!runs[j].full)
+        {
+          continue;
+        }
+
+      /* Do not block in read() on an instance that was drained exactly */
+
+      count = MAX((nsamples - total) / nfull--, 1);
+      if (orb_check(fds[runs[j].instance], &updated) < 0 || !updated)
+        {
+          continue;
+        }
+
+      run   = &runs[nruns];
+      if (orb_batch_read(fds[runs[j].instance], runs[j].instance,
+                         scratch + total * esize, count, esize, run,
+                         &err) > 0)
+        {
+          total += run->count;
+          nruns++;
+        }
+    }
+
+  /* k-way merge of the runs by timestamp.  Equal timestamps keep the
+   * instance order, and runs of the same instance keep read order.
+   */
+
+  for (i = 0; i < total; i++)
+    {
+      FAR struct orb_batch_run_s *next = NULL;
+      orb_abstime next_ts = 0;
+
+      for (j = 0; j < nruns; j++)
+        {
+          orb_abstime ts;
+
+          run = &runs[j];
+          if (run->count == 0)
+            {
+              continue;
+            }
+
+          ts = orb_sample_timestamp(run->data);
+          if (next == NULL || ts < next_ts ||
+              (ts == next_ts && run->instance < next->instance))
+            {
+              next    = run;
+              next_ts = ts;
+            }
+        }
+
+      memcpy(base + i * esize, next->data, esize);
+      if (index != NULL)
+        {
+          index[i] = next->instance;
+        }
+
+      next->data += esize;
+      next->count--;
+    }
+
+  free(runs);
+
+  if (total == 0 && err != 0)
+    {
+      errno = err;
+      return -1;
+    }
+
+  return total;
+}
+
+int orb_loan_init(FAR struct orb_loan_s *loan, int fd,
+                  FAR const struct orb_metadata *meta, unsigned int depth)
+{
+  int flags;
+
+  if (loan == NULL || meta == NULL)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  flags = fcntl(fd, F_GETFL);
+  if (flags < 0)
+    {
+      return -1;
+    }
+
+  memset(loan, 0, sizeof(*loan));
+  loan->depth  = depth ? depth : 1;
+  loan->buffer = malloc(loan->depth * meta->o_size);
+  if (loan->buffer == NULL)
+    {
+      errno = ENOMEM;
+      return -1;
+    }
+
+  loan->fd     = fd;
+  loan->esize  = meta->o_size;
+  loan->writer = (flags & O_ACCMODE) != O_RDONLY;
+  return 0;
+}
+
+int orb_loan_deinit(FAR struct orb_loan_s *loan)
+{
+  int ret = 0;
+
+  if (loan->writer)
+    {
+      ret = orb_loan_flush(loan);
+    }
+
+  free(loan->buffer);
+  loan->buffer = NULL;
+  return ret;
+}
+
+FAR void *orb_loan(FAR struct orb_loan_s *loan)
+{
+  if (!loan->writer)
+    {
+      errno = EBADF;
+      return NULL;
+    }
+
+  if (loan->busy)
+    {
+      errno = EBUSY;
+      return NULL;
+    }
+
+  loan->busy = true;
+  return loan->buffer + loan->nvalid * loan->esize;
+}
+
+int orb_commit(FAR struct orb_loan_s *loan, FAR void *data)
+{
+  if (!loan->busy || data != loan->buffer + loan->nvalid * loan->esize)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  loan->busy = false;
+  if (++loan->nvalid < loan->depth)
+    {
+      return 0;
+    }
+
+  return orb_loan_flush(loan);
+}
+
+int orb_loan_flush(FAR struct orb_loan_s *loan)
+{
+  size_t len = loan->nvalid * loan->esize;
+  ssize_t ret;
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  /* The samples are dropped even on failure, a retry would publish them
+   * again behind samples committed later.
+   */
+
+  loan->nvalid = 0;
+  ret = orb_publish_multi(loan->fd, loan->buffer, len);
+  if (ret < 0)
+    {
+      return -1;
+    }
+
+  if ((size_t)ret != len)
+    {
+      uorberr("loan flush %zd, expect %zu", ret, len);
+      errno = EIO;
+      return -1;
+    }
+
+  return 0;
+}
+
+FAR const void *orb_borrow(FAR struct orb_loan_s *loan)
+{
+  ssize_t ret;
+
+  if (loan->writer)
+    {
+      errno = EBADF;
+      return NULL;
+    }
+
+  if (loan->busy)
+    {
+      errno = EBUSY;
+      return NULL;
+    }
+
+  if (loan->pos >= loan->nvalid)
+    {
+      ret = orb_copy_multi(loan->fd, loan->buffer,
+                           loan->depth * loan->esize);
+      if (ret <= 0)
+        {
+          if (ret == 0)
+            {
+              errno = EAGAIN;
+            }
+
+          loan->nvalid = 0;
+          loan->pos    = 0;
+          return NULL;
+        }
+
+      loan->nvalid = ret / loan->esize;
+      loan->pos    = 0;
+    }
+
+  loan->busy = true;
+  return loan->buffer + loan->pos * loan->esize;
+}
+
+int orb_release(FAR struct orb_loan_s *loan, FAR const void *data)
+{
+  if (!loan->busy || data != loan->buffer + loan->pos * loan->esize)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  loan->busy = false;
+  loan->pos++;
+  return 0;
+}
+
 int orb_get_state(int fd, FAR struct orb_state *state)
 {
   struct sensor_state_s tmp;
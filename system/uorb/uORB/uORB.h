@@ -77,6 +77,24 @@ struct orb_state
   uint64_t generation;          /* Mainline generation */
 };
 
+/* A loan window over a topic fd.  Publishers build samples in place in the
+ * window and commit them, subscribers borrow samples from the window and
+ * release them.  The window is exchanged with the topic ring buffer in one
+ * transfer of up to depth elements, so callers never stage a private copy.
+ */
+
+struct orb_loan_s
+{
+  int          fd;        /* Topic fd the window belongs to */
+  uint16_t     esize;     /* Element size, from orb_metadata.o_size */
+  bool         writer;    /* True if fd was opened by an advertiser */
+  bool         busy;      /* An element is currently loaned / borrowed */
+  unsigned int depth;     /* Number of element slots in the window */
+  unsigned int nvalid;    /* Committed (writer) or fetched (reader) slots */
+  unsigned int pos;       /* Next slot handed out to a reader */
+  FAR uint8_t *buffer;    /* Slot storage, depth * esize bytes */
+};
+
 struct orb_object
 {
   orb_id_t meta;                /* The metadata of topic object */
@@ -101,6 +119,9 @@ typedef CODE int (*orb_eventerr_cb_t)(FAR struct orb_handle_s *handle,
 enum orb_loop_type_e
 {
   ORB_EPOLL_TYPE = 0,
+#ifdef CONFIG_UORB_LOOP_POOL
+  ORB_POOL_TYPE,                  /* Worker pool with work stealing */
+#endif
 };
 
 struct orb_handle_s
@@ -112,6 +133,11 @@ struct orb_handle_s
   orb_dataout_cb_t   dataout_cb;  /* User EPOLLOUT callback funtion. */
   orb_eventpri_cb_t  eventpri_cb; /* User EPOLLPRI callback funtion. */
   orb_eventerr_cb_t  eventerr_cb; /* User EPOLLERR callback funtion. */
+#ifdef CONFIG_UORB_LOOP_POOL
+  int                priority;    /* Dispatch priority in pool loops. */
+  uint32_t           revents;     /* Ready events waiting for dispatch. */
+  FAR struct orb_handle_s *next;  /* Ready queue link in pool loops. */
+#endif
 };
 
 struct orb_loop_ops_s;
@@ -120,6 +146,9 @@ struct orb_loop_s
   FAR const struct orb_loop_ops_s *ops;         /* Loop handle ops. */
   int                              fd;          /* Loop fd. */
   struct orb_handle_s              exit_handle; /* The exit handle */
+#ifdef CONFIG_UORB_LOOP_POOL
+  FAR void                        *priv;        /* Loop type private data */
+#endif
 };
 #endif
 
@@ -512,6 +541,171 @@ static inline int orb_copy(FAR const struct orb_metadata *meta,
   return ret == meta->o_size ? 0 : -1;
 }
 
+/****************************************************************************
+ * Name: orb_copy_batch
+ *
+ * Description:
+ *   Drain queued samples from one or more instances of a topic and merge
+ *   them into a single buffer ordered by timestamp.
+ *
+ *   Each instance is first asked for an equal share of nsamples, capped
+ *   by the queue depth given to orb_advertise_multi_queue().  Budget an
+ *   instance leaves unused goes to the others, so an instance is read at
+ *   most twice per call instead of once per sample.  Combined with
+ *   orb_set_batch_interval() a subscriber can wake up once per batch and
+ *   drain it with one call.  The instances are read into a temporary
+ *   heap buffer of nsamples elements and merged from there into buffer.
+ *
+ *   The topic structure must start with an orb_abstime timestamp, as all
+ *   sensor topics do.  Samples with equal timestamps keep instance order.
+ *   Blocking fds block in read() when an instance has nothing queued, so
+ *   open the subscriptions with O_NONBLOCK or call this after poll().
+ *
+ * Input Parameters:
+ *   meta       The uORB metadata (usually from the ORB_ID() macro)
+ *   fds        Array of fds returned from orb_subscribe_multi().
+ *   nfds       Number of entries in fds.
+ *   buffer     Output buffer of nsamples * meta->o_size bytes.
+ *   nsamples   Capacity of buffer in samples.
+ *   index      Optional array of nsamples entries receiving, for each
+ *              merged sample, the position in fds it was read from.
+ *
+ * Returned Value:
+ *   The number of samples copied on success (0 if none were queued),
+ *   -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+ssize_t orb_copy_batch(FAR const struct orb_metadata *meta,
+                       FAR const int *fds, unsigned int nfds,
+                       FAR void *buffer, unsigned int nsamples,
+                       FAR unsigned int *index);
+
+/****************************************************************************
+ * Name: orb_loan_init
+ *
+ * Description:
+ *   Initialize a loan window over a topic fd.  The window role follows the
+ *   access mode of fd: an fd from orb_advertise_multi_queue() is used with
+ *   orb_loan() / orb_commit(), an fd from orb_subscribe_multi() is used with
+ *   orb_borrow() / orb_release().
+ *
+ *   Committed samples are published together once depth samples are
+ *   pending or on orb_loan_flush().  Borrowed samples are fetched up to
+ *   depth at a time, so depth should not exceed the topic queue size.
+ *
+ * Input Parameters:
+ *   loan     The loan window to initialize.
+ *   fd       A fd returned from orb_advertise / orb_subscribe.
+ *   meta     The uORB metadata (usually from the ORB_ID() macro)
+ *   depth    Number of samples held by the window, 0 is treated as 1.
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_loan_init(FAR struct orb_loan_s *loan, int fd,
+                  FAR const struct orb_metadata *meta, unsigned int depth);
+
+/****************************************************************************
+ * Name: orb_loan_deinit
+ *
+ * Description:
+ *   Publish any committed samples still pending and release the window.
+ *   The topic fd is not closed.
+ *
+ * Input Parameters:
+ *   loan     The loan window to release.
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_loan_deinit(FAR struct orb_loan_s *loan);
+
+/****************************************************************************
+ * Name: orb_loan
+ *
+ * Description:
+ *   Loan the next free sample slot to a publisher.  The caller fills the
+ *   sample in place and hands it back with orb_commit().  Only one slot
+ *   may be loaned at a time.
+ *
+ * Input Parameters:
+ *   loan     A loan window initialized on an advertiser fd.
+ *
+ * Returned Value:
+ *   Pointer to o_size bytes of sample storage on success, NULL otherwise
+ *   with errno set accordingly.
+ ****************************************************************************/
+
+FAR void *orb_loan(FAR struct orb_loan_s *loan);
+
+/****************************************************************************
+ * Name: orb_commit
+ *
+ * Description:
+ *   Commit a sample obtained from orb_loan().  The window is published to
+ *   the topic when it becomes full.
+ *
+ * Input Parameters:
+ *   loan     A loan window initialized on an advertiser fd.
+ *   data     The pointer returned by the last orb_loan().
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_commit(FAR struct orb_loan_s *loan, FAR void *data);
+
+/****************************************************************************
+ * Name: orb_loan_flush
+ *
+ * Description:
+ *   Publish all committed samples of the window in one transfer.
+ *
+ * Input Parameters:
+ *   loan     A loan window initialized on an advertiser fd.
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_loan_flush(FAR struct orb_loan_s *loan);
+
+/****************************************************************************
+ * Name: orb_borrow
+ *
+ * Description:
+ *   Borrow the next sample for reading in place.  When the window is
+ *   drained it is refilled from the topic with up to depth queued samples
+ *   in one transfer.  The sample stays valid until orb_release().
+ *
+ * Input Parameters:
+ *   loan     A loan window initialized on a subscriber fd.
+ *
+ * Returned Value:
+ *   Pointer to the sample on success, NULL otherwise with errno set
+ *   accordingly (EAGAIN if no sample is available on a non-blocking fd).
+ ****************************************************************************/
+
+FAR const void *orb_borrow(FAR struct orb_loan_s *loan);
+
+/****************************************************************************
+ * Name: orb_release
+ *
+ * Description:
+ *   Release a sample obtained from orb_borrow().
+ *
+ * Input Parameters:
+ *   loan     A loan window initialized on a subscriber fd.
+ *   data     The pointer returned by the last orb_borrow().
+ *
+ * Returned Value:
+ *   0 on success, -1 otherwise with errno set accordingly.
+ ****************************************************************************/
+
+int orb_release(FAR struct orb_loan_s *loan, FAR const void *data);
+
 /****************************************************************************
  * Name: orb_get_state
  *
@@ -997,6 +1191,27 @@ int orb_handle_init(FAR struct orb_handle_s *handle, int fd, int events,
                     orb_dataout_cb_t dataout_cb, orb_eventpri_cb_t pri_cb,
                     orb_eventerr_cb_t err_cb);
 
+#ifdef CONFIG_UORB_LOOP_POOL
+/****************************************************************************
+ * Name: orb_handle_set_priority
+ *
+ * Description:
+ *   Set the dispatch priority of a handle in an ORB_POOL_TYPE loop.  Ready
+ *   handles are run highest priority first; EPOLLPRI and EPOLLERR events,
+ *   which go to the pri and err callbacks, run ahead of all data events.
+ *   The default priority set by orb_handle_init() is 0.
+ *
+ * Input Parameters:
+ *   handle     orb loop handle.
+ *   priority   Dispatch priority, larger values are run first.
+ *
+ * Returned Value:
+ *   Zero (OK) on success.
+ ****************************************************************************/
+
+int orb_handle_set_priority(FAR struct orb_handle_s *handle, int priority);
+#endif
+
 /****************************************************************************
  * Name: orb_handle_start
  *
@@ -80,6 +80,20 @@
 #define TEXT_GULP_SIZE  512  /* Text buffer allocations are managed with this unit */
 #define TEXT_GULP_MASK  511  /* Mask for aligning buffer allocation sizes */
 #define ALIGN_GULP(x)   (((x) + TEXT_GULP_MASK) & ~TEXT_GULP_MASK)
+#define TEXT_GAP_SHIFT  4    /* Grow the gap by 1/16th of the text size */
+
+#define LINE_INDEX_SHIFT 5   /* Index the start of every 32nd line */
+#define LINE_INDEX_GULP  32  /* Line index allocation unit */
+
+/* The text is held in a gap buffer:  text[0..gappos-1] followed by gapsize
+ * unused bytes, followed by the rest of the text.  VI_TEXT() accesses the
+ * character at a logical text position.  One byte past the allocation is
+ * kept as a NUL so that the position textsize may be read as before.
+ */
+
+#define VI_TEXT(vi, pos) \
+  (*((pos) < (vi)->gappos ? &(vi)->text[pos] : \
+     &(vi)->text[(pos) + (vi)->gapsize]))
 
 #define VI_TABSIZE      8    /* A TAB is eight characters */
 #define TABMASK         7    /* Mask for TAB alignment */
@@ -311,6 +325,11 @@ struct vi_s
 
   FAR char *text;           /* Dynamically allocated text buffer */
   size_t txtalloc;          /* Current allocated size of the text buffer */
+  off_t gappos;             /* Text position of the gap */
+  size_t gapsize;           /* Size of the gap in the text buffer */
+  FAR off_t *lineidx;       /* Start of every (1 << LINE_INDEX_SHIFT) line */
+  size_t nlineidx;          /* Number of valid entries in lineidx[] */
+  size_t lineidxalloc;      /* Current allocated entries in lineidx[] */
   FAR char *yank;           /* Dynamically allocated yank buffer */
   size_t yankalloc;         /* Current allocated size of the yank buffer */
   size_t yanksize;          /* Current size of the text in the yank buffer */
@@ -373,9 +392,18 @@ static off_t    vi_linebegin(FAR struct vi_s *vi, off_t pos);
 static off_t    vi_prevline(FAR struct vi_s *vi, off_t pos);
 static off_t    vi_lineend(FAR struct vi_s *vi, off_t pos);
 static off_t    vi_nextline(FAR struct vi_s *vi, off_t pos);
+static off_t    vi_skiplines(FAR struct vi_s *vi, off_t pos, size_t nlines,
+                             FAR size_t *nskipped);
+static void     vi_indexlines(FAR struct vi_s *vi, off_t pos, size_t line);
+static off_t    vi_linepos(FAR struct vi_s *vi, size_t line);
+static size_t   vi_lineno(FAR struct vi_s *vi, off_t pos);
 
 /* Text buffer management */
 
+static void     vi_movegap(FAR struct vi_s *vi, off_t pos);
+static bool     vi_growgap(FAR struct vi_s *vi, size_t increment);
+static FAR char *vi_textrange(FAR struct vi_s *vi, off_t start, off_t end);
+static void     vi_textchanged(FAR struct vi_s *vi, off_t pos);
 static bool     vi_extendtext(FAR struct vi_s *vi, off_t pos,
                   size_t increment);
 static void     vi_shrinkpos(FAR struct vi_s *vi, off_t delpos,
@@ -436,6 +464,8 @@ static void     vi_cmdbackspace(FAR struct vi_s *vi);
 static void     vi_parsecolon(FAR struct vi_s *vi);
 static void     vi_cmd_submode(FAR struct vi_s *vi);
 
+static bool     vi_matchtext(FAR struct vi_s *vi, off_t pos,
+                             FAR const char *str, size_t len);
 static bool     vi_findstring(FAR struct vi_s *vi);
 static bool     vi_revfindstring(FAR struct vi_s *vi);
 static void     vi_parsefind(FAR struct vi_s *vi, bool revfind);
@@ -911,7 +941,7 @@ static off_t vi_linebegin(FAR struct vi_s *vi, off_t pos)
    * the beginning of the text buffer).
    */
 
-  while (pos && vi->text[pos - 1] != '\n')
+  while (pos && VI_TEXT(vi, pos - 1) != '\n')
     {
       pos--;
     }
@@ -961,12 +991,12 @@ static off_t vi_lineend(FAR struct vi_s *vi, off_t pos)
    * the end of the text buffer).
    */
 
-  while (pos < vi->textsize && vi->text[pos] != '\n')
+  while (pos < vi->textsize && VI_TEXT(vi, pos) != '\n')
     {
       pos++;
     }
 
-  if (vi->text[pos] == '\n')
+  if (VI_TEXT(vi, pos) == '\n')
     {
       pos--;
     }
@@ -1003,58 +1033,337 @@ static off_t vi_nextline(FAR struct vi_s *vi, off_t pos)
 }
 
 /****************************************************************************
- * Text buffer management
+ * Name: vi_skiplines
+ *
+ * Description:
+ *   Search forward from 'pos' past 'nlines' newline characters and return
+ *   the position following the last one.  If the end of the text is reached
+ *   first, textsize is returned.  The number of newlines actually passed is
+ *   returned in 'nskipped'.
+ *
  ****************************************************************************/
 
+static off_t vi_skiplines(FAR struct vi_s *vi, off_t pos, size_t nlines,
+                          FAR size_t *nskipped)
+{
+  FAR const char *seg;
+  FAR const char *nl;
+  size_t count = 0;
+  off_t segend;
+
+  while (count < nlines && pos < vi->textsize)
+    {
+      /* Search the part of the text before or after the gap */
+
+      if (pos < vi->gappos)
+        {
+          seg    = &vi->text[pos];
+          segend = vi->gappos;
+        }
+      else
+        {
+          seg    = &vi->text[pos + vi->gapsize];
+          segend = vi->textsize;
+        }
+
+      nl = memchr(seg, '\n', segend - pos);
+      if (nl == NULL)
+        {
+          pos = segend;
+        }
+      else
+        {
+          pos += nl - seg + 1;
+          count++;
+        }
+    }
+
+  *nskipped = count;
+  return pos;
+}
+
 /****************************************************************************
- * Name: vi_extendtext
+ * Name: vi_indexlines
  *
  * Description:
- *   Reallocate the in-memory file memory by (at least) 'increment' and make
- *   space for new text of size 'increment' at the specified cursor position.
+ *   Extend the line index until it covers text position 'pos' and line
+ *   number 'line' (zero based), or until the end of the text.
  *
  ****************************************************************************/
 
-static bool vi_extendtext(FAR struct vi_s *vi, off_t pos, size_t increment)
+static void vi_indexlines(FAR struct vi_s *vi, off_t pos, size_t line)
 {
-  FAR char *alloc;
-  int i;
+  FAR off_t *alloc;
+  size_t nskipped;
+  size_t nlines = (size_t)1 << LINE_INDEX_SHIFT;
+  off_t next;
 
-  viinfo("pos=%ld increment=%ld\n", (long)pos, (long)increment);
+  while (vi->nlineidx == 0 ||
+         vi->lineidx[vi->nlineidx - 1] <= pos ||
+         ((vi->nlineidx - 1) << LINE_INDEX_SHIFT) < line)
+    {
+      if (vi->nlineidx >= vi->lineidxalloc)
+        {
+          alloc = realloc(vi->lineidx, (vi->lineidxalloc + LINE_INDEX_GULP) *
+                                       sizeof(off_t));
+          if (alloc == NULL)
+            {
+              /* The index only speeds things up.  Go without. */
+
+              return;
+            }
+
+          vi->lineidx       = alloc;
+          vi->lineidxalloc += LINE_INDEX_GULP;
+        }
 
-  /* Check if we need to reallocate */
+      if (vi->nlineidx == 0)
+        {
+          vi->lineidx[vi->nlineidx++] = 0;
+          continue;
+        }
+
+      next = vi_skiplines(vi, vi->lineidx[vi->nlineidx - 1], nlines,
+                          &nskipped);
+      if (nskipped < nlines)
+        {
+          return;
+        }
 
-  if (!vi->text || vi->textsize + increment > vi->txtalloc)
+      vi->lineidx[vi->nlineidx++] = next;
+    }
+}
+
+/****************************************************************************
+ * Name: vi_linepos
+ *
+ * Description:
+ *   Return the text position of the beginning of the line number 'line'
+ *   (zero based), or textsize if there are not that many lines.
+ *
+ ****************************************************************************/
+
+static off_t vi_linepos(FAR struct vi_s *vi, size_t line)
+{
+  size_t nskipped;
+  size_t index;
+  off_t pos = 0;
+
+  vi_indexlines(vi, -1, line);
+
+  index = line >> LINE_INDEX_SHIFT;
+  if (vi->nlineidx > 0)
     {
-      /* Allocate in chunksize so that we do not have to reallocate so
-       * often.
-       */
+      index = MIN(index, vi->nlineidx - 1);
+      pos   = vi->lineidx[index];
+      line -= index << LINE_INDEX_SHIFT;
+    }
+
+  pos = vi_skiplines(vi, pos, line, &nskipped);
+
+  viinfo("Return pos=%ld\n", (long)pos);
+  return pos;
+}
+
+/****************************************************************************
+ * Name: vi_lineno
+ *
+ * Description:
+ *   Return the line number (zero based) of the text position 'pos'.
+ *
+ ****************************************************************************/
+
+static size_t vi_lineno(FAR struct vi_s *vi, off_t pos)
+{
+  size_t nskipped;
+  size_t lineno = 0;
+  size_t low = 0;
+  size_t high;
+  size_t mid;
+  off_t start = 0;
+  off_t next;
 
-      size_t allocsize = ALIGN_GULP(vi->textsize + increment);
-      alloc = realloc(vi->text, allocsize);
-      if (alloc == NULL)
+  vi_indexlines(vi, pos, 0);
+
+  /* Find the last indexed line that begins at or before 'pos' */
+
+  if (vi->nlineidx > 0)
+    {
+      high = vi->nlineidx - 1;
+      while (low < high)
         {
-          /* Reallocation failed */
+          mid = (low + high + 1) / 2;
+          if (vi->lineidx[mid] <= pos)
+            {
+              low = mid;
+            }
+          else
+            {
+              high = mid - 1;
+            }
+        }
 
-          vi_error(vi, g_fmtallocfail);
-          return false;
+      start  = vi->lineidx[low];
+      lineno = low << LINE_INDEX_SHIFT;
+    }
+
+  /* Then count the remaining lines one at a time */
+
+  for (; ; )
+    {
+      next = vi_skiplines(vi, start, 1, &nskipped);
+      if (nskipped == 0 || next > pos)
+        {
+          break;
         }
 
-      /* Save the new buffer information */
+      start = next;
+      lineno++;
+    }
+
+  return lineno;
+}
+
+/****************************************************************************
+ * Text buffer management
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: vi_movegap
+ *
+ * Description:
+ *   Move the gap in the text buffer to the text position 'pos'.  Only the
+ *   text between the old and the new gap position is copied.
+ *
+ ****************************************************************************/
+
+static void vi_movegap(FAR struct vi_s *vi, off_t pos)
+{
+  if (pos < vi->gappos)
+    {
+      memmove(&vi->text[pos + vi->gapsize], &vi->text[pos],
+              vi->gappos - pos);
+    }
+  else if (pos > vi->gappos)
+    {
+      memmove(&vi->text[vi->gappos], &vi->text[vi->gappos + vi->gapsize],
+              pos - vi->gappos);
+    }
+
+  vi->gappos = pos;
+}
+
+/****************************************************************************
+ * Name: vi_growgap
+ *
+ * Description:
+ *   Reallocate the text buffer so that the gap holds at least 'increment'
+ *   bytes.  The gap is grown by a fraction of the text size so that typing
+ *   into a large file does not move the text after the gap too often.
+ *
+ ****************************************************************************/
+
+static bool vi_growgap(FAR struct vi_s *vi, size_t increment)
+{
+  FAR char *alloc;
+  size_t allocsize;
+  size_t tail;
 
-      vi->text    = alloc;
-      vi->txtalloc = allocsize;
+  if (vi->text != NULL && vi->gapsize >= increment)
+    {
+      return true;
+    }
+
+  allocsize = ALIGN_GULP(vi->textsize + increment +
+                         (vi->textsize >> TEXT_GAP_SHIFT));
+  alloc = realloc(vi->text, allocsize + 1);
+  if (alloc == NULL)
+    {
+      /* Reallocation failed */
+
+      vi_error(vi, g_fmtallocfail);
+      return false;
     }
 
-  /* Move text to make space for new text of size 'increment' at the current
-   * cursor position
+  /* Move the text after the gap to the end of the new buffer */
+
+  tail = vi->textsize - vi->gappos;
+  memmove(&alloc[allocsize - tail], &alloc[vi->txtalloc - tail], tail);
+
+  /* Save the new buffer information */
+
+  vi->text            = alloc;
+  vi->txtalloc        = allocsize;
+  vi->gapsize         = allocsize - vi->textsize;
+  vi->text[allocsize] = '\0';
+  return true;
+}
+
+/****************************************************************************
+ * Name: vi_textrange
+ *
+ * Description:
+ *   Return a pointer to the text in the range 'start' through 'end' - 1,
+ *   moving the gap out of the way if it lies within the range.
+ *
+ ****************************************************************************/
+
+static FAR char *vi_textrange(FAR struct vi_s *vi, off_t start, off_t end)
+{
+  if (start < vi->gappos && end > vi->gappos)
+    {
+      /* Move the gap to whichever end of the range is closer */
+
+      vi_movegap(vi, vi->gappos - start < end - vi->gappos ? start : end);
+    }
+
+  return &VI_TEXT(vi, start);
+}
+
+/****************************************************************************
+ * Name: vi_textchanged
+ *
+ * Description:
+ *   The text was modified at position 'pos'.  Forget the indexed lines that
+ *   begin after that position.
+ *
+ ****************************************************************************/
+
+static void vi_textchanged(FAR struct vi_s *vi, off_t pos)
+{
+  while (vi->nlineidx > 1 && vi->lineidx[vi->nlineidx - 1] > pos)
+    {
+      vi->nlineidx--;
+    }
+}
+
+/****************************************************************************
+ * Name: vi_extendtext
+ *
+ * Description:
+ *   Reallocate the in-memory file memory by (at least) 'increment' and make
+ *   space for new text of size 'increment' at the specified cursor position.
+ *
+ ****************************************************************************/
+
+static bool vi_extendtext(FAR struct vi_s *vi, off_t pos, size_t increment)
+{
+  viinfo("pos=%ld increment=%ld\n", (long)pos, (long)increment);
+
+  /* Move the gap to the cursor position and make sure that it is large
+   * enough.  The new text then takes the first 'increment' bytes of it.
    */
 
-  for (i = vi->textsize - 1; i >= pos; i--)
+  vi_movegap(vi, pos);
+  if (!vi_growgap(vi, increment))
     {
-      vi->text[i + increment] = vi->text[i];
+      return false;
     }
 
+  vi->gappos   += increment;
+  vi->gapsize  -= increment;
+  vi_textchanged(vi, pos);
+
   /* Adjust end of file position */
 
   vi->textsize += increment;
@@ -1133,24 +1442,27 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
 {
   FAR char *alloc;
   size_t allocsize;
-  int i;
 
   viinfo("pos=%ld size=%ld\n", (long)pos, (long)size);
 
-  /* Close up the gap to remove 'size' characters at 'pos' */
+  /* Ensure we are not shrinking more than we have */
 
-  for (i = pos + size; i < vi->textsize; i++)
+  if (pos > vi->textsize)
     {
-      vi->text[i - size] = vi->text[i];
+      pos = vi->textsize;
     }
 
-  /* Ensure we are not shrinking more than we have */
-
-  if (size > vi->textsize)
+  if (size > (size_t)(vi->textsize - pos))
     {
-      size = vi->textsize;
+      size = vi->textsize - pos;
     }
 
+  /* Move the gap to 'pos' and let it swallow the deleted characters */
+
+  vi_movegap(vi, pos);
+  vi->gapsize += size;
+  vi_textchanged(vi, pos);
+
   /* Adjust sizes and positions */
 
   vi->textsize -= size;
@@ -1159,17 +1471,16 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
   vi_shrinkpos(vi, pos, size, &vi->winpos);
   vi_shrinkpos(vi, pos, size, &vi->prevpos);
 
-  /* Reallocate the buffer to free up memory no longer in use */
-
-  allocsize = ALIGN_GULP(vi->textsize);
-  if (allocsize == 0)
-    {
-      allocsize = TEXT_GULP_SIZE;
-    }
+  /* Reallocate the buffer to free up memory no longer in use.  That needs
+   * the gap at the end of the text, so only do it when most of the buffer
+   * is unused.
+   */
 
-  if (allocsize < vi->txtalloc)
+  allocsize = ALIGN_GULP(vi->textsize) + TEXT_GULP_SIZE;
+  if (vi->gapsize > vi->txtalloc / 2 && allocsize < vi->txtalloc)
     {
-      alloc = realloc(vi->text, allocsize);
+      vi_movegap(vi, vi->textsize);
+      alloc = realloc(vi->text, allocsize + 1);
       if (!alloc)
         {
           vi_error(vi, g_fmtallocfail);
@@ -1178,8 +1489,10 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
 
       /* Save the new buffer information */
 
-      vi->text    = alloc;
-      vi->txtalloc = allocsize;
+      vi->text            = alloc;
+      vi->txtalloc        = allocsize;
+      vi->gapsize         = allocsize - vi->textsize;
+      vi->text[allocsize] = '\0';
     }
 }
 
@@ -1244,7 +1557,7 @@ static bool vi_insertfile(FAR struct vi_s *vi, off_t pos,
        * current cursor position.
        */
 
-      nread = fread(vi->text + pos, 1, filesize, stream);
+      nread = fread(&VI_TEXT(vi, pos), 1, filesize, stream);
       if (nread < filesize)
         {
           /* Report the error (or partial read), EINTR is not handled */
@@ -1294,7 +1607,7 @@ static bool vi_savetext(FAR struct vi_s *vi, FAR const char *filename,
    * through pos + size -1.
    */
 
-  nwritten = fwrite(vi->text + pos, 1, size, stream);
+  nwritten = fwrite(vi_textrange(vi, pos, pos + size), 1, size, stream);
   if (nwritten < size)
     {
       /* Report the error (or partial write).  EINTR is not handled. */
@@ -1489,7 +1802,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
     {
       /* Is there a newline terminator at this position? */
 
-      if (vi->text[pos] == '\n')
+      if (VI_TEXT(vi, pos) == '\n')
         {
           /* Yes... break out of the loop return the cursor column */
 
@@ -1505,7 +1818,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
 
       /* No... Is there a TAB at this position? */
 
-      else if (vi->text[pos] == '\t')
+      else if (VI_TEXT(vi, pos) == '\t')
         {
           /* Yes.. expand the TAB */
 
@@ -1523,7 +1836,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
   /* Keep cursor in bounds of text (i.e. not at the '\n') */
 
   if (((pos == vi->textsize && column != 0) ||
-       (vi->text[pos] == '\n' && pos != start)) &&
+       (VI_TEXT(vi, pos) == '\n' && pos != start)) &&
         vi->mode != MODE_INSERT && vi->mode != MODE_REPLACE)
     {
       pos--;
@@ -1559,6 +1872,9 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
 
 static void vi_scrollcheck(FAR struct vi_s *vi)
 {
+  size_t curlineno;
+  size_t winlineno;
+  size_t rows;
   off_t curline;
   off_t pos;
   uint16_t tmp;
@@ -1576,40 +1892,46 @@ static void vi_scrollcheck(FAR struct vi_s *vi)
 
   curline = vi_linebegin(vi, vi->curpos);
 
-  /* Check if the current line is above the first line on the display */
+  /* Check if the current line is above the first line on the display.
+   * Line numbers come from the line index, so a long jump does not step
+   * through every line in between.
+   */
 
-  while (curline < vi->winpos)
+  curlineno = vi_lineno(vi, curline);
+  winlineno = vi_lineno(vi, vi->winpos);
+  if (curline < vi->winpos)
     {
-      /* Yes.. move the window position up to the beginning of the previous
-       * line line and check again
+      /* Yes.. move the window position up to the beginning of the current
+       * line.
        */
 
-      vi->winpos = vi_prevline(vi, vi->winpos);
-      vi->vscroll--;
+      vi->vscroll   -= winlineno - curlineno;
+      vi->winpos     = curline;
+      winlineno      = curlineno;
       vi->fullredraw = true;
     }
 
-  /* Reset the cursor row position so that it is relative to the
-   * top of the display.
-   */
+  /* Get the cursor row position relative to the top of the display */
 
-  vi->cursor.row = 0;
-  for (pos = vi->winpos; pos < curline; pos = vi_nextline(vi, pos))
-    {
-      vi->cursor.row++;
-    }
+  rows = curlineno - winlineno;
 
   /* Check if the cursor row position is below the bottom of the display */
 
-  for (; vi->cursor.row >= vi->display.row - 1; vi->cursor.row--)
+  if (rows >= vi->display.row - 1)
     {
-      /* Yes.. move the window position down by one line and check again */
+      /* Yes.. move the window position down so that the cursor is on the
+       * last text line of the display.
+       */
 
-      vi->winpos = vi_nextline(vi, vi->winpos);
-      vi->vscroll++;
+      nlines         = rows - (vi->display.row - 2);
+      vi->winpos     = vi_linepos(vi, winlineno + nlines);
+      vi->vscroll   += nlines;
+      rows          -= nlines;
       vi->fullredraw = true;
     }
 
+  vi->cursor.row = rows;
+
   /* Check if the cursor column is on the display.  vi_windowpos returns the
    * unrestricted column number of cursor.  hscroll is the horizontal offset
    * in characters.
@@ -1845,20 +2167,21 @@ static void vi_showtext(FAR struct vi_s *vi)
                * last column is encountered.
                */
 
-              if (vi->text[pos] == '\n')
+              if (VI_TEXT(vi, pos) == '\n')
                 {
                   break;
                 }
 
               /* Perform TAB expansion */
 
-              else if (vi->text[pos] == '\t')
+              else if (VI_TEXT(vi, pos) == '\t')
                 {
                   /* Write collected characters */
 
                   if (writefrom != pos)
                     {
-                      vi_write(vi, &vi->text[writefrom], pos - writefrom);
+                      vi_write(vi, vi_textrange(vi, writefrom, pos),
+                               pos - writefrom);
                     }
 
                   tabcol = NEXT_TAB(column);
@@ -1894,7 +2217,8 @@ static void vi_showtext(FAR struct vi_s *vi)
 
           if (writefrom != pos)
             {
-              vi_write(vi, &vi->text[writefrom], pos - writefrom);
+              vi_write(vi, vi_textrange(vi, writefrom, pos),
+                       pos - writefrom);
             }
 
           vi_clrtoeol(vi);
@@ -1905,7 +2229,7 @@ static void vi_showtext(FAR struct vi_s *vi)
       pos = vi_nextline(vi, pos);
     }
 
-  if (pos == vi->textsize && vi->text[pos - 1] == '\n')
+  if (pos == vi->textsize && VI_TEXT(vi, pos - 1) == '\n')
     {
       vi_setcursor(vi, row, 0);
       vi_clrtoeol(vi);
@@ -2079,7 +2403,7 @@ static off_t vi_cursorleft(FAR struct vi_s *vi, off_t curpos, int ncolumns)
    */
 
   for (remaining = (ncolumns < 1 ? 1 : ncolumns);
-       curpos > 0 && remaining > 0 && vi->text[curpos - 1] != '\n';
+       curpos > 0 && remaining > 0 && VI_TEXT(vi, curpos - 1) != '\n';
        curpos--, remaining--)
     {
     }
@@ -2109,13 +2433,13 @@ static off_t vi_cursorright(FAR struct vi_s *vi, off_t curpos, int ncolumns)
    */
 
   for (remaining = (ncolumns < 1 ? 1 : ncolumns);
-       curpos < vi->textsize && remaining > 0 && vi->text[curpos] != '\n';
+       curpos < vi->textsize && remaining > 0 && VI_TEXT(vi, curpos) != '\n';
        curpos++, remaining--)
     {
     }
 
 #if 0
-  if (vi->text[curpos] == '\n' || (curpos == vi->textsize &&
+  if (VI_TEXT(vi, curpos) == '\n' || (curpos == vi->textsize &&
       vi->mode != MODE_INSERT && vi->mode != MODE_REPLACE))
     {
       curpos--;
@@ -2185,8 +2509,8 @@ static int vi_gotoscreenbottom(FAR struct vi_s *vi, int rows)
 static void vi_gotofirstnonwhite(FAR struct vi_s *vi)
 {
   vi->curpos = vi_linebegin(vi, vi->curpos);
-  while (vi->curpos <= vi->textsize && (vi->text[vi->curpos] == ' ' ||
-         vi->text[vi->curpos] == '\t'))
+  while (vi->curpos <= vi->textsize && (VI_TEXT(vi, vi->curpos) == ' ' ||
+         VI_TEXT(vi, vi->curpos) == '\t'))
     {
       vi->curpos++;
     }
@@ -2222,7 +2546,7 @@ static void vi_delforward(FAR struct vi_s *vi)
       /* If at end of file, just return */
 
       if (vi->curpos == vi->textsize ||
-          vi->text[vi->curpos] == '\n')
+          VI_TEXT(vi, vi->curpos) == '\n')
         {
           return;
         }
@@ -2276,8 +2600,8 @@ static void vi_delbackward(FAR struct vi_s *vi)
 
   /* Test if we are at beginning of line */
 
-  if (vi->curpos == 0 || vi->text[vi->curpos] == '\n' ||
-      vi->text[vi->curpos - 1] == '\n')
+  if (vi->curpos == 0 || VI_TEXT(vi, vi->curpos) == '\n' ||
+      VI_TEXT(vi, vi->curpos - 1) == '\n')
     {
       return;
     }
@@ -2303,7 +2627,7 @@ static void vi_delbackward(FAR struct vi_s *vi)
     {
       /* Test if \n' in the range.  Don't delete through \n */
 
-      if (vi->text[x] == '\n')
+      if (VI_TEXT(vi, x) == '\n')
         {
           start = x + 1;
           break;
@@ -2386,7 +2710,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
 
   /* If we are at the end of the line, then return */
 
-  if (vi->curpos == vi->textsize || vi->text[vi->curpos] == '\n')
+  if (vi->curpos == vi->textsize || VI_TEXT(vi, vi->curpos) == '\n')
     {
       return;
     }
@@ -2395,7 +2719,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
 
   start = vi->curpos;
   end   = vi_lineend(vi, vi->curpos);
-  if (end == vi->textsize || vi->text[end] == '\n')
+  if (end == vi->textsize || VI_TEXT(vi, end) == '\n')
     {
       end--;
     }
@@ -2403,7 +2727,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
   /* Yank and remove text from the buffer */
 
   vi_yanktext(vi, start, end, true, true);
-  if (start > 0 && start != vi->textsize && vi->text[start - 1] != '\n')
+  if (start > 0 && start != vi->textsize && VI_TEXT(vi, start - 1) != '\n')
     {
       vi->curpos = start - 1;
     }
@@ -2432,7 +2756,7 @@ static void vi_yanktext(FAR struct vi_s *vi, off_t start, off_t end,
 
   /* At end of file, in line yank mode, if there is no LF, we append one */
 
-  if (vi->text[end] != '\n' && !yankcharmode)
+  if (VI_TEXT(vi, end) != '\n' && !yankcharmode)
     {
       append_lf = 1;
     }
@@ -2485,7 +2809,7 @@ static void vi_yanktext(FAR struct vi_s *vi, off_t start, off_t end,
   /* Copy the block from the text buffer to the yank buffer */
 
   vi->yanksize = size;
-  memcpy(vi->yank, &vi->text[start], size);
+  memcpy(vi->yank, vi_textrange(vi, start, start + size), size);
 
   /* Append \n if needed */
 
@@ -2547,7 +2871,7 @@ static void vi_yank(FAR struct vi_s *vi, bool del_after_yank)
 
   yank_end = end;
   if (del_after_yank && end == textsize - 1 && start != end &&
-      vi->text[end] == '\n')
+      VI_TEXT(vi, end) == '\n')
     {
       yank_end--;
       pos_increment = 1;
@@ -2558,8 +2882,8 @@ static void vi_yank(FAR struct vi_s *vi, bool del_after_yank)
   /* Test if deleting last line with empty line above it */
 
   if ((end > 0 && start == end && end == vi->textsize -1 &&
-      vi->text[end - 1] == '\n') || (start > 1 && end + 1 ==
-      vi->textsize && vi->text[start - 2] == '\n'))
+      VI_TEXT(vi, end - 1) == '\n') || (start > 1 && end + 1 ==
+      vi->textsize && VI_TEXT(vi, start - 2) == '\n'))
     {
       empty_last_line = true;
     }
@@ -2632,7 +2956,7 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
 
           /* Paste at next col to the right of cursor */
 
-          if (vi->text[vi->curpos] == '\n' || vi->curpos == vi->textsize ||
+          if (VI_TEXT(vi, vi->curpos) == '\n' || vi->curpos == vi->textsize ||
               paste_before)
             {
               pos = vi->curpos;
@@ -2648,12 +2972,13 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
                * at the position where the start of the next line was.
                */
 
-              memcpy(&vi->text[pos], vi->yank, vi->yanksize);
+              memcpy(&VI_TEXT(vi, pos), vi->yank, vi->yanksize);
 
               /* Advance the cursor */
 
               vi->curpos = vi->curpos + vi->yanksize;
-              if (vi->curpos > vi->textsize || vi->text[vi->curpos] == '\n')
+              if (vi->curpos > vi->textsize ||
+                  VI_TEXT(vi, vi->curpos) == '\n')
                 {
                   vi->curpos--;
                 }
@@ -2679,7 +3004,7 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
           /* Test if pasting at end of file */
 
           new_curpos = start;
-          if ((start >= vi->textsize && vi->text[vi->textsize - 1] != '\n')
+          if ((start >= vi->textsize && VI_TEXT(vi, vi->textsize - 1) != '\n')
               || vi->curpos == vi->textsize)
             {
               off_t textsize = vi->textsize;
@@ -2692,7 +3017,7 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
 
               /* Don't append the \n' in the yank buffer */
 
-              if (vi->text[textsize - 1] != '\n' || at_end)
+              if (VI_TEXT(vi, textsize - 1) != '\n' || at_end)
                 {
                   size--;
                 }
@@ -2717,7 +3042,7 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
                * at the position where the start of the next line was.
                */
 
-              memcpy(&vi->text[start], vi->yank, size);
+              memcpy(&VI_TEXT(vi, start), vi->yank, size);
 
               /* Advance to next line */
 
@@ -2757,19 +3082,21 @@ static void vi_join(FAR struct vi_s *vi)
 
   /* Ensure the line ends with '\n' */
 
-  if (vi->text[start + 1] != '\n')
+  if (VI_TEXT(vi, start + 1) != '\n')
     {
       return;
     }
 
   /* Convert the '\n' to a space */
 
-  vi->text[++start] = ' ';
+  start++;
+  VI_TEXT(vi, start) = ' ';
+  vi_textchanged(vi, start);
   end = start + 1;
 
   /* Skip all spaces and tabs on next line */
 
-  while ((vi->text[end] == ' ' || vi->text[end] == '\t') &&
+  while ((VI_TEXT(vi, end) == ' ' || VI_TEXT(vi, end) == '\t') &&
       end < vi->textsize)
     {
       end++;
@@ -2809,16 +3136,9 @@ static void vi_gotoline(FAR struct vi_s *vi)
 
   else if (vi->value > 0)
     {
-      uint32_t line;
-
       /* Got to the line == value */
 
-      for (line = vi->value, vi->curpos = 0;
-          --line > 0 && vi->curpos < vi->textsize;
-          )
-        {
-          vi->curpos = vi_nextline(vi, vi->curpos);
-        }
+      vi->curpos = vi_linepos(vi, vi->value - 1);
     }
 
   /* No value means to go to beginning of the last line */
@@ -2893,14 +3213,14 @@ static off_t vi_findnextword(FAR struct vi_s *vi)
    * next "word" looks like.
    */
 
-  srch_type = vi_chartype(vi->text[vi->curpos]);
+  srch_type = vi_chartype(VI_TEXT(vi, vi->curpos));
   pos = vi->curpos + 1;
 
   for (; pos < vi->textsize; pos++)
     {
       /* Get type of the next character */
 
-      pos_type = vi_chartype(vi->text[pos]);
+      pos_type = vi_chartype(VI_TEXT(vi, pos));
 
       /* Skip CR and NL */
 
@@ -2995,13 +3315,13 @@ static void vi_gotonextword(FAR struct vi_s *vi)
       pos     = vi->curpos;
       crfound = false;
 
-      while ((vi->text[pos - 1] == ' ' || vi->text[pos - 1] == '\t' ||
-             vi->text[pos - 1] == '\n') && pos > start)
+      while ((VI_TEXT(vi, pos - 1) == ' ' || VI_TEXT(vi, pos - 1) == '\t' ||
+             VI_TEXT(vi, pos - 1) == '\n') && pos > start)
         {
           /* We rewind only if '\n' found before non-space */
 
           pos--;
-          if (vi->text[pos] == '\n')
+          if (VI_TEXT(vi, pos) == '\n')
             {
               crfound = true;
             }
@@ -3024,7 +3344,7 @@ static void vi_gotonextword(FAR struct vi_s *vi)
             {
               /* Test for '\n' */
 
-              if (vi->text[x] == '\n')
+              if (VI_TEXT(vi, x) == '\n')
                 {
                   /* Modify the yank / delete range */
 
@@ -3050,7 +3370,7 @@ static void vi_gotonextword(FAR struct vi_s *vi)
 
       /* Yank text if it isn't a single \n character */
 
-      if (!(start == end && vi->text[start] == '\n'))
+      if (!(start == end && VI_TEXT(vi, start) == '\n'))
         {
           vi_yanktext(vi, start, end, 1, vi->delarm | vi->chgarm);
         }
@@ -3116,9 +3436,9 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
    * next "word" looks like.
    */
 
-  srch_type = vi_chartype(vi->text[vi->curpos]);
+  srch_type = vi_chartype(VI_TEXT(vi, vi->curpos));
   pos       = vi->curpos - 1;
-  pos_type  = vi_chartype(vi->text[pos]);
+  pos_type  = vi_chartype(VI_TEXT(vi, pos));
 
   /* Test if we are at the beginning of a word */
 
@@ -3128,7 +3448,7 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
 
       while (pos > 0)
         {
-          pos_type = vi_chartype(vi->text[pos - 1]);
+          pos_type = vi_chartype(VI_TEXT(vi, pos - 1));
 
           if (pos_type != srch_type && pos_type != VI_CHAR_CRLF)
             {
@@ -3148,14 +3468,16 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
        * non-space character.
        */
 
-      pos_type = vi_chartype(vi->text[--pos]);
+      pos--;
+      pos_type = vi_chartype(VI_TEXT(vi, pos));
     }
 
   /* If the previous char is space, then skip them */
 
   while ((pos_type == VI_CHAR_SPACE || pos_type == VI_CHAR_CRLF) && pos > 0)
     {
-      pos_type = vi_chartype(vi->text[--pos]);
+      pos--;
+      pos_type = vi_chartype(VI_TEXT(vi, pos));
     }
 
   if (pos == 0)
@@ -3165,8 +3487,8 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
 
   /* Now find beginning of this new type */
 
-  srch_type = vi_chartype(vi->text[pos]);
-  while (pos > 0 && vi_chartype(vi->text[pos - 1]) == srch_type)
+  srch_type = vi_chartype(VI_TEXT(vi, pos));
+  while (pos > 0 && vi_chartype(VI_TEXT(vi, pos - 1)) == srch_type)
     {
       pos--;
     }
@@ -3222,19 +3544,19 @@ static void vi_bottom_line_debug(FAR struct vi_s *vi)
 
   while (pos < vi->textsize && column < vi->display.column)
     {
-      if (vi->text[pos] == '\n')
+      if (VI_TEXT(vi, pos) == '\n')
         {
           vi_putch(vi, '\\');
           vi_putch(vi, 'n');
         }
-      else if (vi->text[pos] == '\t')
+      else if (VI_TEXT(vi, pos) == '\t')
         {
           vi_putch(vi, '\\');
           vi_putch(vi, 'n');
         }
       else
         {
-          vi_putch(vi, vi->text[pos]);
+          vi_putch(vi, VI_TEXT(vi, pos));
         }
 
       pos++;
@@ -3558,8 +3880,8 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
         case KEY_CMDMODE_RIGHT: /* Move the cursor right one character */
         case KEY_RIGHT:         /* Move the cursor right one character */
           {
-            if (vi->text[vi->curpos] != '\n' &&
-                vi->text[vi->curpos + 1] != '\n')
+            if (VI_TEXT(vi, vi->curpos) != '\n' &&
+                VI_TEXT(vi, vi->curpos + 1) != '\n')
               {
                 vi->curpos = vi_cursorright(vi, vi->curpos, vi->value);
                 if (vi->curpos >= vi->textsize)
@@ -3695,7 +4017,7 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
 
                 /* If we moved to \n on the previous line, skip it */
 
-                if (vi->curpos > 0 && vi->text[vi->curpos] == '\n')
+                if (vi->curpos > 0 && VI_TEXT(vi, vi->curpos) == '\n')
                   {
                     vi->curpos--;
                   }
@@ -3947,13 +4269,13 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
 #endif
             /* If we are at the end of the line, then delete backward */
 
-            if (vi->text[pos] == '\n')
+            if (VI_TEXT(vi, pos) == '\n')
               {
                 /* Nothing to do */
 
                 break;
               }
-            else if (pos + 1 != vi->textsize && vi->text[pos + 1] == '\n')
+            else if (pos + 1 != vi->textsize && VI_TEXT(vi, pos + 1) == '\n')
               {
                 if (pos > 0)
                   {
@@ -4610,6 +4932,36 @@ static void vi_cmd_submode(FAR struct vi_s *vi)
  * Find Data Entry Sub-Mode Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: vi_matchtext
+ *
+ * Description:
+ *   Check if the 'len' characters of 'str' are found at text position
+ *   'pos'.
+ *
+ ****************************************************************************/
+
+static bool vi_matchtext(FAR struct vi_s *vi, off_t pos,
+                         FAR const char *str, size_t len)
+{
+  size_t i;
+
+  if (pos < 0 || pos + (off_t)len > vi->textsize)
+    {
+      return false;
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      if (VI_TEXT(vi, pos + i) != str[i])
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
 /****************************************************************************
  * Name: vi_findstring
  *
@@ -4645,7 +4997,7 @@ static bool vi_findstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           /* Found it... save the cursor position and
            * return success.
@@ -4664,7 +5016,7 @@ static bool vi_findstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           vi_write(vi, g_fmtsrcbot, sizeof(g_fmtsrcbot));
 
@@ -4715,7 +5067,7 @@ static bool vi_revfindstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           /* Found it... save the cursor position and
            * return success.
@@ -4734,7 +5086,7 @@ static bool vi_revfindstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           vi_write(vi, g_fmtsrctop, sizeof(g_fmtsrctop));
 
@@ -4898,7 +5250,7 @@ static void vi_replacech(FAR struct vi_s *vi, char ch)
 
   /* Is there a newline at the current cursor position? */
 
-  if (vi->text[vi->curpos] == '\n')
+  if (VI_TEXT(vi, vi->curpos) == '\n')
     {
       /* Yes, then insert the new character before the newline */
 
@@ -4909,7 +5261,9 @@ static void vi_replacech(FAR struct vi_s *vi, char ch)
     {
       /* No, just replace the character and increment the cursor position */
 
-      vi->text[vi->curpos++] = ch;
+      VI_TEXT(vi, vi->curpos) = ch;
+      vi_textchanged(vi, vi->curpos);
+      vi->curpos++;
       vi->redrawline = true;
     }
 }
@@ -5065,7 +5419,7 @@ static void vi_findinline_mode(FAR struct vi_s *vi)
   pos = vi->curpos + 1;
   count = vi->value > 0 ? vi->value : 1;
 
-  while (count > 0 && pos < vi->textsize - 1 && vi->text[pos] != '\n')
+  while (count > 0 && pos < vi->textsize - 1 && VI_TEXT(vi, pos) != '\n')
     {
       /* Increment to next character */
 
@@ -5073,7 +5427,7 @@ static void vi_findinline_mode(FAR struct vi_s *vi)
 
       /* Test if this character matches */
 
-      if (vi->text[pos] == ch)
+      if (VI_TEXT(vi, pos) == ch)
         {
           count--;
         }
@@ -5160,7 +5514,8 @@ static void vi_insertch(FAR struct vi_s *vi, char ch)
     {
       /* Add the new character to the buffer */
 
-      vi->text[vi->curpos++] = ch;
+      VI_TEXT(vi, vi->curpos) = ch;
+      vi->curpos++;
     }
 }
 
@@ -5260,7 +5615,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
           if (vi->cursor.column + 1 < vi->display.column && ch != '\t' &&
               (vi->curpos + 1 == vi->textsize ||
-               vi->text[vi->curpos + 1] == '\n'))
+               VI_TEXT(vi, vi->curpos + 1) == '\n'))
             {
               vi_putch(vi, ch);
             }
@@ -5295,7 +5650,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
             {
               if (vi->curpos < vi->textsize)
                 {
-                  if (vi->text[vi->curpos] == '\n')
+                  if (VI_TEXT(vi, vi->curpos) == '\n')
                     {
                       vi->drawtoeos = true;
                     }
@@ -5315,7 +5670,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
                   if (vi->curpos > 0)
                     {
-                      if (vi->text[vi->curpos - 1] == '\n')
+                      if (VI_TEXT(vi, vi->curpos - 1) == '\n')
                         {
                           vi->drawtoeos = true;
                         }
@@ -5342,7 +5697,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
               /* Move cursor 1 space to the left when exiting insert mode */
 
-              if (vi->curpos > 0 && vi->text[vi->curpos - 1] != '\n')
+              if (vi->curpos > 0 && VI_TEXT(vi, vi->curpos - 1) != '\n')
                 {
                   --vi->curpos;
                 }
@@ -5463,6 +5818,11 @@ static void vi_release(FAR struct vi_s *vi)
           free(vi->text);
         }
 
+      if (vi->lineidx)
+        {
+          free(vi->lineidx);
+        }
+
       if (vi->yank)
         {
           free(vi->yank);
@@ -5657,9 +6017,7 @@ int main(int argc, FAR char *argv[])
 
   if (vi->text == NULL)
     {
-      vi_extendtext(vi, 0, TEXT_GULP_SIZE);
-      vi->textsize = 0;
-      vi->modified = 0;
+      vi_growgap(vi, TEXT_GULP_SIZE);
     }
 
   if (optind != argc)